@@ -0,0 +1,71 @@
+/*
+ * fuzz_image — feed arbitrary bytes to the image decoders.
+ *
+ * Two entry points over the same body:
+ *
+ *   libFuzzer   build with -DHOST_LIBFUZZER -fsanitize=fuzzer
+ *   files       build/host/fuzz_image <file>...  (AFL's @@, valgrind,
+ *               replaying a crash); the exit status is the number of
+ *               files that failed to read
+ *
+ * Every input goes through image_load and then straight into each
+ * decoder, so all three see it, not just the one the magic bytes pick.
+ */
+#include "types.h"
+#include "heap.h"
+#include "image.h"
+#include "vga.h"
+#include "host_os.h"
+
+#define FUZZ_HEAP_SIZE (16 * 1024 * 1024)
+
+static void fuzz_setup(void) {
+    static bool ready;
+    if (ready) return;
+    heap_init(host_alloc(FUZZ_HEAP_SIZE, 4096), FUZZ_HEAP_SIZE);
+    ready = true;
+}
+
+static void check(const image_t* img, bool ok) {
+    if (!ok) return;
+    /* Touch the corners so a bogus size or pixel pointer faults here */
+    if (img->width <= 0 || img->height <= 0 ||
+        img->width > IMG_MAX_W || img->height > IMG_MAX_H)
+        __builtin_trap();
+    volatile uint32_t sink = img->pixels[0];
+    sink = img->pixels[img->width * img->height - 1];
+    (void)sink;
+}
+
+static void fuzz_one(const uint8_t* data, uint32_t size) {
+    image_t img;
+    check(&img, image_load(&img, data, size, "fuzz"));
+    check(&img, image_load_png(&img, data, size));
+    check(&img, image_load_bmp(&img, data, size));
+    check(&img, image_load_tga(&img, data, size));
+}
+
+#ifdef HOST_LIBFUZZER
+
+int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    fuzz_setup();
+    fuzz_one(data, (uint32_t)size);
+    return 0;
+}
+
+#else
+
+int main(int argc, char** argv) {
+    int failed = 0;
+    fuzz_setup();
+    for (int i = 1; i < argc; i++) {
+        uint32_t size;
+        uint8_t* data = host_read_file(argv[i], &size);
+        if (!data) { kprintf("fuzz_image: cannot read %s\n", argv[i]); failed++; continue; }
+        fuzz_one(data, size);
+        host_free(data);
+    }
+    return failed;
+}
+
+#endif
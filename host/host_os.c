@@ -0,0 +1,90 @@
+/*
+ * Host build — libc services behind host_os.h.  See host_os.h for why
+ * this is the only file allowed to include libc headers.
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "host_os.h"
+
+#define SECTOR_SIZE 512
+
+static unsigned char* disk_data;
+static unsigned int   disk_size;
+
+void host_vprintf(int to_stderr, const char* fmt, __builtin_va_list ap) {
+    vfprintf(to_stderr ? stderr : stdout, fmt, ap);
+}
+
+const char* host_getenv(const char* name) {
+    return getenv(name);
+}
+
+int host_getenv_int(const char* name, int def) {
+    const char* v = getenv(name);
+    return v && *v ? atoi(v) : def;
+}
+
+unsigned long long host_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void* host_alloc(unsigned int size, unsigned int align) {
+    void* p = NULL;
+    if (posix_memalign(&p, align < sizeof(void*) ? sizeof(void*) : align, size))
+        return NULL;
+    memset(p, 0, size);
+    return p;
+}
+
+void host_free(void* p) {
+    free(p);
+}
+
+void* host_read_file(const char* path, unsigned int* size) {
+    FILE* f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long len = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    void* buf = len > 0 ? malloc(len) : NULL;
+    if (!buf || fread(buf, 1, len, f) != (size_t)len) {
+        free(buf);
+        fclose(f);
+        return NULL;
+    }
+    fclose(f);
+    *size = (unsigned int)len;
+    return buf;
+}
+
+int host_disk_open(const char* path) {
+    free(disk_data);
+    disk_data = host_read_file(path, &disk_size);
+    if (!disk_data) {
+        fprintf(stderr, "host: cannot read disk image %s\n", path);
+        return -1;
+    }
+    return 0;
+}
+
+unsigned int host_disk_sectors(void) {
+    return disk_size / SECTOR_SIZE;
+}
+
+int host_disk_read(unsigned int lba, void* buf) {
+    if (!disk_data || lba >= host_disk_sectors()) return -1;
+    memcpy(buf, disk_data + (size_t)lba * SECTOR_SIZE, SECTOR_SIZE);
+    return 0;
+}
+
+int host_disk_write(unsigned int lba, const void* buf) {
+    if (!disk_data || lba >= host_disk_sectors()) return -1;
+    memcpy(disk_data + (size_t)lba * SECTOR_SIZE, buf, SECTOR_SIZE);
+    return 0;
+}
@@ -0,0 +1,28 @@
+#ifndef HOST_OS_H
+#define HOST_OS_H
+
+/*
+ * Host build — the libc side of the shim.
+ *
+ * Kernel modules are compiled unchanged against include/types.h, which
+ * clashes with libc headers, so nothing that sees kernel headers may
+ * include libc.  host_os.c is the one translation unit that does; these
+ * declarations only use basic C types so both sides can share them.
+ */
+
+void               host_vprintf(int to_stderr, const char* fmt, __builtin_va_list ap);
+int                host_getenv_int(const char* name, int def);
+const char*        host_getenv(const char* name);
+unsigned long long host_now_ns(void);
+
+void*              host_alloc(unsigned int size, unsigned int align);
+void               host_free(void* p);
+void*              host_read_file(const char* path, unsigned int* size);
+
+/* Disk image, loaded whole: writes land in memory, never in the file */
+int                host_disk_open(const char* path);     /* 0 on success */
+unsigned int       host_disk_sectors(void);
+int                host_disk_read(unsigned int lba, void* buf);
+int                host_disk_write(unsigned int lba, const void* buf);
+
+#endif
@@ -0,0 +1,243 @@
+/*
+ * hostbench — throughput benchmarks for the portable kernel modules,
+ * run natively on the host (see host/shim.c).
+ *
+ * Usage: build/host/hostbench [-d disk.img] [-i image]... [bench]...
+ *
+ * Benchmarks: kmalloc kmalloc_mix ramfs image minigl disk.  With no names
+ * everything runs.  Each result is one line:
+ *
+ *   HOSTBENCH <name> ops=<n> ns_per_op=<n> mbps=<n>
+ *
+ * Ops counts scale with HOST_SCALE (default 1) for longer perf/valgrind
+ * sessions.
+ */
+#include "types.h"
+#include "heap.h"
+#include "ramfs.h"
+#include "image.h"
+#include "minigl.h"
+#include "fat16.h"
+#include "ntfs.h"
+#include "vga.h"
+#include "host_os.h"
+
+#define HOST_HEAP_SIZE  (96 * 1024 * 1024)
+#define MAX_IMAGES      8
+
+static uint32_t scale = 1;
+static const char* disk_path = "ntfs.img";
+static const char* image_paths[MAX_IMAGES];
+static int num_images;
+
+static void report(const char* name, uint32_t ops, uint64_t ns, uint64_t bytes) {
+    uint64_t per_op = ops ? ns / ops : 0;
+    uint64_t mbps = (bytes && ns) ? bytes * 1000ULL / ns : 0;   /* bytes/us */
+    kprintf("HOSTBENCH %s ops=%u ns_per_op=%u mbps=%u\n",
+            name, ops, (uint32_t)per_op, (uint32_t)mbps);
+}
+
+/* ===== kmalloc ===== */
+
+static void bench_kmalloc(void) {
+    uint32_t ops = 1000000 * scale;
+    uint64_t t0 = host_now_ns();
+    for (uint32_t i = 0; i < ops; i++) {
+        void* p = kmalloc(64);
+        kfree(p);
+    }
+    report("kmalloc", ops, host_now_ns() - t0, 0);
+}
+
+/* Mixed sizes with a live set, which is what fragments a first-fit heap */
+#define MIX_SLOTS 1024
+
+static void bench_kmalloc_mix(void) {
+    static void* slots[MIX_SLOTS];
+    uint32_t ops = 200000 * scale;
+    uint32_t seed = 12345;
+
+    uint64_t t0 = host_now_ns();
+    for (uint32_t i = 0; i < ops; i++) {
+        seed = seed * 1103515245 + 12345;
+        uint32_t s = (seed >> 8) % MIX_SLOTS;
+        if (slots[s]) { kfree(slots[s]); slots[s] = NULL; }
+        else          slots[s] = kmalloc(16 + ((seed >> 4) & 4095));
+    }
+    uint64_t ns = host_now_ns() - t0;
+    for (int s = 0; s < MIX_SLOTS; s++)
+        if (slots[s]) { kfree(slots[s]); slots[s] = NULL; }
+    report("kmalloc_mix", ops, ns, 0);
+}
+
+/* ===== ramfs ===== */
+
+static void bench_ramfs(void) {
+    static uint8_t buf[4096];
+    uint32_t ops = 100000 * scale;
+    memset(buf, 'r', sizeof(buf));
+
+    uint64_t t0 = host_now_ns();
+    for (uint32_t i = 0; i < ops; i++) {
+        ramfs_write("/bench.dat", buf, sizeof(buf));
+        ramfs_read("/bench.dat", buf, sizeof(buf));
+    }
+    report("ramfs", ops, host_now_ns() - t0, (uint64_t)ops * 2 * sizeof(buf));
+    ramfs_delete("/bench.dat");
+}
+
+/* ===== image decode ===== */
+
+static void bench_image(void) {
+    for (int n = 0; n < num_images; n++) {
+        uint32_t size;
+        uint8_t* data = host_read_file(image_paths[n], &size);
+        if (!data) { kprintf("hostbench: cannot read %s\n", image_paths[n]); continue; }
+
+        image_t img;
+        if (!image_load(&img, data, size, image_paths[n])) {
+            kprintf("hostbench: %s does not decode\n", image_paths[n]);
+            host_free(data);
+            continue;
+        }
+
+        uint32_t ops = 20 * scale;
+        uint64_t t0 = host_now_ns();
+        for (uint32_t i = 0; i < ops; i++)
+            image_load(&img, data, size, image_paths[n]);
+        uint64_t ns = host_now_ns() - t0;
+
+        char name[64];
+        const char* base = image_paths[n];
+        for (const char* p = base; *p; p++) if (*p == '/') base = p + 1;
+        strcpy(name, "image:");
+        strncpy(name + 6, base, sizeof(name) - 7);
+        name[sizeof(name) - 1] = '\0';
+        /* Throughput in decoded pixel bytes */
+        report(name, ops, ns, (uint64_t)ops * img.width * img.height * 4);
+        host_free(data);
+    }
+}
+
+/* ===== MiniGL fill ===== */
+
+#define GL_W 640
+#define GL_H 480
+
+static void bench_minigl(void) {
+    uint32_t* fb = (uint32_t*)kmalloc(GL_W * GL_H * 4);
+    if (!fb) return;
+    glInit(fb, GL_W, GL_H);
+    glEnable(GL_DEPTH_TEST);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(-1, 1, -1, 1, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+
+    uint32_t ops = 200 * scale;
+    uint64_t t0 = host_now_ns();
+    for (uint32_t i = 0; i < ops; i++) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glBegin(GL_QUADS);
+        glColor3f(0.2f, 0.6f, 1.0f);
+        glVertex3f(-1, -1, 0); glVertex3f(1, -1, 0);
+        glVertex3f(1, 1, 0);   glVertex3f(-1, 1, 0);
+        glEnd();
+    }
+    report("minigl", ops, host_now_ns() - t0, (uint64_t)ops * GL_W * GL_H * 4);
+    glClose();
+    kfree(fb);
+}
+
+/* ===== Filesystem read throughput on the disk image ===== */
+
+#define MAX_DIRENTS 64
+
+static void bench_disk(void) {
+    if (host_disk_open(disk_path) != 0) return;
+
+    static uint8_t filebuf[4 * 1024 * 1024];
+    uint64_t bytes = 0;
+    uint32_t files = 0;
+    uint32_t rounds = 4 * scale;
+    uint64_t t0;
+
+    if (fat16_mount_drive(0)) {
+        static fat16_dirent_t ents[MAX_DIRENTS];
+        int n = fat16_list_dir("/", ents, MAX_DIRENTS);
+        t0 = host_now_ns();
+        for (uint32_t r = 0; r < rounds; r++)
+            for (int i = 0; i < n; i++) {
+                if (ents[i].is_dir) continue;
+                char path[64] = "/";
+                strncpy(path + 1, ents[i].name, sizeof(path) - 2);
+                int32_t got = fat16_read_file(path, filebuf, sizeof(filebuf));
+                if (got > 0) { bytes += got; files++; }
+            }
+        report("disk:fat16", files, host_now_ns() - t0, bytes);
+    } else if (ntfs_mount_drive(0)) {
+        static ntfs_dirent_t ents[MAX_DIRENTS];
+        int n = ntfs_list_dir("/", ents, MAX_DIRENTS);
+        t0 = host_now_ns();
+        for (uint32_t r = 0; r < rounds; r++)
+            for (int i = 0; i < n; i++) {
+                if (ents[i].is_dir || ents[i].name[0] == '$') continue;
+                char path[300] = "/";
+                strncpy(path + 1, ents[i].name, sizeof(path) - 2);
+                int32_t got = ntfs_read_file(path, filebuf, sizeof(filebuf));
+                if (got > 0) { bytes += got; files++; }
+            }
+        report("disk:ntfs", files, host_now_ns() - t0, bytes);
+    } else {
+        kprintf("hostbench: %s has no FAT16 or NTFS volume\n", disk_path);
+    }
+}
+
+/* ===== Driver ===== */
+
+typedef struct {
+    const char* name;
+    void (*fn)(void);
+} hostbench_t;
+
+static const hostbench_t benches[] = {
+    { "kmalloc",     bench_kmalloc },
+    { "kmalloc_mix", bench_kmalloc_mix },
+    { "ramfs",       bench_ramfs },
+    { "image",       bench_image },
+    { "minigl",      bench_minigl },
+    { "disk",        bench_disk },
+    { NULL, NULL }
+};
+
+int main(int argc, char** argv) {
+    const char* names[16];
+    int num_names = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-d") == 0 && i + 1 < argc) disk_path = argv[++i];
+        else if (strcmp(argv[i], "-i") == 0 && i + 1 < argc) {
+            if (num_images < MAX_IMAGES) image_paths[num_images++] = argv[++i];
+        } else if (num_names < 16) names[num_names++] = argv[i];
+    }
+    if (!num_images) {
+        image_paths[num_images++] = "b1.png";
+        image_paths[num_images++] = "wayfire.png";
+    }
+    scale = (uint32_t)host_getenv_int("HOST_SCALE", 1);
+    if (!scale) scale = 1;
+
+    void* heap = host_alloc(HOST_HEAP_SIZE, 4096);
+    if (!heap) return 1;
+    heap_init(heap, HOST_HEAP_SIZE);
+    ramfs_init();
+
+    for (int b = 0; benches[b].name; b++) {
+        bool run = num_names == 0;
+        for (int i = 0; i < num_names; i++)
+            if (strcmp(names[i], benches[b].name) == 0) run = true;
+        if (run) benches[b].fn();
+    }
+    return 0;
+}
@@ -0,0 +1,100 @@
+/*
+ * Host build — kernel-side shim.
+ *
+ * Provides the few kernel services the portable modules (heap, ramfs,
+ * image, minigl, fat16, ntfs) call, on top of host_os.c:
+ *
+ *   console      kprintf/terminal -> stdout, serial_printf -> stderr
+ *                (serial only with HOST_SERIAL=1; image.c is chatty)
+ *   timer        100 Hz ticks from CLOCK_MONOTONIC
+ *   ATA          drive 0 = in-memory copy of a disk image
+ *   PMM          page-aligned host allocations
+ *   procfs       absent
+ */
+#include "types.h"
+#include "vga.h"
+#include "serial.h"
+#include "timer.h"
+#include "ata.h"
+#include "pmm.h"
+#include "procfs.h"
+#include "host_os.h"
+
+typedef __builtin_va_list va_list;
+#define va_start(ap, last) __builtin_va_start(ap, last)
+#define va_end(ap)         __builtin_va_end(ap)
+
+/* ===== Console ===== */
+
+void kprintf(const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    host_vprintf(0, fmt, ap);
+    va_end(ap);
+}
+
+void serial_printf(const char* fmt, ...) {
+    static int verbose = -1;
+    if (verbose < 0) verbose = host_getenv_int("HOST_SERIAL", 0);
+    if (!verbose) return;
+    va_list ap;
+    va_start(ap, fmt);
+    host_vprintf(1, fmt, ap);
+    va_end(ap);
+}
+
+void terminal_print_colored(const char* str, uint8_t color) {
+    (void)color;
+    kprintf("%s", str);
+}
+
+/* ===== Timer ===== */
+
+static uint64_t ns_per_tick(void) { return 1000000000ULL / 100; }
+
+uint32_t timer_get_ticks(void) {
+    return (uint32_t)(host_now_ns() / ns_per_tick());
+}
+
+/* ===== ATA: drive 0 is the disk image ===== */
+
+bool ata_drive_present(int idx) {
+    return idx == 0 && host_disk_sectors() > 0;
+}
+
+bool ata_read_sector_drv(int idx, uint32_t lba, void* buffer) {
+    return idx == 0 && host_disk_read(lba, buffer) == 0;
+}
+
+bool ata_write_sector_drv(int idx, uint32_t lba, const void* buffer) {
+    return idx == 0 && host_disk_write(lba, buffer) == 0;
+}
+
+/* ===== PMM ===== */
+
+void* pmm_alloc_page(void) {
+    return host_alloc(4096, 4096);
+}
+
+void pmm_free_page(void* addr) {
+    host_free(addr);
+}
+
+/* ===== procfs: not part of the host build ===== */
+
+bool procfs_is_virtual(const char* path) {
+    (void)path;
+    return false;
+}
+
+int32_t procfs_read(const char* path, void* buf, uint32_t max) {
+    (void)path; (void)buf; (void)max;
+    return -1;
+}
+
+void procfs_list(void) {}
+
+int32_t procfs_stat(const char* path, ramfs_type_t* type, uint32_t* size) {
+    (void)path; (void)type; (void)size;
+    return -1;
+}
@@ -15,6 +15,13 @@ typedef struct {
     char     serial[21];
 } ata_drive_t;
 
+/* Sector counters since boot, both drives */
+typedef struct {
+    uint32_t sectors_read;
+    uint32_t sectors_written;
+    uint32_t errors;                /* Timeouts and device errors */
+} ata_stats_t;
+
 void         ata_init(void);
 
 /* Legacy single-drive API (drive 0 = primary master) */
@@ -37,5 +44,6 @@ bool ata_read_sector(uint32_t lba, void* buffer);
 bool ata_write_sector(uint32_t lba, const void* buffer);
 
 void ata_print_info(void);
+void ata_get_stats(ata_stats_t* st);
 
 #endif
@@ -0,0 +1,51 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include "types.h"
+
+/*
+ * In-kernel microbenchmark suite.
+ *
+ * Each benchmark takes a fixed number of TSC-timed samples; a sample
+ * covers 'ops' operations (batched when one op is too short to time).
+ * Results are per operation: min, median and p99 in cycles and ns,
+ * plus MB/s for benchmarks that move data.
+ *
+ * Every result is also written to serial as one machine-readable line:
+ *
+ *   BENCH <name> ops=<n> samples=<n> min=<cyc> med=<cyc> p99=<cyc> med_ns=<ns> mbps=<n>
+ *
+ * framed by "BENCH_BEGIN tsc_khz=<khz>" and "BENCH_END failed=<n>", so
+ * a host script can diff runs across kernel versions.
+ */
+
+#define BENCH_MAX_SAMPLES 256
+
+typedef struct {
+    const char* name;
+    const char* desc;
+    uint32_t    samples;        /* Samples to take */
+    uint32_t    ops;            /* Operations per sample */
+    uint32_t    bytes;          /* Bytes moved per sample (0 = n/a) */
+    bool        (*setup)(void); /* false = skip (device absent etc.) */
+    uint32_t    (*sample)(void);/* Cycles for one sample, 0 = failure */
+    void        (*teardown)(void);
+} bench_t;
+
+typedef struct {
+    uint32_t min, median, p99;  /* Cycles per op */
+    uint32_t median_ns;
+    uint32_t mbps;              /* 0 unless the benchmark moves data */
+    uint32_t samples;
+} bench_result_t;
+
+/* Run one benchmark by name; prints its line.  Returns false if unknown,
+ * skipped or failed. */
+bool bench_run(const char* name, bench_result_t* out);
+
+/* Run every registered benchmark; returns the number that failed */
+int  bench_run_all(void);
+
+void bench_list(void);
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef BOOTPROF_H
+#define BOOTPROF_H
+
+#include "types.h"
+
+/*
+ * Boot profiler — TSC timestamps for every boot stage.
+ *
+ * kernel_main() marks the end of each stage; device probes that do not
+ * gate the shell are handed to bootprof_defer() and run as kernel tasks
+ * while the rest of boot continues.  Everything is reported through
+ * /proc/boottime in microseconds since bootprof_init().
+ */
+
+#define BOOTPROF_MAX_STAGES  48
+#define BOOTPROF_MAX_PROBES  8
+#define BOOTPROF_NAME_LEN    40
+
+typedef void (*bootprof_probe_t)(void);
+
+void    bootprof_init(void);                /* First thing in kernel_main */
+void    bootprof_mark(const char* stage);   /* A stage just finished */
+
+/* Run 'probe' in its own kernel task; returns its pid or -1.  If no task
+ * can be created the probe runs synchronously instead. */
+int32_t bootprof_defer(const char* name, bootprof_probe_t probe);
+bool    bootprof_probes_done(void);
+
+/* Render the report (for /proc/boottime) */
+int     bootprof_format(char* buf, int max);
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef CHAN_H
+#define CHAN_H
+
+#include "types.h"
+
+/*
+ * Shared-memory channels — single-producer/single-consumer rings for
+ * streaming between two tasks without a syscall per message.
+ *
+ * A channel is one header page plus a power-of-two data area, mapped
+ * into the kernel at CHAN_KVBASE and into each end that has its own
+ * address space at CHAN_UVADDR (slot id * CHAN_SLOT_SIZE in both).
+ * Records are a 32-bit length followed by the payload, padded to four
+ * bytes; head and tail are free-running byte counts.
+ *
+ * The kernel window sits inside the identity map, so boot reserves the
+ * physical frames behind it (CHAN_KVSIZE) and the PMM never hands them
+ * out; closing a channel puts the identity mapping back.
+ *
+ * The kernel is only involved to sleep.  An end that finds the ring
+ * empty (or full) publishes how far it has got in data_event (or
+ * space_event) and blocks in receive; the other end sends an
+ * ipc_notify() doorbell only when its update crosses that index, as
+ * with virtio's event index.  While both ends keep up, no doorbells are
+ * sent at all.
+ */
+
+#define CHAN_MAX            16
+#define CHAN_MAX_DATA_PAGES 8           /* Power of two */
+#define CHAN_SLOT_SIZE      0x10000     /* Header page + data, per channel */
+#define CHAN_UVADDR         0xA8000000  /* User-space VA of slot 0 */
+#define CHAN_KVBASE         0x26000000  /* Kernel VA of slot 0 */
+#define CHAN_KVSIZE         (CHAN_MAX * CHAN_SLOT_SIZE)
+#define CHAN_DATA_OFFSET    4096
+
+/* SYS_CHAN_CREATE flags */
+#define CHAN_CREATOR_CONSUMES 0x1       /* Default: the creator produces */
+
+typedef struct {
+    /* Written by the producer */
+    volatile uint32_t head;             /* Bytes produced */
+    volatile uint32_t space_event;      /* Producer sleeps until tail passes this */
+    uint32_t          pad0[14];
+
+    /* Written by the consumer (its own cache line) */
+    volatile uint32_t tail;             /* Bytes consumed */
+    volatile uint32_t data_event;       /* Consumer sleeps until head passes this */
+    uint32_t          pad1[14];
+
+    /* Written by the kernel; informational only, the kernel never reads
+     * them back */
+    uint32_t          id;
+    uint32_t          size;             /* Data bytes */
+    uint32_t          producer;         /* PIDs of the two ends */
+    uint32_t          consumer;
+    volatile uint32_t closed;           /* One end has closed or exited */
+} chan_ring_t;
+
+/* The doorbell is due if moving an index from old to new crossed the
+ * event index the sleeper published */
+static inline bool chan_need_event(uint32_t event, uint32_t new_idx, uint32_t old_idx) {
+    return (uint32_t)(new_idx - event - 1) < (uint32_t)(new_idx - old_idx);
+}
+
+/* Kernel side (syscalls, task exit) */
+int32_t      chan_create(uint32_t creator, uint32_t peer, uint32_t data_pages, uint32_t flags);
+chan_ring_t* chan_map(uint32_t id, uint32_t pid);   /* Ring address for pid, or NULL */
+int32_t      chan_close(uint32_t id, uint32_t pid);
+void         chan_task_exit(uint32_t pid);
+
+/* Ring operations for kernel tasks (userlib has the ring 3 versions).
+ * They take the channel id rather than the ring, since the header's
+ * kernel fields are writable by a user end; the caller must be the
+ * producer (chan_write) or consumer (chan_read).  chan_write blocks
+ * while the ring is full, chan_read while it is empty; both return -1
+ * once the other end has closed.  chan_read returns the bytes copied:
+ * at most max, with the rest of a longer record discarded. */
+int32_t chan_write(uint32_t id, const void* data, uint32_t len);
+int32_t chan_read(uint32_t id, void* buf, uint32_t max);
+
+#endif
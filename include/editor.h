@@ -3,8 +3,8 @@
 
 #include "types.h"
 
-#define EDITOR_MAX_LINES 100
-#define EDITOR_LINE_LEN  80
+#define EDITOR_GAP_MIN   4096   /* Spare bytes kept in the text gap */
+#define EDITOR_LINES_MIN 256    /* Spare line index entries */
 
 void editor_open(const char* filename);
 
@@ -80,6 +80,8 @@ typedef struct {
 #define USER_STACK_TOP  0xE0000000  /* Move stack much higher */
 #define USER_STACK_PAGES 4          /* 16KB user stack */
 #define USER_VGA_VADDR  0xB0000000  /* VGA memory mapped here for console server */
+#define USER_HEAP_BASE  0xD0000000  /* sbrk() heap grows up from here */
+#define USER_HEAP_LIMIT 0xDF000000  /* ...and stops well short of the stack */
 
 /* Physical address of VGA text buffer */
 #define VGA_PHYS_BASE   0xB8000
@@ -88,8 +90,58 @@ typedef struct {
 
 #define ELF_MAP_VGA     (1 << 0)    /* Map VGA framebuffer into address space */
 
+/* ---- File handle ---- */
+
+/*
+ * Source of an ELF image.  Segments are copied (or mapped in place)
+ * straight from `data`; the loader never makes its own copy of the file.
+ *
+ *   staged: `data` is a heap copy owned by the handle (disk-backed files,
+ *           which have no offset read) and is released by elf_close().
+ *   stable: the backing pages outlive every process (boot modules), so
+ *           page-aligned read-only pages may be shared instead of copied.
+ *   node/version: ramfs identity used by the image cache (node < 0 means
+ *           the file is not cacheable).
+ */
+typedef struct {
+    const uint8_t* data;
+    uint32_t       size;
+    bool           staged;
+    bool           stable;
+    int32_t        node;
+    uint32_t       version;
+} elf_file_t;
+
+/* ---- Image cache ----
+ *
+ * Parsed program headers and read-only (text/rodata) frames of recently
+ * launched ramfs executables.  A warm launch maps the cached frames
+ * shared and only builds private data/BSS/stack pages.  Entries are
+ * keyed by (ramfs node, version, size) and retired when the file
+ * changes; frames are freed once the last process using them exits.
+ */
+#define ELF_CACHE_SLOTS     8
+#define ELF_CACHE_MAX_LOADS 8       /* PT_LOAD headers kept per image */
+#define ELF_CACHE_MAX_SPAN  4096    /* Pages from first to last read-only page */
+
 /* ---- API ---- */
 
+/*
+ * Open an ELF file by path.  ramfs files are referenced in place;
+ * /disk and /disk2 files are read once into a staging buffer.
+ * Returns 0 on success, -1 if missing, -2 if empty/not a file, -3 on OOM.
+ */
+int elf_open(const char* path, elf_file_t* file);
+
+/* Wrap an image already in kernel memory (e.g. a multiboot module). */
+void elf_open_mem(const void* data, uint32_t size, bool stable, elf_file_t* file);
+
+/* Release a handle from elf_open()/elf_open_mem(). */
+void elf_close(elf_file_t* file);
+
+/* Drop a process's reference on a cached image (task exit/kill). */
+void elf_image_release(uint32_t handle);
+
 /*
  * Validate an ELF binary in memory.
  * Returns 0 if valid, -1 if not.
@@ -99,8 +151,7 @@ int elf_validate(const void* data, uint32_t size);
 /*
  * Load an ELF binary and create a new task for it.
  *
- * data:          Pointer to ELF binary in kernel memory
- * size:          Size of ELF binary in bytes
+ * file:          Open ELF handle (see elf_open)
  * name:          Task name (for ps/debugging)
  * priority:      Scheduler priority
  * io_privileged: If true, set IOPL=3 for port I/O access
@@ -108,7 +159,7 @@ int elf_validate(const void* data, uint32_t size);
  *
  * Returns PID on success, -1 on failure.
  */
-int32_t elf_load(const void* data, uint32_t size, const char* name,
+int32_t elf_load(const elf_file_t* file, const char* name,
                  uint32_t priority, bool io_privileged, uint32_t flags);
 
 #endif
@@ -27,8 +27,12 @@ typedef void (*isr_t)(registers_t*);
 
 void idt_init(void);
 void register_interrupt_handler(uint8_t n, isr_t handler);
+isr_t get_interrupt_handler(uint8_t n);
 void irq_unmask(uint8_t irq);
 
+/* True while running inside an IRQ handler (must not block or yield) */
+bool irq_in_handler(void);
+
 /* IRQ routing — get the task PID that owns a given IRQ */
 extern uint32_t irq_get_owner(uint32_t irq);
 
@@ -0,0 +1,64 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include "types.h"
+
+/*
+ * Input event ring — one timestamped event stream for every input device.
+ *
+ * Producers are interrupt handlers (PS/2 keyboard, PS/2 mouse, virtio
+ * input); they never block or take a lock.  Consecutive motion events
+ * that nobody has read yet are coalesced into one, so a fast mouse
+ * cannot push keystrokes out of the ring.  Consumers either poll or
+ * sleep in input_read() until a producer wakes them.
+ *
+ * Pointer state (position, held buttons, click edges) is also kept
+ * current by the mouse driver, so a consumer only interested in keys
+ * may discard non-key events freely.
+ */
+
+#define INPUT_RING_SIZE  256        /* Power of two */
+
+/* Event types */
+#define INPUT_EV_KEY     1          /* code = ASCII or KEY_* */
+#define INPUT_EV_MOTION  2          /* x, y = new pointer position */
+#define INPUT_EV_BUTTON  3          /* code = button bit, value = pressed */
+
+/* Event sources */
+#define INPUT_SRC_PS2_KBD    0
+#define INPUT_SRC_PS2_MOUSE  1
+#define INPUT_SRC_VIRTIO     2
+#define INPUT_SRC_SERIAL     3
+
+typedef struct {
+    uint64_t tsc;                   /* timer_rdtsc() when it happened */
+    uint8_t  type;
+    uint8_t  source;
+    uint8_t  buttons;               /* Pointer buttons held (bit 0 = left) */
+    uint8_t  value;
+    uint16_t code;
+    int16_t  x, y;                  /* Pointer position after the event */
+} input_event_t;
+
+typedef struct {
+    uint32_t pushed;
+    uint32_t coalesced;
+    uint32_t dropped;               /* Ring full */
+} input_stats_t;
+
+void input_init(void);
+
+/* Producer side — call with interrupts disabled (IRQ handlers are) */
+void input_push(const input_event_t* ev);
+
+/* Consumer side */
+bool input_poll(input_event_t* ev);          /* Non-blocking, false if empty */
+bool input_peek(input_event_t* ev);          /* As input_poll, but leaves it */
+/* Block until an event arrives; timeout in ticks, 0 = forever */
+bool input_read(input_event_t* ev, uint32_t timeout);
+/* Block until the ring is non-empty without consuming anything */
+bool input_wait(uint32_t timeout);
+
+void input_get_stats(input_stats_t* st);
+
+#endif
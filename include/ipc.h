@@ -52,6 +52,7 @@
 #define MSG_REPLY           101
 #define MSG_REGISTER        102
 #define MSG_PING            103
+#define MSG_CHAN_DOORBELL   104     /* Shared-memory channel (chan.h), chan.id */
 
 /* Special PIDs */
 #define PID_ANY         0xFFFFFFFF  /* Receive from any sender */
@@ -89,6 +90,9 @@ typedef struct message {
             uint8_t  color;
             char     data[47];
         } cons;
+        struct {            /* Channel doorbell */
+            uint32_t id;
+        } chan;
     };
 } message_t;
 
@@ -97,6 +101,7 @@ typedef struct message {
 #define BLOCKED_SEND     1   /* Waiting for receiver to accept */
 #define BLOCKED_RECEIVE  2   /* Waiting for any sender */
 #define BLOCKED_SENDREC  3   /* Sent message, waiting for reply */
+#define BLOCKED_PIPE     4   /* Pipe full (writer) or empty (reader) */
 
 /* Kernel-side IPC functions (called from syscall handler) */
 void    ipc_init(void);
@@ -106,13 +111,42 @@ int32_t ipc_sendrec(uint32_t dest_pid, message_t* msg);
 int32_t ipc_reply(uint32_t dest_pid, message_t* msg);
 int32_t ipc_notify(uint32_t dest_pid, message_t* msg);
 
-/* Service registry — maps names to PIDs */
-#define MAX_SERVICES 16
-#define SERVICE_NAME_LEN 32
+/* Service registry — maps names to endpoints.
+ *
+ * An endpoint is a named slot in a hashed table, bound to the PID of the
+ * server behind it.  Clients resolve the name once (ipc_endpoint_open)
+ * and pass the returned handle anywhere a destination PID is accepted
+ * (send, sendrec, notify); the kernel maps it to the bound PID on each
+ * call.  When a server exits its endpoints are unbound but keep their
+ * handles, so a restarted server that creates the same name again is
+ * reached through handles clients already hold.  Slots are never freed.
+ *
+ * A bound endpoint belongs to its server: creating it again from another
+ * live task fails, so nobody can take over the handles clients hold.
+ * Opening a name nobody has created yet reserves a slot for it, but only
+ * up to MAX_UNBOUND_SERVICES of those, so stray names cannot crowd out
+ * real servers.
+ */
+#define MAX_SERVICES        64      /* Power of two */
+#define MAX_UNBOUND_SERVICES 16     /* Opened but never created */
+#define SERVICE_NAME_LEN    32
+#define IPC_ENDPOINT_BASE   0x40000000  /* Handle = base | slot; above any PID */
+
+#define IPC_IS_ENDPOINT(h)  ((h) >= IPC_ENDPOINT_BASE && (h) != PID_ANY)
+
+int32_t  ipc_endpoint_create(const char* name, uint32_t pid);  /* Bind; handle or -1 (full, or bound to another task) */
+int32_t  ipc_endpoint_open(const char* name);                  /* Handle, bound or not; -1 if full */
+void     ipc_task_exit(uint32_t pid);                          /* Unbind pid's endpoints */
+/* Endpoint handle -> bound PID in place (PIDs pass through); false if
+ * the handle is stale or unbound */
+bool     ipc_resolve(uint32_t* dest);
 
 int32_t  ipc_register_service(const char* name, uint32_t pid);
 uint32_t ipc_lookup_service(const char* name);
 void     ipc_service_list(void);
+/* Registry slot idx (0..MAX_SERVICES-1): name and pid of a bound
+ * endpoint, or NULL */
+const char* ipc_service_at(int idx, uint32_t* pid);
 
 /* Stats */
 uint32_t ipc_message_count(void);
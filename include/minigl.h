@@ -42,6 +42,13 @@ void glInit(uint32_t* framebuffer, uint16_t width, uint16_t height);
 void glSetTarget(uint32_t* framebuffer, uint16_t width, uint16_t height);
 void glClose(void);
 
+/* Borrow the rasteriser without disturbing its current user (e.g. a GUI
+ * GL window): glSaveContext() detaches the whole context and leaves it
+ * blank (NULL if out of memory); glRestoreContext() closes whatever was
+ * set up since and puts the saved one back. */
+void* glSaveContext(void);
+void  glRestoreContext(void* saved);
+
 /* ---- State ---- */
 void glEnable(int cap);
 void glDisable(int cap);
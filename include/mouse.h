@@ -11,10 +11,15 @@ bool mouse_left_held(void);
 bool mouse_right_held(void);
 bool mouse_left_click(void);   /* Edge-triggered: true once per press */
 bool mouse_right_click(void);
-void mouse_set_bounds(int max_x, int max_y);
 
-/* Poll for input events (call regularly from GUI loop).
- * Processes virtio-input events if PS/2 mouse is inactive. */
+/* Poll for input events.  Devices report from their IRQs; this only
+ * services a virtio-input device that has no usable interrupt. */
 void mouse_poll(void);
 
+/* Driver side: called by pointing devices (from IRQ context) with their
+ * new state.  Updates the pointer and pushes motion/button events into
+ * the input ring.  Buttons: bit 0 left, bit 1 right, bit 2 middle. */
+void mouse_report_rel(uint8_t source, int dx, int dy, uint8_t buttons);
+void mouse_report_abs(uint8_t source, int x, int y, uint8_t buttons);
+
 #endif
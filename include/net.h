@@ -75,11 +75,22 @@ typedef struct __attribute__((packed)) {
     uint16_t arcount;
 } dns_header_t;
 
+/* Interface counters since boot */
+typedef struct {
+    uint32_t rx_packets;
+    uint32_t rx_bytes;
+    uint32_t rx_errors;             /* Bad length or status in the RX ring */
+    uint32_t tx_packets;
+    uint32_t tx_bytes;
+    uint32_t tx_dropped;            /* Too long for a TX buffer */
+} net_stats_t;
+
 /* Network interface */
 void    net_init(void);
 bool    net_is_available(void);
 void    net_send_raw(const void* data, uint32_t len);
 void    net_poll(void);
+void    net_get_stats(net_stats_t* st);
 
 /* IP config */
 void    net_set_ip(uint8_t a, uint8_t b, uint8_t c, uint8_t d);
@@ -8,6 +8,7 @@
 #define PAGE_USER      0x004
 #define PAGE_4MB       0x080
 #define PAGE_CACHE_DISABLE   (1U << 4)
+#define PAGE_OWNED     0x200   /* OS-available bit: frame belongs to this address space */
 
 /* Initialize paging with identity-mapped kernel space */
 void paging_init(uint32_t mem_kb);
@@ -28,16 +29,24 @@ uint32_t* paging_create_address_space(void);
 uint32_t* paging_create_isolated_space(void);
 
 /* Destroy a process's page directory and free its page tables.
- * Does NOT free user-mapped physical frames — caller must do that. */
+ * Frames mapped with PAGE_OWNED are freed too; all other user-mapped
+ * frames (shared text, device memory, GUI buffers) are left to their owner. */
 void paging_destroy_address_space(uint32_t* pd);
 
+/* Frames an address space would free on destroy: the PD, private page
+ * tables and PAGE_OWNED pages */
+uint32_t paging_count_owned(const uint32_t* pd);
+
 /* Switch the active address space (load CR3) */
 void paging_switch(uint32_t* pd);
 
 /* Map a page in a specific page directory as user-accessible */
 void paging_map_user(uint32_t* page_dir, uint32_t virt, uint32_t phys, uint32_t flags);
 
-/* Unmap a page in a specific page directory */
+/* Read the PTE for virt in a specific page directory (0 if unmapped) */
+uint32_t paging_get_user_pte(uint32_t* page_dir, uint32_t virt);
+
+/* Unmap a page in a specific page directory (frees it if PAGE_OWNED) */
 void paging_unmap_user(uint32_t* pd, uint32_t virt);
 
 /* Get the kernel's page directory (for kernel tasks) */
@@ -0,0 +1,38 @@
+#ifndef PIPE_H
+#define PIPE_H
+
+#include "types.h"
+
+/*
+ * Kernel pipes — bounded ring buffers connecting pipeline stages.
+ *
+ * Each pipe has one writer and one reader.  Writes block while the ring
+ * is full, reads block while it is empty, so a pipeline runs in constant
+ * memory however much data flows through it.
+ *
+ *   pipe_read()  returns 0 (EOF) once the writer has closed and the ring
+ *                has drained.
+ *   pipe_write() returns -1 once the reader has closed (broken pipe).
+ *
+ * A task's standard streams are task_t.pipe_in / pipe_out (pipe id + 1,
+ * 0 = keyboard/console).  While pipe_out is set, everything the task
+ * prints through the terminal goes into that pipe instead of the screen.
+ */
+
+#define MAX_PIPES       8
+#define PIPE_BUF_SIZE   4096
+
+void    pipe_init(void);
+int32_t pipe_create(void);
+int32_t pipe_write(int32_t id, const void* buf, uint32_t len);
+int32_t pipe_read(int32_t id, void* buf, uint32_t max);
+void    pipe_close_read(int32_t id);
+void    pipe_close_write(int32_t id);
+
+/* Current task's stdin: -1 if it is not a pipe, else as pipe_read() */
+int32_t pipe_stdin_read(void* buf, uint32_t max);
+bool    pipe_stdin_is_pipe(void);
+/* Drop the current task's stdin early (reader done, e.g. head) */
+void    pipe_stdin_close(void);
+
+#endif
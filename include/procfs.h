@@ -3,9 +3,77 @@
 
 #include "types.h"
 #include "ramfs.h"
+#include "task.h"
 
 #define PROCFS_MAX_CONTENT 4096
 
+/*
+ * Binary statistics snapshot (SYS_STATS).  Every counter the text files
+ * show, copied in one pass with interrupts off so the values agree with
+ * each other.  Fields are only ever appended: readers check version and
+ * trust size for how much of the struct the kernel filled.
+ */
+#define PROC_STATS_VERSION 1
+
+typedef struct {
+    uint32_t pid;
+    uint32_t state;                 /* task_state_t */
+    uint32_t priority;
+    uint32_t cpu_ticks;
+    uint32_t switches;
+    uint32_t ipc_sent;
+    uint32_t ipc_received;
+    uint32_t page_faults;
+    uint32_t syscalls;
+    char     name[TASK_NAME_LEN];
+} proc_task_stats_t;
+
+typedef struct {
+    uint32_t version;               /* PROC_STATS_VERSION */
+    uint32_t size;                  /* Bytes filled in (a SYS_STATS caller's prefix) */
+    uint32_t ticks;
+    uint32_t tick_hz;
+
+    /* Scheduler */
+    uint32_t preemptive;
+    uint32_t quantum;               /* Ticks */
+    uint32_t switches;
+    uint32_t tasks;                 /* Entries used in task[] */
+    uint32_t tasks_by_state[5];     /* Indexed by task_state_t */
+
+    /* IPC */
+    uint32_t ipc_messages;
+    uint32_t ipc_services;
+
+    /* Memory */
+    uint32_t pages_total;
+    uint32_t pages_free;
+    uint32_t pages_used;
+    uint32_t heap_used;             /* Bytes */
+    uint32_t heap_free;
+
+    /* Disk (ATA, both drives) */
+    uint32_t disk_sectors_read;
+    uint32_t disk_sectors_written;
+    uint32_t disk_errors;
+
+    /* Network (eth0) */
+    uint32_t net_up;
+    uint32_t net_rx_packets;
+    uint32_t net_rx_bytes;
+    uint32_t net_rx_errors;
+    uint32_t net_tx_packets;
+    uint32_t net_tx_bytes;
+    uint32_t net_tx_dropped;
+
+    /* GPU */
+    uint32_t gpu_flush_rects;       /* 2D damage rectangles sent */
+    uint32_t gpu_submits;           /* virgl SUBMIT_3D batches */
+    uint32_t gpu_submit_bytes;
+
+    proc_task_stats_t task[MAX_TASKS];
+} proc_stats_t;
+
 /* Initialize /proc virtual filesystem */
 void procfs_init(void);
 
@@ -24,6 +92,9 @@ bool procfs_is_dir(const char* path);
 /* Stat a /proc entry: returns 0 on success */
 int32_t procfs_stat(const char* path, ramfs_type_t* type, uint32_t* size);
 
+/* Fill *s with a consistent snapshot of the system counters */
+void procfs_snapshot(proc_stats_t* s);
+
 /* Helper: kernel snprintf (supports %s %d %u %x %%) */
 int ksnprintf(char* buf, int max, const char* fmt, ...);
 
@@ -20,6 +20,7 @@ typedef struct {
     int32_t      parent;        /* Index of parent directory (-1 for root) */
     uint32_t     created;       /* Tick when created */
     uint32_t     modified;      /* Tick when last modified */
+    uint32_t     version;       /* Unique per content change (cache identity) */
 } ramfs_node_t;
 
 void     ramfs_init(void);
@@ -36,6 +37,9 @@ uint32_t ramfs_file_count(void);
 uint32_t ramfs_total_size(void);
 int32_t  ramfs_rename(const char* old_path, const char* new_path);
 ramfs_node_t* ramfs_get_node(int32_t idx);
+/* Direct pointer to a ramfs-resident file's bytes (NULL for /proc, disks,
+ * directories or missing files).  Valid until the file is next written. */
+const uint8_t* ramfs_get_data(const char* path, uint32_t* size);
 void     ramfs_get_path(int32_t idx, char* buf, uint32_t max);
 
 /* Current working directory */
@@ -13,4 +13,7 @@ void serial_printf(const char* fmt, ...);  /* To COM1 */
 char serial_read(uint16_t port);
 bool serial_received(uint16_t port);
 
+/* Feed bytes received on COM1 into the input ring as keystrokes */
+void serial_enable_input(void);
+
 #endif
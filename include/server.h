@@ -12,14 +12,16 @@
  * through synchronous IPC messages.
  *
  * Server lifecycle:
- *   1. Register service name (e.g., "console", "vfs", "ata")
+ *   1. Create its named endpoint (e.g., "console", "vfs", "ata")
  *   2. Optionally register for IRQ notifications
  *   3. Enter receive loop: receive message, process, reply
  *
  * Client pattern:
- *   1. Look up service PID: pid = sys_lookup_service("vfs")
- *   2. Send request: sys_sendrec(pid, &msg)
+ *   1. Open the endpoint once: ep = sys_endpoint_open("vfs")
+ *   2. Send request: sys_sendrec(ep, &msg)
  *   3. Result is in msg when sendrec returns
+ * The handle follows the server across restarts; userlib's endpoint_t
+ * does the caching.
  */
 
 /* Well-known service names */
@@ -46,7 +48,10 @@ void servers_wait_ready(void);
 /* Launch all servers — called from kernel_main */
 void servers_launch(void);
 
-/* Launch only servers not already loaded from ELF modules */
+/* Launch only servers not already loaded from ELF modules.  The
+ * network server is left out: it drives the NIC, so the boot-time NIC
+ * probe starts it (servers_launch_net) once the card is up. */
 void servers_launch_missing(void);
+void servers_launch_net(void);
 
 #endif
@@ -9,9 +9,9 @@
  * The minimal microkernel syscall interface:
  *   - IPC (send, receive, sendrec, reply, notify)
  *   - Task management (exit, getpid, sleep)
- *   - Memory (malloc, free - temporary, will be replaced by VMM grants)
+ *   - Memory (sbrk for ring 3 tasks; malloc/free into the kernel heap)
  *   - I/O privileges (grant_io, register_irq)
- *   - Service registry (register_service, lookup_service)
+ *   - Service registry (register_service, lookup_service, endpoints)
  *   - Legacy I/O (write, read - for direct console during boot)
  */
 
@@ -29,6 +29,7 @@
 #define SYS_EXEC            11
 #define SYS_GET_TIME        12
 #define SYS_GET_TICKS       13   /* NEW: Get timer ticks */
+#define SYS_SBRK            14   /* Grow/shrink the task's own heap (ebx=increment) */
 /* IPC syscalls — the core microkernel interface */
 #define SYS_SEND            20  /* Send message, block until received */
 #define SYS_RECEIVE         21  /* Block until message arrives */
@@ -42,6 +43,11 @@
 #define SYS_GRANT_IO        32  /* Grant I/O port access to a task */
 #define SYS_REGISTER_IRQ    33  /* Register to receive IRQ notifications */
 #define SYS_CREATE_TASK     34  /* Create a new ring 3 task */
+#define SYS_ENDPOINT_CREATE 35  /* Create/rebind a named endpoint to the caller (ebx=name) -> handle */
+#define SYS_ENDPOINT_OPEN   36  /* Get the handle for a named endpoint (ebx=name) -> handle */
+#define SYS_CHAN_CREATE     37  /* Shared ring with a peer (ebx=pid/handle, ecx=data pages, edx=flags) -> id */
+#define SYS_CHAN_MAP        38  /* Address of channel ebx in the caller's space, 0 if not an end */
+#define SYS_CHAN_CLOSE      39  /* Release the caller's end of channel ebx */
 
 /* Server-support syscalls — allow isolated servers to access kernel services.
  * These bridge the gap until drivers are fully self-contained in userspace.
@@ -82,6 +88,13 @@
 #define SYS_GPU3D_MVP       74  /* Set MVP matrix (ebx=ptr to 16 floats) */
 #define SYS_GPU3D_DRAW      75  /* Draw (ebx=prim_mode, ecx=start, edx=count) */
 #define SYS_GPU3D_PRESENT   76  /* Present framebuffer to display */
+#define SYS_GPU3D_TEX_CREATE 77 /* Create texture (ebx=w, ecx=h, edx=mip levels) -> handle */
+#define SYS_GPU3D_TEX_UPLOAD 78 /* Upload one level (ebx=handle, ecx=level, edx=ptr to texels) */
+#define SYS_GPU3D_TEX_BIND  79  /* Sample texture in later draws (ebx=handle, 0=none) */
+#define SYS_GPU3D_TEX_FREE  80  /* Free texture (ebx=handle) */
+
+/* Monitoring */
+#define SYS_STATS           81  /* Counter snapshot (ebx=proc_stats_t*, ecx=size) -> bytes */
 void syscall_init(void);
 
 /* --- User-space IPC wrappers (used by servers and user processes) --- */
@@ -101,6 +114,8 @@ void    sys_sleep(uint32_t ms);
 /* Service wrappers */
 int32_t sys_register_service(const char* name);
 uint32_t sys_lookup_service(const char* name);
+int32_t sys_endpoint_create(const char* name);
+int32_t sys_endpoint_open(const char* name);
 
 
 /* Add this function declaration: */
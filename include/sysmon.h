@@ -0,0 +1,82 @@
+#ifndef SYSMON_H
+#define SYSMON_H
+
+#include "types.h"
+#include "procfs.h"
+#include "ipc.h"
+
+/*
+ * Live system monitor — the engine behind the shell's `top` and the GUI
+ * Monitor window.
+ *
+ * Each sysmon_update() takes one procfs_snapshot() plus the TSC CPU time
+ * of every task, and turns the difference from the previous sample into
+ * per-second rates.  A sample is a flat copy of counters with no /proc
+ * text generation and no page-table walks, so the monitor can be left
+ * running during benchmarks.  The view is rendered to text lines by
+ * sysmon_line(), which both front ends share.
+ */
+
+typedef struct {
+    uint32_t pid;
+    uint32_t state;                 /* task_state_t */
+    uint32_t permille;              /* CPU share of the interval, 0-1000 */
+    uint32_t cpu_ms;                /* Total CPU time */
+    uint32_t csw;                   /* Per second */
+    uint32_t ipc;                   /* Messages sent + received per second */
+    uint32_t faults;                /* Per second */
+    uint32_t syscalls;              /* Per second */
+    char     name[TASK_NAME_LEN];
+} sysmon_task_t;
+
+typedef struct {
+    uint32_t pid;
+    uint32_t msgs;                  /* Messages received per second */
+    char     name[SERVICE_NAME_LEN];
+} sysmon_service_t;
+
+typedef struct {
+    uint32_t interval_ms;
+    uint32_t uptime_s;
+    uint32_t tasks;
+    uint32_t tasks_by_state[5];
+    uint32_t csw;                   /* Rates are per second */
+    uint32_t ipc;
+    uint32_t pages_used, pages_total;
+    uint32_t heap_used, heap_free;  /* KB */
+    uint32_t disk_read, disk_write; /* KB/s */
+    uint32_t net_up;
+    uint32_t net_rx, net_tx;        /* KB/s */
+    uint32_t net_rx_pkts, net_tx_pkts;
+    uint32_t gpu_submits, gpu_kb, gpu_rects;
+
+    uint32_t         ntasks;        /* Sorted by permille, highest first */
+    sysmon_task_t    task[MAX_TASKS];
+    uint32_t         nservices;
+    sysmon_service_t service[MAX_SERVICES];
+} sysmon_view_t;
+
+typedef struct {
+    proc_stats_t st;
+    uint64_t     tsc;
+    uint64_t     cpu_tsc[MAX_TASKS];  /* user + sys, parallel to st.task[] */
+} sysmon_sample_t;
+
+typedef struct {
+    sysmon_sample_t sample[2];
+    int             cur;            /* Index of the latest sample */
+    bool            primed;         /* A previous sample exists */
+    sysmon_view_t   view;
+} sysmon_t;
+
+/* Take a sample and rebuild mon->view from the interval since the last
+ * one.  Returns false on the first call, when there is no interval yet. */
+bool sysmon_update(sysmon_t* mon);
+
+/* Text rendering shared by `top` and the GUI.  sysmon_line() writes line
+ * n (0 <= n < sysmon_lines()) into buf, at most width characters plus
+ * the terminator, and returns true for heading lines. */
+int  sysmon_lines(const sysmon_view_t* v);
+bool sysmon_line(const sysmon_view_t* v, int n, char* buf, int width);
+
+#endif
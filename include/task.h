@@ -9,6 +9,7 @@
 #define KERNEL_STACK_SIZE 4096     /* Per-task kernel stack for ring 3 tasks */
 #define TASK_NAME_LEN     32
 #define DEFAULT_QUANTUM   10      /* Timer ticks per time slice (100ms at 100Hz) */
+#define TASK_SYSCALL_SLOTS 128    /* Per-task syscall counters; higher numbers share the last */
 
 typedef enum {
     TASK_READY,
@@ -24,6 +25,17 @@ typedef struct {
     uint32_t eip, eflags;
 } task_regs_t;
 
+/* Why a task was off the CPU: the state it had when switched out */
+typedef enum {
+    TASK_WAIT_RUNQ,       /* Preempted or yielded while runnable */
+    TASK_WAIT_SLEEP,
+    TASK_WAIT_SEND,
+    TASK_WAIT_RECV,
+    TASK_WAIT_SENDREC,
+    TASK_WAIT_OTHER,      /* Blocked outside IPC (pipes, wait) */
+    TASK_WAIT_COUNT
+} task_wait_t;
+
 /* Include IPC header for message_t */
 #include "ipc.h"
 
@@ -66,11 +78,39 @@ typedef struct {
     bool         io_privileged;       /* Has IOPL=3 for hardware access */
     uint32_t     owned_irqs;         /* Bitmask of IRQs this task handles */
 
+    /* ELF image cache reference (slot + 1, 0 = none) */
+    uint32_t     elf_image;
+
+    /* User heap: current program break (0 = sbrk never called) */
+    uint32_t     heap_brk;
+
+    /* Standard streams: pipe id + 1 (0 = keyboard / console) */
+    uint32_t     pipe_in;
+    uint32_t     pipe_out;
+
     /* Kernel-side IPC message buffer.
      * With isolated address spaces, we can't write directly to a destination
      * task's user buffer (wrong page directory). So IPC copies go through
      * these kernel-resident buffers which are always accessible. */
     message_t    ipc_msg;
+
+    /* Resource accounting (TSC cycles; see task_acct_*) */
+    uint64_t     start_tsc;           /* Creation time */
+    uint64_t     user_tsc;            /* On CPU in ring 3 */
+    uint64_t     sys_tsc;             /* On CPU in the kernel (all of it for ring 0 tasks) */
+    uint64_t     acct_stamp;          /* Last charge point while on CPU */
+    uint64_t     wait_tsc[TASK_WAIT_COUNT];
+    uint64_t     wait_stamp;          /* Switched out at */
+    uint32_t     wait_reason;         /* task_wait_t for the current wait */
+    bool         in_syscall;
+    bool         yielded;             /* Gave up the CPU via task_yield this quantum */
+    uint32_t     nvcsw;               /* Voluntary switches out (sleep, block, yield) */
+    uint32_t     nivcsw;              /* Involuntary (quantum expired) */
+    uint32_t     ipc_sent;
+    uint32_t     ipc_received;
+    uint32_t     page_faults;
+    uint32_t     syscalls;
+    uint32_t     syscall_counts[TASK_SYSCALL_SLOTS];
 } task_t;
 
 typedef void (*task_entry_t)(void);
@@ -111,4 +151,10 @@ task_t*  task_get_by_pid(uint32_t pid);
 task_t*  task_get_all(void);
 uint32_t task_total_switches(void);
 
+/* Accounting hooks (syscall entry/exit bracket kernel time for ring 3 tasks) */
+void     task_acct_syscall_enter(uint32_t num);
+void     task_acct_syscall_exit(void);
+void     task_acct_sync(task_t* t);    /* Bring the running task's times up to now */
+uint32_t task_owned_pages(const task_t* t);
+
 #endif
@@ -13,4 +13,14 @@ uint32_t timer_get_frequency(void);
 void     timer_get_uptime(uint32_t* hours, uint32_t* mins, uint32_t* secs);
 void     timer_sleep(uint32_t ms);
 
+/* Cycle-accurate timing: TSC calibrated against PIT channel 2 at init */
+static inline uint64_t timer_rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+uint32_t timer_tsc_khz(void);
+uint32_t timer_tsc_to_us(uint64_t cycles);
+uint32_t timer_tsc_to_ms(uint64_t cycles);
+
 #endif
@@ -46,6 +46,18 @@ static inline void cli(void) { __asm__ volatile ("cli"); }
 static inline void sti(void) { __asm__ volatile ("sti"); }
 static inline void hlt(void) { __asm__ volatile ("hlt"); }
 
+/* Disable interrupts, returning EFLAGS so irq_restore() can put IF back
+ * the way it was (nesting-safe, unlike a bare cli/sti pair) */
+static inline uint32_t irq_save(void) {
+    uint32_t flags;
+    __asm__ volatile ("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    if (flags & 0x200) sti();
+}
+
 /* String utilities */
 static inline size_t strlen(const char* s) {
     size_t len = 0;
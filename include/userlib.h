@@ -65,6 +65,7 @@ static inline uint32_t inl(uint16_t port) {
 #define SYS_EXIT            6
 #define SYS_SLEEP           7
 #define SYS_TIME            8
+#define SYS_SBRK            14
 
 #define SYS_SEND            20
 #define SYS_RECEIVE         21
@@ -75,6 +76,11 @@ static inline uint32_t inl(uint16_t port) {
 #define SYS_REGISTER_SVC    30
 #define SYS_LOOKUP_SVC      31
 #define SYS_REGISTER_IRQ    33
+#define SYS_ENDPOINT_CREATE 35
+#define SYS_ENDPOINT_OPEN   36
+#define SYS_CHAN_CREATE     37
+#define SYS_CHAN_MAP        38
+#define SYS_CHAN_CLOSE      39
 
 #define SYS_KBD_GETCHAR     40
 #define SYS_RAMFS_READ      41
@@ -130,9 +136,13 @@ static inline uint32_t inl(uint16_t port) {
 
 #define MSG_IRQ_NOTIFY      100
 #define MSG_REPLY           101
+#define MSG_CHAN_DOORBELL   104
 
 #define PID_ANY             0xFFFFFFFF
 
+/* Endpoint handles are accepted wherever a destination PID is */
+#define IPC_ENDPOINT_BASE   0x40000000
+
 
 #define SYS_VIRGL_SUBMIT    70
 
@@ -143,6 +153,12 @@ static inline uint32_t inl(uint16_t port) {
 #define SYS_GPU3D_MVP       74
 #define SYS_GPU3D_DRAW      75
 #define SYS_GPU3D_PRESENT   76
+#define SYS_GPU3D_TEX_CREATE 77
+#define SYS_GPU3D_TEX_UPLOAD 78
+#define SYS_GPU3D_TEX_BIND  79
+#define SYS_GPU3D_TEX_FREE  80
+
+#define SYS_STATS           81
 
 /* GPU3D primitive types (Gallium PIPE_PRIM_*) */
 #define GPU3D_TRIANGLES      4
@@ -169,6 +185,14 @@ int32_t  sys_gpu3d_set_mvp(const float* mvp16);
 int32_t  sys_gpu3d_draw(uint32_t prim_mode, uint32_t start, uint32_t count);
 int32_t  sys_gpu3d_present(void);
 
+/* GPU3D textures: 0xAARRGGBB texels, level n is (w>>n)x(h>>n) (min 1).
+ * While a texture is bound, the second vertex attribute is read as
+ * (u, v, shade, unused) instead of RGBA. */
+int32_t  sys_gpu3d_tex_create(uint32_t width, uint32_t height, uint32_t levels);
+int32_t  sys_gpu3d_tex_upload(int32_t tex, uint32_t level, const uint32_t* texels);
+int32_t  sys_gpu3d_tex_bind(int32_t tex);
+int32_t  sys_gpu3d_tex_free(int32_t tex);
+
 // Under "String/memory utilities"
 char* utoa(uint32_t value, char* str, int base);
 
@@ -202,15 +226,122 @@ typedef struct {
             uint8_t  color;
             char     data[47];
         } cons;
+        struct {
+            uint32_t id;
+        } chan;
     };
 } message_t;
 
+/* ---- Statistics snapshot (must match kernel's proc_stats_t) ---- */
+
+#define PROC_STATS_VERSION 1
+#define PROC_STATS_TASKS   32       /* MAX_TASKS */
+
+typedef struct {
+    uint32_t pid;
+    uint32_t state;                 /* 0 ready, 1 running, 2 sleeping, 3 blocked, 4 terminated */
+    uint32_t priority;
+    uint32_t cpu_ticks;
+    uint32_t switches;
+    uint32_t ipc_sent;
+    uint32_t ipc_received;
+    uint32_t page_faults;
+    uint32_t syscalls;
+    char     name[32];
+} proc_task_stats_t;
+
+typedef struct {
+    uint32_t version;
+    uint32_t size;
+    uint32_t ticks;
+    uint32_t tick_hz;
+
+    uint32_t preemptive;
+    uint32_t quantum;
+    uint32_t switches;
+    uint32_t tasks;
+    uint32_t tasks_by_state[5];
+
+    uint32_t ipc_messages;
+    uint32_t ipc_services;
+
+    uint32_t pages_total;
+    uint32_t pages_free;
+    uint32_t pages_used;
+    uint32_t heap_used;
+    uint32_t heap_free;
+
+    uint32_t disk_sectors_read;
+    uint32_t disk_sectors_written;
+    uint32_t disk_errors;
+
+    uint32_t net_up;
+    uint32_t net_rx_packets;
+    uint32_t net_rx_bytes;
+    uint32_t net_rx_errors;
+    uint32_t net_tx_packets;
+    uint32_t net_tx_bytes;
+    uint32_t net_tx_dropped;
+
+    uint32_t gpu_flush_rects;
+    uint32_t gpu_submits;
+    uint32_t gpu_submit_bytes;
+
+    proc_task_stats_t task[PROC_STATS_TASKS];
+} proc_stats_t;
+
 /* ---- Service names ---- */
 #define SVC_CONSOLE     "console"
 #define SVC_VFS         "vfs"
 #define SVC_DISK        "ata"
 #define SVC_NET         "net"
 
+/* ---- Endpoints ----
+ *
+ * A client keeps one endpoint_t per server, initialised with
+ * ENDPOINT(SVC_VFS) and so on.  The first call resolves the name; every
+ * later call goes straight to the cached handle, which stays valid when
+ * the server restarts and creates its endpoint again.
+ */
+typedef struct {
+    const char* name;
+    uint32_t    handle;             /* 0 until resolved */
+} endpoint_t;
+
+#define ENDPOINT(n)     { (n), 0 }
+
+/* ---- Shared-memory channels (must match the kernel's chan.h) ----
+ *
+ * A single-producer/single-consumer ring mapped into two tasks.
+ * Records go through shared memory; a sleeping end is woken with a
+ * MSG_CHAN_DOORBELL notification only when the other end's update
+ * crosses the event index it published.  chan_write and chan_read block
+ * (full / empty) and return -1 once the other end has closed.  A task
+ * that also serves IPC requests should not block in chan_read: it gets
+ * the doorbell in its own receive loop instead.  Notifications share a
+ * single pending slot per task, so a doorbell that arrives while the
+ * task is not receiving (even a stale one) replaces any IRQ
+ * notification still pending there; a driver should not be a channel
+ * end unless it re-checks its device after every doorbell.
+ */
+#define CHAN_MAX_DATA_PAGES     8
+#define CHAN_DATA_OFFSET        4096
+#define CHAN_CREATOR_CONSUMES   0x1
+
+typedef struct {
+    volatile uint32_t head;
+    volatile uint32_t space_event;
+    uint32_t          pad0[14];
+    volatile uint32_t tail;
+    volatile uint32_t data_event;
+    uint32_t          pad1[14];
+    uint32_t          id;
+    uint32_t          size;
+    uint32_t          producer;
+    uint32_t          consumer;
+    volatile uint32_t closed;
+} chan_ring_t;
+
 /* ---- VGA constants (for console server) ---- */
 
 /* VGA text buffer is mapped at this virtual address by the ELF loader */
@@ -232,6 +363,10 @@ int32_t sys_reply(uint32_t dest, message_t* msg);
 int32_t sys_notify(uint32_t dest, message_t* msg);
 int32_t sys_register_service(const char* name);
 uint32_t sys_lookup_service(const char* name);
+int32_t sys_endpoint_create(const char* name);   /* Server side: handle or -1 */
+int32_t sys_endpoint_open(const char* name);     /* Handle or -1 */
+int32_t endpoint_send(endpoint_t* ep, message_t* msg);
+int32_t endpoint_sendrec(endpoint_t* ep, message_t* msg);
 int32_t sys_register_irq(uint32_t irq);
 uint32_t sys_getpid(void);
 void    sys_exit(int code);
@@ -255,6 +390,19 @@ int32_t sys_ata_write(uint32_t lba, const uint8_t* buf, uint32_t count);
 int32_t sys_ata_info(uint32_t drive);
 int32_t sys_net_status(void);
 int32_t sys_net_poll(void);
+/* Channels: peer is a PID or endpoint handle, data_pages a power of two
+ * up to CHAN_MAX_DATA_PAGES.  The peer maps the ring with chan_open(id)
+ * once the creator has told it the id. */
+int32_t      sys_chan_create(uint32_t peer, uint32_t data_pages, uint32_t flags);
+chan_ring_t* sys_chan_map(uint32_t id);
+int32_t      sys_chan_close(uint32_t id);
+chan_ring_t* chan_create(uint32_t peer, uint32_t data_pages, uint32_t flags);
+chan_ring_t* chan_open(uint32_t id);
+int32_t      chan_close(chan_ring_t* r);
+int32_t      chan_write(chan_ring_t* r, const void* data, uint32_t len);
+int32_t      chan_read(chan_ring_t* r, void* buf, uint32_t max);   /* Bytes copied (<= max; rest of record dropped) */
+/* One consistent copy of the kernel counters; returns bytes filled */
+int32_t sys_stats(proc_stats_t* st, uint32_t size);
 void    sys_debug_log(const char* msg);
 
 /* GUI window syscalls */
@@ -263,6 +411,63 @@ void     sys_gui_present(void);                /* signal frame ready + yield */
 void     sys_gui_win_close(void);              /* close window */
 uint32_t sys_gui_get_ticks(void);              /* get timer ticks */
 
+/* ---- User heap ----
+ *
+ * malloc/free run entirely in user space on memory obtained from
+ * sys_sbrk().  Requests up to 4080 bytes come from power-of-two size
+ * classes (32..4096 byte blocks incl. a 16-byte header) with per-class
+ * free lists refilled 16KB at a time; larger requests are carved
+ * straight from the break and recycled through a first-fit list.
+ * Only a refill or a large miss enters the kernel.  Every pointer
+ * returned is 16-byte aligned, as for max_align_t.
+ */
+void*   sys_sbrk(int32_t increment);       /* returns old break, (void*)-1 on failure */
+void*   malloc(size_t size);
+void*   calloc(size_t count, size_t size);
+void*   realloc(void* ptr, size_t size);
+void    free(void* ptr);
+
+/* ---- Buffered stdio ----
+ *
+ * stdout collects output in user space and hands whole buffers to the
+ * console with one SYS_WRITE each.  It is line-buffered by default;
+ * setvbuf(stdout, NULL, _IOFBF, 0) batches full screens, _IONBF writes
+ * through.  sys_exit() flushes stdout.
+ */
+typedef __builtin_va_list va_list;
+#define va_start(ap, last) __builtin_va_start(ap, last)
+#define va_end(ap)         __builtin_va_end(ap)
+#define va_arg(ap, type)   __builtin_va_arg(ap, type)
+
+#define _IOFBF  0
+#define _IOLBF  1
+#define _IONBF  2
+#define BUFSIZ  1024
+#define EOF     (-1)
+
+typedef struct {
+    char     buf[BUFSIZ];
+    uint32_t len;
+    int      mode;
+} FILE;
+
+extern FILE* stdout;
+
+int32_t sys_write(const char* buf, uint32_t len);   /* bulk console write */
+
+int     fputc(int c, FILE* f);
+int     fputs(const char* s, FILE* f);
+size_t  fwrite(const void* ptr, size_t size, size_t count, FILE* f);
+int     fflush(FILE* f);
+int     setvbuf(FILE* f, char* buf, int mode, size_t size);  /* buf/size ignored */
+int     putchar(int c);
+int     puts(const char* s);
+int     printf(const char* fmt, ...);
+int     fprintf(FILE* f, const char* fmt, ...);
+int     vfprintf(FILE* f, const char* fmt, va_list ap);
+int     snprintf(char* buf, size_t size, const char* fmt, ...);
+int     vsnprintf(char* buf, size_t size, const char* fmt, va_list ap);
+
 /* ---- Math utilities for user-space rendering ---- */
 
 static inline float u_fabs(float x) { return x < 0 ? -x : x; }
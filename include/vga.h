@@ -20,6 +20,7 @@ void terminal_setcolor(uint8_t color);
 uint8_t terminal_getcolor(void);
 void terminal_putchar(char c);
 void terminal_print(const char* str);
+void terminal_write(const char* buf, uint32_t len);
 void terminal_print_hex(uint32_t value);
 void terminal_print_dec(uint32_t value);
 void terminal_print_dec64(uint64_t value);
@@ -30,10 +31,21 @@ void terminal_get_cursor(int* row, int* col);
 void terminal_print_at(int row, int col, const char* str, uint8_t color);
 void terminal_draw_box(int row, int col, int w, int h, uint8_t color);
 
+/* Output is kept in a RAM shadow; every call above flushes it.  flush
+ * writes only what changed; refresh rewrites the whole screen, e.g.
+ * after drawing straight into VGA memory. */
+void terminal_flush(void);
+void terminal_refresh(void);
+
 /* Output hook for pipes/redirection */
 typedef void (*terminal_hook_t)(char c);
 void terminal_set_hook(terminal_hook_t hook);
 
+/* Redirect: returns true if it consumed the character (it never reaches
+ * the screen or the hook).  Used for pipeline stdout. */
+typedef bool (*terminal_redirect_t)(char c);
+void terminal_set_redirect(terminal_redirect_t redirect);
+
 /* Printf-lite: supports %s %d %x %c %% */
 void kprintf(const char* fmt, ...);
 
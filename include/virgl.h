@@ -258,6 +258,7 @@ typedef struct {
     uint32_t  dsa_handle;
     uint32_t  vs_handle;
     uint32_t  fs_handle;
+    uint32_t  fs_tex_handle;       /* Texture-sampling FS, 0 if unavailable */
     uint32_t  ve_handle;
 
     uint32_t  fb_res_id;
@@ -267,6 +268,13 @@ typedef struct {
 
     uint32_t  vbo_res_id;
     uint32_t  vbo_size;
+
+    /* VBO as a streaming ring: uploads take [vbo_head, +size) and only
+     * wrap once the host has retired every submit that used the ring */
+    uint32_t  vbo_head;
+    uint64_t  vbo_fence;           /* Last fence covering ring data */
+    uint64_t  fence_next;
+    uint64_t  fence_done;
 } virgl_ctx_t;
 
 /* ============================================================
@@ -279,10 +287,18 @@ virgl_ctx_t* virgl_get_ctx(void);
 
 void virgl_cmd_begin(void);
 
+/* Bulk emission: room for n contiguous dwords (flushing queued commands
+ * first if needed), filled by the caller, then committed */
+uint32_t* virgl_cmd_reserve(uint32_t words);
+void      virgl_cmd_commit(uint32_t words);
+
 void virgl_cmd_clear(uint32_t buffers,
                      float r, float g, float b, float a,
                      double depth, uint32_t stencil);
 
+/* Copies vertices into the next free stretch of the VBO ring and returns
+ * its byte offset (for virgl_cmd_set_vertex_buffer).  Wrapping flushes
+ * the pending command buffer first. */
 uint32_t virgl_upload_vertices(const float* data, uint32_t num_floats);
 void virgl_cmd_set_vertex_buffer(uint32_t stride, uint32_t offset);
 void virgl_cmd_draw(uint32_t prim_mode, uint32_t start, uint32_t count);
@@ -290,6 +306,15 @@ void virgl_cmd_draw(uint32_t prim_mode, uint32_t start, uint32_t count);
 void virgl_cmd_set_constant_buffer(uint32_t shader_type,
                                    const float* data, uint32_t num_floats);
 
+/* Sampled 2D textures (B8G8R8A8, mip levels 0..levels-1).  Sampler
+ * objects and binding live in virgl_pipeline.c. */
+uint32_t virgl_alloc_handle(void);
+uint32_t virgl_create_texture(uint32_t width, uint32_t height, uint32_t levels,
+                              void** backing);
+bool     virgl_upload_texture(uint32_t res_id, uint32_t level,
+                              uint32_t width, uint32_t height, const uint32_t* texels);
+void     virgl_destroy_resource(uint32_t res_id);
+
 bool virgl_cmd_submit(void);
 void virgl_present(void);
 void virgl_shutdown(void);
@@ -7,16 +7,10 @@
 /*
  * Virgl Pipeline State Encoding
  *
- * This implements the ~600 lines of state object creation that Mesa's
- * virgl Gallium driver does in virgl_encode.c. It creates and binds:
- *
- *   1. Blend state         (VIRGL_OBJECT_BLEND)
- *   2. Rasterizer state    (VIRGL_OBJECT_RASTERIZER)
- *   3. Depth-stencil-alpha (VIRGL_OBJECT_DSA)
- *   4. Vertex elements     (VIRGL_OBJECT_VERTEX_ELEMENTS)
- *   5. Surface objects     (VIRGL_OBJECT_SURFACE) — color + depth
- *   6. Shaders             (VIRGL_OBJECT_SHADER) — vertex + fragment (TGSI text)
- *   7. Framebuffer state   (SET_FRAMEBUFFER_STATE)
+ * Gallium state values shared by the virgl encoders, and the GPU3D
+ * texture objects (VIRGL_OBJECT_SAMPLER_VIEW / SAMPLER_STATE).  The
+ * fixed pipeline itself is set up by virgl_setup_pipeline_state() in
+ * virgl.c.
  *
  * Wire format reference: virglrenderer vrend_decode.c + Mesa virgl_hw.h
  */
@@ -88,14 +82,38 @@
 #define PIPE_CLEAR_DEPTH   0x2
 #define PIPE_CLEAR_STENCIL 0x4
 
-/* ===== Public API ===== */
+/* ===== Gallium sampler state values ===== */
+#define PIPE_TEX_WRAP_REPEAT          0
+#define PIPE_TEX_WRAP_CLAMP_TO_EDGE   2
+
+#define PIPE_TEX_FILTER_NEAREST       0
+#define PIPE_TEX_FILTER_LINEAR        1
+
+#define PIPE_TEX_MIPFILTER_NEAREST    0
+#define PIPE_TEX_MIPFILTER_LINEAR     1
+#define PIPE_TEX_MIPFILTER_NONE       2
 
-/* Create all GPU pipeline state objects and bind them.
- * Must be called AFTER virgl_init() and virgl_setup_framebuffer().
- * Returns true on success. */
-bool virgl_pipeline_setup(void);
+#define PIPE_SWIZZLE_X  0
+#define PIPE_SWIZZLE_Y  1
+#define PIPE_SWIZZLE_Z  2
+#define PIPE_SWIZZLE_W  3
+
+/* ===== GPU3D textures ===== */
+#define VIRGL_MAX_TEXTURES  16
+#define VIRGL_TEX_MAX_SIZE  1024
+
+/* ===== Public API ===== */
 
-/* Re-bind the DSA state (e.g., after toggling depth test) */
-void virgl_pipeline_set_depth_test(bool enable);
+/* GPU3D textures: B8G8R8A8 2D with `levels` mip levels (clamped to the
+ * full chain).  Returns a handle 1..VIRGL_MAX_TEXTURES, 0 on failure. */
+uint32_t virgl_pipeline_tex_create(uint32_t width, uint32_t height, uint32_t levels);
+bool     virgl_pipeline_tex_level_size(uint32_t tex, uint32_t level,
+                                       uint32_t* width, uint32_t* height);
+/* Whole level at once, width*height texels; submitted immediately */
+bool     virgl_pipeline_tex_upload(uint32_t tex, uint32_t level, const uint32_t* texels);
+/* Sample tex in the fragment stage (0 = back to vertex color); batched */
+bool     virgl_pipeline_tex_bind(uint32_t tex);
+void     virgl_pipeline_tex_free(uint32_t tex);
+void     virgl_pipeline_tex_reset(void);
 
 #endif /* VIRGL_PIPELINE_H */
@@ -30,9 +30,14 @@
 /* ===== Virtqueue Descriptor Flags ===== */
 #define VRING_DESC_F_NEXT       1   /* Descriptor continues via 'next' */
 #define VRING_DESC_F_WRITE      2   /* Device writes (vs reads) */
+#define VRING_DESC_F_INDIRECT   4   /* Buffer holds a descriptor table */
+
+/* ===== Ring Flags (used when EVENT_IDX is not negotiated) ===== */
+#define VRING_USED_F_NO_NOTIFY  1   /* Device: don't kick me */
 
 /* ===== Virtqueue Sizes ===== */
 #define VIRTQ_MAX_SIZE  256
+#define VIRTIO_MAX_SG   8       /* Segments per chain (out + in) */
 
 /* VirtIO 1.0+ Feature Bits (from spec §2.2) */
 #define VIRTIO_F_INDIRECT_DESC      (1 << 28)   // Indirect descriptors supported
@@ -82,6 +87,33 @@ typedef struct {
     virtq_used_elem_t ring[];
 } __attribute__((packed)) virtq_used_t;
 
+/* ===== Scatter-Gather Segment ===== */
+typedef struct {
+    uint32_t addr;      /* Physical (identity-mapped) address */
+    uint32_t len;
+} virtio_sg_t;
+
+/* ===== Request Completion Objects =====
+ * A request lives in the submitter's memory from virtio_send_req() until
+ * it completes (or virtio_wait_req() gives up on it).  Completion is
+ * signalled from the device IRQ: 'done' is set, the sleeping waiter is
+ * woken, and the optional callback runs (in interrupt context). */
+typedef struct virtio_req {
+    volatile bool   done;
+    uint32_t        len;            /* Bytes the device wrote */
+    uint32_t        waiter;         /* PID + 1 sleeping on this request (0 = none) */
+    void          (*callback)(struct virtio_req* req);
+    void*           ctx;
+} virtio_req_t;
+
+struct virtio_dev;
+
+/* Per-queue hook for drivers that handle used buffers themselves
+ * (e.g. input event buffers that are re-posted).  Called with the
+ * chain already returned to the free list; desc[head] is still intact. */
+typedef void (*virtq_used_fn)(struct virtio_dev* dev, uint16_t queue_idx,
+                              uint16_t head, uint32_t len);
+
 /* ===== Virtqueue (driver-side bookkeeping) ===== */
 typedef struct {
     uint16_t        size;           /* Number of descriptors */
@@ -100,6 +132,21 @@ typedef struct {
 
     /* Notify offset for this queue (multiplied by notify_off_multiplier) */
     uint32_t        notify_offset;
+
+    /* Indirect descriptor tables, VIRTIO_MAX_SG per ring slot, indexed by
+     * chain head (NULL when INDIRECT_DESC was not negotiated) */
+    virtq_desc_t*   indirect;
+
+    /* Completion tracking */
+    virtio_req_t*   reqs[VIRTQ_MAX_SIZE];   /* In-flight request by chain head */
+    virtq_used_fn   on_used;                /* Optional driver hook */
+    uint32_t        submitted;              /* Chains made available so far */
+    uint16_t        kicked_idx;             /* avail->idx at the last notify */
+    bool            batch_irq;              /* Interrupt once per batch, not per chain */
+    uint32_t        kicks;                  /* Notifies written */
+    uint32_t        kicks_skipped;          /* Notifies the device didn't need */
+    volatile uint32_t completions;          /* Chains retired so far */
+    volatile uint32_t waiter;               /* PID + 1 in virtio_wait() (0 = none) */
 } virtq_t;
 
 /* ===== VirtIO Common Configuration (MMIO layout) ===== */
@@ -125,7 +172,7 @@ typedef struct {
 #define VIRTIO_COMMON_QUSED_HI      0x34    /* uint32 - used ring addr hi */
 
 /* ===== VirtIO Device State ===== */
-typedef struct {
+typedef struct virtio_dev {
     pci_device_t*   pci;            /* PCI device handle */
 
     /* MMIO virtual addresses for each capability region */
@@ -136,6 +183,12 @@ typedef struct {
 
     uint32_t        notify_off_mul; /* Notification offset multiplier */
     uint8_t         irq;            /* IRQ line */
+    uint32_t        features_lo;    /* Negotiated feature bits 0-31 */
+
+    /* Interrupt delivery (legacy INTx, line may be shared) */
+    bool            irq_enabled;
+    uint32_t        irq_count;
+    struct virtio_dev* irq_next;    /* Next device on the same line */
 
     /* Virtqueues */
     virtq_t         queues[4];      /* Up to 4 queues */
@@ -161,15 +214,50 @@ int virtio_send(virtio_dev_t* dev, uint16_t queue_idx,
                 uint32_t out_addr, uint32_t out_len,
                 uint32_t in_addr, uint32_t in_len);
 
-/* Notify the device about new available buffers */
+/* Queue one chain built from arbitrary out (device-readable) and in
+ * (device-writable) segment lists, at most VIRTIO_MAX_SG in total.
+ * Does NOT notify: queue a batch, then kick once with virtio_notify().
+ * Returns the chain head (its completion token) or -1 if the ring is
+ * full. */
+int virtio_submit_sg(virtio_dev_t* dev, uint16_t queue_idx,
+                     const virtio_sg_t* out, uint16_t n_out,
+                     const virtio_sg_t* in, uint16_t n_in,
+                     virtio_req_t* req);
+
+/* Notify the device about new available buffers.  With EVENT_IDX the
+ * MMIO write is skipped unless the device asked for it (avail_event). */
 void virtio_notify(virtio_dev_t* dev, uint16_t queue_idx);
 
+/* Request/response queues: with EVENT_IDX, interrupt only once every
+ * chain in flight has retired instead of after each one */
+void virtio_set_batch_irq(virtio_dev_t* dev, uint16_t queue_idx, bool batch);
+
 /* Poll for completed requests. Returns true if something completed. */
 bool virtio_poll(virtio_dev_t* dev, uint16_t queue_idx);
 
-/* Wait (busy-poll) until queue has a used entry */
+/* Wait until every chain submitted so far has been retired (sleeps on
+ * the IRQ when enabled, polls otherwise; gives up after VIRTIO_WAIT_TICKS) */
 void virtio_wait(virtio_dev_t* dev, uint16_t queue_idx);
 
+#define VIRTIO_WAIT_TICKS   50      /* 500 ms */
+
+/* Submit with a completion object.  Returns the chain head or -1. */
+int virtio_send_req(virtio_dev_t* dev, uint16_t queue_idx,
+                    uint32_t out_addr, uint32_t out_len,
+                    uint32_t in_addr, uint32_t in_len,
+                    virtio_req_t* req);
+
+/* Sleep until req completes.  On timeout the request is detached so a
+ * late completion never touches it; returns false. */
+bool virtio_wait_req(virtio_dev_t* dev, uint16_t queue_idx, virtio_req_t* req);
+
+/* Route the device's IRQ line to the transport and start completing
+ * requests from the interrupt.  Safe to call once queues are set up. */
+bool virtio_enable_irq(virtio_dev_t* dev);
+
+/* Install a per-queue used-buffer hook (NULL to remove) */
+void virtio_set_used_handler(virtio_dev_t* dev, uint16_t queue_idx, virtq_used_fn fn);
+
 /* Read/write ISR status (clears interrupt) */
 uint8_t virtio_isr_status(virtio_dev_t* dev);
 
@@ -68,6 +68,9 @@
 #define VIRTIO_GPU_CMD_TRANSFER_FROM_HOST_2D 0x0109
 #endif
 
+/* ctrl_hdr.flags: the host answers only once the command has executed */
+#define VIRTIO_GPU_FLAG_FENCE                    (1u << 0)
+
 /* ===== Control Header (every command starts with this) ===== */
 typedef struct {
     uint32_t type;          /* VIRTIO_GPU_CMD_* or VIRTIO_GPU_RESP_* */
@@ -201,15 +204,39 @@ uint16_t virtio_gpu_get_width(void);
 uint16_t virtio_gpu_get_height(void);
 
 /* Flush a rectangle from guest memory to the display.
- * Call this after writing pixels to the framebuffer. */
+ * Call this after writing pixels to the framebuffer.  Synchronous. */
 void virtio_gpu_flush(uint32_t x, uint32_t y, uint32_t w, uint32_t h);
 
+/* Asynchronous damage flush: queue transfer+flush for every rectangle
+ * as one submission and return immediately.  Returns rectangles queued.
+ * Before rewriting framebuffer pixels, call virtio_gpu_wait_rect() for
+ * that region — it only blocks on transfers still reading it. */
+#define GPU_FLUSH_SLOTS 32
+int  virtio_gpu_flush_rects(const virtio_gpu_rect_t* rects, uint32_t count);
+void virtio_gpu_wait_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h);
+void virtio_gpu_wait_idle(void);
+
+/* Traffic since boot: 2D damage rectangles queued, and the 3D batches
+ * virgl_cmd_submit reports through virtio_gpu_count_submit */
+typedef struct {
+    uint32_t flush_rects;
+    uint32_t submits;
+    uint32_t submit_bytes;
+} virtio_gpu_stats_t;
+
+void virtio_gpu_count_submit(uint32_t bytes);
+void virtio_gpu_get_stats(virtio_gpu_stats_t* st);
+
 /* Flush the entire screen */
 void virtio_gpu_flush_all(void);
 
 /* Disable / clean up the GPU */
 void virtio_gpu_disable(void);
 
+/* Send one control command and wait for it.  hdr (at most 4 KB) is copied
+ * into a driver-owned DMA slot; data, if any, goes out in place and must
+ * stay allocated.  Up to 4 KB of response is copied to resp, or checked
+ * and dropped if resp is NULL.  False on timeout or an error response. */
 bool virtio_gpu_send_cmd_2iov(const void *hdr, uint32_t hdr_len,
                               const void *data, uint32_t data_len,
                               void *resp, uint32_t resp_len);
@@ -66,21 +66,11 @@ bool virtio_input_init(void);
 /* Check if virtio-input is available on PCI bus */
 bool virtio_input_available(void);
 
-/* Poll for and process pending input events.
- * Updates internal mouse state (position + buttons).
- * Call this regularly from the GUI loop. */
+/* Events are delivered from the device IRQ into the mouse driver and
+ * the input ring.  This only drains the queue by hand when the device
+ * has no usable interrupt. */
 void virtio_input_poll(void);
 
-/* Get current absolute mouse position (scaled to screen bounds) */
-int  virtio_input_get_x(void);
-int  virtio_input_get_y(void);
-
-/* Get button state */
-bool virtio_input_left_held(void);
-bool virtio_input_right_held(void);
-bool virtio_input_left_click(void);   /* Edge-triggered */
-bool virtio_input_right_click(void);  /* Edge-triggered */
-
 /* Set screen bounds for coordinate scaling */
 void virtio_input_set_bounds(int max_x, int max_y);
 
@@ -33,6 +33,7 @@
 
 static ata_drive_t drives[ATA_MAX_DRIVES];
 static int num_drives = 0;
+static ata_stats_t stats;
 
 static inline void ata_400ns_delay(void) {
     inb(ATA_CONTROL); inb(ATA_CONTROL);
@@ -153,7 +154,7 @@ ata_drive_t* ata_get_drive_n(int idx)     { return (idx >= 0 && idx < ATA_MAX_DR
 bool ata_read_sector_drv(int idx, uint32_t lba, void* buffer) {
     if (idx < 0 || idx >= ATA_MAX_DRIVES || !drives[idx].present) return false;
     if (lba >= drives[idx].sectors) return false;
-    if (!ata_wait_ready()) return false;
+    if (!ata_wait_ready()) { stats.errors++; return false; }
 
     uint8_t dh = (idx == 0) ? ATA_DH_LBA_MASTER : ATA_DH_LBA_SLAVE;
     outb(ATA_DRIVE_HEAD, dh | ((lba >> 24) & 0x0F));
@@ -164,11 +165,12 @@ bool ata_read_sector_drv(int idx, uint32_t lba, void* buffer) {
     outb(ATA_LBA_HI,  (uint8_t)((lba >> 16) & 0xFF));
     outb(ATA_COMMAND, ATA_CMD_READ_PIO);
 
-    if (!ata_wait_drq()) return false;
+    if (!ata_wait_drq()) { stats.errors++; return false; }
     uint16_t* buf = (uint16_t*)buffer;
     for (int i = 0; i < 256; i++)
         buf[i] = inw(ATA_DATA);
     ata_400ns_delay();
+    stats.sectors_read++;
     return true;
 }
 
@@ -176,7 +178,7 @@ bool ata_read_sector_drv(int idx, uint32_t lba, void* buffer) {
 bool ata_write_sector_drv(int idx, uint32_t lba, const void* buffer) {
     if (idx < 0 || idx >= ATA_MAX_DRIVES || !drives[idx].present) return false;
     if (lba >= drives[idx].sectors) return false;
-    if (!ata_wait_ready()) return false;
+    if (!ata_wait_ready()) { stats.errors++; return false; }
 
     uint8_t dh = (idx == 0) ? ATA_DH_LBA_MASTER : ATA_DH_LBA_SLAVE;
     outb(ATA_DRIVE_HEAD, dh | ((lba >> 24) & 0x0F));
@@ -187,7 +189,7 @@ bool ata_write_sector_drv(int idx, uint32_t lba, const void* buffer) {
     outb(ATA_LBA_HI,  (uint8_t)((lba >> 16) & 0xFF));
     outb(ATA_COMMAND, ATA_CMD_WRITE_PIO);
 
-    if (!ata_wait_drq()) return false;
+    if (!ata_wait_drq()) { stats.errors++; return false; }
     const uint16_t* buf = (const uint16_t*)buffer;
     for (int i = 0; i < 256; i++)
         outw(ATA_DATA, buf[i]);
@@ -195,6 +197,7 @@ bool ata_write_sector_drv(int idx, uint32_t lba, const void* buffer) {
 
     outb(ATA_COMMAND, ATA_CMD_FLUSH);
     ata_wait_ready();
+    stats.sectors_written++;
     return true;
 }
 
@@ -240,3 +243,7 @@ void ata_print_info(void) {
         kprintf("    Size:    %u MB\n", drives[i].size_mb);
     }
 }
+
+void ata_get_stats(ata_stats_t* st) {
+    *st = stats;
+}
@@ -0,0 +1,524 @@
+#include "bench.h"
+#include "timer.h"
+#include "task.h"
+#include "ipc.h"
+#include "chan.h"
+#include "heap.h"
+#include "pmm.h"
+#include "paging.h"
+#include "ramfs.h"
+#include "ata.h"
+#include "minigl.h"
+#include "elf.h"
+#include "syscall.h"
+#include "serial.h"
+#include "vga.h"
+
+/*
+ * Microbenchmarks.  Samples are taken on the calling (shell) task with
+ * preemption left on: the p99 column is where interference shows up.
+ * Scheduling benchmarks (ipc, ctxswitch, exec) are bounded by the timer
+ * tick, since context switches only happen there.
+ */
+
+static uint32_t samples[BENCH_MAX_SAMPLES];
+
+static inline uint32_t elapsed(uint64_t t0) {
+    uint64_t d = timer_rdtsc() - t0;
+    if (d > 0xFFFFFFFFULL) return 0xFFFFFFFF;
+    return d ? (uint32_t)d : 1;
+}
+
+/* ===== syscall: INT 0x80 round trip (SYS_GETPID) ===== */
+
+#define SYSCALL_OPS 100
+
+static uint32_t sample_syscall(void) {
+    uint64_t t0 = timer_rdtsc();
+    for (int i = 0; i < SYSCALL_OPS; i++) {
+        uint32_t ret;
+        __asm__ volatile ("int $0x80" : "=a"(ret) : "a"(SYS_GETPID) : "memory");
+        (void)ret;
+    }
+    return elapsed(t0);
+}
+
+/* ===== ipc: sendrec ping-pong with a kernel echo task ===== */
+
+#define BENCH_MSG_PING  0xBE00
+#define BENCH_MSG_STOP  0xBE01
+
+static int32_t echo_pid = -1;
+
+static void echo_task_main(void) {
+    message_t m;
+    while (1) {
+        if (ipc_receive(PID_ANY, &m) != 0) continue;
+        uint32_t type = m.type;
+        ipc_reply(m.sender, &m);
+        if (type == BENCH_MSG_STOP) break;
+    }
+    task_exit();
+}
+
+static bool setup_ipc(void) {
+    echo_pid = task_create("bench_echo", echo_task_main, 10);
+    return echo_pid >= 0;
+}
+
+static uint32_t sample_ipc(void) {
+    message_t m;
+    memset(&m, 0, sizeof(m));
+    m.type = BENCH_MSG_PING;
+    uint64_t t0 = timer_rdtsc();
+    if (ipc_sendrec((uint32_t)echo_pid, &m) != 0) return 0;
+    return elapsed(t0);
+}
+
+static void teardown_ipc(void) {
+    message_t m;
+    memset(&m, 0, sizeof(m));
+    m.type = BENCH_MSG_STOP;
+    ipc_sendrec((uint32_t)echo_pid, &m);
+    echo_pid = -1;
+}
+
+/* ===== ctxswitch: yield to a spinning peer and back ===== */
+
+static volatile bool spin_run;
+static int32_t spin_pid = -1;
+
+static void spin_task_main(void) {
+    while (spin_run) task_yield();
+    task_exit();
+}
+
+static bool setup_ctxswitch(void) {
+    spin_run = true;
+    spin_pid = task_create("bench_spin", spin_task_main, 10);
+    return spin_pid >= 0;
+}
+
+static uint32_t sample_ctxswitch(void) {
+    uint64_t t0 = timer_rdtsc();
+    task_yield();
+    return elapsed(t0);
+}
+
+static void teardown_ctxswitch(void) {
+    spin_run = false;
+    uint32_t deadline = timer_get_ticks() + timer_get_frequency();
+    while (task_get_by_pid((uint32_t)spin_pid) && timer_get_ticks() < deadline)
+        task_yield();
+    spin_pid = -1;
+}
+
+/* ===== chan: small records into a shared ring drained by a kernel task ===== */
+
+#define CHAN_OPS        256
+#define CHAN_REC_SIZE   32
+
+static volatile int32_t bench_chan = -1;
+static chan_ring_t* chan_ring;
+static int32_t drain_pid = -1;
+
+static void drain_task_main(void) {
+    uint8_t buf[CHAN_REC_SIZE];
+    while (bench_chan < 0) task_yield();
+    uint32_t self = task_get_current()->id;
+    uint32_t id = (uint32_t)bench_chan;
+    while (chan_read(id, buf, sizeof(buf)) >= 0)
+        ;
+    chan_close(id, self);
+    task_exit();
+}
+
+static bool setup_chan(void) {
+    drain_pid = task_create("bench_drain", drain_task_main, 10);
+    if (drain_pid < 0) return false;
+    uint32_t self = task_get_current()->id;
+    int32_t id = chan_create(self, (uint32_t)drain_pid, 4, 0);
+    if (id < 0) {
+        task_kill((uint32_t)drain_pid);
+        drain_pid = -1;
+        return false;
+    }
+    chan_ring = chan_map((uint32_t)id, self);
+    bench_chan = id;
+    return true;
+}
+
+/* Records are 36 bytes in the ring, so a sample fits without blocking:
+ * this times the producer side plus at most one doorbell */
+static uint32_t sample_chan(void) {
+    static const uint8_t rec[CHAN_REC_SIZE];
+    while (chan_ring->tail != chan_ring->head) task_yield();
+    uint64_t t0 = timer_rdtsc();
+    for (int i = 0; i < CHAN_OPS; i++)
+        if (chan_write((uint32_t)bench_chan, rec, sizeof(rec)) < 0) return 0;
+    return elapsed(t0);
+}
+
+static void teardown_chan(void) {
+    chan_close((uint32_t)bench_chan, task_get_current()->id);
+    uint32_t deadline = timer_get_ticks() + timer_get_frequency();
+    while (task_get_by_pid((uint32_t)drain_pid) && timer_get_ticks() < deadline)
+        task_yield();
+    bench_chan = -1;
+    chan_ring = NULL;
+    drain_pid = -1;
+}
+
+/* ===== kmalloc: 64-byte alloc/free pairs ===== */
+
+#define KMALLOC_OPS 100
+
+static uint32_t sample_kmalloc(void) {
+    uint64_t t0 = timer_rdtsc();
+    for (int i = 0; i < KMALLOC_OPS; i++) {
+        void* p = kmalloc(64);
+        if (!p) return 0;
+        kfree(p);
+    }
+    return elapsed(t0);
+}
+
+/* ===== pmm: page frame alloc/free pairs ===== */
+
+#define PMM_OPS 100
+
+static uint32_t sample_pmm(void) {
+    uint64_t t0 = timer_rdtsc();
+    for (int i = 0; i < PMM_OPS; i++) {
+        void* p = pmm_alloc_page();
+        if (!p) return 0;
+        pmm_free_page(p);
+    }
+    return elapsed(t0);
+}
+
+/* ===== pagein: what a demand fault would do, minus the trap ===== */
+
+#define PAGEIN_OPS  16
+#define PAGEIN_VA   0xD0000000      /* User heap base of the scratch space */
+
+static uint32_t* pagein_pd;
+
+static bool setup_pagein(void) {
+    pagein_pd = paging_create_address_space();
+    return pagein_pd != NULL;
+}
+
+static uint32_t sample_pagein(void) {
+    uint64_t t0 = timer_rdtsc();
+    for (int i = 0; i < PAGEIN_OPS; i++) {
+        void* frame = pmm_alloc_page();
+        if (!frame) return 0;
+        memset(frame, 0, 4096);
+        paging_map_user(pagein_pd, PAGEIN_VA, (uint32_t)frame,
+                        PAGE_PRESENT | PAGE_WRITE | PAGE_USER | PAGE_OWNED);
+        paging_unmap_user(pagein_pd, PAGEIN_VA);    /* Frees the frame */
+    }
+    return elapsed(t0);
+}
+
+static void teardown_pagein(void) {
+    paging_destroy_address_space(pagein_pd);
+    pagein_pd = NULL;
+}
+
+/* ===== memcpy: 1 MB copies between heap buffers ===== */
+
+#define MEMCPY_SIZE (1024 * 1024)
+
+static uint8_t* copy_src;
+static uint8_t* copy_dst;
+
+static bool setup_memcpy(void) {
+    copy_src = (uint8_t*)kmalloc(MEMCPY_SIZE);
+    copy_dst = (uint8_t*)kmalloc(MEMCPY_SIZE);
+    if (!copy_src || !copy_dst) {
+        if (copy_src) kfree(copy_src);
+        if (copy_dst) kfree(copy_dst);
+        return false;
+    }
+    memset(copy_src, 0x5A, MEMCPY_SIZE);
+    memset(copy_dst, 0, MEMCPY_SIZE);
+    return true;
+}
+
+static uint32_t sample_memcpy(void) {
+    uint64_t t0 = timer_rdtsc();
+    memcpy(copy_dst, copy_src, MEMCPY_SIZE);
+    return elapsed(t0);
+}
+
+static void teardown_memcpy(void) {
+    kfree(copy_src);
+    kfree(copy_dst);
+}
+
+/* ===== ramfs: 4 KB write + read back ===== */
+
+#define RAMFS_PATH  "/tmp/.bench"
+#define RAMFS_SIZE  4096
+
+static uint8_t* ramfs_buf;
+
+static bool setup_ramfs(void) {
+    ramfs_buf = (uint8_t*)kmalloc(RAMFS_SIZE);
+    if (!ramfs_buf) return false;
+    memset(ramfs_buf, 'b', RAMFS_SIZE);
+    return true;
+}
+
+static uint32_t sample_ramfs(void) {
+    uint64_t t0 = timer_rdtsc();
+    if (ramfs_write(RAMFS_PATH, ramfs_buf, RAMFS_SIZE) < 0) return 0;
+    if (ramfs_read(RAMFS_PATH, ramfs_buf, RAMFS_SIZE) != RAMFS_SIZE) return 0;
+    return elapsed(t0);
+}
+
+static void teardown_ramfs(void) {
+    ramfs_delete(RAMFS_PATH);
+    kfree(ramfs_buf);
+}
+
+/* ===== disk: sequential 64 KB reads from hda ===== */
+
+#define DISK_SECTORS 128
+
+static uint8_t* disk_buf;
+static uint32_t disk_lba;
+
+static bool setup_disk(void) {
+    if (!ata_drive_present(0)) return false;
+    disk_buf = (uint8_t*)kmalloc(DISK_SECTORS * 512);
+    disk_lba = 0;
+    return disk_buf != NULL;
+}
+
+static uint32_t sample_disk(void) {
+    ata_drive_t* d = ata_get_drive_n(0);
+    if (disk_lba + DISK_SECTORS > d->size_mb * 2048) disk_lba = 0;
+    uint64_t t0 = timer_rdtsc();
+    if (!ata_read_sectors(disk_lba, DISK_SECTORS, disk_buf)) return 0;
+    uint32_t c = elapsed(t0);
+    disk_lba += DISK_SECTORS;
+    return c;
+}
+
+static void teardown_disk(void) {
+    kfree(disk_buf);
+}
+
+/* ===== minigl: clear + full-viewport quad, 320x240 ===== */
+
+#define GL_BENCH_W 320
+#define GL_BENCH_H 240
+
+static uint32_t* gl_buf;
+static void*     gl_saved;          /* Context of an open GL window, if any */
+
+static bool setup_minigl(void) {
+    gl_buf = (uint32_t*)kmalloc(GL_BENCH_W * GL_BENCH_H * sizeof(uint32_t));
+    if (!gl_buf) return false;
+    gl_saved = glSaveContext();
+    if (!gl_saved) {
+        kfree(gl_buf);
+        return false;
+    }
+    glInit(gl_buf, GL_BENCH_W, GL_BENCH_H);
+    glEnable(GL_DEPTH_TEST);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glOrtho(-1, 1, -1, 1, -1, 1);
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    return true;
+}
+
+static uint32_t sample_minigl(void) {
+    uint64_t t0 = timer_rdtsc();
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    glBegin(GL_QUADS);
+    glColor3f(0.2f, 0.6f, 1.0f);
+    glVertex3f(-1, -1, 0); glVertex3f(1, -1, 0);
+    glVertex3f(1, 1, 0);   glVertex3f(-1, 1, 0);
+    glEnd();
+    return elapsed(t0);
+}
+
+static void teardown_minigl(void) {
+    glRestoreContext(gl_saved);
+    gl_saved = NULL;
+    kfree(gl_buf);
+}
+
+/* ===== exec: spawn + reap hello.elf (what execbench measures) ===== */
+
+static const char* exec_path;
+
+static bool setup_exec(void) {
+    /* Built into /bin, or loaded from the boot initrd into /home/root */
+    static const char* const candidates[] = {
+        "/bin/hello.elf", "/home/root/hello.elf", NULL
+    };
+    for (int i = 0; candidates[i]; i++) {
+        if (ramfs_find(candidates[i]) >= 0) {
+            exec_path = candidates[i];
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t sample_exec(void) {
+    uint64_t t0 = timer_rdtsc();
+    elf_file_t file;
+    if (elf_open(exec_path, &file) != 0) return 0;
+    int32_t pid = elf_load(&file, "bench_exec", 10, false, 0);
+    elf_close(&file);
+    if (pid < 0) return 0;
+
+    uint32_t deadline = timer_get_ticks() + 2 * timer_get_frequency();
+    while (task_get_by_pid((uint32_t)pid)) {
+        if (timer_get_ticks() >= deadline) { task_kill((uint32_t)pid); return 0; }
+        task_yield();
+    }
+    return elapsed(t0);
+}
+
+/* ===== Registry ===== */
+
+static const bench_t benches[] = {
+    { "syscall",   "INT 0x80 round trip (getpid)",     256, SYSCALL_OPS, 0,
+      NULL, sample_syscall, NULL },
+    { "ipc",       "sendrec ping-pong, kernel task",    32, 1, 0,
+      setup_ipc, sample_ipc, teardown_ipc },
+    { "ctxswitch", "yield to peer and back",            32, 1, 0,
+      setup_ctxswitch, sample_ctxswitch, teardown_ctxswitch },
+    { "chan",      "32 B records into a shared ring",   32, CHAN_OPS, CHAN_OPS * CHAN_REC_SIZE,
+      setup_chan, sample_chan, teardown_chan },
+    { "kmalloc",   "kmalloc(64) + kfree",              256, KMALLOC_OPS, 0,
+      NULL, sample_kmalloc, NULL },
+    { "pmm",       "page frame alloc + free",          256, PMM_OPS, 0,
+      NULL, sample_pmm, NULL },
+    { "pagein",    "frame alloc + zero + map + unmap", 128, PAGEIN_OPS, 0,
+      setup_pagein, sample_pagein, teardown_pagein },
+    { "memcpy",    "1 MB kernel memcpy",                32, 1, MEMCPY_SIZE,
+      setup_memcpy, sample_memcpy, teardown_memcpy },
+    { "ramfs",     "4 KB write + read back",           128, 1, 2 * RAMFS_SIZE,
+      setup_ramfs, sample_ramfs, teardown_ramfs },
+    { "disk",      "hda sequential 64 KB read",         32, 1, DISK_SECTORS * 512,
+      setup_disk, sample_disk, teardown_disk },
+    { "minigl",    "clear + 320x240 quad",              32, 1, GL_BENCH_W * GL_BENCH_H * 4,
+      setup_minigl, sample_minigl, teardown_minigl },
+    { "exec",      "spawn + reap hello.elf",            8, 1, 0,
+      setup_exec, sample_exec, NULL },
+};
+
+#define NUM_BENCHES (sizeof(benches) / sizeof(benches[0]))
+
+/* ===== Statistics ===== */
+
+static void sort_samples(uint32_t* a, uint32_t n) {
+    for (uint32_t i = 1; i < n; i++) {
+        uint32_t v = a[i];
+        uint32_t j = i;
+        while (j > 0 && a[j - 1] > v) { a[j] = a[j - 1]; j--; }
+        a[j] = v;
+    }
+}
+
+static uint32_t cycles_to_ns(uint32_t cycles) {
+    uint32_t mhz = timer_tsc_khz() / 1000;
+    if (!mhz) return 0;
+    if (cycles < 4000000) return cycles * 1000 / mhz;
+    return timer_tsc_to_us(cycles) * 1000;
+}
+
+/* Returns 1 on success, 0 if skipped, -1 on failure */
+static int run_one(const bench_t* b, bench_result_t* r) {
+    memset(r, 0, sizeof(*r));
+
+    if (b->setup && !b->setup()) {
+        kprintf("  %s: skipped (%s)\n", b->name, b->desc);
+        serial_printf("BENCH %s skipped\n", b->name);
+        return 0;
+    }
+
+    uint32_t n = b->samples < BENCH_MAX_SAMPLES ? b->samples : BENCH_MAX_SAMPLES;
+    uint32_t got = 0;
+    bool ok = true;
+
+    b->sample();    /* Warm caches and TLB; not counted */
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t c = b->sample();
+        if (!c) { ok = false; break; }
+        samples[got++] = c;
+    }
+    if (b->teardown) b->teardown();
+
+    if (!ok || !got) {
+        kprintf("  %s: FAILED after %u samples\n", b->name, got);
+        serial_printf("BENCH %s failed samples=%u\n", b->name, got);
+        return -1;
+    }
+
+    sort_samples(samples, got);
+    uint32_t med_sample = samples[got / 2];
+    r->samples   = got;
+    r->min       = samples[0] / b->ops;
+    r->median    = med_sample / b->ops;
+    r->p99       = samples[(got * 99) / 100] / b->ops;
+    r->median_ns = cycles_to_ns(r->median);
+    if (b->bytes) {
+        uint32_t us = timer_tsc_to_us(med_sample);
+        r->mbps = us ? b->bytes / us : 0;    /* bytes/us == MB/s */
+    }
+
+    kprintf("  %s\t%u\t%u\t%u\t%u", b->name, r->min, r->median, r->p99, r->median_ns);
+    if (b->bytes) kprintf("\t%u MB/s", r->mbps);
+    kprintf("\n");
+    serial_printf("BENCH %s ops=%u samples=%u min=%u med=%u p99=%u med_ns=%u mbps=%u\n",
+                  b->name, b->ops, got, r->min, r->median, r->p99, r->median_ns, r->mbps);
+    return 1;
+}
+
+static void print_header(void) {
+    kprintf("  TSC %u MHz; cycles per op unless noted\n", timer_tsc_khz() / 1000);
+    kprintf("  name\tmin\tmedian\tp99\tmed_ns\n");
+    serial_printf("BENCH_BEGIN tsc_khz=%u\n", timer_tsc_khz());
+}
+
+bool bench_run(const char* name, bench_result_t* out) {
+    for (uint32_t i = 0; i < NUM_BENCHES; i++) {
+        if (strcmp(benches[i].name, name) != 0) continue;
+        bench_result_t r;
+        print_header();
+        int st = run_one(&benches[i], &r);
+        serial_printf("BENCH_END failed=%u\n", st < 0 ? 1 : 0);
+        if (out) *out = r;
+        return st > 0;
+    }
+    kprintf("  %s: unknown benchmark (see 'bench list')\n", name);
+    return false;
+}
+
+int bench_run_all(void) {
+    int failed = 0;
+    print_header();
+    for (uint32_t i = 0; i < NUM_BENCHES; i++) {
+        bench_result_t r;
+        /* Skipped (device absent) is not a regression */
+        if (run_one(&benches[i], &r) < 0) failed++;
+    }
+    serial_printf("BENCH_END failed=%u\n", (uint32_t)failed);
+    return failed;
+}
+
+void bench_list(void) {
+    for (uint32_t i = 0; i < NUM_BENCHES; i++)
+        kprintf("  %s\t%s\n", benches[i].name, benches[i].desc);
+}
@@ -0,0 +1,138 @@
+#include "bootprof.h"
+#include "task.h"
+#include "timer.h"
+#include "procfs.h"
+#include "serial.h"
+
+/*
+ * Timestamps are raw TSC values: the early stages run before the TSC is
+ * calibrated (timer_init), so conversion to microseconds happens only
+ * when the report is read.
+ */
+
+typedef struct {
+    char     name[BOOTPROF_NAME_LEN];
+    uint64_t tsc;
+} boot_stage_t;
+
+typedef struct {
+    char             name[BOOTPROF_NAME_LEN];
+    bootprof_probe_t fn;
+    int32_t          pid;
+    uint64_t         start;
+    uint64_t         end;
+    volatile bool    done;
+} boot_probe_t;
+
+static uint64_t     boot_t0;
+static boot_stage_t stages[BOOTPROF_MAX_STAGES];
+static uint32_t     num_stages;
+static boot_probe_t probes[BOOTPROF_MAX_PROBES];
+static uint32_t     num_probes;
+
+static void copy_name(char* dst, const char* src) {
+    strncpy(dst, src, BOOTPROF_NAME_LEN - 1);
+    dst[BOOTPROF_NAME_LEN - 1] = '\0';
+}
+
+static uint32_t since_boot_us(uint64_t tsc) {
+    return tsc > boot_t0 ? timer_tsc_to_us(tsc - boot_t0) : 0;
+}
+
+void bootprof_init(void) {
+    boot_t0 = timer_rdtsc();
+    num_stages = 0;
+    num_probes = 0;
+}
+
+void bootprof_mark(const char* stage) {
+    if (num_stages >= BOOTPROF_MAX_STAGES) return;
+    boot_stage_t* s = &stages[num_stages];
+    s->tsc = timer_rdtsc();
+    copy_name(s->name, stage);
+    num_stages++;
+}
+
+/* ===== Deferred probes ===== */
+
+static void run_probe(boot_probe_t* p) {
+    p->start = timer_rdtsc();
+    p->fn();
+    p->end = timer_rdtsc();
+    p->done = true;
+    serial_printf("bootprof: probe %s took %u us\n", p->name,
+                  timer_tsc_to_us(p->end - p->start));
+}
+
+static void probe_task_main(void) {
+    task_t* self = task_get_current();
+    boot_probe_t* mine = NULL;
+
+    task_lock_scheduler();
+    for (uint32_t i = 0; i < num_probes; i++)
+        if (probes[i].pid == (int32_t)self->id) mine = &probes[i];
+    task_unlock_scheduler();
+
+    if (mine) run_probe(mine);
+    task_exit();
+}
+
+int32_t bootprof_defer(const char* name, bootprof_probe_t probe) {
+    if (num_probes >= BOOTPROF_MAX_PROBES) {
+        probe();
+        return -1;
+    }
+
+    boot_probe_t* p = &probes[num_probes];
+    memset(p, 0, sizeof(*p));
+    copy_name(p->name, name);
+    p->fn = probe;
+
+    /* The task looks itself up by pid, so publish it before it can run */
+    task_lock_scheduler();
+    p->pid = task_create(name, probe_task_main, 10);
+    if (p->pid >= 0) num_probes++;
+    task_unlock_scheduler();
+
+    if (p->pid < 0) {
+        run_probe(p);
+        return -1;
+    }
+    return p->pid;
+}
+
+bool bootprof_probes_done(void) {
+    for (uint32_t i = 0; i < num_probes; i++)
+        if (!probes[i].done) return false;
+    return true;
+}
+
+/* ===== /proc/boottime ===== */
+
+int bootprof_format(char* buf, int max) {
+    int p = 0;
+    uint64_t prev = boot_t0;
+
+    p += ksnprintf(buf + p, max - p, "tsc_khz:\t%u\n\n", timer_tsc_khz());
+    p += ksnprintf(buf + p, max - p, "at_us\ttook_us\tstage\n");
+    for (uint32_t i = 0; i < num_stages; i++) {
+        p += ksnprintf(buf + p, max - p, "%u\t%u\t%s\n",
+                       since_boot_us(stages[i].tsc),
+                       timer_tsc_to_us(stages[i].tsc - prev), stages[i].name);
+        prev = stages[i].tsc;
+    }
+
+    if (num_probes) {
+        p += ksnprintf(buf + p, max - p, "\nstart_us\tend_us\tprobe (deferred)\n");
+        for (uint32_t i = 0; i < num_probes; i++) {
+            boot_probe_t* b = &probes[i];
+            if (b->done)
+                p += ksnprintf(buf + p, max - p, "%u\t%u\t%s\n",
+                               since_boot_us(b->start), since_boot_us(b->end), b->name);
+            else
+                p += ksnprintf(buf + p, max - p, "%u\t-\t%s (running)\n",
+                               since_boot_us(b->start), b->name);
+        }
+    }
+    return p;
+}
@@ -0,0 +1,261 @@
+#include "chan.h"
+#include "ipc.h"
+#include "task.h"
+#include "paging.h"
+#include "pmm.h"
+#include "serial.h"
+
+/*
+ * Channel table.  Frames come from the PMM one page at a time and are
+ * made contiguous by the mappings.  A channel is freed only when both
+ * ends have released it, so the end that is still draining never has
+ * its mapping pulled out from under it; the first release just marks
+ * the ring closed and rings the other end's doorbell.
+ */
+
+#define END_PRODUCER 0x1
+#define END_CONSUMER 0x2
+
+typedef struct {
+    bool     active;
+    uint8_t  released;              /* END_* bits */
+    uint32_t producer;
+    uint32_t consumer;
+    uint32_t pages;                 /* Header page included */
+    uint32_t size;                  /* Data bytes; the ring's copy is the user's */
+    uint32_t phys[1 + CHAN_MAX_DATA_PAGES];
+} chan_t;
+
+static chan_t chans[CHAN_MAX];
+
+static uint32_t slot_kva(int id) { return CHAN_KVBASE + (uint32_t)id * CHAN_SLOT_SIZE; }
+static uint32_t slot_uva(int id) { return CHAN_UVADDR + (uint32_t)id * CHAN_SLOT_SIZE; }
+
+/* The header through the identity map, valid under any CR3 */
+static chan_ring_t* ring_of(const chan_t* c) { return (chan_ring_t*)c->phys[0]; }
+
+static void doorbell(uint32_t pid, uint32_t id) {
+    message_t m;
+    memset(&m, 0, sizeof(m));
+    m.type = MSG_CHAN_DOORBELL;
+    m.chan.id = id;
+    ipc_notify(pid, &m);
+}
+
+/* Tasks with their own address space get the user mapping; kernel tasks
+ * use the kernel one */
+static void map_end(const chan_t* c, int id, uint32_t pid) {
+    task_t* t = task_get_by_pid(pid);
+    if (!t || !t->page_directory) return;
+    for (uint32_t i = 0; i < c->pages; i++)
+        paging_map_user(t->page_directory, slot_uva(id) + i * PAGE_SIZE, c->phys[i],
+                        PAGE_PRESENT | PAGE_WRITE | PAGE_USER);
+}
+
+static void unmap_end(const chan_t* c, int id, uint32_t pid) {
+    task_t* t = task_get_by_pid(pid);
+    if (!t || !t->page_directory) return;   /* Kernel task: nothing mapped */
+    for (uint32_t i = 0; i < c->pages; i++)
+        paging_unmap_user(t->page_directory, slot_uva(id) + i * PAGE_SIZE);
+}
+
+static void free_chan(chan_t* c, int id) {
+    for (uint32_t i = 0; i < c->pages; i++) {
+        uint32_t va = slot_kva(id) + i * PAGE_SIZE;
+        paging_map_page(va, va, PAGE_PRESENT | PAGE_WRITE | PAGE_USER);    /* As paging_init */
+        pmm_free_page((void*)c->phys[i]);
+    }
+    memset(c, 0, sizeof(*c));
+}
+
+int32_t chan_create(uint32_t creator, uint32_t peer, uint32_t data_pages, uint32_t flags) {
+    if (creator == peer || !task_get_by_pid(creator) || !task_get_by_pid(peer)) return -1;
+    if (!data_pages || data_pages > CHAN_MAX_DATA_PAGES || (data_pages & (data_pages - 1)))
+        return -1;
+
+    int id = -1;
+    for (int i = 0; i < CHAN_MAX; i++)
+        if (!chans[i].active) { id = i; break; }
+    if (id < 0) return -1;
+
+    chan_t* c = &chans[id];
+    c->pages = data_pages + 1;
+    for (uint32_t i = 0; i < c->pages; i++) {
+        uint32_t phys = (uint32_t)pmm_alloc_page();
+        if (!phys) {
+            c->pages = i;
+            free_chan(c, id);
+            return -1;
+        }
+        memset((void*)phys, 0, PAGE_SIZE);
+        c->phys[i] = phys;
+        paging_map_page(slot_kva(id) + i * PAGE_SIZE, phys, PAGE_PRESENT | PAGE_WRITE);
+    }
+
+    c->active = true;
+    c->size = data_pages * PAGE_SIZE;
+    c->producer = (flags & CHAN_CREATOR_CONSUMES) ? peer : creator;
+    c->consumer = (flags & CHAN_CREATOR_CONSUMES) ? creator : peer;
+
+    chan_ring_t* r = ring_of(c);
+    r->id = (uint32_t)id;
+    r->size = c->size;
+    r->producer = c->producer;
+    r->consumer = c->consumer;
+    r->data_event = r->space_event = 0xFFFFFFFF;    /* Nobody asleep */
+
+    map_end(c, id, c->producer);
+    map_end(c, id, c->consumer);
+    serial_printf("chan: %d created, %u -> %u, %u KB\n",
+                  id, c->producer, c->consumer, r->size / 1024);
+    return id;
+}
+
+/* END_* bit for pid on an open channel, 0 if it is not a live end */
+static uint8_t end_of(uint32_t id, uint32_t pid) {
+    if (id >= CHAN_MAX || !chans[id].active) return 0;
+    uint8_t end = 0;
+    if (chans[id].producer == pid) end = END_PRODUCER;
+    else if (chans[id].consumer == pid) end = END_CONSUMER;
+    return (chans[id].released & end) ? 0 : end;
+}
+
+chan_ring_t* chan_map(uint32_t id, uint32_t pid) {
+    if (!end_of(id, pid)) return NULL;
+    task_t* t = task_get_by_pid(pid);
+    if (t && t->page_directory) return (chan_ring_t*)slot_uva((int)id);
+    return (chan_ring_t*)slot_kva((int)id);
+}
+
+static void release(uint32_t id, uint8_t end) {
+    chan_t* c = &chans[id];
+    uint32_t pid = end == END_PRODUCER ? c->producer : c->consumer;
+    uint32_t other = end == END_PRODUCER ? c->consumer : c->producer;
+
+    c->released |= end;
+    unmap_end(c, (int)id, pid);
+    if (c->released == (END_PRODUCER | END_CONSUMER)) {
+        free_chan(c, (int)id);
+        return;
+    }
+    ring_of(c)->closed = 1;
+    doorbell(other, id);
+}
+
+int32_t chan_close(uint32_t id, uint32_t pid) {
+    uint8_t end = end_of(id, pid);
+    if (!end) return -1;
+    release(id, end);
+    return 0;
+}
+
+void chan_task_exit(uint32_t pid) {
+    for (uint32_t id = 0; id < CHAN_MAX; id++) {
+        uint8_t end = end_of(id, pid);
+        if (end) release(id, end);
+    }
+}
+
+/* ===== Ring operations for kernel tasks =====
+ *
+ * The header page is mapped writable into the other end, so everything
+ * the kernel acts on -- size, the peer's PID, the channel id -- comes
+ * from chans[]; only the indices, event indices and closed flag are
+ * read from the ring, and indices are masked with the kernel's size
+ * before they touch memory.
+ */
+
+/* Full fence: orders our index store before reading the peer's event
+ * index (a locked op; mfence needs SSE2) */
+static inline void chan_mb(void) {
+    __asm__ volatile ("lock; addl $0, (%%esp)" : : : "memory");
+}
+
+static inline void chan_barrier(void) {
+    __asm__ volatile ("" : : : "memory");
+}
+
+/* The calling kernel task's end of id, or NULL if it is not that end */
+static chan_ring_t* kernel_end(uint32_t id, uint8_t end) {
+    task_t* t = task_get_current();
+    if (!t || t->page_directory || end_of(id, t->id) != end) return NULL;
+    return (chan_ring_t*)slot_kva((int)id);
+}
+
+static inline uint8_t* ring_data(chan_ring_t* r) {
+    return (uint8_t*)r + CHAN_DATA_OFFSET;
+}
+
+static void copy_in(chan_ring_t* r, uint32_t size, uint32_t pos, const void* src, uint32_t n) {
+    uint32_t off = pos & (size - 1);
+    uint32_t first = size - off < n ? size - off : n;
+    memcpy(ring_data(r) + off, src, first);
+    memcpy(ring_data(r), (const uint8_t*)src + first, n - first);
+}
+
+static void copy_out(chan_ring_t* r, uint32_t size, uint32_t pos, void* dst, uint32_t n) {
+    uint32_t off = pos & (size - 1);
+    uint32_t first = size - off < n ? size - off : n;
+    memcpy(dst, ring_data(r) + off, first);
+    memcpy((uint8_t*)dst + first, ring_data(r), n - first);
+}
+
+/* Sleep until a doorbell.  Notifications come from the kernel (PID 0)
+ * and one that arrived early is delivered without blocking. */
+static void wait_doorbell(void) {
+    message_t m;
+    ipc_receive(0, &m);
+}
+
+int32_t chan_write(uint32_t id, const void* data, uint32_t len) {
+    chan_ring_t* r = kernel_end(id, END_PRODUCER);
+    if (!r) return -1;
+    uint32_t size = chans[id].size;
+    uint32_t need = 4 + ((len + 3) & ~3u);
+    if (need > size || r->closed) return -1;
+
+    uint32_t head = r->head;
+    while (size - (head - r->tail) < need) {
+        if (r->closed) return -1;
+        if (head - r->tail > size) return -1;   /* Consumer corrupted the ring */
+        r->space_event = r->tail;
+        chan_mb();
+        if (size - (head - r->tail) >= need) break;
+        if (!r->closed) wait_doorbell();
+    }
+
+    copy_in(r, size, head, &len, 4);
+    copy_in(r, size, head + 4, data, len);
+    chan_barrier();                 /* x86 keeps stores in order */
+    r->head = head + need;
+    chan_mb();
+    if (chan_need_event(r->data_event, head + need, head)) doorbell(chans[id].consumer, id);
+    return (int32_t)len;
+}
+
+int32_t chan_read(uint32_t id, void* buf, uint32_t max) {
+    chan_ring_t* r = kernel_end(id, END_CONSUMER);
+    if (!r) return -1;
+    uint32_t size = chans[id].size;
+    uint32_t tail = r->tail;
+    while (r->head == tail) {
+        if (r->closed) return -1;
+        r->data_event = tail;
+        chan_mb();
+        if (r->head != tail) break;
+        if (!r->closed) wait_doorbell();
+    }
+    chan_barrier();
+
+    uint32_t len;
+    copy_out(r, size, tail, &len, 4);
+    if (len > size - 4) return -1;          /* Corrupt ring */
+    uint32_t copied = len < max ? len : max;    /* The rest of the record is dropped */
+    copy_out(r, size, tail + 4, buf, copied);
+    uint32_t next = tail + 4 + ((len + 3) & ~3u);
+    chan_barrier();
+    r->tail = next;
+    chan_mb();
+    if (chan_need_event(r->space_event, next, tail)) doorbell(chans[id].producer, id);
+    return (int32_t)copied;
+}
@@ -1,18 +1,18 @@
 ; crt0.asm — User-space C runtime entry point
-; Each server binary starts here. Calls main(), then SYS_EXIT.
+; Each server binary starts here. Calls main(), then sys_exit().
 
 section .note.GNU-stack noalloc noexec nowrite progbits
 
 section .text
 global _start
 extern main
+extern sys_exit
 
 _start:
     ; Stack is already set up by the kernel (user stack from ELF loader)
     call main
 
-    ; If main() ever returns, exit cleanly
-    mov eax, 6          ; SYS_EXIT
-    mov ebx, 0          ; exit code 0
-    int 0x80
+    ; If main() ever returns, exit through userlib so stdout is flushed
+    push eax            ; exit code = main's return value
+    call sys_exit
     jmp $               ; Should never reach here
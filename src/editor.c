@@ -2,72 +2,242 @@
 #include "vga.h"
 #include "keyboard.h"
 #include "ramfs.h"
+#include "heap.h"
 
-static char lines[EDITOR_MAX_LINES][EDITOR_LINE_LEN];
-static int num_lines;
-static int cursor_row, cursor_col;
-static int scroll_offset;
+/*
+ * The file is held in one gap buffer: bytes [0, gap_start) and
+ * [gap_end, text_cap) are the text, the hole between them follows the
+ * cursor so typing is a single store and moving costs only the distance
+ * travelled.  Both halves grow by doubling.
+ *
+ * Line starts live in a second gap array split after the cursor line.
+ * Lines 0..lfront-1 store their offset from the start of the text, the
+ * lback lines after them store their distance from the end.  Neither
+ * moves when bytes are inserted or deleted at the cursor, so an edit
+ * leaves the index alone and a newline is one push.
+ */
+static char*     text;
+static uint32_t  text_cap, gap_start, gap_end;
+
+static uint32_t* lidx;
+static uint32_t  lidx_cap, lfront, lback;
+
+static char*     cut_buf;
+static uint32_t  cut_len;
+
+static int32_t num_lines;
+static int32_t cursor_row, cursor_col;
+static int32_t scroll_offset, hscroll;
 static char edit_filename[64];
 static bool modified;
 
+/* Lines to repaint; nothing pending when dirty_first > dirty_last */
+static int32_t dirty_first, dirty_last;
+static int32_t drawn_scroll, drawn_hscroll, drawn_gutter;
+
 #define EDIT_ROWS (VGA_HEIGHT - 2) /* Reserve top and bottom rows */
 #define STATUS_ROW 0
 #define TEXT_START 1
+#define LINES_END 0x7FFFFFFF
+
+/* ===== Gap buffer ===== */
+
+static uint32_t text_len(void) {
+    return text_cap - (gap_end - gap_start);
+}
+
+static char text_at(uint32_t pos) {
+    return pos < gap_start ? text[pos] : text[pos + (gap_end - gap_start)];
+}
+
+static void gap_move(uint32_t pos) {
+    if (pos < gap_start) {
+        uint32_t n = gap_start - pos;
+        memmove(text + gap_end - n, text + pos, n);
+        gap_start -= n;
+        gap_end -= n;
+    } else if (pos > gap_start) {
+        uint32_t n = pos - gap_start;
+        memmove(text + gap_start, text + gap_end, n);
+        gap_start += n;
+        gap_end += n;
+    }
+}
+
+static bool gap_reserve(uint32_t n) {
+    if (gap_end - gap_start >= n) return true;
+    uint32_t len = text_len();
+    uint32_t cap = text_cap * 2;
+    if (cap < len + n + EDITOR_GAP_MIN) cap = len + n + EDITOR_GAP_MIN;
+    char* nt = (char*)kmalloc(cap);
+    if (!nt) return false;
+    uint32_t tail = text_cap - gap_end;
+    memcpy(nt, text, gap_start);
+    memcpy(nt + cap - tail, text + gap_end, tail);
+    kfree(text);
+    text = nt;
+    gap_end = cap - tail;
+    text_cap = cap;
+    return true;
+}
+
+/* ===== Line index ===== */
+
+static bool lidx_reserve(uint32_t n) {
+    if (lidx_cap - lfront - lback >= n) return true;
+    uint32_t cap = lidx_cap * 2;
+    if (cap < lfront + lback + n + EDITOR_LINES_MIN)
+        cap = lfront + lback + n + EDITOR_LINES_MIN;
+    uint32_t* ni = (uint32_t*)kmalloc(cap * sizeof(uint32_t));
+    if (!ni) return false;
+    memcpy(ni, lidx, lfront * sizeof(uint32_t));
+    memcpy(ni + cap - lback, lidx + lidx_cap - lback, lback * sizeof(uint32_t));
+    kfree(lidx);
+    lidx = ni;
+    lidx_cap = cap;
+    return true;
+}
+
+static uint32_t line_start(int32_t line) {
+    if ((uint32_t)line < lfront) return lidx[line];
+    return text_len() - lidx[lidx_cap - lback + (line - lfront)];
+}
+
+static uint32_t line_len(int32_t line) {
+    uint32_t end = line + 1 < num_lines ? line_start(line + 1) - 1 : text_len();
+    return end - line_start(line);
+}
+
+/* Move the index split so the cursor line is the last front entry */
+static void goto_row(int32_t row) {
+    uint32_t len = text_len();
+    while ((int32_t)lfront - 1 > row) {
+        uint32_t s = lidx[--lfront];
+        lidx[lidx_cap - ++lback] = len - s;
+    }
+    while ((int32_t)lfront - 1 < row) {
+        uint32_t d = lidx[lidx_cap - lback--];
+        lidx[lfront++] = len - d;
+    }
+    cursor_row = row;
+    uint32_t ll = line_len(row);
+    if ((uint32_t)cursor_col > ll) cursor_col = ll;
+}
+
+static uint32_t cursor_pos(void) {
+    return line_start(cursor_row) + cursor_col;
+}
+
+/* ===== Drawing ===== */
+
+static void mark_lines(int32_t first, int32_t last) {
+    if (dirty_first > dirty_last) {
+        dirty_first = first;
+        dirty_last = last;
+        return;
+    }
+    if (first < dirty_first) dirty_first = first;
+    if (last > dirty_last) dirty_last = last;
+}
+
+static int fmt_dec(char* out, uint32_t v) {
+    char tmp[12];
+    int n = 0;
+    do { tmp[n++] = '0' + v % 10; v /= 10; } while (v);
+    for (int i = 0; i < n; i++) out[i] = tmp[n - 1 - i];
+    return n;
+}
+
+/* Append str to buf at *pos, space padded to at least width */
+static void put_field(char* buf, int* pos, const char* str, int width) {
+    int n = 0;
+    while (str[n] && *pos < VGA_WIDTH) { buf[(*pos)++] = str[n++]; }
+    while (n++ < width && *pos < VGA_WIDTH) buf[(*pos)++] = ' ';
+}
+
+static int gutter_width(void) {
+    char tmp[12];
+    int w = fmt_dec(tmp, num_lines) + 1;
+    return w < 4 ? 4 : w;
+}
 
 static void editor_draw_status(void) {
-    /* Top status bar */
-    uint8_t old = terminal_getcolor();
-    terminal_set_cursor(STATUS_ROW, 0);
-    terminal_setcolor(0x70); /* Black on grey */
-    kprintf(" EDIT: %-20s  Ln:%-4d Col:%-4d  %s",
-            edit_filename, cursor_row + 1, cursor_col + 1,
-            modified ? "[Modified]" : "          ");
-    /* Pad to full width */
-    int r, c;
-    terminal_get_cursor(&r, &c);
-    while (c < VGA_WIDTH) { terminal_putchar(' '); c++; }
-
-    /* Bottom help bar */
-    terminal_set_cursor(VGA_HEIGHT - 1, 0);
-    terminal_setcolor(0x70);
-    kprintf(" ^S Save  ^Q Quit  ^G Goto  ^K Cut Line  ^U Paste             ");
-    terminal_get_cursor(&r, &c);
-    while (c < VGA_WIDTH) { terminal_putchar(' '); c++; }
-
-    terminal_setcolor(old);
+    char bar[VGA_WIDTH + 1];
+    char num[12];
+    int pos = 0;
+
+    /* Top status bar, black on grey */
+    put_field(bar, &pos, " EDIT: ", 0);
+    put_field(bar, &pos, edit_filename, 20);
+    put_field(bar, &pos, "  Ln:", 0);
+    num[fmt_dec(num, cursor_row + 1)] = '\0';
+    put_field(bar, &pos, num, 4);
+    put_field(bar, &pos, " Col:", 0);
+    num[fmt_dec(num, cursor_col + 1)] = '\0';
+    put_field(bar, &pos, num, 4);
+    put_field(bar, &pos, modified ? "  [Modified]" : "", 0);
+    while (pos < VGA_WIDTH) bar[pos++] = ' ';
+    bar[pos] = '\0';
+    terminal_print_at(STATUS_ROW, 0, bar, 0x70);
+
+    /* Bottom help bar; stop one short so the last cell does not scroll */
+    pos = 0;
+    put_field(bar, &pos, " ^S Save  ^Q Quit  ^K Cut Line  ^U Paste", VGA_WIDTH - 1);
+    bar[pos] = '\0';
+    terminal_print_at(VGA_HEIGHT - 1, 0, bar, 0x70);
+}
+
+static void editor_draw_row(int y, int gutter) {
+    char gut[16];
+    char row[VGA_WIDTH + 1];
+    int32_t line = scroll_offset + y;
+    int n = 0;
+
+    if (line < num_lines) {
+        char num[12];
+        int len = fmt_dec(num, line + 1);
+        while (n < gutter - 1 - len) gut[n++] = ' ';
+        memcpy(gut + n, num, len);
+        n += len;
+    } else {
+        while (n < gutter - 2) gut[n++] = ' ';
+        gut[n++] = '~';
+    }
+    gut[n++] = ' ';
+    gut[n] = '\0';
+    terminal_print_at(TEXT_START + y, 0, gut, 0x08);
+
+    int width = VGA_WIDTH - gutter;
+    n = 0;
+    if (line < num_lines) {
+        uint32_t start = line_start(line);
+        uint32_t len = line_len(line);
+        for (uint32_t x = hscroll; x < len && n < width; x++) {
+            char c = text_at(start + x);
+            row[n++] = (uint8_t)c < 32 ? ' ' : c;
+        }
+    }
+    while (n < width) row[n++] = ' ';
+    row[n] = '\0';
+    terminal_print_at(TEXT_START + y, gutter, row, 0x07);
 }
 
 static void editor_draw_text(void) {
-    uint8_t old = terminal_getcolor();
+    int gutter = gutter_width();
+    if (scroll_offset != drawn_scroll || hscroll != drawn_hscroll ||
+        gutter != drawn_gutter)
+        mark_lines(0, LINES_END);
+
     for (int y = 0; y < EDIT_ROWS; y++) {
-        terminal_set_cursor(TEXT_START + y, 0);
-        int line_idx = scroll_offset + y;
-        if (line_idx < num_lines) {
-            terminal_setcolor(0x08);
-            /* Line number (3 chars + space) */
-            int ln = line_idx + 1;
-            if (ln < 10) kprintf("  %d ", ln);
-            else if (ln < 100) kprintf(" %d ", ln);
-            else kprintf("%d ", ln);
-            terminal_setcolor(0x07);
-            /* Line content */
-            int len = strlen(lines[line_idx]);
-            for (int x = 0; x < VGA_WIDTH - 4 && x < len; x++)
-                terminal_putchar(lines[line_idx][x]);
-            /* Clear rest of line */
-            int r, c;
-            terminal_get_cursor(&r, &c);
-            while (c < VGA_WIDTH) { terminal_putchar(' '); c++; }
-        } else {
-            terminal_setcolor(0x08);
-            kprintf("  ~ ");
-            terminal_setcolor(0x07);
-            int r, c;
-            terminal_get_cursor(&r, &c);
-            while (c < VGA_WIDTH) { terminal_putchar(' '); c++; }
-        }
+        int32_t line = scroll_offset + y;
+        if (line >= dirty_first && line <= dirty_last)
+            editor_draw_row(y, gutter);
     }
-    terminal_setcolor(old);
+    dirty_first = 1;
+    dirty_last = 0;
+    drawn_scroll = scroll_offset;
+    drawn_hscroll = hscroll;
+    drawn_gutter = gutter;
 }
 
 static void editor_update_cursor(void) {
@@ -77,138 +247,200 @@ static void editor_update_cursor(void) {
     if (cursor_row >= scroll_offset + EDIT_ROWS)
         scroll_offset = cursor_row - EDIT_ROWS + 1;
 
-    terminal_set_cursor(TEXT_START + (cursor_row - scroll_offset), 4 + cursor_col);
+    int width = VGA_WIDTH - gutter_width();
+    if (cursor_col < hscroll)
+        hscroll = cursor_col;
+    if (cursor_col >= hscroll + width)
+        hscroll = cursor_col - width + 1;
+}
+
+static void editor_place_cursor(void) {
+    terminal_set_cursor(TEXT_START + (cursor_row - scroll_offset),
+                        gutter_width() + cursor_col - hscroll);
 }
 
-static void editor_insert_char(char c) {
-    if (cursor_row >= EDITOR_MAX_LINES) return;
-    int len = strlen(lines[cursor_row]);
-    if (len >= EDITOR_LINE_LEN - 2) return;
+/* ===== Editing ===== */
 
-    /* Shift right */
-    for (int i = len + 1; i > cursor_col; i--)
-        lines[cursor_row][i] = lines[cursor_row][i - 1];
-    lines[cursor_row][cursor_col] = c;
-    cursor_col++;
+static bool editor_insert_char(char c) {
+    if (!gap_reserve(1)) return false;
+    if (c == '\n' && !lidx_reserve(1)) return false;
+
+    uint32_t pos = cursor_pos();
+    gap_move(pos);
+    text[gap_start++] = c;
+    if (c == '\n') {
+        lidx[lfront++] = pos + 1;
+        num_lines++;
+        mark_lines(cursor_row, LINES_END);
+        cursor_row++;
+        cursor_col = 0;
+    } else {
+        mark_lines(cursor_row, cursor_row);
+        cursor_col++;
+    }
     modified = true;
+    return true;
 }
 
 static void editor_backspace(void) {
     if (cursor_col > 0) {
-        int len = strlen(lines[cursor_row]);
-        for (int i = cursor_col - 1; i < len; i++)
-            lines[cursor_row][i] = lines[cursor_row][i + 1];
+        gap_move(cursor_pos());
+        gap_start--;
         cursor_col--;
+        mark_lines(cursor_row, cursor_row);
         modified = true;
     } else if (cursor_row > 0) {
-        /* Join with previous line */
-        int prev_len = strlen(lines[cursor_row - 1]);
-        int cur_len = strlen(lines[cursor_row]);
-        if (prev_len + cur_len < EDITOR_LINE_LEN - 1) {
-            strcat(lines[cursor_row - 1], lines[cursor_row]);
-            /* Shift all lines up */
-            for (int i = cursor_row; i < num_lines - 1; i++)
-                strcpy(lines[i], lines[i + 1]);
-            num_lines--;
-            lines[num_lines][0] = '\0';
-            cursor_row--;
-            cursor_col = prev_len;
-            modified = true;
-        }
+        /* Join with previous line: drop its newline and its index entry */
+        uint32_t prev_len = line_len(cursor_row - 1);
+        gap_move(cursor_pos());
+        gap_start--;
+        lfront--;
+        num_lines--;
+        cursor_row--;
+        cursor_col = prev_len;
+        mark_lines(cursor_row, LINES_END);
+        modified = true;
     }
 }
 
-static void editor_enter(void) {
-    if (num_lines >= EDITOR_MAX_LINES) return;
-
-    /* Shift lines down */
-    for (int i = num_lines; i > cursor_row + 1; i--)
-        strcpy(lines[i], lines[i - 1]);
-    num_lines++;
-
-    /* Split current line */
-    int len = strlen(lines[cursor_row]);
-    strcpy(lines[cursor_row + 1], lines[cursor_row] + cursor_col);
-    lines[cursor_row][cursor_col] = '\0';
-    (void)len;
-
-    cursor_row++;
-    cursor_col = 0;
+static void editor_delete(void) {
+    uint32_t pos = cursor_pos();
+    if (pos >= text_len()) return;
+    gap_move(pos);
+    if (text[gap_end] == '\n') {
+        /* The next line merges into this one */
+        lback--;
+        num_lines--;
+        mark_lines(cursor_row, LINES_END);
+    } else {
+        mark_lines(cursor_row, cursor_row);
+    }
+    gap_end++;
     modified = true;
 }
 
 static void editor_cut_line(void) {
-    static char cut_buffer[EDITOR_LINE_LEN];
-    strcpy(cut_buffer, lines[cursor_row]);
-    if (num_lines > 1) {
-        for (int i = cursor_row; i < num_lines - 1; i++)
-            strcpy(lines[i], lines[i + 1]);
+    uint32_t start = line_start(cursor_row);
+    uint32_t len = line_len(cursor_row);
+
+    /* The cut buffer always ends in a newline so ^U pastes whole lines */
+    char* cb = (char*)kmalloc(len + 1);
+    if (!cb) return;
+    for (uint32_t i = 0; i < len; i++) cb[i] = text_at(start + i);
+    cb[len] = '\n';
+    if (cut_buf) kfree(cut_buf);
+    cut_buf = cb;
+    cut_len = len + 1;
+
+    uint32_t del = len;
+    if (lback > 0) {
+        /* Take the newline too; the next line's entry now names this one */
+        del++;
+        lback--;
         num_lines--;
-        lines[num_lines][0] = '\0';
-        if (cursor_row >= num_lines && cursor_row > 0)
-            cursor_row--;
-    } else {
-        lines[0][0] = '\0';
+    } else if (cursor_row > 0) {
+        /* Last line: take the newline before it instead */
+        start--;
+        del++;
+        lfront--;
+        num_lines--;
+        cursor_row--;
     }
+    gap_move(start + del);
+    gap_start -= del;
     cursor_col = 0;
+    mark_lines(cursor_row, LINES_END);
     modified = true;
-    /* Store in global for paste - we'll use a static for simplicity */
-    (void)cut_buffer;
+}
+
+static void editor_paste(void) {
+    cursor_col = 0;
+    for (uint32_t i = 0; i < cut_len; i++)
+        if (!editor_insert_char(cut_buf[i])) break;
 }
 
 static void editor_save(void) {
-    /* Build file content */
-    char buf[RAMFS_MAX_DATA];
-    int pos = 0;
-    for (int i = 0; i < num_lines && pos < RAMFS_MAX_DATA - 2; i++) {
-        int len = strlen(lines[i]);
-        if (pos + len + 1 >= RAMFS_MAX_DATA) break;
-        memcpy(buf + pos, lines[i], len);
-        pos += len;
-        buf[pos++] = '\n';
-    }
-    ramfs_write(edit_filename, buf, pos);
-    modified = false;
+    /* ramfs wants one contiguous run: park the gap at the end */
+    uint32_t len = text_len();
+    gap_move(len);
+    if (ramfs_write(edit_filename, text, len) >= 0)
+        modified = false;
+}
+
+/* ===== Load / main loop ===== */
+
+static bool editor_load(const char* filename) {
+    ramfs_type_t type;
+    uint32_t size = 0;
+    if (ramfs_stat(filename, &type, &size) < 0 || type != RAMFS_FILE)
+        size = 0;
+
+    /* Text goes at the top of the buffer so the gap starts at the cursor */
+    text_cap = size + EDITOR_GAP_MIN;
+    text = (char*)kmalloc(text_cap);
+    if (!text) return false;
+    int32_t n = size ? ramfs_read(filename, text + text_cap - size, size) : 0;
+    if (n < 0) n = 0;
+    if ((uint32_t)n < size)
+        memmove(text + text_cap - n, text + text_cap - size, n);
+    gap_start = 0;
+    gap_end = text_cap - n;
+
+    uint32_t newlines = 0;
+    for (uint32_t i = gap_end; i < text_cap; i++)
+        if (text[i] == '\n') newlines++;
+
+    lidx_cap = newlines + 1 + EDITOR_LINES_MIN;
+    lidx = (uint32_t*)kmalloc(lidx_cap * sizeof(uint32_t));
+    if (!lidx) return false;
+    lidx[0] = 0;
+    lfront = 1;
+    lback = newlines;
+    uint32_t k = lidx_cap - lback;
+    for (uint32_t i = gap_end; i < text_cap; i++)
+        if (text[i] == '\n') lidx[k++] = text_cap - i - 1;
+    num_lines = newlines + 1;
+    return true;
+}
+
+static void editor_free(void) {
+    if (text) kfree(text);
+    if (lidx) kfree(lidx);
+    if (cut_buf) kfree(cut_buf);
+    text = NULL;
+    lidx = NULL;
+    cut_buf = NULL;
+    text_cap = gap_start = gap_end = 0;
+    lidx_cap = lfront = lback = 0;
+    cut_len = 0;
 }
 
 void editor_open(const char* filename) {
-    memset(lines, 0, sizeof(lines));
-    num_lines = 1;
-    cursor_row = cursor_col = scroll_offset = 0;
+    cursor_row = cursor_col = scroll_offset = hscroll = 0;
     modified = false;
     strncpy(edit_filename, filename, sizeof(edit_filename) - 1);
+    edit_filename[sizeof(edit_filename) - 1] = '\0';
 
-    /* Try to load file */
-    char buf[RAMFS_MAX_DATA];
-    int32_t n = ramfs_read(filename, buf, sizeof(buf));
-    if (n > 0) {
-        num_lines = 0;
-        int col = 0;
-        for (int32_t i = 0; i < n && num_lines < EDITOR_MAX_LINES; i++) {
-            if (buf[i] == '\n') {
-                lines[num_lines][col] = '\0';
-                num_lines++;
-                col = 0;
-            } else if (col < EDITOR_LINE_LEN - 1) {
-                lines[num_lines][col++] = buf[i];
-            }
-        }
-        if (col > 0 || num_lines == 0) {
-            lines[num_lines][col] = '\0';
-            num_lines++;
-        }
+    if (!editor_load(filename)) {
+        editor_free();
+        kprintf("edit: out of memory\n");
+        return;
     }
 
     /* Editor main loop */
     terminal_clear();
+    drawn_scroll = -1;
+    mark_lines(0, LINES_END);
+    editor_update_cursor();
     editor_draw_status();
     editor_draw_text();
-    editor_update_cursor();
+    editor_place_cursor();
 
     while (1) {
         unsigned char c = (unsigned char)keyboard_getchar();
 
         if (c == 17) { /* Ctrl+Q */
+            editor_free();
             terminal_clear();
             return;
         }
@@ -216,43 +448,42 @@ void editor_open(const char* filename) {
             editor_save();
         } else if (c == 11) { /* Ctrl+K */
             editor_cut_line();
+        } else if (c == 21) { /* Ctrl+U */
+            editor_paste();
         } else if (c == '\n') {
-            editor_enter();
+            editor_insert_char('\n');
         } else if (c == '\b') {
             editor_backspace();
-        } else if (c == KEY_UP && cursor_row > 0) {
-            cursor_row--;
-            int len = strlen(lines[cursor_row]);
-            if (cursor_col > len) cursor_col = len;
-        } else if (c == KEY_DOWN && cursor_row < num_lines - 1) {
-            cursor_row++;
-            int len = strlen(lines[cursor_row]);
-            if (cursor_col > len) cursor_col = len;
+        } else if (c == KEY_DELETE) {
+            editor_delete();
+        } else if (c == KEY_UP) {
+            if (cursor_row > 0) goto_row(cursor_row - 1);
+        } else if (c == KEY_DOWN) {
+            if (cursor_row < num_lines - 1) goto_row(cursor_row + 1);
         } else if (c == KEY_LEFT) {
             if (cursor_col > 0) cursor_col--;
-            else if (cursor_row > 0) { cursor_row--; cursor_col = strlen(lines[cursor_row]); }
+            else if (cursor_row > 0) { goto_row(cursor_row - 1); cursor_col = line_len(cursor_row); }
         } else if (c == KEY_RIGHT) {
-            int len = strlen(lines[cursor_row]);
-            if (cursor_col < len) cursor_col++;
-            else if (cursor_row < num_lines - 1) { cursor_row++; cursor_col = 0; }
+            if ((uint32_t)cursor_col < line_len(cursor_row)) cursor_col++;
+            else if (cursor_row < num_lines - 1) { goto_row(cursor_row + 1); cursor_col = 0; }
         } else if (c == KEY_HOME) {
             cursor_col = 0;
         } else if (c == KEY_END) {
-            cursor_col = strlen(lines[cursor_row]);
+            cursor_col = line_len(cursor_row);
         } else if (c == KEY_PGUP) {
-            cursor_row -= EDIT_ROWS;
-            if (cursor_row < 0) cursor_row = 0;
+            goto_row(cursor_row > EDIT_ROWS ? cursor_row - EDIT_ROWS : 0);
         } else if (c == KEY_PGDOWN) {
-            cursor_row += EDIT_ROWS;
-            if (cursor_row >= num_lines) cursor_row = num_lines - 1;
-        } else if (c >= 32 && c != 127) {
-            editor_insert_char(c);
+            int32_t r = cursor_row + EDIT_ROWS;
+            goto_row(r < num_lines ? r : num_lines - 1);
         } else if (c == '\t') {
             for (int i = 0; i < 4; i++) editor_insert_char(' ');
+        } else if (c >= 32 && c < 127) {
+            editor_insert_char(c);
         }
 
+        editor_update_cursor();
         editor_draw_status();
         editor_draw_text();
-        editor_update_cursor();
+        editor_place_cursor();
     }
 }
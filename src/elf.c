@@ -6,6 +6,8 @@
 #include "gdt.h"
 #include "vga.h"
 #include "serial.h"
+#include "ramfs.h"
+#include "timer.h"
 
 /*
  * ELF Loader — loads user-space binaries into isolated address spaces.
@@ -16,11 +18,13 @@
  * down the kernel.
  *
  * Loading process:
- *   1. Validate ELF header (32-bit, x86, executable)
+ *   1. Validate ELF header (32-bit, x86, executable), unless the file
+ *      is already in the image cache
  *   2. Create isolated page directory (kernel pages supervisor-only)
  *   3. For each PT_LOAD segment:
- *      a. Allocate physical frames
- *      b. Copy file data, zero BSS
+ *      a. Share aligned read-only pages from stable backing, or
+ *         allocate a frame and copy straight from the file pages
+ *      b. Zero only the BSS remainder
  *      c. Map at segment's virtual address with PAGE_USER
  *   4. Allocate and map user stack
  *   5. Allocate kernel stack (for ring 3 → ring 0 transitions)
@@ -71,15 +75,110 @@ int elf_validate(const void* data, uint32_t size) {
     return 0;
 }
 
+/* ---- File handles ---- */
+
+int elf_open(const char* path, elf_file_t* file) {
+    memset(file, 0, sizeof(*file));
+    file->node = -1;
+
+    /* ramfs-resident files: read segments straight out of the node */
+    uint32_t size;
+    const uint8_t* data = ramfs_get_data(path, &size);
+    if (data) {
+        if (size == 0) return -2;
+        file->data = data;
+        file->size = size;
+        file->node = ramfs_find(path);
+        ramfs_node_t* node = ramfs_get_node(file->node);
+        file->version = node ? node->version : 0;
+        return 0;
+    }
+
+    /* Disk-backed files only support whole-file reads: stage once */
+    ramfs_type_t type;
+    if (ramfs_stat(path, &type, &size) != 0) return -1;
+    if (type != RAMFS_FILE || size == 0) return -2;
+
+    uint8_t* buf = (uint8_t*)kmalloc(size);
+    if (!buf) return -3;
+    int32_t n = ramfs_read(path, buf, size);
+    if (n <= 0) {
+        kfree(buf);
+        return -2;
+    }
+    file->data = buf;
+    file->size = (uint32_t)n;
+    file->staged = true;
+    return 0;
+}
+
+void elf_open_mem(const void* data, uint32_t size, bool stable, elf_file_t* file) {
+    file->data = (const uint8_t*)data;
+    file->size = size;
+    file->staged = false;
+    file->stable = stable;
+    file->node = -1;
+    file->version = 0;
+}
+
+void elf_close(elf_file_t* file) {
+    if (file->staged && file->data)
+        kfree((void*)file->data);
+    file->data = NULL;
+    file->size = 0;
+    file->staged = false;
+}
+
+/*
+ * Fill one page of a segment from the file.  A fresh frame gets the
+ * file bytes and zeroes around them; a frame already holding another
+ * segment's bytes only has this segment's part written (file bytes,
+ * then the BSS remainder zeroed).
+ */
+static void fill_segment_page(uint8_t* frame, bool fresh, uint32_t page_start,
+                              const elf32_phdr_t* phdr, const elf_file_t* file) {
+    uint32_t page_end       = page_start + PAGE_SIZE;
+    uint32_t seg_file_start = phdr->p_vaddr;
+    uint32_t seg_file_end   = phdr->p_vaddr + phdr->p_filesz;
+    uint32_t seg_mem_end    = phdr->p_vaddr + phdr->p_memsz;
+
+    uint32_t off = 0, len = 0;
+    if (seg_file_end > page_start && seg_file_start < page_end) {
+        uint32_t copy_start = (seg_file_start > page_start) ? seg_file_start : page_start;
+        uint32_t copy_end   = (seg_file_end < page_end) ? seg_file_end : page_end;
+        off = copy_start - page_start;
+        len = copy_end - copy_start;
+        memcpy(frame + off, file->data + phdr->p_offset + (copy_start - phdr->p_vaddr), len);
+    }
+
+    if (fresh) {
+        if (!len) {
+            memset(frame, 0, PAGE_SIZE);
+        } else {
+            if (off) memset(frame, 0, off);
+            if (off + len < PAGE_SIZE) memset(frame + off + len, 0, PAGE_SIZE - off - len);
+        }
+        return;
+    }
+
+    uint32_t bss_start = (seg_file_end > page_start) ? seg_file_end : page_start;
+    uint32_t bss_end   = (seg_mem_end < page_end) ? seg_mem_end : page_end;
+    if (bss_end > bss_start)
+        memset(frame + (bss_start - page_start), 0, bss_end - bss_start);
+}
+
 /*
  * Map an ELF segment into a user address space.
  *
- * Allocates physical pages, copies data from the ELF file,
- * zeros BSS (memsz > filesz), and maps with appropriate permissions.
+ * Each page is populated straight from the file's backing store:
+ *   - read-only pages wholly covered by file data whose source is
+ *     page-aligned in stable memory are mapped in place (no copy);
+ *   - otherwise a private frame receives the file bytes and only the
+ *     head/tail not covered by them is zeroed (BSS remainder).
+ * A page already mapped by an earlier segment (or shared from the image
+ * cache) is reused, taking a private copy first if it is not owned.
  */
-// src/elf.c
-
-static int map_segment(uint32_t* pd, const elf32_phdr_t* phdr, const uint8_t* file_data) {
+static int map_segment(uint32_t* pd, const elf32_phdr_t* phdr, const elf_file_t* file) {
     uint32_t vaddr_start = phdr->p_vaddr & ~0xFFF;
     uint32_t vaddr_end   = (phdr->p_vaddr + phdr->p_memsz + 0xFFF) & ~0xFFF;
     uint32_t num_pages   = (vaddr_end - vaddr_start) / PAGE_SIZE;
@@ -88,51 +187,226 @@ static int map_segment(uint32_t* pd, const elf32_phdr_t* phdr, const uint8_t* fi
     if (phdr->p_flags & PF_W) flags |= PAGE_WRITE;
 
     for (uint32_t i = 0; i < num_pages; i++) {
-        uint32_t page_vaddr = vaddr_start + i * PAGE_SIZE;
+        uint32_t page_start = vaddr_start + i * PAGE_SIZE;
+        uint32_t pte = paging_get_user_pte(pd, page_start);
+
+        if (!(pte & PAGE_PRESENT)) {
+            /* Share read-only text/rodata straight from the backing pages */
+            if (file->stable && !(flags & PAGE_WRITE) &&
+                page_start >= phdr->p_vaddr &&
+                page_start + PAGE_SIZE <= phdr->p_vaddr + phdr->p_filesz) {
+                uint32_t src = (uint32_t)file->data + phdr->p_offset + (page_start - phdr->p_vaddr);
+                if ((src & 0xFFF) == 0) {
+                    paging_map_user(pd, page_start, src, flags);
+                    continue;
+                }
+            }
+
+            uint32_t frame_phys = (uint32_t)pmm_alloc_page();
+            if (!frame_phys) return -1;
+
+            /* Identity mapped kernel: write directly to frame address */
+            fill_segment_page((uint8_t*)frame_phys, true, page_start, phdr, file);
+            paging_map_user(pd, page_start, frame_phys, flags | PAGE_OWNED);
+            continue;
+        }
 
-        // Allocate frame
-        uint32_t frame_phys = (uint32_t)pmm_alloc_page();
-        if (!frame_phys) return -1;
+        /* Page already populated by a previous segment */
+        uint32_t frame_phys = pte & 0xFFFFF000;
+        if (!(pte & PAGE_OWNED)) {
+            /* It was shared: take a private copy before writing */
+            uint32_t copy = (uint32_t)pmm_alloc_page();
+            if (!copy) return -1;
+            memcpy((void*)copy, (const void*)frame_phys, PAGE_SIZE);
+            frame_phys = copy;
+        }
 
-        // Identity mapped kernel: write directly to frame address
-        memset((void*)frame_phys, 0, PAGE_SIZE);
+        fill_segment_page((uint8_t*)frame_phys, false, page_start, phdr, file);
+        paging_map_user(pd, page_start, frame_phys,
+                        (pte & (PAGE_WRITE | PAGE_USER)) | flags | PAGE_OWNED);
+    }
+    return 0;
+}
 
-        // Copy file data if it falls within this page
-        uint32_t seg_file_start = phdr->p_vaddr;
-        uint32_t seg_file_end   = phdr->p_vaddr + phdr->p_filesz;
-        uint32_t page_start = page_vaddr;
-        uint32_t page_end   = page_vaddr + PAGE_SIZE;
+/* ---- Image cache ---- */
+
+typedef struct {
+    uint32_t vaddr;
+    uint32_t phys;
+} elf_shared_page_t;
+
+typedef struct {
+    bool               active;
+    bool               stale;       /* File changed: free when users drops to 0 */
+    int32_t            node;        /* ramfs identity */
+    uint32_t           version;
+    uint32_t           size;
+    uint32_t           entry;
+    uint32_t           nloads;
+    elf32_phdr_t       loads[ELF_CACHE_MAX_LOADS];
+    elf_shared_page_t* pages;       /* Read-only pages, shared by every user */
+    uint32_t           npages;
+    uint32_t           users;       /* Live processes mapping the pages */
+    uint32_t           last_used;   /* Tick, for LRU eviction */
+} elf_image_t;
+
+static elf_image_t image_cache[ELF_CACHE_SLOTS];
+
+static void image_free(elf_image_t* img) {
+    for (uint32_t i = 0; i < img->npages; i++)
+        pmm_free_page((void*)img->pages[i].phys);
+    if (img->pages) kfree(img->pages);
+    memset(img, 0, sizeof(*img));
+}
 
-        if (seg_file_end > page_start && seg_file_start < page_end) {
-            uint32_t copy_start = (seg_file_start > page_start) ? seg_file_start : page_start;
-            uint32_t copy_end   = (seg_file_end < page_end) ? seg_file_end : page_end;
-            uint32_t copy_len   = copy_end - copy_start;
+static void image_retire(elf_image_t* img) {
+    if (img->users == 0) image_free(img);
+    else img->stale = true;
+}
 
-            uint32_t file_offset = phdr->p_offset + (copy_start - phdr->p_vaddr);
-            uint32_t page_offset = copy_start - page_start;
+void elf_image_release(uint32_t handle) {
+    if (handle == 0 || handle > ELF_CACHE_SLOTS) return;
+    elf_image_t* img = &image_cache[handle - 1];
+    if (!img->active || img->users == 0) return;
+    if (--img->users == 0 && img->stale) image_free(img);
+}
 
-            memcpy((uint8_t*)frame_phys + page_offset, file_data + file_offset, copy_len);
+static elf_image_t* image_lookup(const elf_file_t* file) {
+    if (file->node < 0) return NULL;
+    for (int i = 0; i < ELF_CACHE_SLOTS; i++) {
+        elf_image_t* img = &image_cache[i];
+        if (!img->active || img->stale || img->node != file->node) continue;
+        if (img->version == file->version && img->size == file->size) {
+            img->last_used = timer_get_ticks();
+            return img;
         }
+        image_retire(img);   /* File rewritten since it was cached */
+    }
+    return NULL;
+}
 
-        // Map into user PD
-        paging_map_user(pd, page_vaddr, frame_phys, flags);
+/* A PT_LOAD whose file bytes lie inside the file and whose memory range
+ * neither wraps nor runs into the last page (so rounding up is safe) */
+static bool segment_fits(const elf32_phdr_t* phdr, uint32_t file_size) {
+    return phdr->p_filesz <= phdr->p_memsz &&
+           phdr->p_offset <= file_size &&
+           phdr->p_filesz <= file_size - phdr->p_offset &&
+           phdr->p_vaddr <= 0xFFFFF000 &&
+           phdr->p_memsz <= 0xFFFFF000 - phdr->p_vaddr;
+}
+
+/*
+ * Parse an already-validated file into a cache slot: keep its PT_LOAD
+ * headers and build the read-only pages once.  Returns NULL if the file
+ * is not cacheable, malformed, or no slot can be freed; the caller then
+ * takes the uncached path (which reports malformed files).
+ */
+static elf_image_t* image_build(const elf_file_t* file) {
+    if (file->node < 0) return NULL;
+
+    const elf32_ehdr_t* ehdr = (const elf32_ehdr_t*)file->data;
+    elf32_phdr_t loads[ELF_CACHE_MAX_LOADS];
+    uint32_t nloads = 0, max_pages = 0;
+    uint32_t ro_lo = 0xFFFFFFFF, ro_hi = 0;
+
+    for (uint32_t i = 0; i < ehdr->e_phnum; i++) {
+        const elf32_phdr_t* phdr = (const elf32_phdr_t*)
+            (file->data + ehdr->e_phoff + i * ehdr->e_phentsize);
+        if (phdr->p_type != PT_LOAD || phdr->p_memsz == 0) continue;
+        if (nloads == ELF_CACHE_MAX_LOADS) return NULL;
+        if (phdr->p_vaddr < USER_BASE || !segment_fits(phdr, file->size))
+            return NULL;
+        loads[nloads++] = *phdr;
+        if (!(phdr->p_flags & PF_W)) {
+            uint32_t start = phdr->p_vaddr & ~0xFFF;
+            uint32_t end   = (phdr->p_vaddr + phdr->p_memsz + 0xFFF) & ~0xFFF;
+            max_pages += (end - start) / PAGE_SIZE;
+            if (start < ro_lo) ro_lo = start;
+            if (end > ro_hi)   ro_hi = end;
+        }
     }
-    return 0;
+
+    /* Frames built so far, indexed by page from ro_lo: segments that
+     * share a boundary page fill the same frame */
+    uint32_t span = max_pages ? (ro_hi - ro_lo) / PAGE_SIZE : 0;
+    if (span > ELF_CACHE_MAX_SPAN) return NULL;
+    uint32_t* built = NULL;
+    if (span) {
+        built = (uint32_t*)kmalloc(span * sizeof(uint32_t));
+        if (!built) return NULL;
+        memset(built, 0, span * sizeof(uint32_t));
+    }
+
+    /* Free slot, else evict the least recently used idle image */
+    elf_image_t* img = NULL;
+    for (int i = 0; i < ELF_CACHE_SLOTS; i++) {
+        elf_image_t* c = &image_cache[i];
+        if (!c->active) { img = c; break; }
+        if (c->users == 0 && (!img || c->last_used < img->last_used)) img = c;
+    }
+    if (!img) { kfree(built); return NULL; }
+    if (img->active) image_free(img);
+
+    if (max_pages) {
+        img->pages = (elf_shared_page_t*)kmalloc(max_pages * sizeof(elf_shared_page_t));
+        if (!img->pages) { kfree(built); return NULL; }
+    }
+
+    for (uint32_t l = 0; l < nloads; l++) {
+        const elf32_phdr_t* phdr = &loads[l];
+        if (phdr->p_flags & PF_W) continue;
+
+        uint32_t vaddr_start = phdr->p_vaddr & ~0xFFF;
+        uint32_t vaddr_end   = (phdr->p_vaddr + phdr->p_memsz + 0xFFF) & ~0xFFF;
+        for (uint32_t va = vaddr_start; va < vaddr_end; va += PAGE_SIZE) {
+            uint32_t* slot = &built[(va - ro_lo) / PAGE_SIZE];
+            uint32_t phys = *slot;
+            bool fresh = (phys == 0);
+            if (fresh) {
+                phys = (uint32_t)pmm_alloc_page();
+                if (!phys) { image_free(img); kfree(built); return NULL; }
+                *slot = phys;
+                img->pages[img->npages].vaddr = va;
+                img->pages[img->npages].phys  = phys;
+                img->npages++;
+            }
+            fill_segment_page((uint8_t*)phys, fresh, va, phdr, file);
+        }
+    }
+
+    img->active    = true;
+    img->node      = file->node;
+    img->version   = file->version;
+    img->size      = file->size;
+    img->entry     = ehdr->e_entry;
+    img->nloads    = nloads;
+    memcpy(img->loads, loads, nloads * sizeof(elf32_phdr_t));
+    img->last_used = timer_get_ticks();
+    kfree(built);
+    return img;
 }
 
 
 
-int32_t elf_load(const void* data, uint32_t size, const char* name,
+int32_t elf_load(const elf_file_t* file, const char* name,
                  uint32_t priority, bool io_privileged, uint32_t flags) {
-    /* Validate first */
-    if (elf_validate(data, size) != 0)
-        return -1;
+    if (!file) return -1;
 
-    const elf32_ehdr_t* ehdr = (const elf32_ehdr_t*)data;
-    const uint8_t* file_data = (const uint8_t*)data;
+    /* Warm launch: headers already parsed, text frames already built */
+    elf_image_t* img = image_lookup(file);
+    if (!img) {
+        if (elf_validate(file->data, file->size) != 0)
+            return -1;
+        img = image_build(file);
+    }
 
-    serial_printf("ELF: loading '%s' entry=%x phnum=%u\n",
-                  name, ehdr->e_entry, ehdr->e_phnum);
+    const elf32_ehdr_t* ehdr = (const elf32_ehdr_t*)file->data;
+    const uint8_t* file_data = file->data;
+    uint32_t size = file->size;
+    uint32_t entry = img ? img->entry : ehdr->e_entry;
+
+    serial_printf("ELF: loading '%s' entry=%x phnum=%u%s\n",
+                  name, entry, ehdr->e_phnum, img ? " (image cache)" : "");
 
     /* Create an isolated address space.
      * Kernel pages are supervisor-only — ring 3 code CANNOT access them. */
@@ -142,8 +416,23 @@ int32_t elf_load(const void* data, uint32_t size, const char* name,
         return -1;
     }
 
-    /* Load each PT_LOAD segment */
-    for (uint32_t i = 0; i < ehdr->e_phnum; i++) {
+    if (img) {
+        /* Shared read-only pages, then private copies of writable segments */
+        for (uint32_t i = 0; i < img->npages; i++)
+            paging_map_user(pd, img->pages[i].vaddr, img->pages[i].phys,
+                            PAGE_PRESENT | PAGE_USER);
+
+        for (uint32_t i = 0; i < img->nloads; i++) {
+            if (!(img->loads[i].p_flags & PF_W)) continue;
+            if (map_segment(pd, &img->loads[i], file) != 0) {
+                paging_destroy_address_space(pd);
+                return -1;
+            }
+        }
+    }
+
+    /* Load each PT_LOAD segment (uncached files) */
+    for (uint32_t i = 0; !img && i < ehdr->e_phnum; i++) {
         const elf32_phdr_t* phdr = (const elf32_phdr_t*)
             (file_data + ehdr->e_phoff + i * ehdr->e_phentsize);
 
@@ -160,8 +449,8 @@ int32_t elf_load(const void* data, uint32_t size, const char* name,
             return -1;
         }
 
-        /* Validate file data is within bounds */
-        if (phdr->p_offset + phdr->p_filesz > size) {
+        /* Validate file data is within bounds and the range does not wrap */
+        if (!segment_fits(phdr, size)) {
             serial_printf("ELF: segment file data exceeds binary size\n");
             paging_destroy_address_space(pd);
             return -1;
@@ -170,17 +459,15 @@ int32_t elf_load(const void* data, uint32_t size, const char* name,
         serial_printf("ELF:   LOAD vaddr=%x memsz=%x filesz=%x flags=%x\n",
                       phdr->p_vaddr, phdr->p_memsz, phdr->p_filesz, phdr->p_flags);
 
-        if (map_segment(pd, phdr, file_data) != 0) {
+        if (map_segment(pd, phdr, file) != 0) {
             paging_destroy_address_space(pd);
             return -1;
         }
     }
 
     /* Allocate and map user stack (grows downward from USER_STACK_TOP) */
-/* Allocate and map user stack (grows downward from USER_STACK_TOP) */
     uint32_t stack_bottom = USER_STACK_TOP - (USER_STACK_PAGES * PAGE_SIZE);
-    const uint32_t TEMP_MAP_VA = 0x3FD00000;
-    
+
     for (uint32_t i = 0; i < USER_STACK_PAGES; i++) {
         uint32_t frame_phys = (uint32_t)pmm_alloc_page();
         if (!frame_phys) {
@@ -189,14 +476,12 @@ int32_t elf_load(const void* data, uint32_t size, const char* name,
             return -1;
         }
         
-        /* Zero the stack page using temporary mapping */
-        paging_map_page(TEMP_MAP_VA, frame_phys, PAGE_PRESENT | PAGE_WRITE);
-        memset((void*)TEMP_MAP_VA, 0, PAGE_SIZE);
-        paging_unmap_page(TEMP_MAP_VA);
+        /* Identity mapped kernel: zero the stack frame directly */
+        memset((void*)frame_phys, 0, PAGE_SIZE);
         
         /* Map into user space */
         paging_map_user(pd, stack_bottom + i * PAGE_SIZE, frame_phys,
-                        PAGE_PRESENT | PAGE_WRITE | PAGE_USER);
+                        PAGE_PRESENT | PAGE_WRITE | PAGE_USER | PAGE_OWNED);
     }
 
     /* Map VGA memory if requested (for console server) */
@@ -218,10 +503,13 @@ int32_t elf_load(const void* data, uint32_t size, const char* name,
         return -1;
     }
 
-    /* Create the task using the ELF-specific task creation function */
+    /* Create the task using the ELF-specific task creation function.
+     * Hold off preemption until the image reference is recorded, so the
+     * task cannot exit before it owns one. */
+    task_lock_scheduler();
     int32_t pid = task_create_from_elf(
         name,
-        ehdr->e_entry,           /* Entry point from ELF header */
+        entry,                   /* Entry point from ELF header */
         USER_STACK_TOP,          /* User stack top */
         pd,                      /* Isolated page directory */
         (uint32_t)kernel_stack,  /* Kernel stack base */
@@ -230,6 +518,12 @@ int32_t elf_load(const void* data, uint32_t size, const char* name,
         io_privileged
     );
 
+    if (pid >= 0 && img) {
+        img->users++;
+        task_get_by_pid((uint32_t)pid)->elf_image = (uint32_t)(img - image_cache) + 1;
+    }
+    task_unlock_scheduler();
+
     if (pid < 0) {
         serial_printf("ELF: failed to create task\n");
         kfree(kernel_stack);
@@ -238,6 +532,6 @@ int32_t elf_load(const void* data, uint32_t size, const char* name,
     }
 
     serial_printf("ELF: loaded '%s' as PID %u (entry=%x, isolated address space)\n",
-                  name, pid, ehdr->e_entry);
+                  name, pid, entry);
     return pid;
 }
@@ -9,6 +9,7 @@
 #include "minifont.h"
 #include "image.h"
 #include "procfs.h"
+#include "sysmon.h"
 #include "heap.h"
 #include "fat16.h"
 #include "ntfs.h"
@@ -22,6 +23,7 @@
 #include "rtc.h"
 #include "virtio_gpu.h"
 #include "virgl.h" 
+#include "input.h"
 
 /* ====== CONSTANTS ====== */
 static uint16_t GFX_W = 1920;
@@ -32,6 +34,7 @@ static uint16_t GFX_H = 1080;
 #define TITLEBAR_H 25
 #define MAX_WINDOWS 8
 #define MAX_WIN_TITLE 40
+#define GUI_IDLE_TICKS 5     /* Longest wait for input between redraw checks */
 
 /* ====== BGA (Bochs VBE) REGISTERS ====== */
 #define BGA_IOPORT_INDEX 0x01CE
@@ -240,13 +243,72 @@ static void bga_disable(void) {
 }
 
 /* ====== BLIT ====== */
+/*
+ * Damage-tracked present.  The backbuffer is diffed against the scanout
+ * copy in bands of BLIT_BAND rows; only changed column spans are copied,
+ * and vertically adjacent dirty bands with overlapping extents are merged
+ * into one rectangle.  The rects go to the GPU in a single asynchronous batch,
+ * so the next frame is drawn while the host is still transferring this one.
+ */
+#define BLIT_BAND      16
+#define BLIT_MAX_RECTS 16
+
 static void blit(void) {
-  
-        /* virtio FB is regular RAM (identity-mapped) — memcpy is safe & fast */
-        uint32_t* fb = virtio_gpu_get_fb();
-        memcpy(fb, backbuf, GFX_W * GFX_H * sizeof(uint32_t));
-        virtio_gpu_flush_all();
-    
+    uint32_t* fb = virtio_gpu_get_fb();
+    if (!fb) return;
+
+    virtio_gpu_rect_t rects[BLIT_MAX_RECTS];
+    uint32_t nrects = 0;
+
+    for (int y0 = 0; y0 < GFX_H; y0 += BLIT_BAND) {
+        int y1 = y0 + BLIT_BAND;
+        if (y1 > GFX_H) y1 = GFX_H;
+
+        /* Changed x-extent of this band */
+        int minx = GFX_W, maxx = -1;
+        for (int y = y0; y < y1; y++) {
+            const uint32_t* src = &backbuf[y * GFX_W];
+            const uint32_t* dst = &fb[y * GFX_W];
+            int l = 0, r = GFX_W - 1;
+            while (l < GFX_W && src[l] == dst[l]) l++;
+            if (l == GFX_W) continue;
+            while (r > l && src[r] == dst[r]) r--;
+            if (l < minx) minx = l;
+            if (r > maxx) maxx = r;
+        }
+        if (maxx < 0) continue;
+
+        uint32_t w = maxx - minx + 1, h = y1 - y0;
+
+        /* The host may still be reading these pixels from the last frame */
+        virtio_gpu_wait_rect(minx, y0, w, h);
+        for (int y = y0; y < y1; y++)
+            memcpy(&fb[y * GFX_W + minx], &backbuf[y * GFX_W + minx],
+                   w * sizeof(uint32_t));
+
+        /* Grow the previous rect when it ends right above this band with
+         * an overlapping extent, or when we are out of rects */
+        virtio_gpu_rect_t* last = nrects ? &rects[nrects - 1] : NULL;
+        if (last && (nrects == BLIT_MAX_RECTS ||
+                     (last->y + last->height == (uint32_t)y0 &&
+                      last->x <= (uint32_t)maxx &&
+                      (uint32_t)minx < last->x + last->width))) {
+            uint32_t rx0 = last->x < (uint32_t)minx ? last->x : (uint32_t)minx;
+            uint32_t rx1 = last->x + last->width > (uint32_t)minx + w ?
+                           last->x + last->width : (uint32_t)minx + w;
+            last->x = rx0;
+            last->width = rx1 - rx0;
+            last->height = y1 - last->y;
+        } else {
+            rects[nrects].x = minx;
+            rects[nrects].y = y0;
+            rects[nrects].width = w;
+            rects[nrects].height = h;
+            nrects++;
+        }
+    }
+
+    if (nrects) virtio_gpu_flush_rects(rects, nrects);
 }
 
 /* ====== DRAWING PRIMITIVES ====== */
@@ -497,7 +559,7 @@ static void draw_cursor(int mx, int my) {
 }
 
 /* ====== WINDOW MANAGER ====== */
-typedef enum { APP_NONE=0, APP_ABOUT, APP_CALC, APP_FILES, APP_NOTEPAD, APP_IMGVIEW, APP_GL3D, APP_TERM, APP_ELF_GL } app_type_t;
+typedef enum { APP_NONE=0, APP_ABOUT, APP_CALC, APP_FILES, APP_NOTEPAD, APP_IMGVIEW, APP_GL3D, APP_TERM, APP_ELF_GL, APP_MONITOR } app_type_t;
 
 typedef struct {
     bool active;
@@ -1125,32 +1187,81 @@ static void draw_app_imgview(window_t* win) {
 
 /* ====== APP: TERMINAL ====== */
 
-/* Global terminal output buffer */
-#define TERM_OUT_SIZE  16384
+/*
+ * Global terminal scrollback: a ring of text plus a ring of line records.
+ * Offsets and line numbers are absolute (they only grow); the rings are
+ * indexed with a mask.  The last record is the open line being appended
+ * to.  Each record keeps its first wrapped row (row0) at term_wrap_cols,
+ * so the draw finds its first visible line by binary search and only
+ * touches what is on screen; a width change re-derives row0 once.
+ * When either ring is full the oldest lines are dropped.
+ */
+#define TERM_TEXT_SIZE  65536          /* Power of two */
+#define TERM_MAX_LINES  4096           /* Power of two */
+#define TERM_LINE_MAX   2048           /* Longer lines are broken here */
 #define TERM_HIST_SIZE 8
 #define TERM_HIST_LEN  256
-static char term_out[TERM_OUT_SIZE];
-static int  term_out_len = 0;
+
+typedef struct {
+    uint32_t start;     /* Absolute text offset of the first char */
+    uint32_t len;       /* Chars, without the '\n' */
+    uint32_t row0;      /* First wrapped row at term_wrap_cols */
+} term_line_t;
+
+static char        term_text[TERM_TEXT_SIZE];
+static term_line_t term_lines[TERM_MAX_LINES];
+static uint32_t    term_text_end = 0;      /* Next text offset */
+static uint32_t    term_line_first = 0;    /* Oldest line kept */
+static uint32_t    term_line_last = 0;     /* Open line */
+static int         term_wrap_cols = 80;
 static char term_history[TERM_HIST_SIZE][TERM_HIST_LEN];
 static int  term_hist_count = 0;
 
+#define TERM_LINE(n)  (&term_lines[(n) & (TERM_MAX_LINES - 1)])
+#define TERM_CHAR(o)  (term_text[(o) & (TERM_TEXT_SIZE - 1)])
+
+/* Rows a finished line takes; an empty one still takes a row */
+static uint32_t term_line_rows(uint32_t len) {
+    return len ? (len + term_wrap_cols - 1) / term_wrap_cols : 1;
+}
+
+static void term_clear(void) {
+    term_text_end = 0;
+    term_line_first = term_line_last = 0;
+    memset(TERM_LINE(0), 0, sizeof(term_line_t));
+}
+
+static void term_newline(void) {
+    term_line_t* cur = TERM_LINE(term_line_last);
+    uint32_t row0 = cur->row0 + term_line_rows(cur->len);
+    if (term_line_last - term_line_first + 1 >= TERM_MAX_LINES)
+        term_line_first++;
+    term_line_last++;
+    cur = TERM_LINE(term_line_last);
+    cur->start = term_text_end;
+    cur->len = 0;
+    cur->row0 = row0;
+}
+
+static void term_putc(char c) {
+    if (c == '\n') { term_newline(); return; }
+    term_line_t* cur = TERM_LINE(term_line_last);
+    if (cur->len >= TERM_LINE_MAX) {
+        term_newline();
+        cur = TERM_LINE(term_line_last);
+    }
+    /* The open line never outgrows the ring, so this only drops
+     * finished lines */
+    while (term_text_end - TERM_LINE(term_line_first)->start >= TERM_TEXT_SIZE)
+        term_line_first++;
+    TERM_CHAR(term_text_end) = c;
+    term_text_end++;
+    cur->len++;
+}
+
 /* Append text to terminal output buffer */
 static void term_print(const char* s) {
-    while (*s) {
-        if (term_out_len >= TERM_OUT_SIZE - 1) {
-            /* Shift buffer: discard first half */
-            int half = TERM_OUT_SIZE / 2;
-            /* Find start of a line near the midpoint */
-            int cut = half;
-            while (cut < term_out_len && term_out[cut] != '\n') cut++;
-            if (cut < term_out_len) cut++;
-            int remain = term_out_len - cut;
-            memmove(term_out, term_out + cut, remain);
-            term_out_len = remain;
-        }
-        term_out[term_out_len++] = *s++;
-    }
-    term_out[term_out_len] = '\0';
+    while (*s) term_putc(*s++);
 }
 
 /* Printf-style into terminal - uses same va_list builtins as procfs */
@@ -1246,15 +1357,36 @@ static void term_printf(const char* fmt, ...) {
     term_va_end(ap);
 }
 
-/* Count lines in terminal output */
+/* Re-derive the wrapped-row index for a new width */
+static void term_reflow(int char_cols) {
+    if (char_cols == term_wrap_cols) return;
+    term_wrap_cols = char_cols;
+    uint32_t row = 0;
+    for (uint32_t n = term_line_first; n != term_line_last + 1; n++) {
+        term_line_t* l = TERM_LINE(n);
+        l->row0 = row;
+        row += term_line_rows(l->len);
+    }
+}
+
+/* Count wrapped lines in terminal output (an empty open line is none) */
 static int term_count_lines(int char_cols) {
-    int lines = 0, col = 0;
-    for (int i = 0; i < term_out_len; i++) {
-        if (term_out[i] == '\n') { lines++; col = 0; }
-        else { col++; if (col >= char_cols) { lines++; col = 0; } }
+    term_reflow(char_cols);
+    term_line_t* last = TERM_LINE(term_line_last);
+    uint32_t end = last->row0 + (last->len ? term_line_rows(last->len) : 0);
+    return (int)(end - TERM_LINE(term_line_first)->row0);
+}
+
+/* Line holding wrapped row `row` (counted from the oldest line) */
+static uint32_t term_find_row(uint32_t row) {
+    uint32_t target = TERM_LINE(term_line_first)->row0 + row;
+    uint32_t lo = term_line_first, hi = term_line_last;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo + 1) / 2;
+        if (TERM_LINE(mid)->row0 <= target) lo = mid;
+        else hi = mid - 1;
     }
-    if (col > 0) lines++;
-    return lines;
+    return lo;
 }
 
 /* Terminal command processor */
@@ -1326,7 +1458,7 @@ static void term_exec_cmd(window_t* win) {
     }
     /* ---- clear ---- */
     else if (strcmp(argv[0], "clear") == 0) {
-        term_out_len = 0; term_out[0] = '\0';
+        term_clear();
         win->term.scroll = 0;
     }
     /* ---- pwd ---- */
@@ -1463,28 +1595,26 @@ static void term_exec_cmd(window_t* win) {
             ename = namebuf;
         }
 
-        /* Stat + read */
-        ramfs_type_t ftype; uint32_t fsize;
-        if (ramfs_stat(target, &ftype, &fsize) < 0) {
-            term_printf("exec: %s: Not found\n", argv[1]); return;
+        /* Open: ramfs data is used in place, disk files are staged once */
+        elf_file_t file;
+        int rc = elf_open(target, &file);
+        if (rc == -1) { term_printf("exec: %s: Not found\n", argv[1]); return; }
+        if (rc == -2) { term_printf("exec: %s: Not a file\n", argv[1]); return; }
+        if (rc < 0) { term_print("exec: Out of memory\n"); return; }
+        if (file.size < sizeof(elf32_ehdr_t)) {
+            term_printf("exec: Too small for ELF (%u bytes)\n", file.size);
+            elf_close(&file); return;
         }
-        if (ftype != RAMFS_FILE) { term_printf("exec: %s: Not a file\n", argv[1]); return; }
-        if (fsize < sizeof(elf32_ehdr_t)) { term_printf("exec: Too small for ELF (%u bytes)\n", fsize); return; }
 
-        uint8_t* buf = (uint8_t*)kmalloc(fsize);
-        if (!buf) { term_printf("exec: Out of memory (need %u bytes)\n", fsize); return; }
-        int32_t rd = ramfs_read(target, buf, fsize);
-        if (rd <= 0) { kfree(buf); term_print("exec: Read failed\n"); return; }
-
-        if (elf_validate(buf, (uint32_t)rd) != 0) {
-            kfree(buf);
+        if (elf_validate(file.data, file.size) != 0) {
+            elf_close(&file);
             term_printf("exec: %s: Not a valid ELF binary\n", argv[1]);
             return;
         }
 
-        term_printf("Loading '%s' (%u bytes)...\n", ename, rd);
-        int32_t pid = elf_load(buf, (uint32_t)rd, ename, priority, io_priv, flags);
-        kfree(buf);
+        term_printf("Loading '%s' (%u bytes)...\n", ename, file.size);
+        int32_t pid = elf_load(&file, ename, priority, io_priv, flags);
+        elf_close(&file);
 
         if (pid < 0) { term_print("exec: Failed to load ELF\n"); return; }
         term_printf("[OK] Process '%s' started (PID %u", ename, pid);
@@ -1579,25 +1709,22 @@ static void term_exec_cmd(window_t* win) {
         bool found_elf = false;
         if (ramfs_stat(target, &ftype, &fsize) >= 0 && ftype == RAMFS_FILE) {
             /* Try as ELF automatically */
-            if (fsize >= sizeof(elf32_ehdr_t)) {
-                uint8_t* buf = (uint8_t*)kmalloc(fsize);
-                if (buf) {
-                    int32_t rd = ramfs_read(target, buf, fsize);
-                    if (rd > 0 && elf_validate(buf, (uint32_t)rd) == 0) {
-                        /* Auto-exec */
-                        const char* bn = argv[0];
-                        for (const char* q = argv[0]; *q; q++) if (*q == '/') bn = q + 1;
-                        char nb[32]; strncpy(nb, bn, 31); nb[31] = '\0';
-                        size_t nl = strlen(nb);
-                        if (nl > 4 && strcmp(nb + nl - 4, ".elf") == 0) nb[nl - 4] = '\0';
-                        term_printf("Loading '%s'...\n", nb);
-                        int32_t pid = elf_load(buf, (uint32_t)rd, nb, 2, false, 0);
-                        if (pid >= 0) term_printf("[OK] Process '%s' started (PID %u)\n", nb, pid);
-                        else term_print("Failed to load\n");
-                        found_elf = true;
-                    }
-                    kfree(buf);
+            elf_file_t file;
+            if (fsize >= sizeof(elf32_ehdr_t) && elf_open(target, &file) == 0) {
+                if (elf_validate(file.data, file.size) == 0) {
+                    /* Auto-exec */
+                    const char* bn = argv[0];
+                    for (const char* q = argv[0]; *q; q++) if (*q == '/') bn = q + 1;
+                    char nb[32]; strncpy(nb, bn, 31); nb[31] = '\0';
+                    size_t nl = strlen(nb);
+                    if (nl > 4 && strcmp(nb + nl - 4, ".elf") == 0) nb[nl - 4] = '\0';
+                    term_printf("Loading '%s'...\n", nb);
+                    int32_t pid = elf_load(&file, nb, 2, false, 0);
+                    if (pid >= 0) term_printf("[OK] Process '%s' started (PID %u)\n", nb, pid);
+                    else term_print("Failed to load\n");
+                    found_elf = true;
                 }
+                elf_close(&file);
             }
         }
         if (!found_elf)
@@ -1633,23 +1760,23 @@ static void draw_app_term(window_t* win) {
     if (max_scroll < 0) max_scroll = 0;
     if (win->term.scroll > max_scroll) win->term.scroll = max_scroll;
 
-    /* Draw output buffer */
+    /* Draw the visible rows of the output buffer */
     int tx = x + 4, ty = y + 2;
-    int cur_line = 0, col = 0;
     uint32_t text_col = RGB(200, 255, 200);  /* Light green */
-    uint32_t dir_col = RGB(100, 200, 255);   /* Cyan for directories */
 
-    for (int i = 0; i < term_out_len; i++) {
-        char c = term_out[i];
-        if (c == '\n') {
-            cur_line++; col = 0; continue;
-        }
-        if (col >= char_cols) { cur_line++; col = 0; }
-        int vis_row = cur_line - win->term.scroll;
-        if (vis_row >= 0 && vis_row < char_rows) {
-            draw_char(tx + col * FONT_W, ty + vis_row * FONT_H, c, text_col);
+    uint32_t n = term_find_row((uint32_t)win->term.scroll);
+    term_line_t* l = TERM_LINE(n);
+    uint32_t off = (TERM_LINE(term_line_first)->row0 + win->term.scroll - l->row0) * char_cols;
+    for (int vis_row = 0; vis_row < char_rows; vis_row++) {
+        for (int col = 0; col < char_cols && off + col < l->len; col++)
+            draw_char(tx + col * FONT_W, ty + vis_row * FONT_H,
+                      TERM_CHAR(l->start + off + col), text_col);
+        off += char_cols;
+        if (off >= l->len) {
+            if (n == term_line_last) break;
+            l = TERM_LINE(++n);
+            off = 0;
         }
-        col++;
     }
 
     /* Draw input line at bottom of terminal */
@@ -1801,12 +1928,59 @@ static void term_init_window(window_t* win) {
     win->term.cwd[63] = '\0';
 
     /* Print welcome message if buffer is empty */
-    if (term_out_len == 0) {
+    if (term_text_end == 0) {
         term_print("MicroKernel Terminal v1.0\n");
         term_print("Type 'help' for available commands.\n\n");
     }
 }
 
+/* ====== APP: MONITOR ====== */
+/* One sampler shared by all Monitor windows; the main loop calls
+ * sysmon_update() once a second while one is open */
+static sysmon_t gui_mon;
+static bool     gui_mon_ready;          /* gui_mon.view holds an interval */
+static uint32_t gui_mon_next;           /* Tick of the next sample */
+
+#define MON_LINE_H (FONT_H + 3)
+
+static void monitor_init_window(void) {
+    gui_mon.primed = false;
+    gui_mon_ready = false;
+    sysmon_update(&gui_mon);
+    gui_mon_next = timer_get_ticks() + timer_get_frequency();
+}
+
+static void monitor_tick(void) {
+    if ((int32_t)(timer_get_ticks() - gui_mon_next) < 0) return;
+    gui_mon_next = timer_get_ticks() + timer_get_frequency();
+    if (sysmon_update(&gui_mon)) gui_mon_ready = true;
+    gui_mark_dirty();
+}
+
+static void draw_app_monitor(window_t* win) {
+    int x = win->x + 4, y = win->y + TITLEBAR_H + 2;
+    int cw = win->w - 8, ch = win->h - TITLEBAR_H - 6;
+
+    fill_rect(x, y, cw, ch, RGB(12, 12, 12));
+    draw_rect(x - 1, y - 1, cw + 2, ch + 2, RGB(60, 60, 60));
+
+    if (!gui_mon_ready) {
+        draw_text(x + 4, y + 4, "Sampling...", RGB(160, 160, 160));
+        return;
+    }
+
+    char line[128];
+    int cols = (cw - 8) / FONT_W;
+    if (cols > (int)sizeof(line) - 1) cols = sizeof(line) - 1;
+    int rows = (ch - 8) / MON_LINE_H;
+    int lines = sysmon_lines(&gui_mon.view);
+    for (int n = 0; n < lines && n < rows; n++) {
+        bool head = sysmon_line(&gui_mon.view, n, line, cols);
+        draw_text(x + 4, y + 4 + n * MON_LINE_H, line,
+                  head ? RGB(100, 200, 255) : RGB(200, 200, 200));
+    }
+}
+
 /* ====== APP: 3D VIEWER ====== */
 static void gl3d_init_window(window_t* win) {
     win->gl3d.ax = 25; win->gl3d.ay = 0; win->gl3d.dist = 5;
@@ -2449,7 +2623,7 @@ static void draw_taskbar(void) {
 #define SM_X 2
 #define SM_W 200
 #define SM_ITEM_H 24
-#define MENU_COUNT 8
+#define MENU_COUNT 9
 #define SM_BANNER_H 48
 #define SM_BOTTOM_H 32
 #define SM_BODY_H (MENU_COUNT * SM_ITEM_H + 8)
@@ -2457,13 +2631,13 @@ static void draw_taskbar(void) {
 #define SM_Y (GFX_H - TASKBAR_H - SM_H)
 
 static const char* menu_items[] = {
-    "Terminal", "Calculator", "Notepad", "Files", "3D Demo", "About", "---", "Turn Off Computer", NULL
+    "Terminal", "Calculator", "Notepad", "Files", "3D Demo", "Monitor", "About", "---", "Turn Off Computer", NULL
 };
 
 /* Icons for menu items (which icon type to draw) */
-typedef enum { ICON_TERM, ICON_CALC, ICON_NOTE, ICON_FILES, ICON_3D, ICON_ABOUT, ICON_NONE, ICON_EXIT } menu_icon_t;
+typedef enum { ICON_TERM, ICON_CALC, ICON_NOTE, ICON_FILES, ICON_3D, ICON_MONITOR, ICON_ABOUT, ICON_NONE, ICON_EXIT } menu_icon_t;
 static const menu_icon_t menu_icons[] = {
-    ICON_TERM, ICON_CALC, ICON_NOTE, ICON_FILES, ICON_3D, ICON_ABOUT, ICON_NONE, ICON_EXIT
+    ICON_TERM, ICON_CALC, ICON_NOTE, ICON_FILES, ICON_3D, ICON_MONITOR, ICON_ABOUT, ICON_NONE, ICON_EXIT
 };
 
 /* Draw a tiny 12x12 icon for menu items */
@@ -2510,6 +2684,14 @@ static void draw_menu_icon(int x, int y, menu_icon_t icon) {
             /* Connect corners for 3D effect */
             putpixel(x + 3, y + 3, RGB(40, 60, 120));
             break;
+        case ICON_MONITOR:
+            /* Screen with a bar graph */
+            fill_rect(x, y, 12, 12, RGB(12, 12, 12));
+            draw_rect(x, y, 12, 12, RGB(100, 100, 160));
+            fill_rect(x + 2, y + 7, 2, 3, RGB(100, 255, 100));
+            fill_rect(x + 5, y + 3, 2, 7, RGB(100, 255, 100));
+            fill_rect(x + 8, y + 5, 2, 5, RGB(100, 255, 100));
+            break;
         case ICON_ABOUT:
             /* Info circle */
             fill_rect(x + 3, y + 1, 6, 10, RGB(50, 100, 200));
@@ -2627,6 +2809,7 @@ void render(void) {
             case APP_GL3D:    draw_app_gl3d(&windows[i]); break;
             case APP_TERM:    draw_app_term(&windows[i]); break;
             case APP_ELF_GL:  draw_app_elf_gl(&windows[i]); break;
+            case APP_MONITOR: draw_app_monitor(&windows[i]); break;
             default: break;
         }
     }
@@ -2704,8 +2887,11 @@ static void handle_start_click(int mx, int my) {
             int idx = open_window("3D Demo", 100, 60, GL_WIN_W + 14, GL_WIN_H + TITLEBAR_H + 10, APP_GL3D);
             if (idx >= 0) gl3d_init_window(&windows[idx]);
         } else if (item == 5) {
+            if (open_window("System Monitor", 90, 40, 420, 340, APP_MONITOR) >= 0)
+                monitor_init_window();
+        } else if (item == 6) {
             open_window("About MicroKernel OS", 170, 100, 290, 230, APP_ABOUT);
-        } else if (item == 7) {
+        } else if (item == 8) {
             gui_running = false;
         }
     } else { start_menu_open = false; }
@@ -2962,12 +3148,17 @@ void gui_start(void) {
         handle_keyboard();
 
         /* Active ELF GL windows are continuously animating — always redraw */
+        bool animating = false;
+        bool monitoring = false;
         for (int i = 0; i < MAX_WINDOWS; i++) {
-            if (windows[i].active && windows[i].app == APP_ELF_GL) {
+            if (!windows[i].active) continue;
+            if (windows[i].app == APP_MONITOR) monitoring = true;
+            if (windows[i].app == APP_ELF_GL) {
                 gui_mark_dirty();
-                break;
+                animating = true;
             }
         }
+        if (monitoring) monitor_tick();
 
         /* Only redraw + blit when something actually changed */
         if (needs_redraw) {
@@ -2975,7 +3166,9 @@ void gui_start(void) {
             needs_redraw = false;
         }
 
-        task_sleep(10);
+        /* Sleep until input arrives; the timeout only paces animation
+         * and redraws requested by other tasks */
+        input_wait(animating ? 1 : GUI_IDLE_TICKS);
     }
 
     mouse_set_bounds(319, 199);
@@ -14,6 +14,10 @@ typedef struct block_header {
 static block_header_t* heap_start = NULL;
 static size_t heap_total = 0;
 
+/* Kept current by kmalloc/kfree so the space queries need no walk */
+static size_t heap_used = 0;       /* Bytes in allocated blocks */
+static size_t heap_blocks = 0;     /* Headers, free or not */
+
 void heap_init(void* start, size_t size) {
     heap_start = (block_header_t*)start;
     heap_start->magic = HEAP_MAGIC;
@@ -22,6 +26,8 @@ void heap_init(void* start, size_t size) {
     heap_start->next  = NULL;
     heap_start->prev  = NULL;
     heap_total = size;
+    heap_used = 0;
+    heap_blocks = 1;
 }
 
 static void split_block(block_header_t* block, size_t size) {
@@ -38,6 +44,7 @@ static void split_block(block_header_t* block, size_t size) {
     if (block->next) block->next->prev = new_block;
     block->next = new_block;
     block->size = size;
+    heap_blocks++;
 }
 
 static void merge_free(block_header_t* block) {
@@ -46,6 +53,7 @@ static void merge_free(block_header_t* block) {
         block->size += sizeof(block_header_t) + block->next->size;
         block->next = block->next->next;
         if (block->next) block->next->prev = block;
+        heap_blocks--;
     }
 }
 
@@ -59,6 +67,7 @@ void* kmalloc(size_t size) {
         if (curr->free && curr->size >= size) {
             split_block(curr, size);
             curr->free = false;
+            heap_used += curr->size;
             return (void*)((uint8_t*)curr + sizeof(block_header_t));
         }
         curr = curr->next;
@@ -80,6 +89,7 @@ void kfree(void* ptr) {
         return;
     }
     block->free = true;
+    heap_used -= block->size;
 
     /* Merge with neighbors */
     if (block->prev && block->prev->free) {
@@ -89,23 +99,11 @@ void kfree(void* ptr) {
 }
 
 size_t heap_free_space(void) {
-    size_t total = 0;
-    block_header_t* curr = heap_start;
-    while (curr) {
-        if (curr->free) total += curr->size;
-        curr = curr->next;
-    }
-    return total;
+    return heap_total - heap_blocks * sizeof(block_header_t) - heap_used;
 }
 
 size_t heap_used_space(void) {
-    size_t total = 0;
-    block_header_t* curr = heap_start;
-    while (curr) {
-        if (!curr->free) total += curr->size;
-        curr = curr->next;
-    }
-    return total;
+    return heap_used;
 }
 
 void heap_dump(void) {
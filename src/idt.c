@@ -114,6 +114,10 @@ void register_interrupt_handler(uint8_t n, isr_t handler) {
     interrupt_handlers[n] = handler;
 }
 
+isr_t get_interrupt_handler(uint8_t n) {
+    return interrupt_handlers[n];
+}
+
 void isr_handler(registers_t* regs) {
     if (interrupt_handlers[regs->int_no]) {
         interrupt_handlers[regs->int_no](regs);
@@ -123,6 +127,7 @@ void isr_handler(registers_t* regs) {
                       name, regs->int_no, regs->err_code, regs->eip);
         task_t* t = task_get_current();
         if (t) serial_printf("  Task: '%s' PID=%u\n", t->name, t->id);
+        terminal_set_redirect(NULL);    /* Straight to the screen, even from a pipeline */
         kprintf("\n PANIC: %s (int %u, err=%x, eip=%x)\n",
                 name, regs->int_no, regs->err_code, regs->eip);
         kprintf("  System halted.\n");
@@ -134,10 +139,17 @@ void isr_handler(registers_t* regs) {
 /* Returns new ESP for task switch, or 0 for no switch */
 extern uint32_t task_preempt_check(registers_t* regs);
 
+/* Depth of IRQ handlers on the stack; the task switch happens after it
+ * drops back to zero */
+static volatile uint32_t irq_depth = 0;
+
+bool irq_in_handler(void) { return irq_depth > 0; }
+
 uint32_t irq_handler(registers_t* regs) {
     /* ACK the PIC */
     if (regs->int_no >= 40) outb(0xA0, 0x20);
     outb(0x20, 0x20);
+    irq_depth++;
 
     /* Call the kernel-registered handler (timer, keyboard, etc.) */
     if (interrupt_handlers[regs->int_no])
@@ -159,6 +171,7 @@ uint32_t irq_handler(registers_t* regs) {
         }
     }
 
+    irq_depth--;
     return task_preempt_check(regs);
 }
 
@@ -0,0 +1,118 @@
+#include "input.h"
+#include "task.h"
+#include "timer.h"
+
+/*
+ * Input ring — single consumer, producers serialized by the CPU.
+ *
+ * Every producer runs with interrupts disabled (an IRQ handler, or the
+ * virtio used-ring drain), so they never race each other.  The consumer
+ * takes an event with interrupts briefly off: that is what lets a
+ * producer safely rewrite the newest unread motion event in place.
+ * head/tail are free-running counters, as in the pipe rings.
+ */
+
+#define RING_MASK        (INPUT_RING_SIZE - 1)
+#define INPUT_WAIT_SLICE 100        /* Re-check deadline for "forever" waits */
+
+static input_event_t      ring[INPUT_RING_SIZE];
+static volatile uint32_t  ring_head;     /* Total events pushed */
+static volatile uint32_t  ring_tail;     /* Total events consumed */
+static volatile uint32_t  ring_waiter;   /* Sleeping reader's pid + 1 */
+static input_stats_t      stats;
+
+void input_init(void) {
+    memset(ring, 0, sizeof(ring));
+    memset(&stats, 0, sizeof(stats));
+    ring_head = ring_tail = 0;
+    ring_waiter = 0;
+}
+
+void input_push(const input_event_t* ev) {
+    /* Fold motion into an unread motion event from the same source,
+     * provided the button state has not changed in between */
+    if (ev->type == INPUT_EV_MOTION && ring_head != ring_tail) {
+        input_event_t* last = &ring[(ring_head - 1) & RING_MASK];
+        if (last->type == INPUT_EV_MOTION && last->source == ev->source &&
+            last->buttons == ev->buttons) {
+            last->x   = ev->x;
+            last->y   = ev->y;
+            last->tsc = ev->tsc;
+            stats.coalesced++;
+            return;
+        }
+    }
+
+    if (ring_head - ring_tail >= INPUT_RING_SIZE) {
+        stats.dropped++;
+        return;
+    }
+
+    ring[ring_head & RING_MASK] = *ev;
+    ring_head++;
+    stats.pushed++;
+
+    uint32_t w = ring_waiter;
+    if (w) {
+        ring_waiter = 0;
+        task_t* t = task_get_by_pid(w - 1);
+        if (t && t->state == TASK_SLEEPING) t->state = TASK_READY;
+    }
+}
+
+static bool take(input_event_t* ev, bool consume) {
+    uint32_t flags = irq_save();
+    bool have = ring_head != ring_tail;
+    if (have) {
+        *ev = ring[ring_tail & RING_MASK];
+        if (consume) ring_tail++;
+    }
+    irq_restore(flags);
+    return have;
+}
+
+bool input_poll(input_event_t* ev) { return take(ev, true); }
+bool input_peek(input_event_t* ev) { return take(ev, false); }
+
+bool input_wait(uint32_t timeout) {
+    uint32_t start = timer_get_ticks();
+
+    while (ring_head == ring_tail) {
+        uint32_t waited = timer_get_ticks() - start;
+        if (timeout && waited >= timeout) return false;
+
+        task_t* self = task_get_current();
+        if (!self) { hlt(); continue; }      /* Before tasking: plain idle */
+
+        uint32_t flags = irq_save();
+        if (ring_head == ring_tail) {
+            ring_waiter = self->id + 1;
+            self->state = TASK_SLEEPING;
+            self->wake_tick = timer_get_ticks() +
+                              (timeout ? timeout - waited : INPUT_WAIT_SLICE);
+        }
+        irq_restore(flags);
+        task_yield();
+    }
+    return true;
+}
+
+bool input_read(input_event_t* ev, uint32_t timeout) {
+    uint32_t start = timer_get_ticks();
+    while (!input_poll(ev)) {
+        uint32_t left = 0;
+        if (timeout) {
+            uint32_t waited = timer_get_ticks() - start;
+            if (waited >= timeout) return false;
+            left = timeout - waited;
+        }
+        if (!input_wait(left)) return false;
+    }
+    return true;
+}
+
+void input_get_stats(input_stats_t* st) {
+    uint32_t flags = irq_save();
+    *st = stats;
+    irq_restore(flags);
+}
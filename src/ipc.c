@@ -17,11 +17,16 @@
  * notify(dest, msg): non-blocking notification (for IRQs)
  */
 
-/* Service registry */
+/* Service registry: open-addressed on the name hash with linear
+ * probing.  Slots are never freed, so a probe stops at the first unused
+ * slot and a slot index is a stable endpoint handle. */
 typedef struct {
-    bool     active;
-    char     name[SERVICE_NAME_LEN];
+    bool     used;
+    bool     bound;                 /* pid is serving this endpoint */
+    bool     unclaimed;             /* Opened, never created (counts against the cap) */
+    uint32_t hash;
     uint32_t pid;
+    char     name[SERVICE_NAME_LEN];
 } service_entry_t;
 
 static service_entry_t services[MAX_SERVICES];
@@ -31,10 +36,14 @@ static uint32_t total_messages = 0;
 static uint32_t pending_notify[MAX_TASKS];
 static message_t notify_msg[MAX_TASKS];
 
+/* Slots in use that no server has ever bound */
+static uint32_t unclaimed;
+
 void ipc_init(void) {
     memset(services, 0, sizeof(services));
     memset(pending_notify, 0, sizeof(pending_notify));
     total_messages = 0;
+    unclaimed = 0;
 }
 
 /* Copy a message between two buffers */
@@ -56,15 +65,25 @@ static task_t* find_blocked_sender(uint32_t receiver_pid, uint32_t from_pid) {
     return NULL;
 }
 
+bool ipc_resolve(uint32_t* dest) {
+    if (!IPC_IS_ENDPOINT(*dest)) return true;
+    uint32_t slot = *dest - IPC_ENDPOINT_BASE;
+    if (slot >= MAX_SERVICES || !services[slot].bound) return false;
+    *dest = services[slot].pid;
+    return true;
+}
+
 int32_t ipc_send(uint32_t dest_pid, message_t* msg) {
     task_t* current = task_get_current();
     if (!current || !msg) return -1;
 
+    if (!ipc_resolve(&dest_pid)) return -2;
     task_t* dest = task_get_by_pid(dest_pid);
     if (!dest || !dest->active) return -2; /* No such process */
 
     msg->sender = current->id;
     total_messages++;
+    current->ipc_sent++;
 
     /* Is the destination already waiting to receive from us (or from ANY)? */
     if (dest->state == TASK_BLOCKED && dest->blocked_on == BLOCKED_RECEIVE) {
@@ -73,6 +92,7 @@ int32_t ipc_send(uint32_t dest_pid, message_t* msg) {
             /* Deliver immediately */
             copy_message(msg, dest->msg_buf);
             dest->msg_buf->sender = current->id;
+            dest->ipc_received++;
             dest->state = TASK_READY;
             dest->blocked_on = BLOCKED_NONE;
             return 0;
@@ -98,6 +118,7 @@ int32_t ipc_receive(uint32_t from_pid, message_t* msg) {
     if (pending_notify[current->id % MAX_TASKS]) {
         copy_message(&notify_msg[current->id % MAX_TASKS], msg);
         pending_notify[current->id % MAX_TASKS] = 0;
+        current->ipc_received++;
         return 0;
     }
 
@@ -106,6 +127,7 @@ int32_t ipc_receive(uint32_t from_pid, message_t* msg) {
     if (sender) {
         copy_message(sender->msg_buf, msg);
         msg->sender = sender->id;
+        current->ipc_received++;
 
         if (sender->blocked_on == BLOCKED_SENDREC) {
             /* Sender is doing sendrec — keep it blocked, waiting for our reply */
@@ -134,11 +156,13 @@ int32_t ipc_sendrec(uint32_t dest_pid, message_t* msg) {
     task_t* current = task_get_current();
     if (!current || !msg) return -1;
 
+    if (!ipc_resolve(&dest_pid)) return -2;
     task_t* dest = task_get_by_pid(dest_pid);
     if (!dest || !dest->active) return -2;
 
     msg->sender = current->id;
     total_messages++;
+    current->ipc_sent++;
 
     /* Is the destination waiting to receive? */
     if (dest->state == TASK_BLOCKED && dest->blocked_on == BLOCKED_RECEIVE) {
@@ -147,6 +171,7 @@ int32_t ipc_sendrec(uint32_t dest_pid, message_t* msg) {
             /* Deliver the send part immediately */
             copy_message(msg, dest->msg_buf);
             dest->msg_buf->sender = current->id;
+            dest->ipc_received++;
             dest->state = TASK_READY;
             dest->blocked_on = BLOCKED_NONE;
 
@@ -183,6 +208,8 @@ int32_t ipc_reply(uint32_t dest_pid, message_t* msg) {
         dest->state = TASK_READY;
         dest->blocked_on = BLOCKED_NONE;
         total_messages++;
+        current->ipc_sent++;
+        dest->ipc_received++;
         return 0;
     }
 
@@ -191,6 +218,7 @@ int32_t ipc_reply(uint32_t dest_pid, message_t* msg) {
 }
 
 int32_t ipc_notify(uint32_t dest_pid, message_t* msg) {
+    if (!ipc_resolve(&dest_pid)) return -2;
     task_t* dest = task_get_by_pid(dest_pid);
     if (!dest || !dest->active) return -2;
 
@@ -200,6 +228,7 @@ int32_t ipc_notify(uint32_t dest_pid, message_t* msg) {
     /* If destination is blocked in receive, deliver immediately */
     if (dest->state == TASK_BLOCKED && dest->blocked_on == BLOCKED_RECEIVE) {
         copy_message(msg, dest->msg_buf);
+        dest->ipc_received++;
         dest->state = TASK_READY;
         dest->blocked_on = BLOCKED_NONE;
         return 0;
@@ -214,42 +243,99 @@ int32_t ipc_notify(uint32_t dest_pid, message_t* msg) {
 
 /* --- Service registry --- */
 
-int32_t ipc_register_service(const char* name, uint32_t pid) {
-    /* Check for duplicates */
-    for (int i = 0; i < MAX_SERVICES; i++) {
-        if (services[i].active && strcmp(services[i].name, name) == 0) {
-            services[i].pid = pid;
-            return i;
-        }
-    }
-    /* Find free slot */
-    for (int i = 0; i < MAX_SERVICES; i++) {
-        if (!services[i].active) {
-            services[i].active = true;
-            strncpy(services[i].name, name, SERVICE_NAME_LEN - 1);
-            services[i].name[SERVICE_NAME_LEN - 1] = '\0';
-            services[i].pid = pid;
+/* FNV-1a */
+static uint32_t name_hash(const char* name) {
+    uint32_t h = 2166136261u;
+    for (int i = 0; name[i] && i < SERVICE_NAME_LEN - 1; i++)
+        h = (h ^ (uint8_t)name[i]) * 16777619u;
+    return h;
+}
+
+/* Slot holding name, or the first unused slot of its probe sequence
+ * (-1 when the table is full and name is absent) */
+static int find_slot(const char* name) {
+    uint32_t h = name_hash(name);
+    for (uint32_t n = 0; n < MAX_SERVICES; n++) {
+        int i = (int)((h + n) & (MAX_SERVICES - 1));
+        if (!services[i].used) return i;
+        if (services[i].hash == h &&
+            strncmp(services[i].name, name, SERVICE_NAME_LEN - 1) == 0)
             return i;
-        }
     }
     return -1;
 }
 
-uint32_t ipc_lookup_service(const char* name) {
-    for (int i = 0; i < MAX_SERVICES; i++) {
-        if (services[i].active && strcmp(services[i].name, name) == 0)
-            return services[i].pid;
+/* Slot for name, claiming a new one if needed.  for_server: the caller
+ * is about to bind it, so it does not count against the unbound cap. */
+static int open_slot(const char* name, bool for_server) {
+    if (!name || !name[0]) return -1;
+    int i = find_slot(name);
+    if (i < 0 || services[i].used) return i;
+    if (!for_server) {
+        if (unclaimed >= MAX_UNBOUND_SERVICES) return -1;
+        unclaimed++;
+        services[i].unclaimed = true;
     }
-    return 0;
+    services[i].used = true;
+    services[i].hash = name_hash(name);
+    strncpy(services[i].name, name, SERVICE_NAME_LEN - 1);
+    services[i].name[SERVICE_NAME_LEN - 1] = '\0';
+    return i;
+}
+
+int32_t ipc_endpoint_create(const char* name, uint32_t pid) {
+    int i = open_slot(name, true);
+    if (i < 0) return -1;
+    if (services[i].bound && services[i].pid != pid && task_get_by_pid(services[i].pid))
+        return -1;      /* Still served: unbound only by ipc_task_exit */
+    if (services[i].unclaimed) {
+        services[i].unclaimed = false;
+        unclaimed--;
+    }
+    services[i].pid = pid;
+    services[i].bound = true;
+    return (int32_t)(IPC_ENDPOINT_BASE + i);
+}
+
+int32_t ipc_endpoint_open(const char* name) {
+    int i = open_slot(name, false);
+    return i < 0 ? -1 : (int32_t)(IPC_ENDPOINT_BASE + i);
+}
+
+void ipc_task_exit(uint32_t pid) {
+    for (int i = 0; i < MAX_SERVICES; i++)
+        if (services[i].bound && services[i].pid == pid)
+            services[i].bound = false;
+}
+
+int32_t ipc_register_service(const char* name, uint32_t pid) {
+    int32_t h = ipc_endpoint_create(name, pid);
+    return h < 0 ? -1 : h - IPC_ENDPOINT_BASE;
+}
+
+uint32_t ipc_lookup_service(const char* name) {
+    if (!name) return 0;
+    int i = find_slot(name);
+    if (i < 0 || !services[i].bound) return 0;
+    return services[i].pid;
+}
+
+const char* ipc_service_at(int idx, uint32_t* pid) {
+    if (idx < 0 || idx >= MAX_SERVICES || !services[idx].bound) return NULL;
+    if (pid) *pid = services[idx].pid;
+    return services[idx].name;
 }
 
 void ipc_service_list(void) {
-    kprintf("  SERVICE            PID\n");
-    kprintf("  -------            ---\n");
+    kprintf("  SERVICE              HANDLE      PID\n");
+    kprintf("  -------              ------      ---\n");
     for (int i = 0; i < MAX_SERVICES; i++) {
-        if (services[i].active) {
-            kprintf("  %-20s %u\n", services[i].name, services[i].pid);
-        }
+        if (!services[i].used) continue;
+        kprintf("  %s", services[i].name);
+        for (int n = (int)strlen(services[i].name); n < 21; n++) kprintf(" ");
+        kprintf("%x  ", IPC_ENDPOINT_BASE + i);
+        if (services[i].bound) kprintf("%u\n", services[i].pid);
+        else                   kprintf("unbound\n");
     }
 }
 
@@ -267,7 +353,7 @@ void ipc_status(void) {
 uint32_t ipc_port_count(void) {
     uint32_t c = 0;
     for (int i = 0; i < MAX_SERVICES; i++)
-        if (services[i].active) c++;
+        if (services[i].bound) c++;
     return c;
 }
 
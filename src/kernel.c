@@ -20,6 +20,8 @@
 #include "paging.h"
 #include "task.h"
 #include "ipc.h"
+#include "chan.h"
+#include "pipe.h"
 #include "ramfs.h"
 #include "speaker.h"
 #include "cpuid.h"
@@ -37,6 +39,8 @@
 #include "server.h"
 #include "elf.h"
 #include "virtio_input.h"
+#include "input.h"
+#include "bootprof.h"
 
 #define MULTIBOOT_MAGIC 0x2BADB002
 #define HEAP_SIZE       (128 * 1024 * 1024)   /* 128MB heap */
@@ -64,6 +68,7 @@ static void ok(const char* msg) {
     terminal_print_colored("OK", 0x0A);
     terminal_print_colored("] ", 0x07);
     kprintf("%s\n", msg);
+    bootprof_mark(msg);
 }
 
 static void boot_logo(void) {
@@ -161,6 +166,116 @@ static int load_multiboot_modules(struct multiboot_info* mbi) {
     return loaded;
 }
 
+/* ============================================================
+ * Device probes
+ *
+ * Only a probe that is slow and that nothing else waits on is worth
+ * deferring.  The NIC reset is the one slow probe, so it runs in its
+ * own kernel task once the other servers are launched, and starts the
+ * network server itself when the card is up; the shell waits for it
+ * before its first command.  The ATA probe runs inline (the disk
+ * server and the shell must not race it), and the VirtIO lines only
+ * report devices found earlier.  Reporting holds the scheduler lock so
+ * lines from a running probe do not interleave with boot's own.
+ * ============================================================ */
+
+/* net_srv module, kept for probe_net instead of being loaded with the
+ * other servers */
+static elf_file_t net_module;
+static bool       net_module_found;
+
+static void report_virtio(void) {
+    bool gpu = virtio_gpu_available();
+    bool has_3d = gpu && virgl_available();
+    bool input = virtio_input_available();
+
+    task_lock_scheduler();
+    if (gpu) {
+        kprintf("  [");
+        terminal_print_colored("OK", 0x0A);
+        kprintf("] VirtIO-GPU (%s)\n", has_3d ? "3D virgl" : "2D only");
+    }
+    if (input) {
+        kprintf("  [");
+        terminal_print_colored("OK", 0x0A);
+        kprintf("] VirtIO-Input (tablet/mouse)\n");
+    }
+    task_unlock_scheduler();
+}
+
+static void probe_net(void) {
+    net_init();
+
+    task_lock_scheduler();
+    if (net_module_found) {
+        int32_t pid = elf_load(&net_module, "net_srv", 2, true, 0);
+        if (pid >= 0) net_server_pid = pid;
+    } else {
+        servers_launch_net();
+    }
+    if (net_is_available()) {
+        terminal_print_colored("  [", 0x07);
+        terminal_print_colored("OK", 0x0A);
+        terminal_print_colored("] ", 0x07);
+        kprintf("Network (RTL8139)\n");
+    } else {
+        terminal_print_colored("  [", 0x07);
+        terminal_print_colored("--", 0x08);
+        terminal_print_colored("] ", 0x07);
+        kprintf("Network (no NIC)\n");
+    }
+    kprintf("  [");
+    terminal_print_colored(net_server_pid ? "OK" : "--", net_server_pid ? 0x0A : 0x08);
+    kprintf("] Network server (PID %u, ring 3%s)\n", net_server_pid,
+            net_module_found ? ", isolated" : ", IOPL=3");
+    task_unlock_scheduler();
+}
+
+static void probe_ata(void) {
+    ata_init();
+    if (ata_drive_count() == 0) {
+        task_lock_scheduler();
+        kprintf("  [");
+        terminal_print_colored("--", 0x08);
+        kprintf("] ATA disk (none)\n");
+        task_unlock_scheduler();
+    }
+
+    for (int drv = 0; drv < ATA_MAX_DRIVES; drv++) {
+        if (!ata_drive_present(drv)) continue;
+        ata_drive_t* d = ata_get_drive_n(drv);
+        const char* mnt = (drv == 0) ? "/disk" : "/disk2";
+
+        /* Mount first (disk I/O), then report in one piece */
+        bool fat = fat16_mount_drive(drv);
+        bool ntfs = !fat && ntfs_mount_drive(drv);
+
+        task_lock_scheduler();
+        kprintf("  [");
+        terminal_print_colored("OK", 0x0A);
+        kprintf("] ATA %s: %s (%u MB)\n", drv == 0 ? "hda" : "hdb", d->model, d->size_mb);
+
+        if (fat) {
+            fat16_info_t* fi = fat16_get_info();
+            kprintf("  [");
+            terminal_print_colored("OK", 0x0A);
+            kprintf("] FAT16 at %s: %s (%u MB)\n", mnt, fi->volume_label,
+                    (fi->total_clusters * fi->cluster_size) / (1024 * 1024));
+        } else if (ntfs) {
+            ntfs_info_t* ni = ntfs_get_info();
+            kprintf("  [");
+            terminal_print_colored("OK", 0x0A);
+            kprintf("] NTFS at %s: %s (%u MB)\n", mnt, ni->volume_label,
+                    (uint32_t)((ni->total_sectors * ni->bytes_per_sector) >> 20));
+        } else {
+            kprintf("  [");
+            terminal_print_colored("--", 0x08);
+            kprintf("] %s: no filesystem\n", mnt);
+        }
+        task_unlock_scheduler();
+    }
+}
+
 void enable_fpu(void) {
     uint32_t cr0;
     __asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
@@ -174,8 +289,7 @@ void enable_fpu(void) {
     __asm__ volatile("mov %0, %%cr4" : : "r"(cr4));
 }
 void kernel_main(uint32_t magic, struct multiboot_info* mbi) {
-
-
+    bootprof_init();
 
     /* ============================================================
      * Phase 1: Core hardware — ring 0 kernel initialization
@@ -202,6 +316,7 @@ void kernel_main(uint32_t magic, struct multiboot_info* mbi) {
         kprintf("  [");
         terminal_print_colored("OK", 0x0A);
         kprintf("] CPU: %s\n", brand);
+        bootprof_mark("CPU identification");
     }
 
     /* GDT with TSS — enables ring 3 ↔ ring 0 transitions */
@@ -228,8 +343,12 @@ void kernel_main(uint32_t magic, struct multiboot_info* mbi) {
     timer_init(100);
     ok("PIT timer (100 Hz)");
 
+    input_init();
     keyboard_init();
-    ok("PS/2 keyboard");
+    ok("PS/2 keyboard (IRQ-driven input event ring)");
+
+    serial_enable_input();
+    ok("Serial console input (COM1)");
 
     rtc_init();
     {
@@ -237,6 +356,7 @@ void kernel_main(uint32_t magic, struct multiboot_info* mbi) {
         kprintf("  [");
         terminal_print_colored("OK", 0x0A);
         kprintf("] RTC (%u/%u/%u %d:%d:%d)\n", t.month, t.day, t.year, t.hour, t.minute, t.second);
+        bootprof_mark("RTC");
     }
 
     /* ============================================================
@@ -249,20 +369,26 @@ void kernel_main(uint32_t magic, struct multiboot_info* mbi) {
     kprintf("  [");
     terminal_print_colored("OK", 0x0A);
     kprintf("] Physical memory (%u MB, %u MB free)\n", mem_kb/1024, pmm_get_free_pages()*4/1024);
+    bootprof_mark("Physical memory");
 
     uint32_t heap_start = ((uint32_t)&_kernel_end + 0xFFF) & ~0xFFF;
     if (saved_mbi && (saved_mbi->flags & (1 << 3)) && saved_mbi->mods_count > 0) {
         struct multiboot_module* mods = (struct multiboot_module*)(uint32_t)saved_mbi->mods_addr;
         for (uint32_t i = 0; i < saved_mbi->mods_count; i++) {
+            /* Server text is shared from these pages in place (Phase 6) */
+            pmm_reserve_range(mods[i].mod_start, mods[i].mod_end - mods[i].mod_start);
             if (mods[i].mod_end > heap_start)
                 heap_start = (mods[i].mod_end + 0xFFF) & ~0xFFF;
         }
     }
     heap_init((void*)heap_start, HEAP_SIZE);
     pmm_reserve_range(heap_start, HEAP_SIZE);
+    /* Channel rings are remapped over this part of the identity map */
+    pmm_reserve_range(CHAN_KVBASE, CHAN_KVSIZE);
     kprintf("  [");
     terminal_print_colored("OK", 0x0A);
     kprintf("] Kernel heap (%u MB at %x)\n", HEAP_SIZE/(1024*1024), heap_start);
+    bootprof_mark("Kernel heap");
 
     paging_init(mem_kb);
     ok("Paging (per-process address spaces)");
@@ -276,6 +402,9 @@ void kernel_main(uint32_t magic, struct multiboot_info* mbi) {
     ipc_init();
     ok("Synchronous IPC (blocking send/receive)");
 
+    pipe_init();
+    ok("Pipes (bounded streaming buffers)");
+
     syscall_init();
     ok("Syscall interface (INT 0x80, ring 3 safe)");
 
@@ -298,74 +427,27 @@ void kernel_main(uint32_t magic, struct multiboot_info* mbi) {
     kprintf("] RAM filesystem (%u files", ramfs_file_count());
     if (nmods > 0) kprintf(", %d loaded from boot", nmods);
     kprintf(")\n");
+    bootprof_mark("RAM filesystem");
 
     /* ============================================================
      * Phase 5: Hardware detection
      * ============================================================ */
     pci_init();
-    if (virtio_gpu_available()) {
-    /* Check if 3D is available */
-    bool has_3d = virgl_available();
-    kprintf(" [OK] VirtIO-GPU (%s)\n", has_3d ? "3D virgl" : "2D only");
-}
-    if (virtio_input_available()) {
-        kprintf("  [");
-        terminal_print_colored("OK", 0x0A);
-        kprintf("] VirtIO-Input (tablet/mouse)\n");
-    }
     kprintf("  [");
     terminal_print_colored("OK", 0x0A);
     kprintf("] PCI bus (%u devices)\n", pci_device_count());
-
-    net_init();
-    if (net_is_available()) {
-        terminal_print_colored("  [", 0x07);
-        terminal_print_colored("OK", 0x0A);
-        terminal_print_colored("] ", 0x07);
-        kprintf("Network (RTL8139)\n");
-    } else {
-        terminal_print_colored("  [", 0x07);
-        terminal_print_colored("--", 0x08);
-        terminal_print_colored("] ", 0x07);
-        kprintf("Network (no NIC)\n");
-    }
+    bootprof_mark("PCI bus");
 
     ok("PC speaker");
 
-    /* ATA disk detection */
-    ata_init();
-    if (ata_drive_count() == 0) {
-        kprintf("  [");
-        terminal_print_colored("--", 0x08);
-        kprintf("] ATA disk (none)\n");
-    }
+    /* Disks and their filesystems are probed before anything can use
+     * them: ata.c has no lock, and the disk server and the shell would
+     * race identify and mount on the same ports */
+    probe_ata();
+    bootprof_mark("ATA disks");
 
-    for (int drv = 0; drv < ATA_MAX_DRIVES; drv++) {
-        if (!ata_drive_present(drv)) continue;
-        ata_drive_t* d = ata_get_drive_n(drv);
-        const char* mnt = (drv == 0) ? "/disk" : "/disk2";
-        kprintf("  [");
-        terminal_print_colored("OK", 0x0A);
-        kprintf("] ATA %s: %s (%u MB)\n", drv == 0 ? "hda" : "hdb", d->model, d->size_mb);
-
-        if (fat16_mount_drive(drv)) {
-            fat16_info_t* fi = fat16_get_info();
-            kprintf("  [");
-            terminal_print_colored("OK", 0x0A);
-            kprintf("] FAT16 at %s: %s (%u MB)\n", mnt, fi->volume_label,
-                    (fi->total_clusters * fi->cluster_size) / (1024 * 1024));
-        } else if (ntfs_mount_drive(drv)) {
-            ntfs_info_t* ni = ntfs_get_info();
-            kprintf("  [");
-            terminal_print_colored("OK", 0x0A);
-            kprintf("] NTFS at %s: %s (%u MB)\n", mnt, ni->volume_label,
-                    (uint32_t)((ni->total_sectors * ni->bytes_per_sector) >> 20));
-        } else {
-            kprintf("  [");
-            terminal_print_colored("--", 0x08);
-            kprintf("] %s: no filesystem\n", mnt);
-        }
-    }
+    report_virtio();
+    bootprof_mark("VirtIO devices");
 
     /* Enable interrupts */
     sti();
@@ -399,6 +481,10 @@ void kernel_main(uint32_t magic, struct multiboot_info* mbi) {
             if (size < sizeof(elf32_ehdr_t)) continue;
             if (elf_validate((void*)start, size) != 0) continue;
 
+            /* Module pages stay resident, so read-only text is shared in place */
+            elf_file_t mod;
+            elf_open_mem((void*)start, size, true, &mod);
+
             /* Determine which server this is from the module command line */
             int32_t pid = -1;
             if (cmdline && *cmdline) {
@@ -408,17 +494,18 @@ void kernel_main(uint32_t magic, struct multiboot_info* mbi) {
                     if (*p == '/' || *p == '\\') name = p + 1;
 
                 if (strncmp(name, "console", 7) == 0) {
-                    pid = elf_load((void*)start, size, "console_srv", 1, true, ELF_MAP_VGA);
+                    pid = elf_load(&mod, "console_srv", 1, true, ELF_MAP_VGA);
                     if (pid >= 0) console_server_pid = pid;
                 } else if (strncmp(name, "vfs", 3) == 0) {
-                    pid = elf_load((void*)start, size, "vfs_srv", 2, false, 0);
+                    pid = elf_load(&mod, "vfs_srv", 2, false, 0);
                     if (pid >= 0) vfs_server_pid = pid;
                 } else if (strncmp(name, "ata", 3) == 0 || strncmp(name, "disk", 4) == 0) {
-                    pid = elf_load((void*)start, size, "ata_srv", 2, true, 0);
+                    pid = elf_load(&mod, "ata_srv", 2, true, 0);
                     if (pid >= 0) disk_server_pid = pid;
                 } else if (strncmp(name, "net", 3) == 0) {
-                    pid = elf_load((void*)start, size, "net_srv", 2, true, 0);
-                    if (pid >= 0) net_server_pid = pid;
+                    /* Started by probe_net once the NIC is up */
+                    net_module = mod;
+                    net_module_found = true;
                 }
             }
 
@@ -439,7 +526,7 @@ void kernel_main(uint32_t magic, struct multiboot_info* mbi) {
 
     /* Fall back to in-kernel servers for any not loaded from ELF */
     if (!elf_loaded || !console_server_pid || !vfs_server_pid ||
-        !disk_server_pid || !net_server_pid) {
+        !disk_server_pid) {
         if (!elf_loaded) {
             kprintf("  (no ELF modules, using in-kernel servers)\n");
         }
@@ -458,12 +545,12 @@ void kernel_main(uint32_t magic, struct multiboot_info* mbi) {
     terminal_print_colored("OK", 0x0A);
     kprintf("] ATA disk server (PID %u, ring 3%s)\n", disk_server_pid,
             elf_loaded ? ", isolated" : ", IOPL=3");
-    kprintf("  [");
-    terminal_print_colored("OK", 0x0A);
-    kprintf("] Network server (PID %u, ring 3%s)\n", net_server_pid,
-            elf_loaded ? ", isolated" : ", IOPL=3");
 
-    terminal_print_colored("  --- All servers running ---\n\n", 0x0E);
+    /* The NIC reset overlaps with the rest of boot; net_srv follows it */
+    bootprof_defer("probe_net", probe_net);
+
+    terminal_print_colored("  --- Servers running (net_srv follows the NIC probe) ---\n\n", 0x0E);
+    bootprof_mark("Servers");
 
     /* Startup sound */
     speaker_startup_sound();
@@ -485,6 +572,7 @@ void kernel_main(uint32_t magic, struct multiboot_info* mbi) {
     terminal_print_colored("root", 0x0A);
     kprintf("\n\n");
 
+    bootprof_mark("Shell ready");
     serial_printf("Boot complete. Microkernel architecture active.\n");
     serial_printf("  Kernel (ring 0): scheduler, IPC, VMM\n");
     serial_printf("  Servers (ring 3): console, VFS, ATA, network\n");
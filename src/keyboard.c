@@ -1,12 +1,8 @@
 #include "keyboard.h"
 #include "idt.h"
 #include "vga.h"
-
-/* Key buffer */
-#define KEY_BUF_SIZE 256
-static volatile char key_buffer[KEY_BUF_SIZE];
-static volatile uint32_t key_head = 0;
-static volatile uint32_t key_tail = 0;
+#include "input.h"
+#include "timer.h"
 
 /* Modifier states */
 static volatile bool shift_held = false;
@@ -39,12 +35,16 @@ static const char scancode_upper[128] = {
     0, 0, '|', 0, 0  /* 0x56: | (shift+ISO key) */
 };
 
+/* Keystrokes go into the shared input ring */
 static void buf_put(char c) {
-    uint32_t next = (key_head + 1) % KEY_BUF_SIZE;
-    if (next != key_tail) {
-        key_buffer[key_head] = c;
-        key_head = next;
-    }
+    input_event_t ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.tsc    = timer_rdtsc();
+    ev.type   = INPUT_EV_KEY;
+    ev.source = INPUT_SRC_PS2_KBD;
+    ev.code   = (uint8_t)c;
+    ev.value  = 1;
+    input_push(&ev);
 }
 
 static void keyboard_callback(registers_t* regs) {
@@ -115,22 +115,32 @@ void keyboard_init(void) {
     register_interrupt_handler(33, keyboard_callback);
 }
 
+/*
+ * Key readers share the ring with pointer events.  Those are skipped:
+ * the mouse driver already folded them into its position/button state.
+ */
 bool keyboard_haskey(void) {
-    return key_head != key_tail;
+    input_event_t ev;
+    while (input_peek(&ev)) {
+        if (ev.type == INPUT_EV_KEY) return true;
+        input_poll(&ev);
+    }
+    return false;
 }
 
 char keyboard_getchar(void) {
-    while (!keyboard_haskey()) hlt();
-    char c = key_buffer[key_tail];
-    key_tail = (key_tail + 1) % KEY_BUF_SIZE;
-    return c;
+    input_event_t ev;
+    do {
+        input_read(&ev, 0);
+    } while (ev.type != INPUT_EV_KEY);
+    return (char)ev.code;
 }
 
 char keyboard_trychar(void) {
-    if (!keyboard_haskey()) return 0;
-    char c = key_buffer[key_tail];
-    key_tail = (key_tail + 1) % KEY_BUF_SIZE;
-    return c;
+    input_event_t ev;
+    while (input_poll(&ev))
+        if (ev.type == INPUT_EV_KEY) return (char)ev.code;
+    return 0;
 }
 
 bool keyboard_get_shift(void) { return shift_held; }
@@ -170,6 +170,21 @@ void glClose(void) {
     if (ctx.zbuf) { kfree(ctx.zbuf); ctx.zbuf = NULL; }
 }
 
+void* glSaveContext(void) {
+    void* saved = kmalloc(sizeof(ctx));
+    if (!saved) return NULL;
+    memcpy(saved, &ctx, sizeof(ctx));
+    memset(&ctx, 0, sizeof(ctx));       /* The saved zbuf now belongs to 'saved' */
+    return saved;
+}
+
+void glRestoreContext(void* saved) {
+    if (!saved) return;
+    glClose();
+    memcpy(&ctx, saved, sizeof(ctx));
+    kfree(saved);
+}
+
 /* Switch render target without reallocating zbuf (if same dimensions) */
 void glSetTarget(uint32_t* framebuffer, uint16_t width, uint16_t height) {
     if (ctx.zbuf && ctx.width == width && ctx.height == height) {
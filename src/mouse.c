@@ -2,6 +2,8 @@
 #include "idt.h"
 #include "virtio_input.h"
 #include "serial.h"
+#include "input.h"
+#include "timer.h"
 
 #define MOUSE_PORT   0x60
 #define MOUSE_CMD    0x64
@@ -10,10 +12,9 @@
 static volatile int mx = 160, my = 100;
 static volatile int mx_max = 319, my_max = 199;
 static volatile uint8_t mouse_buttons = 0;
-static volatile uint8_t prev_buttons = 0;
+static volatile uint8_t mouse_clicks = 0;    /* Press edges not yet read */
 static volatile uint8_t packet[3];
 static volatile int      pkt_idx = 0;
-static volatile bool ps2_received = false;   /* true once PS/2 gets any data */
 static bool use_virtio_input = false;        /* true when virtio-input is active */
 
 static void mouse_wait_write(void) {
@@ -55,24 +56,61 @@ static void mouse_callback(registers_t* regs) {
 
     if (pkt_idx >= 3) {
         pkt_idx = 0;
-        ps2_received = true;
-
-        prev_buttons = mouse_buttons;
-        mouse_buttons = packet[0] & 0x07;
 
         int dx = (int)packet[1] - ((packet[0] & 0x10) ? 256 : 0);
         int dy = (int)packet[2] - ((packet[0] & 0x20) ? 256 : 0);
 
-        mx += dx;
-        my -= dy;  /* Mouse Y is inverted */
+        /* Mouse Y is inverted */
+        mouse_report_rel(INPUT_SRC_PS2_MOUSE, dx, -dy, packet[0] & 0x07);
+    }
+}
 
-        if (mx < 0) mx = 0;
-        if (mx > mx_max) mx = mx_max;
-        if (my < 0) my = 0;
-        if (my > my_max) my = my_max;
+/* ===== Pointer state, shared by every pointing device ===== */
+
+static void report(uint8_t source, int x, int y, uint8_t buttons) {
+    if (x < 0) x = 0;
+    if (x > mx_max) x = mx_max;
+    if (y < 0) y = 0;
+    if (y > my_max) y = my_max;
+
+    bool moved = (x != mx || y != my);
+    uint8_t changed = buttons ^ mouse_buttons;
+
+    mx = x;
+    my = y;
+    mouse_buttons = buttons;
+    mouse_clicks |= changed & buttons;
+
+    input_event_t ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.tsc     = timer_rdtsc();
+    ev.source  = source;
+    ev.buttons = buttons;
+    ev.x       = (int16_t)x;
+    ev.y       = (int16_t)y;
+
+    /* Motion first, so a click lands where the pointer now is */
+    if (moved) {
+        ev.type = INPUT_EV_MOTION;
+        input_push(&ev);
+    }
+    ev.type = INPUT_EV_BUTTON;
+    for (uint8_t bit = 0x01; bit <= 0x04; bit <<= 1) {
+        if (!(changed & bit)) continue;
+        ev.code  = bit;
+        ev.value = (buttons & bit) ? 1 : 0;
+        input_push(&ev);
     }
 }
 
+void mouse_report_rel(uint8_t source, int dx, int dy, uint8_t buttons) {
+    report(source, mx + dx, my + dy, buttons);
+}
+
+void mouse_report_abs(uint8_t source, int x, int y, uint8_t buttons) {
+    report(source, x, y, buttons);
+}
+
 void mouse_init(void) {
     /* Enable auxiliary device (mouse) on PS/2 controller */
     mouse_wait_write();
@@ -123,23 +161,15 @@ void mouse_init(void) {
     }
 }
 
+/* Only does anything for a virtio device without a working interrupt */
 void mouse_poll(void) {
     if (use_virtio_input) {
         virtio_input_poll();
     }
 }
 
-int  mouse_get_x(void) {
-    if (use_virtio_input && !ps2_received)
-        return virtio_input_get_x();
-    return mx;
-}
-
-int  mouse_get_y(void) {
-    if (use_virtio_input && !ps2_received)
-        return virtio_input_get_y();
-    return my;
-}
+int  mouse_get_x(void) { return mx; }
+int  mouse_get_y(void) { return my; }
 
 void mouse_set_bounds(int max_x, int max_y) {
     mx_max = max_x;
@@ -150,27 +180,14 @@ void mouse_set_bounds(int max_x, int max_y) {
         virtio_input_set_bounds(max_x, max_y);
 }
 
-bool mouse_left_held(void) {
-    if (use_virtio_input && !ps2_received)
-        return virtio_input_left_held();
-    return (mouse_buttons & 0x01) != 0;
-}
-
-bool mouse_right_held(void) {
-    if (use_virtio_input && !ps2_received)
-        return virtio_input_right_held();
-    return (mouse_buttons & 0x02) != 0;
-}
+bool mouse_left_held(void)  { return (mouse_buttons & 0x01) != 0; }
+bool mouse_right_held(void) { return (mouse_buttons & 0x02) != 0; }
 
+/* Latched in the IRQ, so a press is seen once however late we look */
 bool mouse_left_click(void) {
-    if (use_virtio_input && !ps2_received)
-        return virtio_input_left_click();
-    return (mouse_buttons & 0x01) && !(prev_buttons & 0x01);
+    return (__sync_fetch_and_and(&mouse_clicks, (uint8_t)~0x01) & 0x01) != 0;
 }
 
 bool mouse_right_click(void) {
-    if (use_virtio_input && !ps2_received)
-        return virtio_input_right_click();
-    return (mouse_buttons & 0x02) && !(prev_buttons & 0x02);
+    return (__sync_fetch_and_and(&mouse_clicks, (uint8_t)~0x02) & 0x02) != 0;
 }
-
@@ -38,6 +38,7 @@ static uint8_t rx_buffer[RX_BUF_SIZE] __attribute__((aligned(4)));
 static uint8_t tx_buffers[4][TX_BUF_SIZE] __attribute__((aligned(4)));
 static int current_tx = 0;
 static uint32_t rx_offset = 0;
+static net_stats_t stats;
 
 /* ARP cache */
 #define ARP_CACHE_SIZE 16
@@ -188,6 +189,8 @@ skip_qtype:
 
 /* ---- Packet processing ---- */
 static void process_rx_packet(uint8_t* data, uint32_t len) {
+    stats.rx_packets++;
+    stats.rx_bytes += len;
     if (len < sizeof(eth_header_t)) return;
     eth_header_t* eth = (eth_header_t*)data;
     uint16_t ethertype = ntohs(eth->ethertype);
@@ -250,8 +253,10 @@ static void rtl_irq_handler(registers_t* regs) {
             uint32_t* header = (uint32_t*)(rx_buffer + rx_offset);
             uint32_t rx_status = header[0];
             uint32_t rx_size = (rx_status >> 16) & 0xFFFF;
-            if (rx_size == 0 || rx_size > 1500 + 4) break;
-            if (!(rx_status & 1)) break;
+            if (rx_size == 0 || rx_size > 1500 + 4 || !(rx_status & 1)) {
+                stats.rx_errors++;
+                break;
+            }
             process_rx_packet(rx_buffer + rx_offset + 4, rx_size - 4);
             rx_offset = (rx_offset + rx_size + 4 + 3) & ~3;
             if (rx_offset >= 8192) rx_offset -= 8192;
@@ -294,7 +299,8 @@ void net_init(void) {
 bool net_is_available(void) { return nic_available; }
 
 void net_send_raw(const void* data, uint32_t len) {
-    if (!nic_available || len > TX_BUF_SIZE) return;
+    if (!nic_available) return;
+    if (len > TX_BUF_SIZE) { stats.tx_dropped++; return; }
     memcpy(tx_buffers[current_tx], data, len);
     if (len < 60) { memset(tx_buffers[current_tx] + len, 0, 60 - len); len = 60; }
     rtl_write32(RTL_TXADDR0 + current_tx * 4, (uint32_t)tx_buffers[current_tx]);
@@ -306,6 +312,12 @@ void net_send_raw(const void* data, uint32_t len) {
         if (stat & 0xC000) break;
     }
     current_tx = (current_tx + 1) % 4;
+    stats.tx_packets++;
+    stats.tx_bytes += len;
+}
+
+void net_get_stats(net_stats_t* st) {
+    *st = stats;
 }
 
 void net_poll(void) {
@@ -318,7 +330,10 @@ void net_poll(void) {
                 uint32_t* header = (uint32_t*)(rx_buffer + rx_offset);
                 uint32_t rx_status = header[0];
                 uint32_t rx_size = (rx_status >> 16) & 0xFFFF;
-                if (rx_size == 0 || rx_size > 1504 || !(rx_status & 1)) break;
+                if (rx_size == 0 || rx_size > 1504 || !(rx_status & 1)) {
+                    stats.rx_errors++;
+                    break;
+                }
                 process_rx_packet(rx_buffer + rx_offset + 4, rx_size - 4);
                 rx_offset = (rx_offset + rx_size + 4 + 3) & ~3;
                 if (rx_offset >= 8192) rx_offset -= 8192;
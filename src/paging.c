@@ -4,6 +4,7 @@
 #include "vga.h"
 #include "task.h"
 #include "serial.h"
+#include "elf.h"
 
 /* Master kernel page directory and static tables */
 static uint32_t page_directory[1024] __attribute__((aligned(4096)));
@@ -17,6 +18,7 @@ static void page_fault_handler(registers_t* regs) {
     uint32_t faulting_addr;
     __asm__ volatile ("mov %%cr2, %0" : "=r"(faulting_addr));
     task_t* t = task_get_current();
+    if (t) t->page_faults++;
     
     serial_printf("\n!!! PAGE FAULT !!! addr=%x eip=%x err=%x\n", faulting_addr, regs->eip, regs->err_code);
     
@@ -27,6 +29,7 @@ static void page_fault_handler(registers_t* regs) {
         return;
     }
 
+    terminal_set_redirect(NULL);
     kprintf("\n KERNEL PANIC: Page Fault at %x (EIP: %x)\n", faulting_addr, regs->eip);
     cli(); for (;;) hlt();
 }
@@ -183,6 +186,12 @@ uint32_t* paging_create_isolated_space(void) {
          * (e.g., 0x40000000 - 0xBFFFFFFF) to ensure a clean start.
          */
         if (i >= 256 && i < 768) pd[i] = 0; 
+        /*
+         * The image and stack window (USER_BASE .. USER_STACK_TOP) must
+         * get private page tables, or every process would write its
+         * PTEs into the kernel's shared static tables.
+         */
+        if (i >= (int)(USER_BASE >> 22) && i < (int)(USER_STACK_TOP >> 22)) pd[i] = 0;
     }
     return pd;
 }
@@ -262,8 +271,9 @@ void paging_map_user(uint32_t* target_pd_phys, uint32_t virt, uint32_t phys, uin
 
     /* 
      * 1. Switch to Kernel Context:
-     * We must ensure the Kernel's Page Directory is active to use the 
-     * TEMP windows (0x3FE00000). Otherwise, we Page Fault.
+     * Page directories and page tables live in identity-mapped RAM,
+     * which the kernel PD always covers.  Edit them through that
+     * mapping directly -- no TEMP windows, no per-page map/unmap.
      */
     uint32_t saved_cr3;
     __asm__ volatile ("mov %%cr3, %0" : "=r"(saved_cr3));
@@ -273,41 +283,29 @@ void paging_map_user(uint32_t* target_pd_phys, uint32_t virt, uint32_t phys, uin
         __asm__ volatile ("mov %0, %%cr3" : : "r"(kernel_cr3) : "memory");
     }
 
-    /* 
-     * 2. Map Target Directory into View:
-     */
-    paging_map_page(TEMP_PD_VA, (uint32_t)target_pd_phys, PAGE_PRESENT | PAGE_WRITE);
-    uint32_t* pd_view = (uint32_t*)TEMP_PD_VA;
+    uint32_t* pd_view = target_pd_phys;
 
     /* 
-     * 3. Handle Page Table Allocation:
+     * 2. Handle Page Table Allocation:
      */
     if (!(pd_view[pd_idx] & PAGE_PRESENT)) {
         uint32_t new_pt_phys = (uint32_t)pmm_alloc_page();
-        
-        // Zero out the new Page Table using the second window
-        paging_map_page(TEMP_PT_VA, new_pt_phys, PAGE_PRESENT | PAGE_WRITE);
-        memset((void*)TEMP_PT_VA, 0, 4096);
+        if (!new_pt_phys) {
+            serial_printf("OOM: cannot alloc user PT for v=%x\n", virt);
+            goto out;
+        }
+        memset((void*)new_pt_phys, 0, 4096);
         
         // Link the new PT into the Page Directory
         // Set PAGE_USER (0x04) so User Mode can traverse this branch
         pd_view[pd_idx] = new_pt_phys | PAGE_PRESENT | PAGE_WRITE | PAGE_USER;
-        
-        paging_unmap_page(TEMP_PT_VA);
     } else {
         // Ensure existing Directory Entry allows User access
         pd_view[pd_idx] |= PAGE_USER;
     }
 
     /* 
-     * 4. Map the Page Table itself:
-     */
-    uint32_t pt_phys = pd_view[pd_idx] & 0xFFFFF000;
-    paging_map_page(TEMP_PT_VA, pt_phys, PAGE_PRESENT | PAGE_WRITE);
-    uint32_t* pt_view = (uint32_t*)TEMP_PT_VA;
-
-    /* 
-     * 5. The GPU Cache Sync (Crucial Fix):
+     * 3. The GPU Cache Sync (Crucial Fix):
      * If mapping the GPU buffer area (0x30000000), add the 
      * PAGE_WRITE_THROUGH (0x08) bit. This forces the CPU to write 
      * commands to RAM immediately so the GPU (VirtIO) sees them correctly.
@@ -318,16 +316,12 @@ void paging_map_user(uint32_t* target_pd_phys, uint32_t virt, uint32_t phys, uin
     }
 
     /* 
-     * 6. Final Mapping:
+     * 4. Final Mapping:
      */
+    uint32_t* pt_view = (uint32_t*)(pd_view[pd_idx] & 0xFFFFF000);
     pt_view[pt_idx] = (phys & 0xFFFFF000) | (final_flags & 0xFFF);
 
-    /* 
-     * 7. Cleanup and Restore:
-     */
-    paging_unmap_page(TEMP_PT_VA);
-    paging_unmap_page(TEMP_PD_VA);
-
+out:
     if (saved_cr3 != kernel_cr3) {
         __asm__ volatile ("mov %0, %%cr3" : : "r"(saved_cr3) : "memory");
     }
@@ -335,6 +329,58 @@ void paging_map_user(uint32_t* target_pd_phys, uint32_t virt, uint32_t phys, uin
     // Invalidate the TLB for the target address
     __asm__ volatile("invlpg (%0)" :: "r"(virt) : "memory");
 }
+
+/*
+ * Walks of another task's page directory go through the physical
+ * addresses of its tables.  Only the kernel PD identity-maps all of RAM
+ * (isolated spaces drop the 1-3 GB range), so switch to it for the walk,
+ * as paging_map_user does, and return the previous CR3.
+ */
+static uint32_t enter_kernel_pd(void) {
+    uint32_t saved;
+    __asm__ volatile ("mov %%cr3, %0" : "=r"(saved));
+    if (saved != (uint32_t)page_directory)
+        __asm__ volatile ("mov %0, %%cr3" : : "r"((uint32_t)page_directory) : "memory");
+    return saved;
+}
+
+static void leave_kernel_pd(uint32_t saved) {
+    if (saved != (uint32_t)page_directory)
+        __asm__ volatile ("mov %0, %%cr3" : : "r"(saved) : "memory");
+}
+
+/* Caller is on the kernel PD */
+static uint32_t* user_pt(const uint32_t* pd, uint32_t virt) {
+    uint32_t pde = pd[virt >> 22];
+    if (!(pde & PAGE_PRESENT)) return NULL;
+    if ((pde & 0xFFFFF000) == (page_directory[virt >> 22] & 0xFFFFF000))
+        return NULL;    /* still the kernel's shared table -- nothing user-mapped */
+    return (uint32_t*)(pde & 0xFFFFF000);
+}
+
+uint32_t paging_get_user_pte(uint32_t* page_dir, uint32_t virt) {
+    uint32_t saved = enter_kernel_pd();
+    uint32_t* pt = user_pt(page_dir, virt);
+    uint32_t pte = pt ? pt[(virt >> 12) & 0x3FF] : 0;
+    leave_kernel_pd(saved);
+    return pte;
+}
+
+void paging_unmap_user(uint32_t* pd, uint32_t virt) {
+    uint32_t saved = enter_kernel_pd();
+    uint32_t* pt = user_pt(pd, virt);
+    uint32_t pte = pt ? pt[(virt >> 12) & 0x3FF] : 0;
+    if (pte & PAGE_PRESENT) {
+        pt[(virt >> 12) & 0x3FF] = 0;
+        if (pte & PAGE_OWNED)
+            pmm_free_page((void*)(pte & 0xFFFFF000));
+    }
+    leave_kernel_pd(saved);
+
+    if (pte & PAGE_PRESENT)
+        __asm__ volatile("invlpg (%0)" :: "r"(virt) : "memory");
+}
+
 void paging_destroy_address_space(uint32_t* pd) {
     if (!pd || pd == page_directory) return;
 
@@ -342,20 +388,47 @@ void paging_destroy_address_space(uint32_t* pd) {
      * Free any page tables that are NOT the kernel's shared tables.
      * Per-process page tables (created by paging_create_address_space
      * or paging_map_user) have different physical addresses than the
-     * kernel's static page_tables[] array.
+     * kernel's static page_tables[] array.  Frames the loader marked
+     * PAGE_OWNED (private segment pages, user stack) go with them.
      */
+    uint32_t saved = enter_kernel_pd();
     for (int i = 0; i < 1024; i++) {
         if (!(pd[i] & PAGE_PRESENT)) continue;
         uint32_t pt_phys = pd[i] & 0xFFFFF000;
         uint32_t kernel_pt_phys = page_directory[i] & 0xFFFFF000;
         if (pt_phys != kernel_pt_phys) {
+            uint32_t* pt = (uint32_t*)pt_phys;
+            for (int j = 0; j < 1024; j++) {
+                if ((pt[j] & (PAGE_PRESENT | PAGE_OWNED)) == (PAGE_PRESENT | PAGE_OWNED))
+                    pmm_free_page((void*)(pt[j] & 0xFFFFF000));
+            }
             pmm_free_page((void*)pt_phys);
         }
     }
+    leave_kernel_pd(saved);
 
     pmm_free_page(pd);
 }
 
+uint32_t paging_count_owned(const uint32_t* pd) {
+    if (!pd || pd == page_directory) return 0;
+
+    uint32_t saved = enter_kernel_pd();
+    uint32_t pages = 1;
+    for (int i = 0; i < 1024; i++) {
+        if (!(pd[i] & PAGE_PRESENT)) continue;
+        uint32_t pt_phys = pd[i] & 0xFFFFF000;
+        if (pt_phys == (page_directory[i] & 0xFFFFF000)) continue;
+        const uint32_t* pt = (const uint32_t*)pt_phys;
+        for (int j = 0; j < 1024; j++)
+            if ((pt[j] & (PAGE_PRESENT | PAGE_OWNED)) == (PAGE_PRESENT | PAGE_OWNED))
+                pages++;
+        pages++;
+    }
+    leave_kernel_pd(saved);
+    return pages;
+}
+
 void paging_switch(uint32_t* pd) {
     __asm__ volatile ("mov %0, %%cr3" : : "r"((uint32_t)pd) : "memory");
 }
@@ -380,6 +453,28 @@ int copy_from_user(void* to, const void* from, uint32_t size) {
     return 0;
 }
 
+/* The destination must be present, user and writable in the calling
+ * task's space, so a bad pointer fails here instead of faulting in ring
+ * 0 (which panics).  Kernel tasks have no PD of their own and are trusted. */
+int copy_to_user(void* to, const void* from, uint32_t size) {
+    if (!from || !to) return -1;
+    if (!size) return 0;
+    uint32_t start = (uint32_t)to;
+    if (start + size < start) return -1;
+
+    task_t* t = task_get_current();
+    if (t && t->page_directory) {
+        const uint32_t need = PAGE_PRESENT | PAGE_WRITE | PAGE_USER;
+        uint32_t pages = ((start + size - 1) >> 12) - (start >> 12) + 1;
+        for (uint32_t i = 0; i < pages; i++) {
+            uint32_t pte = paging_get_user_pte(t->page_directory, (start & ~0xFFF) + i * PAGE_SIZE);
+            if ((pte & need) != need) return -1;
+        }
+    }
+    memcpy(to, from, size);
+    return 0;
+}
+
 uint32_t virt_to_phys(const void* va) {
     uint32_t v = (uint32_t)va;
 
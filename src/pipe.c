@@ -0,0 +1,181 @@
+#include "pipe.h"
+#include "task.h"
+#include "ipc.h"
+#include "idt.h"
+#include "vga.h"
+
+/*
+ * Pipes — single-producer/single-consumer rings with blocking ends.
+ *
+ * head/tail are free-running byte counters: the writer only advances
+ * head, the reader only advances tail, so the ring needs no lock on a
+ * uniprocessor.  An end that cannot make progress blocks (BLOCKED_PIPE)
+ * and records itself in the pipe; the other end wakes it after moving
+ * its counter or closing.
+ */
+
+typedef struct {
+    bool              active;
+    volatile bool     reader_open;
+    volatile bool     writer_open;
+    volatile uint32_t head;         /* Total bytes written */
+    volatile uint32_t tail;         /* Total bytes read */
+    volatile uint32_t reader_wait;  /* PID + 1 of a blocked reader, 0 = none */
+    volatile uint32_t writer_wait;
+    uint8_t           buf[PIPE_BUF_SIZE];
+} pipe_t;
+
+static pipe_t pipes[MAX_PIPES];
+
+static pipe_t* get_pipe(int32_t id) {
+    if (id < 0 || id >= MAX_PIPES || !pipes[id].active) return NULL;
+    return &pipes[id];
+}
+
+static void release_if_closed(pipe_t* p) {
+    if (!p->reader_open && !p->writer_open) p->active = false;
+}
+
+/* Block until woken, unless the condition changed first.  The scheduler
+ * lock keeps the other end from running between the check and the state
+ * change; a wake after the unlock just makes the task ready again. */
+static void pipe_block(pipe_t* p, volatile uint32_t* wait_slot, bool writer) {
+    task_t* t = task_get_current();
+    task_lock_scheduler();
+    bool stuck = writer ? (p->reader_open && p->head - p->tail == PIPE_BUF_SIZE)
+                        : (p->writer_open && p->head == p->tail);
+    if (stuck) {
+        *wait_slot = t->id + 1;
+        t->state = TASK_BLOCKED;
+        t->blocked_on = BLOCKED_PIPE;
+    }
+    task_unlock_scheduler();
+    if (stuck) task_yield();
+}
+
+static void pipe_wake(volatile uint32_t* wait_slot) {
+    uint32_t slot = *wait_slot;
+    if (!slot) return;
+    *wait_slot = 0;
+    task_t* t = task_get_by_pid(slot - 1);
+    if (t && t->state == TASK_BLOCKED && t->blocked_on == BLOCKED_PIPE) {
+        t->blocked_on = BLOCKED_NONE;
+        t->state = TASK_READY;
+    }
+}
+
+/* Terminal redirect: output of a task whose stdout is a pipe.  IRQ
+ * handlers print to the screen whatever task they interrupted. */
+static bool pipe_redirect(char c) {
+    if (irq_in_handler()) return false;
+    task_t* t = task_get_current();
+    if (!t || !t->pipe_out) return false;
+    pipe_write((int32_t)t->pipe_out - 1, &c, 1);
+    return true;    /* Swallowed even if the reader went away */
+}
+
+void pipe_init(void) {
+    memset(pipes, 0, sizeof(pipes));
+    terminal_set_redirect(pipe_redirect);
+}
+
+int32_t pipe_create(void) {
+    task_lock_scheduler();
+    for (int32_t i = 0; i < MAX_PIPES; i++) {
+        if (!pipes[i].active) {
+            pipes[i].active = true;
+            pipes[i].reader_open = true;
+            pipes[i].writer_open = true;
+            pipes[i].head = 0;
+            pipes[i].tail = 0;
+            pipes[i].reader_wait = 0;
+            pipes[i].writer_wait = 0;
+            task_unlock_scheduler();
+            return i;
+        }
+    }
+    task_unlock_scheduler();
+    return -1;
+}
+
+int32_t pipe_write(int32_t id, const void* buf, uint32_t len) {
+    pipe_t* p = get_pipe(id);
+    if (!p || !p->writer_open) return -1;
+
+    const uint8_t* src = (const uint8_t*)buf;
+    uint32_t done = 0;
+    while (done < len) {
+        if (!p->reader_open) return -1;
+        uint32_t space = PIPE_BUF_SIZE - (p->head - p->tail);
+        if (space == 0) {
+            if (irq_in_handler()) break;    /* Never block in an IRQ */
+            pipe_block(p, &p->writer_wait, true);
+            continue;
+        }
+
+        uint32_t n = len - done;
+        if (n > space) n = space;
+        for (uint32_t i = 0; i < n; i++)
+            p->buf[(p->head + i) % PIPE_BUF_SIZE] = src[done + i];
+        __asm__ volatile ("" ::: "memory");
+        p->head += n;
+        done += n;
+        pipe_wake(&p->reader_wait);
+    }
+    return (int32_t)done;
+}
+
+int32_t pipe_read(int32_t id, void* buf, uint32_t max) {
+    pipe_t* p = get_pipe(id);
+    if (!p || !p->reader_open) return -1;
+    if (max == 0) return 0;
+
+    uint32_t avail;
+    while ((avail = p->head - p->tail) == 0) {
+        if (!p->writer_open) return 0;     /* EOF */
+        pipe_block(p, &p->reader_wait, false);
+    }
+
+    uint8_t* dst = (uint8_t*)buf;
+    uint32_t n = (avail < max) ? avail : max;
+    for (uint32_t i = 0; i < n; i++)
+        dst[i] = p->buf[(p->tail + i) % PIPE_BUF_SIZE];
+    __asm__ volatile ("" ::: "memory");
+    p->tail += n;
+    pipe_wake(&p->writer_wait);
+    return (int32_t)n;
+}
+
+void pipe_close_read(int32_t id) {
+    pipe_t* p = get_pipe(id);
+    if (!p) return;
+    p->reader_open = false;
+    pipe_wake(&p->writer_wait);
+    release_if_closed(p);
+}
+
+void pipe_close_write(int32_t id) {
+    pipe_t* p = get_pipe(id);
+    if (!p) return;
+    p->writer_open = false;
+    pipe_wake(&p->reader_wait);
+    release_if_closed(p);
+}
+
+int32_t pipe_stdin_read(void* buf, uint32_t max) {
+    task_t* t = task_get_current();
+    if (!t || !t->pipe_in) return -1;
+    return pipe_read((int32_t)t->pipe_in - 1, buf, max);
+}
+
+bool pipe_stdin_is_pipe(void) {
+    task_t* t = task_get_current();
+    return t && t->pipe_in;
+}
+
+void pipe_stdin_close(void) {
+    task_t* t = task_get_current();
+    if (!t || !t->pipe_in) return;
+    pipe_close_read((int32_t)t->pipe_in - 1);
+    t->pipe_in = 0;
+}
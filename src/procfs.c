@@ -13,6 +13,9 @@
 #include "fat16.h"
 #include "env.h"
 #include "vga.h"
+#include "bootprof.h"
+#include "ata.h"
+#include "virtio_gpu.h"
 
 /* ---- ksnprintf implementation ---- */
 typedef __builtin_va_list va_list;
@@ -76,6 +79,75 @@ done:
     return pos;
 }
 
+/* ---- Statistics snapshot ---- */
+
+void procfs_snapshot(proc_stats_t* s) {
+    memset(s, 0, sizeof(*s));
+    s->version = PROC_STATS_VERSION;
+    s->size = sizeof(*s);
+
+    /* Everything below is plain counter reads; no walk is longer than
+     * the task table, so interrupts stay off for the whole copy */
+    uint32_t flags = irq_save();
+
+    s->ticks = timer_get_ticks();
+    s->tick_hz = timer_get_frequency();
+    s->preemptive = task_is_preemptive();
+    s->quantum = task_get_quantum();
+    s->switches = task_total_switches();
+
+    task_t* all = task_get_all();
+    for (int i = 0; i < MAX_TASKS; i++) {
+        if (!all[i].active) continue;
+        proc_task_stats_t* pt = &s->task[s->tasks++];
+        pt->pid = all[i].id;
+        pt->state = all[i].state;
+        pt->priority = all[i].priority;
+        pt->cpu_ticks = all[i].cpu_ticks;
+        pt->switches = all[i].switches;
+        pt->ipc_sent = all[i].ipc_sent;
+        pt->ipc_received = all[i].ipc_received;
+        pt->page_faults = all[i].page_faults;
+        pt->syscalls = all[i].syscalls;
+        memcpy(pt->name, all[i].name, TASK_NAME_LEN);
+        pt->name[TASK_NAME_LEN - 1] = '\0';
+        if (all[i].state <= TASK_TERMINATED) s->tasks_by_state[all[i].state]++;
+    }
+
+    s->ipc_messages = ipc_message_count();
+    s->ipc_services = ipc_port_count();
+
+    s->pages_total = pmm_get_total_pages();
+    s->pages_free = pmm_get_free_pages();
+    s->pages_used = pmm_get_used_pages();
+    s->heap_used = heap_used_space();
+    s->heap_free = heap_free_space();
+
+    ata_stats_t disk;
+    ata_get_stats(&disk);
+    s->disk_sectors_read = disk.sectors_read;
+    s->disk_sectors_written = disk.sectors_written;
+    s->disk_errors = disk.errors;
+
+    net_stats_t net;
+    net_get_stats(&net);
+    s->net_up = net_is_available();
+    s->net_rx_packets = net.rx_packets;
+    s->net_rx_bytes = net.rx_bytes;
+    s->net_rx_errors = net.rx_errors;
+    s->net_tx_packets = net.tx_packets;
+    s->net_tx_bytes = net.tx_bytes;
+    s->net_tx_dropped = net.tx_dropped;
+
+    virtio_gpu_stats_t gpu;
+    virtio_gpu_get_stats(&gpu);
+    s->gpu_flush_rects = gpu.flush_rects;
+    s->gpu_submits = gpu.submits;
+    s->gpu_submit_bytes = gpu.submit_bytes;
+
+    irq_restore(flags);
+}
+
 /* ---- /proc file generators ---- */
 
 static int gen_cpuinfo(char* buf, int max) {
@@ -103,25 +175,16 @@ static int gen_cpuinfo(char* buf, int max) {
     return p;
 }
 
-static int gen_meminfo(char* buf, int max) {
-    uint32_t total_pages = pmm_get_total_pages();
-    uint32_t free_pages = pmm_get_free_pages();
-    uint32_t used_pages = pmm_get_used_pages();
-    uint32_t total_kb = total_pages * 4;
-    uint32_t free_kb = free_pages * 4;
-    uint32_t used_kb = used_pages * 4;
-    uint32_t heap_free_kb = heap_free_space() / 1024;
-    uint32_t heap_used_kb = heap_used_space() / 1024;
-
+static int gen_meminfo(const proc_stats_t* st, char* buf, int max) {
     int p = 0;
-    p += ksnprintf(buf + p, max - p, "MemTotal:       %u kB\n", total_kb);
-    p += ksnprintf(buf + p, max - p, "MemFree:        %u kB\n", free_kb);
-    p += ksnprintf(buf + p, max - p, "MemUsed:        %u kB\n", used_kb);
-    p += ksnprintf(buf + p, max - p, "HeapFree:       %u kB\n", heap_free_kb);
-    p += ksnprintf(buf + p, max - p, "HeapUsed:       %u kB\n", heap_used_kb);
+    p += ksnprintf(buf + p, max - p, "MemTotal:       %u kB\n", st->pages_total * 4);
+    p += ksnprintf(buf + p, max - p, "MemFree:        %u kB\n", st->pages_free * 4);
+    p += ksnprintf(buf + p, max - p, "MemUsed:        %u kB\n", st->pages_used * 4);
+    p += ksnprintf(buf + p, max - p, "HeapFree:       %u kB\n", st->heap_free / 1024);
+    p += ksnprintf(buf + p, max - p, "HeapUsed:       %u kB\n", st->heap_used / 1024);
     p += ksnprintf(buf + p, max - p, "PageSize:       4 kB\n");
-    p += ksnprintf(buf + p, max - p, "TotalPages:     %u\n", total_pages);
-    p += ksnprintf(buf + p, max - p, "FreePages:      %u\n", free_pages);
+    p += ksnprintf(buf + p, max - p, "TotalPages:     %u\n", st->pages_total);
+    p += ksnprintf(buf + p, max - p, "FreePages:      %u\n", st->pages_free);
     return p;
 }
 
@@ -138,20 +201,18 @@ static int gen_version(char* buf, int max) {
         "MicroKernel v0.2.0 (i686-gcc) #1 SMP PREEMPT x86\n");
 }
 
-static int gen_stat(char* buf, int max) {
-    uint32_t ticks = timer_get_ticks();
-    uint32_t switches = task_total_switches();
+static int gen_stat(const proc_stats_t* st, char* buf, int max) {
     int p = 0;
-    p += ksnprintf(buf + p, max - p, "cpu  %u 0 0 %u 0 0 0 0 0 0\n", ticks, ticks);
-    p += ksnprintf(buf + p, max - p, "ctxt %u\n", switches);
+    p += ksnprintf(buf + p, max - p, "cpu  %u 0 0 %u 0 0 0 0 0 0\n", st->ticks, st->ticks);
+    p += ksnprintf(buf + p, max - p, "ctxt %u\n", st->switches);
     p += ksnprintf(buf + p, max - p, "btime 0\n");
-    p += ksnprintf(buf + p, max - p, "processes %u\n", task_count());
-    p += ksnprintf(buf + p, max - p, "procs_running %u\n", task_count());
+    p += ksnprintf(buf + p, max - p, "processes %u\n", st->tasks);
+    p += ksnprintf(buf + p, max - p, "procs_running %u\n", st->tasks);
     return p;
 }
 
-static int gen_loadavg(char* buf, int max) {
-    uint32_t count = task_count();
+static int gen_loadavg(const proc_stats_t* st, char* buf, int max) {
+    uint32_t count = st->tasks;
     return ksnprintf(buf, max, "0.%u 0.%u 0.%u %u/%u 0\n",
                      count * 5, count * 3, count * 2, count, count);
 }
@@ -200,30 +261,75 @@ static int gen_pid_status(char* buf, int max, int pid) {
     return ksnprintf(buf, max, "No such process\n");
 }
 
-static int gen_processes(char* buf, int max) {
-    task_t* all = task_get_all();
+/* TSC cycles as "<ms>.<us>" milliseconds */
+static int put_tsc_ms(char* buf, int max, uint64_t cycles) {
+    uint32_t ms = timer_tsc_to_ms(cycles);
+    uint32_t us = timer_tsc_to_us(cycles - (uint64_t)ms * timer_tsc_khz());
+    if (us > 999) us = 999;
+    return ksnprintf(buf, max, "%u.%c%c%c", ms,
+                     '0' + us / 100, '0' + us / 10 % 10, '0' + us % 10);
+}
+
+static const char* wait_names[TASK_WAIT_COUNT] = {
+    "runq", "sleep", "send", "recv", "sendrec", "other"
+};
+
+/* /proc/<pid>/stat: accounting counters, times in milliseconds */
+static int gen_pid_stat(char* buf, int max, int pid) {
+    task_t* t = task_get_by_pid((uint32_t)pid);
+    if (!t) return ksnprintf(buf, max, "No such process\n");
+    task_acct_sync(t);
+
     int p = 0;
-    for (int i = 0; i < MAX_TASKS; i++) {
-        if (all[i].active) {
-            p += ksnprintf(buf + p, max - p, "%u %s %s\n",
-                           all[i].id, all[i].name, task_state_str[all[i].state]);
-        }
+    p += ksnprintf(buf + p, max - p, "pid:\t\t%u\nname:\t\t%s\nstate:\t\t%s\n",
+                   t->id, t->name, task_state_str[t->state]);
+    p += ksnprintf(buf + p, max - p, "age_ms:\t\t");
+    p += put_tsc_ms(buf + p, max - p, timer_rdtsc() - t->start_tsc);
+    p += ksnprintf(buf + p, max - p, "\nuser_ms:\t");
+    p += put_tsc_ms(buf + p, max - p, t->user_tsc);
+    p += ksnprintf(buf + p, max - p, "\nsys_ms:\t\t");
+    p += put_tsc_ms(buf + p, max - p, t->sys_tsc);
+    for (int w = 0; w < TASK_WAIT_COUNT; w++) {
+        p += ksnprintf(buf + p, max - p, "\nwait_%s_ms:\t", wait_names[w]);
+        p += put_tsc_ms(buf + p, max - p, t->wait_tsc[w]);
+    }
+    p += ksnprintf(buf + p, max - p, "\nvol_switches:\t%u\ninvol_switches:\t%u\n",
+                   t->nvcsw, t->nivcsw);
+    p += ksnprintf(buf + p, max - p, "ipc_sent:\t%u\nipc_received:\t%u\n",
+                   t->ipc_sent, t->ipc_received);
+    p += ksnprintf(buf + p, max - p, "page_faults:\t%u\npages_owned:\t%u\n",
+                   t->page_faults, task_owned_pages(t));
+    p += ksnprintf(buf + p, max - p, "syscalls:\t%u\n", t->syscalls);
+    for (int n = 0; n < TASK_SYSCALL_SLOTS; n++)
+        if (t->syscall_counts[n])
+            p += ksnprintf(buf + p, max - p, "syscall_%u:\t%u\n", n, t->syscall_counts[n]);
+    return p;
+}
+
+static int gen_processes(const proc_stats_t* st, char* buf, int max) {
+    int p = 0;
+    for (uint32_t i = 0; i < st->tasks; i++) {
+        const proc_task_stats_t* pt = &st->task[i];
+        p += ksnprintf(buf + p, max - p, "%u %s %s\n",
+                       pt->pid, pt->name, task_state_str[pt->state]);
     }
     return p;
 }
 
-static int gen_net_dev(char* buf, int max) {
+static int gen_net_dev(const proc_stats_t* st, char* buf, int max) {
     int p = 0;
     p += ksnprintf(buf + p, max - p,
         "Inter-|   Receive                                     |  Transmit\n");
     p += ksnprintf(buf + p, max - p,
-        " face |bytes  packets errs drop fifo frame compressed |bytes  packets\n");
-    if (net_is_available()) {
+        " face |bytes  packets errs drop fifo frame compressed |bytes  packets errs drop\n");
+    if (st->net_up) {
         p += ksnprintf(buf + p, max - p,
-            "  eth0: 0       0       0    0    0    0     0         0       0\n");
+            "  eth0: %u %u %u 0 0 0 0 %u %u 0 %u\n",
+            st->net_rx_bytes, st->net_rx_packets, st->net_rx_errors,
+            st->net_tx_bytes, st->net_tx_packets, st->net_tx_dropped);
     }
     p += ksnprintf(buf + p, max - p,
-        "    lo: 0       0       0    0    0    0     0         0       0\n");
+        "    lo: 0       0       0    0    0    0     0         0       0       0    0\n");
     return p;
 }
 
@@ -238,46 +344,62 @@ static int gen_interrupts(char* buf, int max) {
     return p;
 }
 
-static int gen_scheduler(char* buf, int max) {
+static int gen_scheduler(const proc_stats_t* st, char* buf, int max) {
     int p = 0;
     p += ksnprintf(buf + p, max - p, "mode:\t\t%s\n",
-                   task_is_preemptive() ? "preemptive" : "cooperative");
+                   st->preemptive ? "preemptive" : "cooperative");
     p += ksnprintf(buf + p, max - p, "quantum:\t%u ticks (%u ms)\n",
-                   task_get_quantum(), task_get_quantum() * 1000 / timer_get_frequency());
-    p += ksnprintf(buf + p, max - p, "frequency:\t%u Hz\n", timer_get_frequency());
-    p += ksnprintf(buf + p, max - p, "total_switches:\t%u\n", task_total_switches());
-    p += ksnprintf(buf + p, max - p, "active_tasks:\t%u\n", task_count());
+                   st->quantum, st->quantum * 1000 / st->tick_hz);
+    p += ksnprintf(buf + p, max - p, "frequency:\t%u Hz\n", st->tick_hz);
+    p += ksnprintf(buf + p, max - p, "total_switches:\t%u\n", st->switches);
+    p += ksnprintf(buf + p, max - p, "active_tasks:\t%u\n", st->tasks);
     return p;
 }
 
 /* ---- /proc dispatch ---- */
 
+/* Counter files take a snapshot instead of reading live state */
 typedef struct {
     const char* name;
     int (*generator)(char* buf, int max);
+    int (*from_stats)(const proc_stats_t* st, char* buf, int max);
 } procfs_entry_t;
 
 static const procfs_entry_t proc_files[] = {
-    { "cpuinfo",     gen_cpuinfo },
-    { "meminfo",     gen_meminfo },
-    { "uptime",      gen_uptime },
-    { "version",     gen_version },
-    { "stat",        gen_stat },
-    { "loadavg",     gen_loadavg },
-    { "filesystems", gen_filesystems },
-    { "mounts",      gen_mounts },
-    { "processes",   gen_processes },
-    { "interrupts",  gen_interrupts },
-    { "scheduler",   gen_scheduler },
-    { NULL, NULL }
+    { "cpuinfo",     gen_cpuinfo,     NULL },
+    { "meminfo",     NULL,            gen_meminfo },
+    { "uptime",      gen_uptime,      NULL },
+    { "version",     gen_version,     NULL },
+    { "stat",        NULL,            gen_stat },
+    { "loadavg",     NULL,            gen_loadavg },
+    { "filesystems", gen_filesystems, NULL },
+    { "mounts",      gen_mounts,      NULL },
+    { "processes",   NULL,            gen_processes },
+    { "interrupts",  gen_interrupts,  NULL },
+    { "scheduler",   NULL,            gen_scheduler },
+    { "boottime",    bootprof_format, NULL },
+    { NULL, NULL, NULL }
 };
 
 /* Sub-directories */
 static const procfs_entry_t proc_net_files[] = {
-    { "dev", gen_net_dev },
-    { NULL, NULL }
+    { "dev", NULL, gen_net_dev },
+    { NULL, NULL, NULL }
 };
 
+/* Too big for a 4K kernel stack; the scheduler lock keeps it private
+ * to one reader at a time */
+static proc_stats_t snap;
+
+static int gen_entry(const procfs_entry_t* e, char* buf, int max) {
+    if (e->generator) return e->generator(buf, max);
+    task_lock_scheduler();
+    procfs_snapshot(&snap);
+    int n = e->from_stats(&snap, buf, max);
+    task_unlock_scheduler();
+    return n;
+}
+
 void procfs_init(void) {
     /* /proc and /proc/net directories are created by create_default_fs */
 }
@@ -323,18 +445,21 @@ int32_t procfs_read(const char* path, void* buf, uint32_t max) {
         const char* net_name = name + 4;
         for (int i = 0; proc_net_files[i].name; i++) {
             if (strcmp(net_name, proc_net_files[i].name) == 0)
-                return proc_net_files[i].generator((char*)buf, max);
+                return gen_entry(&proc_net_files[i], (char*)buf, max);
         }
         return -1;
     }
 
-    /* Check /proc/<pid>/status */
+    /* Check /proc/<pid>/status and /proc/<pid>/stat */
     if (isdigit(name[0])) {
         int pid = atoi(name);
         const char* slash = strchr(name, '/');
         if (slash && strcmp(slash + 1, "status") == 0) {
             return gen_pid_status((char*)buf, max, pid);
         }
+        if (slash && strcmp(slash + 1, "stat") == 0) {
+            return gen_pid_stat((char*)buf, max, pid);
+        }
         /* /proc/<pid> alone -> same as status */
         if (!slash || slash[1] == '\0') {
             return gen_pid_status((char*)buf, max, pid);
@@ -345,7 +470,7 @@ int32_t procfs_read(const char* path, void* buf, uint32_t max) {
     /* Check top-level /proc/ files */
     for (int i = 0; proc_files[i].name; i++) {
         if (strcmp(name, proc_files[i].name) == 0)
-            return proc_files[i].generator((char*)buf, max);
+            return gen_entry(&proc_files[i], (char*)buf, max);
     }
 
     return -1;
@@ -8,6 +8,7 @@
 
 static ramfs_node_t nodes[RAMFS_MAX_FILES];
 static char cwd[RAMFS_MAX_PATH] = "/";
+static uint32_t version_seq = 0;   /* Source of ramfs_node_t.version */
 
 /* Determine if a resolved path targets /disk (drive 0) or /disk2 (drive 1).
  * Returns drive index (0 or 1) + 1, or 0 if not a disk path.
@@ -147,6 +148,7 @@ int32_t ramfs_create(const char* path, ramfs_type_t type) {
             nodes[i].capacity = 0;
             nodes[i].created = timer_get_ticks();
             nodes[i].modified = timer_get_ticks();
+            nodes[i].version = ++version_seq;
             return i;
         }
     }
@@ -186,6 +188,7 @@ int32_t ramfs_write(const char* path, const void* data, uint32_t size) {
     memcpy(nodes[idx].data, data, size);
     nodes[idx].size = size;
     nodes[idx].modified = timer_get_ticks();
+    nodes[idx].version = ++version_seq;
     return size;
 }
 
@@ -211,6 +214,7 @@ int32_t ramfs_append(const char* path, const void* data, uint32_t size) {
     memcpy(nodes[idx].data + nodes[idx].size, data, to_add);
     nodes[idx].size = new_size;
     nodes[idx].modified = timer_get_ticks();
+    nodes[idx].version = ++version_seq;
     return to_add;
 }
 
@@ -478,6 +482,18 @@ ramfs_node_t* ramfs_get_node(int32_t idx) {
     return &nodes[idx];
 }
 
+const uint8_t* ramfs_get_data(const char* path, uint32_t* size) {
+    char resolved[RAMFS_MAX_PATH];
+    ramfs_resolve_path(path, resolved);
+    const char* dp;
+    if (procfs_is_virtual(resolved) || match_disk(resolved, &dp)) return NULL;
+
+    int32_t idx = ramfs_find(path);
+    if (idx < 0 || nodes[idx].type != RAMFS_FILE || !nodes[idx].data) return NULL;
+    if (size) *size = nodes[idx].size;
+    return nodes[idx].data;
+}
+
 void ramfs_get_path(int32_t idx, char* buf, uint32_t max) {
     if (idx < 0 || idx >= RAMFS_MAX_FILES || !nodes[idx].active) {
         buf[0] = '\0';
@@ -53,7 +53,7 @@ void screensaver_matrix(void) {
         timer_sleep(50);
     }
     keyboard_getchar(); /* Consume the key */
-    terminal_clear();
+    terminal_refresh();     /* Redraw the console from the shadow buffer */
 }
 
 /* ===== STARFIELD ===== */
@@ -101,7 +101,7 @@ void screensaver_starfield(void) {
         timer_sleep(30);
     }
     keyboard_getchar();
-    terminal_clear();
+    terminal_refresh();
 }
 
 /* ===== PIPES ===== */
@@ -161,5 +161,5 @@ void screensaver_pipes(void) {
         timer_sleep(20);
     }
     keyboard_getchar();
-    terminal_clear();
+    terminal_refresh();
 }
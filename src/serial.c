@@ -1,5 +1,8 @@
 #include "serial.h"
 #include "vga.h"
+#include "idt.h"
+#include "input.h"
+#include "timer.h"
 
 void serial_init(uint16_t port) {
     outb(port + 1, 0x00);    /* Disable interrupts */
@@ -36,6 +39,33 @@ char serial_read(uint16_t port) {
     return inb(port);
 }
 
+/* ===== Serial console input =====
+ * Bytes arriving on COM1 become keystrokes, so the shell can be driven
+ * over the serial line (e.g. QEMU -nographic). */
+static void serial_rx_callback(registers_t* regs) {
+    (void)regs;
+    while (serial_received(COM1)) {
+        char c = inb(COM1);
+        if (c == '\r') c = '\n';
+        if (c == 0x7F) c = '\b';
+
+        input_event_t ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.tsc    = timer_rdtsc();
+        ev.type   = INPUT_EV_KEY;
+        ev.source = INPUT_SRC_SERIAL;
+        ev.code   = (uint8_t)c;
+        ev.value  = 1;
+        input_push(&ev);
+    }
+}
+
+void serial_enable_input(void) {
+    register_interrupt_handler(32 + 4, serial_rx_callback);
+    outb(COM1 + 1, 0x01);    /* Interrupt on received data */
+    irq_unmask(4);
+}
+
 typedef __builtin_va_list va_list;
 #define va_start(ap, last) __builtin_va_start(ap, last)
 #define va_end(ap)         __builtin_va_end(ap)
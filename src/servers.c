@@ -38,8 +38,8 @@ uint32_t net_server_pid     = 0;
  * ================================================================ */
 
 void console_server_main(void) {
-    /* Register our service */
-    sys_register_service(SVC_CONSOLE);
+    /* Create our endpoint */
+    sys_endpoint_create(SVC_CONSOLE);
 
     message_t msg;
     message_t reply;
@@ -57,8 +57,9 @@ void console_server_main(void) {
             const char* text = msg.cons.data;
             uint32_t len = msg.cons.len;
             if (len > sizeof(msg.cons.data)) len = sizeof(msg.cons.data);
-            for (uint32_t i = 0; i < len && text[i]; i++)
-                terminal_putchar(text[i]);
+            uint32_t n = 0;
+            while (n < len && text[n]) n++;
+            terminal_write(text, n);
             reply.reply.status = 0;
             reply.reply.value = len;
             break;
@@ -103,7 +104,7 @@ void console_server_main(void) {
  * ================================================================ */
 
 void vfs_server_main(void) {
-    sys_register_service(SVC_VFS);
+    sys_endpoint_create(SVC_VFS);
 
     message_t msg;
     message_t reply;
@@ -197,7 +198,7 @@ void vfs_server_main(void) {
  * ================================================================ */
 
 void disk_server_main(void) {
-    sys_register_service(SVC_DISK);
+    sys_endpoint_create(SVC_DISK);
 
     message_t msg;
     message_t reply;
@@ -255,7 +256,7 @@ void disk_server_main(void) {
  * ================================================================ */
 
 void net_server_main(void) {
-    sys_register_service(SVC_NET);
+    sys_endpoint_create(SVC_NET);
 
     message_t msg;
     message_t reply;
@@ -333,10 +334,12 @@ void servers_launch_missing(void) {
         pid = task_create_user("ata_srv", disk_server_main, 2, true);
         if (pid >= 0) disk_server_pid = pid;
     }
-    if (!net_server_pid) {
-        pid = task_create_user("net_srv", net_server_main, 2, true);
-        if (pid >= 0) net_server_pid = pid;
-    }
+}
+
+void servers_launch_net(void) {
+    if (net_server_pid) return;
+    int32_t pid = task_create_user("net_srv", net_server_main, 2, true);
+    if (pid >= 0) net_server_pid = pid;
 }
 
 void servers_wait_ready(void) {
@@ -29,11 +29,20 @@
 #include "gl_demo.h"
 #include "elf.h"
 #include "server.h"
+#include "pipe.h"
+#include "bench.h"
+#include "sysmon.h"
+#include "bootprof.h"
 
 #define CMD_MAX 256
 #define HISTORY_SIZE 32
 #define MAX_ARGS 16
 #define OUTPUT_BUF_SIZE 4096
+#define PIPE_MAX_STAGES 4
+#define TEXT_LINE_MAX   256     /* grep/tail line length (longer lines are cut) */
+#define STAGE_MIN       16384   /* Staging size for /proc files (stat is a guess) */
+#define TAIL_MAX_LINES  512
+#define MORE_MAX        65536   /* Pager collects at most this much from a pipe */
 
 static char history[HISTORY_SIZE][CMD_MAX];
 static int  history_count = 0;
@@ -249,8 +258,10 @@ static void cmd_help(int argc, char* argv[]) {
     terminal_print_colored("    mem heap alloc\n\n", d);
 
     terminal_print_colored("  PROCESSES & IPC\n", g);
-    terminal_print_colored("    ps kill ipc services mkport send recv syscall scheduler\n", d);
-    terminal_print_colored("    exec <elf> - run ELF binary in isolated address space\n\n", d);
+    terminal_print_colored("    ps top kill ipc services mkport send recv syscall scheduler\n", d);
+    terminal_print_colored("    exec <elf> - run ELF binary in isolated address space\n", d);
+    terminal_print_colored("    execbench <elf> [n] - spawn/reap latency benchmark\n", d);
+    terminal_print_colored("    bench [list|name...] - kernel microbenchmarks (min/median/p99)\n\n", d);
 
     terminal_print_colored("  FILESYSTEM\n", g);
     terminal_print_colored("    ls cd pwd cat more head tail grep find\n", d);
@@ -363,6 +374,42 @@ static void cmd_alloc(int argc, char** argv) {
 
 static void cmd_ps(int ac, char** av) { (void)ac; (void)av; task_list(); }
 
+/* Live system monitor (see sysmon.h), redrawn in place every second.
+ * Any key quits. */
+static void cmd_top(int ac, char** av) {
+    (void)ac; (void)av;
+    static sysmon_t mon;
+    char line[VGA_WIDTH + 1];
+
+    mon.primed = false;
+    sysmon_update(&mon);
+    terminal_clear();
+    terminal_print_at(VGA_HEIGHT - 1, 0, "top - 1 s samples, sorted by CPU; any key quits", 0x08);
+
+    while (!keyboard_haskey()) {
+        for (int n = 0; n < 10 && !keyboard_haskey(); n++) timer_sleep(100);
+        if (keyboard_haskey()) break;
+        sysmon_update(&mon);
+
+        /* Rows are padded to the full width so nothing stale survives;
+         * the bottom row keeps the hint */
+        int lines = sysmon_lines(&mon.view);
+        for (int row = 0; row < VGA_HEIGHT - 1; row++) {
+            bool head = false;
+            int len = 0;
+            if (row < lines) {
+                head = sysmon_line(&mon.view, row, line, VGA_WIDTH);
+                len = (int)strlen(line);
+            }
+            while (len < VGA_WIDTH) line[len++] = ' ';
+            line[len] = '\0';
+            terminal_print_at(row, 0, line, head ? 0x0B : 0x07);
+        }
+    }
+    if (keyboard_haskey()) keyboard_getchar();
+    terminal_clear();
+}
+
 static void cmd_kill(int argc, char** argv) {
     if(argc<2){kprintf("Usage: kill <pid>\n");return;}
     uint32_t pid=atoi(argv[1]); if(!pid){kprintf("Can't kill PID 0\n");return;}
@@ -381,13 +428,18 @@ static void cmd_mkport(int argc, char** argv) {
 static void cmd_services(int ac, char** av) { (void)ac; (void)av; ipc_service_list(); }
 
 static void cmd_send(int argc, char** argv) {
-    if(argc<3){kprintf("Usage: send <pid> <msg>\n");return;}
+    if(argc<3){kprintf("Usage: send <pid|service> <msg>\n");return;}
     message_t msg; memset(&msg,0,sizeof(msg));
     msg.type=MSG_PING;
     char text[48]=""; for(int i=2;i<argc;i++){if(i>2)strcat(text," ");strcat(text,argv[i]);}
     strncpy((char*)msg.raw,text,sizeof(msg.raw)-1);
-    int32_t r=ipc_send(atoi(argv[1]),&msg);
-    if(r==0) kprintf("Sent to PID %s\n",argv[1]); else kprintf("Error %d\n",r);
+    /* Look names up rather than opening them: a typo must not reserve a
+     * registry slot */
+    uint32_t dest = (argv[1][0]>='0'&&argv[1][0]<='9') ? (uint32_t)atoi(argv[1])
+                                                       : ipc_lookup_service(argv[1]);
+    if(!dest){kprintf("send: no service '%s'\n",argv[1]);return;}
+    int32_t r=ipc_send(dest,&msg);
+    if(r==0) kprintf("Sent to %s\n",argv[1]); else kprintf("Error %d\n",r);
 }
 
 static void cmd_recv(int argc, char** argv) {
@@ -432,11 +484,155 @@ static void cmd_cd(int argc, char** argv) {
 
 static void cmd_pwd(int ac, char** av) { (void)ac; (void)av; kprintf("%s\n",ramfs_get_cwd()); }
 
+/* ====== STREAMING INPUT ======
+ * Text filters read either a file or, with no file argument, the pipe on
+ * their stdin.  ramfs files are walked in place; disk and /proc files are
+ * staged once.  Nothing here puts a whole file on the stack — pipeline
+ * stages run on 8 KB kernel task stacks. */
+typedef struct {
+    const uint8_t* data;        /* File contents (NULL when piped) */
+    uint32_t       size;
+    uint32_t       pos;
+    uint8_t*       staged;      /* kmalloc'd copy to free on close */
+    bool           piped;
+    uint8_t        chunk[128];  /* Read-ahead for pipe input */
+    uint32_t       clen, cpos;
+} shell_input_t;
+
+/* The heap has no lock of its own and stages run concurrently */
+static void* shell_alloc(uint32_t size) {
+    task_lock_scheduler();
+    void* p = kmalloc(size);
+    task_unlock_scheduler();
+    return p;
+}
+
+static void shell_free(void* p) {
+    task_lock_scheduler();
+    kfree(p);
+    task_unlock_scheduler();
+}
+
+/* path == NULL: read stdin.  Returns false (after printing why) on failure. */
+static bool input_open(shell_input_t* in, const char* path, const char* cmd) {
+    memset(in, 0, sizeof(*in));
+    if (!path) {
+        if (!pipe_stdin_is_pipe()) return false;
+        in->piped = true;
+        return true;
+    }
+
+    in->data = ramfs_get_data(path, &in->size);
+    if (in->data) return true;
+
+    ramfs_type_t type;
+    uint32_t size;
+    if (ramfs_stat(path, &type, &size) != 0) {
+        kprintf("%s: %s: not found\n", cmd, path);
+        return false;
+    }
+    if (type != RAMFS_FILE) {
+        kprintf("%s: %s: is a directory\n", cmd, path);
+        return false;
+    }
+    if (size < STAGE_MIN) size = STAGE_MIN;
+    in->staged = (uint8_t*)shell_alloc(size);
+    if (!in->staged) { kprintf("%s: out of memory\n", cmd); return false; }
+    int32_t n = ramfs_read(path, in->staged, size);
+    in->data = in->staged;
+    in->size = (n > 0) ? (uint32_t)n : 0;
+    return true;
+}
+
+static int32_t input_read(shell_input_t* in, void* buf, uint32_t max) {
+    if (in->cpos < in->clen) {
+        uint32_t n = in->clen - in->cpos;
+        if (n > max) n = max;
+        memcpy(buf, in->chunk + in->cpos, n);
+        in->cpos += n;
+        return (int32_t)n;
+    }
+    if (in->piped) {
+        int32_t n = pipe_stdin_read(buf, max);
+        return (n > 0) ? n : 0;
+    }
+    uint32_t n = in->size - in->pos;
+    if (n > max) n = max;
+    memcpy(buf, in->data + in->pos, n);
+    in->pos += n;
+    return (int32_t)n;
+}
+
+static int input_getc(shell_input_t* in) {
+    if (!in->piped)
+        return (in->pos < in->size) ? in->data[in->pos++] : -1;
+    if (in->cpos >= in->clen) {
+        int32_t n = pipe_stdin_read(in->chunk, sizeof(in->chunk));
+        if (n <= 0) return -1;
+        in->clen = (uint32_t)n;
+        in->cpos = 0;
+    }
+    return in->chunk[in->cpos++];
+}
+
+/* Next line without its '\n'; -1 at end of input.  Overlong lines are cut. */
+static int input_getline(shell_input_t* in, char* line, int max) {
+    int len = 0, c;
+    while ((c = input_getc(in)) >= 0 && c != '\n')
+        if (len < max - 1) line[len++] = (char)c;
+    line[len] = '\0';
+    return (c < 0 && len == 0) ? -1 : len;
+}
+
+static void input_close(shell_input_t* in) {
+    if (in->staged) shell_free(in->staged);
+    in->staged = NULL;
+    in->data = NULL;
+    if (in->piped) pipe_stdin_close();
+}
+
+/* Whole-file copy in a NUL-terminated heap buffer, for commands that need
+ * all of it at once.  Returns NULL (after printing why) on failure. */
+static char* read_file(const char* path, const char* cmd, int32_t* len) {
+    ramfs_type_t type;
+    uint32_t size;
+    if (ramfs_stat(path, &type, &size) != 0) {
+        kprintf("%s: %s: not found\n", cmd, path);
+        return NULL;
+    }
+    if (type != RAMFS_FILE) {
+        kprintf("%s: %s: is a directory\n", cmd, path);
+        return NULL;
+    }
+    if (size < STAGE_MIN) size = STAGE_MIN;
+    char* buf = (char*)shell_alloc(size + 1);
+    if (!buf) { kprintf("%s: out of memory\n", cmd); return NULL; }
+    int32_t n = ramfs_read(path, buf, size);
+    if (n < 0) {
+        shell_free(buf);
+        kprintf("%s: %s: read failed\n", cmd, path);
+        return NULL;
+    }
+    buf[n] = '\0';
+    if (len) *len = n;
+    return buf;
+}
+
 static void cmd_cat(int argc, char** argv) {
-    if(argc<2){kprintf("Usage: cat <file>\n");return;}
-    char buf[RAMFS_MAX_DATA+1]; int32_t n=ramfs_read(argv[1],buf,RAMFS_MAX_DATA);
-    if(n<0){kprintf("cat: %s: not found\n",argv[1]);return;}
-    buf[n]='\0'; kprintf("%s",buf); if(n>0&&buf[n-1]!='\n') kprintf("\n");
+    shell_input_t in;
+    if (!input_open(&in, (argc > 1) ? argv[1] : NULL, "cat")) {
+        if (argc < 2) kprintf("Usage: cat <file>\n");
+        return;
+    }
+    char buf[256];
+    char last = '\n';
+    int32_t n;
+    while ((n = input_read(&in, buf, sizeof(buf))) > 0) {
+        terminal_write(buf, (uint32_t)n);
+        last = buf[n - 1];
+    }
+    if (last != '\n') terminal_putchar('\n');
+    input_close(&in);
 }
 
 static void cmd_touch(int argc, char** argv) {
@@ -452,7 +648,7 @@ static void cmd_mkdir(int argc, char** argv) {
 
 static void cmd_write(int argc, char** argv) {
     if(argc<3){kprintf("Usage: write <file> <text...>\n");return;}
-    char buf[RAMFS_MAX_DATA]="";
+    char buf[CMD_MAX + 2]="";     /* The words came from one command line */
     for(int i=2;i<argc;i++){if(i>2)strcat(buf," ");strcat(buf,argv[i]);}
     strcat(buf,"\n");
     int32_t r=ramfs_write(argv[1],buf,strlen(buf));
@@ -472,38 +668,48 @@ static void cmd_tree(int argc, char** argv) {
 
 static void cmd_hex(int argc, char** argv) {
     if(argc<2){kprintf("Usage: hex <file>\n");return;}
-    uint8_t buf[RAMFS_MAX_DATA]; int32_t n=ramfs_read(argv[1],buf,sizeof(buf));
-    if(n<0){kprintf("Not found\n");return;}
-    for(int32_t i=0;i<n;i+=16){
+    shell_input_t in;
+    if(!input_open(&in,argv[1],"hex"))return;
+    uint8_t buf[16]; int32_t n;
+    for(int32_t i=0;(n=input_read(&in,buf,16))>0;i+=16){
         terminal_print_hex(i); kprintf("  ");
         for(int j=0;j<16;j++){
-            if(i+j<n)kprintf("%c%c ","0123456789ABCDEF"[(buf[i+j]>>4)&0xF],"0123456789ABCDEF"[buf[i+j]&0xF]);
+            if(j<n)kprintf("%c%c ","0123456789ABCDEF"[(buf[j]>>4)&0xF],"0123456789ABCDEF"[buf[j]&0xF]);
             else kprintf("   ");
             if(j==7)kprintf(" ");
         }
         kprintf(" |");
-        for(int j=0;j<16&&i+j<n;j++){char c=buf[i+j];terminal_putchar((c>=32&&c<127)?c:'.');}
+        for(int j=0;j<n;j++){char c=buf[j];terminal_putchar((c>=32&&c<127)?c:'.');}
         kprintf("|\n");
     }
+    input_close(&in);
 }
 
 static void cmd_wc(int argc, char** argv) {
-    if(argc<2){kprintf("Usage: wc <file>\n");return;}
-    char buf[RAMFS_MAX_DATA]; int32_t n=ramfs_read(argv[1],buf,sizeof(buf));
-    if(n<0){kprintf("Not found\n");return;}
-    int lines=0,words=0; bool in_word=false;
-    for(int32_t i=0;i<n;i++){
-        if(buf[i]=='\n')lines++;
-        if(isspace(buf[i])){in_word=false;}else{if(!in_word)words++;in_word=true;}
+    shell_input_t in;
+    if (!input_open(&in, (argc > 1) ? argv[1] : NULL, "wc")) {
+        if (argc < 2) kprintf("Usage: wc <file>\n");
+        return;
     }
-    kprintf("  %d lines, %d words, %d bytes  %s\n",lines,words,n,argv[1]);
+    char buf[256];
+    int lines = 0, words = 0; uint32_t bytes = 0; bool in_word = false;
+    int32_t n;
+    while ((n = input_read(&in, buf, sizeof(buf))) > 0) {
+        for (int32_t i = 0; i < n; i++) {
+            if (buf[i] == '\n') lines++;
+            if (isspace(buf[i])) { in_word = false; } else { if (!in_word) words++; in_word = true; }
+        }
+        bytes += (uint32_t)n;
+    }
+    input_close(&in);
+    kprintf("  %d lines, %d words, %d bytes  %s\n", lines, words, bytes, (argc > 1) ? argv[1] : "");
 }
 
 static void cmd_cp(int argc, char** argv) {
     if (argc < 3) { kprintf("Usage: cp <src> <dest>\n"); return; }
-    char buf[RAMFS_MAX_DATA];
-    int32_t n = ramfs_read(argv[1], buf, sizeof(buf));
-    if (n < 0) { kprintf("cp: %s: not found\n", argv[1]); return; }
+    int32_t n;
+    char* buf = read_file(argv[1], "cp", &n);
+    if (!buf) return;
 
     /* If dest is a directory, append source filename */
     char dest[RAMFS_MAX_PATH];
@@ -522,6 +728,7 @@ static void cmd_cp(int argc, char** argv) {
     }
 
     int32_t r = ramfs_write(dest, buf, n);
+    shell_free(buf);
     if (r < 0) kprintf("cp: failed to write %s\n", dest);
 }
 
@@ -562,19 +769,23 @@ static void cmd_head(int argc, char** argv) {
         else
             file = argv[i];
     }
-    if (!file) { kprintf("Usage: head [-n N] <file>\n"); return; }
 
-    char buf[RAMFS_MAX_DATA + 1];
-    int32_t n = ramfs_read(file, buf, RAMFS_MAX_DATA);
-    if (n < 0) { kprintf("head: %s: not found\n", file); return; }
-    buf[n] = '\0';
+    shell_input_t in;
+    if (!input_open(&in, file, "head")) {
+        if (!file) kprintf("Usage: head [-n N] <file>\n");
+        return;
+    }
 
-    int count = 0;
-    for (int32_t i = 0; i < n && count < lines; i++) {
-        terminal_putchar(buf[i]);
-        if (buf[i] == '\n') count++;
+    /* Stop reading as soon as we have enough; closing stdin early lets
+     * the producer see a broken pipe instead of filling the buffer. */
+    int count = 0, c = -1, prev = '\n';
+    while (count < lines && (c = input_getc(&in)) >= 0) {
+        terminal_putchar((char)c);
+        if (c == '\n') count++;
+        prev = c;
     }
-    if (count == 0 && n > 0 && buf[n-1] != '\n') terminal_putchar('\n');
+    if (prev != '\n') terminal_putchar('\n');
+    input_close(&in);
 }
 
 static void cmd_tail(int argc, char** argv) {
@@ -588,33 +799,28 @@ static void cmd_tail(int argc, char** argv) {
         else
             file = argv[i];
     }
-    if (!file) { kprintf("Usage: tail [-n N] <file>\n"); return; }
+    if (lines <= 0) return;
+    if (lines > TAIL_MAX_LINES) lines = TAIL_MAX_LINES;
 
-    char buf[RAMFS_MAX_DATA + 1];
-    int32_t n = ramfs_read(file, buf, RAMFS_MAX_DATA);
-    if (n < 0) { kprintf("tail: %s: not found\n", file); return; }
-    buf[n] = '\0';
+    shell_input_t in;
+    if (!input_open(&in, file, "tail")) {
+        if (!file) kprintf("Usage: tail [-n N] <file>\n");
+        return;
+    }
 
-    /* Count total newlines */
-    int total = 0;
-    for (int32_t i = 0; i < n; i++)
-        if (buf[i] == '\n') total++;
+    /* Ring of the last N lines — memory follows N, not the input size */
+    char* ring = (char*)shell_alloc((uint32_t)lines * TEXT_LINE_MAX);
+    if (!ring) { kprintf("tail: out of memory\n"); input_close(&in); return; }
 
-    /* Find start position: skip (total - lines) newlines */
-    int skip = total - lines;
-    int32_t start = 0;
-    if (skip > 0) {
-        int count = 0;
-        for (int32_t i = 0; i < n; i++) {
-            if (buf[i] == '\n') {
-                count++;
-                if (count >= skip) { start = i + 1; break; }
-            }
-        }
-    }
-    for (int32_t i = start; i < n; i++)
-        terminal_putchar(buf[i]);
-    if (n > 0 && buf[n-1] != '\n') terminal_putchar('\n');
+    uint32_t seen = 0;
+    while (input_getline(&in, ring + (seen % (uint32_t)lines) * TEXT_LINE_MAX, TEXT_LINE_MAX) >= 0)
+        seen++;
+    input_close(&in);
+
+    uint32_t first = (seen > (uint32_t)lines) ? seen - (uint32_t)lines : 0;
+    for (uint32_t i = first; i < seen; i++)
+        kprintf("%s\n", ring + (i % (uint32_t)lines) * TEXT_LINE_MAX);
+    shell_free(ring);
 }
 
 static void cmd_grep(int argc, char** argv) {
@@ -622,26 +828,15 @@ static void cmd_grep(int argc, char** argv) {
     const char* pattern = argv[1];
     uint32_t plen = strlen(pattern);
 
-    char buf[RAMFS_MAX_DATA + 1];
-    int32_t n;
-
-    if (argc >= 3) {
-        /* Grep in file */
-        n = ramfs_read(argv[2], buf, RAMFS_MAX_DATA);
-        if (n < 0) { kprintf("grep: %s: not found\n", argv[2]); return; }
-    } else {
-        /* Grep from pipe input */
-        n = ramfs_read("/tmp/.pipe", buf, RAMFS_MAX_DATA);
-        if (n < 0) { kprintf("Usage: grep <pattern> <file>\n"); return; }
+    shell_input_t in;
+    if (!input_open(&in, (argc >= 3) ? argv[2] : NULL, "grep")) {
+        if (argc < 3) kprintf("Usage: grep <pattern> <file>\n");
+        return;
     }
-    buf[n] = '\0';
 
     /* Process line by line */
-    char* line = buf;
-    while (*line) {
-        char* nl = strchr(line, '\n');
-        if (nl) *nl = '\0';
-
+    char line[TEXT_LINE_MAX];
+    while (input_getline(&in, line, sizeof(line)) >= 0) {
         /* Search for pattern in line */
         bool found = false;
         for (char* p = line; *p; p++) {
@@ -650,7 +845,7 @@ static void cmd_grep(int argc, char** argv) {
         if (found) {
             /* Print line with matching part highlighted */
             for (char* p = line; *p; p++) {
-                if (strncmp(p, pattern, plen) == 0) {
+                if (plen && strncmp(p, pattern, plen) == 0) {
                     terminal_print_colored(pattern, 0x0C); /* Red highlight */
                     p += plen - 1;
                 } else {
@@ -659,10 +854,8 @@ static void cmd_grep(int argc, char** argv) {
             }
             terminal_putchar('\n');
         }
-
-        if (nl) { *nl = '\n'; line = nl + 1; }
-        else break;
     }
+    input_close(&in);
 }
 
 static void cmd_find(int argc, char** argv) {
@@ -1089,46 +1282,38 @@ static void cmd_exec(int argc, char** argv) {
         name = namebuf;
     }
 
-    /* Stat the file to get its size */
-    ramfs_type_t type;
-    uint32_t fsize;
-    if (ramfs_stat(path, &type, &fsize) < 0) {
+    /* Open the file: ramfs data is used in place, disk files are staged once */
+    elf_file_t file;
+    int rc = elf_open(path, &file);
+    if (rc == -1) {
         kprintf("  File not found: %s\n", path);
         return;
     }
-    if (type != RAMFS_FILE) {
+    if (rc == -2) {
         kprintf("  Not a file: %s\n", path);
         return;
     }
-    if (fsize < sizeof(elf32_ehdr_t)) {
-        kprintf("  File too small to be an ELF binary (%u bytes)\n", fsize);
-        return;
-    }
-
-    /* Read the file into memory */
-    uint8_t* buf = kmalloc(fsize);
-    if (!buf) {
-        kprintf("  Out of memory (need %u bytes)\n", fsize);
+    if (rc < 0) {
+        kprintf("  Out of memory reading %s\n", path);
         return;
     }
-    int32_t rd = ramfs_read(path, buf, fsize);
-    if (rd <= 0) {
-        kfree(buf);
-        kprintf("  Failed to read file\n");
+    if (file.size < sizeof(elf32_ehdr_t)) {
+        kprintf("  File too small to be an ELF binary (%u bytes)\n", file.size);
+        elf_close(&file);
         return;
     }
 
     /* Validate and load */
-    if (elf_validate(buf, (uint32_t)rd) != 0) {
-        kfree(buf);
+    if (elf_validate(file.data, file.size) != 0) {
+        elf_close(&file);
         kprintf("  Not a valid ELF binary (need 32-bit x86 executable, linked at 0x%x+)\n",
                 USER_BASE);
         return;
     }
 
-    kprintf("  Loading '%s' (%u bytes)...\n", name, rd);
-    int32_t pid = elf_load(buf, (uint32_t)rd, name, priority, io_priv, flags);
-    kfree(buf);
+    kprintf("  Loading '%s' (%u bytes)...\n", name, file.size);
+    int32_t pid = elf_load(&file, name, priority, io_priv, flags);
+    elf_close(&file);
 
     if (pid < 0) {
         kprintf("  Failed to load ELF binary\n");
@@ -1143,6 +1328,76 @@ static void cmd_exec(int argc, char** argv) {
     kprintf(")\n");
 }
 
+/* Exec latency benchmark: spawn and reap N instances of an ELF */
+static void cmd_execbench(int argc, char** argv) {
+    if (argc < 2) {
+        kprintf("  Usage: execbench <path> [count]\n");
+        kprintf("  Example: execbench /bin/hello.elf 20\n");
+        return;
+    }
+    const char* path = argv[1];
+    uint32_t count = (argc > 2) ? (uint32_t)atoi(argv[2]) : 10;
+    if (count < 1) count = 1;
+    if (count > 1000) count = 1000;
+    if (!timer_tsc_khz()) { kprintf("  TSC not calibrated\n"); return; }
+
+    uint32_t load_min = 0xFFFFFFFF, load_max = 0, load_sum = 0;
+    uint32_t run_min = 0xFFFFFFFF, run_max = 0, run_sum = 0;
+    uint32_t free_before = pmm_get_free_pages();
+    uint32_t done = 0, killed = 0;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint64_t t0 = timer_rdtsc();
+
+        elf_file_t file;
+        if (elf_open(path, &file) != 0) { kprintf("  Cannot open %s\n", path); return; }
+        int32_t pid = elf_load(&file, "execbench", 10, false, 0);
+        elf_close(&file);
+        if (pid < 0) { kprintf("  Failed to load %s\n", path); return; }
+
+        uint64_t t1 = timer_rdtsc();
+
+        /* Reap: wait for the instance to exit (2s cap, then kill it) */
+        uint32_t deadline = timer_get_ticks() + 2 * timer_get_frequency();
+        while (task_get_by_pid((uint32_t)pid)) {
+            if (timer_get_ticks() >= deadline) { task_kill((uint32_t)pid); killed++; break; }
+            task_yield();
+        }
+
+        uint64_t t2 = timer_rdtsc();
+        uint32_t load = timer_tsc_to_us(t1 - t0), run = timer_tsc_to_us(t2 - t0);
+        load_sum += load; run_sum += run;
+        if (load < load_min) load_min = load;
+        if (load > load_max) load_max = load;
+        if (run < run_min) run_min = run;
+        if (run > run_max) run_max = run;
+        done++;
+    }
+
+    uint32_t free_after = pmm_get_free_pages();
+    kprintf("  execbench: %s x%u (TSC %u MHz)\n", path, done, timer_tsc_khz() / 1000);
+    kprintf("    load        min %u us  avg %u us  max %u us\n",
+            load_min, load_sum / done, load_max);
+    kprintf("    spawn+reap  min %u us  avg %u us  max %u us\n",
+            run_min, run_sum / done, run_max);
+    kprintf("    frames: %u free before, %u after", free_before, free_after);
+    if (killed) kprintf(", %u killed on timeout", killed);
+    kprintf("\n");
+}
+
+/* Microbenchmark suite (results also go to serial as BENCH lines) */
+static void cmd_bench(int argc, char** argv) {
+    if (!timer_tsc_khz()) { kprintf("  TSC not calibrated\n"); return; }
+    if (argc < 2) {
+        int failed = bench_run_all();
+        if (failed) kprintf("  %d benchmark(s) FAILED\n", failed);
+        return;
+    }
+    if (strcmp(argv[1], "list") == 0) { bench_list(); return; }
+    for (int i = 1; i < argc; i++)
+        bench_run(argv[i], NULL);
+}
+
 /* Login/user commands */
 static void cmd_whoami(int ac, char** av) { (void)ac; (void)av; kprintf("%s\n",login_current_user()); }
 static void cmd_users(int ac, char** av) { (void)ac; (void)av; login_list_users(); }
@@ -1256,9 +1511,8 @@ static void cmd_gui(int ac, char** av) {
 
 static void cmd_sh(int argc, char** argv) {
     if(argc<2){kprintf("Usage: sh <script>\n");return;}
-    char buf[RAMFS_MAX_DATA]; int32_t n=ramfs_read(argv[1],buf,sizeof(buf)-1);
-    if(n<0){kprintf("sh: %s: not found\n",argv[1]);return;}
-    buf[n]='\0';
+    char* buf=read_file(argv[1],"sh",NULL);
+    if(!buf)return;
 
     /* Execute each line */
     char* line=buf;
@@ -1281,6 +1535,7 @@ static void cmd_sh(int argc, char** argv) {
         kprintf("%s\n", expanded);
         execute_command(expanded);
     }
+    shell_free(buf);
 }
 
 /* ====== PAGER (more) ====== */
@@ -1326,27 +1581,26 @@ static void pager_display(const char* data, int len) {
 }
 
 static void cmd_more(int argc, char** argv) {
-    if (argc < 2) {
-        /* No argument — read from /tmp/.pipe if piped, otherwise show usage */
-        char buf[OUTPUT_BUF_SIZE];
-        int32_t n = ramfs_read("/tmp/.pipe", buf, sizeof(buf) - 1);
-        if (n > 0) {
-            buf[n] = '\0';
-            pager_display(buf, n);
-        } else {
-            kprintf("  Usage: more <file>  or  command | more\n");
-        }
+    shell_input_t in;
+    if (!input_open(&in, (argc > 1) ? argv[1] : NULL, "  more")) {
+        if (argc < 2) kprintf("  Usage: more <file>  or  command | more\n");
         return;
     }
-    /* Display file through pager */
-    char buf[OUTPUT_BUF_SIZE];
-    int32_t n = ramfs_read(argv[1], buf, sizeof(buf) - 1);
-    if (n < 0) {
-        kprintf("  more: %s: not found\n", argv[1]);
+    /* Files are paged in place; piped input is collected up to MORE_MAX */
+    if (!in.piped) {
+        pager_display((const char*)in.data, (int)in.size);
+        input_close(&in);
         return;
     }
-    buf[n] = '\0';
-    pager_display(buf, n);
+    char* buf = (char*)shell_alloc(MORE_MAX);
+    if (!buf) { input_close(&in); return; }
+    uint32_t len = 0;
+    int32_t n;
+    while (len < MORE_MAX && (n = input_read(&in, buf + len, MORE_MAX - len)) > 0)
+        len += (uint32_t)n;
+    input_close(&in);
+    pager_display(buf, (int)len);
+    shell_free(buf);
 }
 
 /* ====== COMMAND TABLE ====== */
@@ -1357,7 +1611,7 @@ static const command_t commands[] = {
     {"echo",cmd_echo},{"uname",cmd_uname},{"uptime",cmd_uptime},{"date",cmd_date},{"time",cmd_date},
     {"sysinfo",cmd_sysinfo},{"cpuid",cmd_cpuid},{"lspci",cmd_lspci},{"paging",cmd_paging},
     {"mem",cmd_mem},{"free",cmd_mem},{"heap",cmd_heap},{"alloc",cmd_alloc},
-    {"ps",cmd_ps},{"kill",cmd_kill},{"ipc",cmd_ipc},{"services",cmd_services},{"mkport",cmd_mkport},{"send",cmd_send},{"recv",cmd_recv},
+    {"ps",cmd_ps},{"top",cmd_top},{"kill",cmd_kill},{"ipc",cmd_ipc},{"services",cmd_services},{"mkport",cmd_mkport},{"send",cmd_send},{"recv",cmd_recv},
     {"syscall",cmd_syscall_test},
     {"ls",cmd_ls},{"dir",cmd_ls},{"cd",cmd_cd},{"pwd",cmd_pwd},{"cat",cmd_cat},
     {"touch",cmd_touch},{"mkdir",cmd_mkdir},{"write",cmd_write},{"rm",cmd_rm},{"del",cmd_rm},
@@ -1369,7 +1623,7 @@ static const command_t commands[] = {
     {"disk",cmd_disk},{"hdd",cmd_disk},{"format",cmd_format},
     {"mount",cmd_mount},{"umount",cmd_umount},{"unmount",cmd_umount},
     {"ntfsinfo",cmd_ntfsinfo},
-    {"save",cmd_save},{"load",cmd_load},{"exec",cmd_exec},
+    {"save",cmd_save},{"load",cmd_load},{"exec",cmd_exec},{"execbench",cmd_execbench},{"bench",cmd_bench},
     {"whoami",cmd_whoami},{"users",cmd_users},{"adduser",cmd_adduser},{"passwd",cmd_passwd},
     {"login",cmd_login},{"logout",cmd_logout},
     {"env",cmd_env},{"export",cmd_export},{"set",cmd_export},{"unset",cmd_unset},
@@ -1407,6 +1661,82 @@ static void exec_single(char* cmdline) {
     kprintf(": command not found. Type 'help'.\n");
 }
 
+/* ====== PIPELINES ======
+ * "a | b | c": every stage but the last runs as its own kernel task with
+ * stdout (and stdin, past the first) bound to a pipe.  The last stage runs
+ * right here in the shell task so it keeps the keyboard (more, less) and
+ * any > redirection. */
+static struct {
+    char             cmd[CMD_MAX];
+    volatile int32_t pid;       /* -1 = slot idle */
+} stages[PIPE_MAX_STAGES];
+
+static void pipeline_stage_main(void) {
+    task_t* self = task_get_current();
+    for (int i = 0; i < PIPE_MAX_STAGES; i++) {
+        if (self && stages[i].pid == (int32_t)self->id) {
+            exec_single(stages[i].cmd);
+            break;
+        }
+    }
+    task_exit();    /* Closes our pipe ends: EOF downstream, EPIPE upstream */
+}
+
+static void run_pipeline(char* segs[], int n, const char* redir, bool append) {
+    int32_t pipes[PIPE_MAX_STAGES - 1];
+    for (int i = 0; i < n - 1; i++) {
+        pipes[i] = pipe_create();
+        if (pipes[i] < 0) {
+            kprintf("pipe: too many open pipes\n");
+            for (int j = 0; j < i; j++) { pipe_close_read(pipes[j]); pipe_close_write(pipes[j]); }
+            return;
+        }
+    }
+
+    for (int i = 0; i < n - 1; i++) {
+        strcpy(stages[i].cmd, segs[i]);
+        /* Bind the streams before the new task can run */
+        task_lock_scheduler();
+        int32_t pid = task_create("pipe", pipeline_stage_main, 10);
+        task_t* t = (pid >= 0) ? task_get_by_pid((uint32_t)pid) : NULL;
+        if (t) {
+            t->pipe_in  = (i > 0) ? (uint32_t)pipes[i - 1] + 1 : 0;
+            t->pipe_out = (uint32_t)pipes[i] + 1;
+            stages[i].pid = pid;
+        }
+        task_unlock_scheduler();
+        if (!t) {
+            kprintf("pipe: cannot start '%s'\n", segs[i]);
+            stages[i].pid = -1;
+            if (i > 0) pipe_close_read(pipes[i - 1]);
+            pipe_close_write(pipes[i]);
+        }
+    }
+
+    task_t* shell = task_get_current();
+    shell->pipe_in = (uint32_t)pipes[n - 2] + 1;
+    if (redir) start_capture();
+    exec_single(segs[n - 1]);
+    if (redir) stop_capture();
+    pipe_stdin_close();
+
+    /* Reap the producers.  Once our end is closed their writes fail
+     * fast, so anything still alive after a grace period is stuck. */
+    uint32_t deadline = timer_get_ticks() + 200;
+    for (int i = 0; i < n - 1; i++) {
+        while (stages[i].pid >= 0 && task_get_by_pid((uint32_t)stages[i].pid)) {
+            if (timer_get_ticks() >= deadline) { task_kill((uint32_t)stages[i].pid); break; }
+            task_yield();
+        }
+        stages[i].pid = -1;
+    }
+
+    if (redir) {
+        if (append) ramfs_append(redir, output_buffer, output_pos);
+        else        ramfs_write(redir, output_buffer, output_pos);
+    }
+}
+
 /* Execute with pipe and redirection support */
 static void execute_command(char* cmdline) {
     /* Expand environment variables */
@@ -1429,60 +1759,22 @@ static void execute_command(char* cmdline) {
         }
     }
 
-    /* Check for pipe */
-    char* pipe = strchr(expanded, '|');
-    if (pipe && !redir) {
-        *pipe = '\0';
-        pipe++;
-        while (*pipe == ' ') pipe++;
-
-        /* Capture output of first command */
-        start_capture();
-        exec_single(expanded);
-        stop_capture();
-
-        /* For pipe, we write captured output to a temp file, then use it as input */
-        /* Simple approach: write to /tmp/.pipe, then modify second command */
-        ramfs_write("/tmp/.pipe", output_buffer, output_pos);
-
-        /* Execute second command - for now just run it (full pipe would need stdin redirection) */
-        /* If it's 'grep' or 'wc', handle specially */
-        char* argv2[MAX_ARGS];
-        char pipe_cmd[CMD_MAX];
-        strcpy(pipe_cmd, pipe);
-        int argc2 = tokenize(pipe_cmd, argv2);
-
-        if (argc2 > 0 && (strcmp(argv2[0], "more") == 0 || strcmp(argv2[0], "less") == 0)) {
-            /* Page through captured output */
-            pager_display(output_buffer, output_pos);
-        } else if (argc2 > 0 && strcmp(argv2[0], "wc") == 0) {
-            /* Count lines/words in captured output */
-            int lines=0, words=0; bool in_word=false;
-            for (int i = 0; i < output_pos; i++) {
-                if (output_buffer[i]=='\n') lines++;
-                if (isspace(output_buffer[i])) in_word=false;
-                else { if(!in_word) words++; in_word=true; }
-            }
-            kprintf("  %d lines, %d words, %d bytes\n", lines, words, output_pos);
-        } else if (argc2 > 1 && strcmp(argv2[0], "grep") == 0) {
-            /* Simple grep */
-            char* line = output_buffer;
-            while (*line) {
-                char* nl = strchr(line, '\n');
-                if (nl) *nl = '\0';
-                /* Check if line contains pattern */
-                char* found = NULL;
-                for (char* p = line; *p; p++) {
-                    if (strncmp(p, argv2[1], strlen(argv2[1])) == 0) { found = p; break; }
-                }
-                if (found) kprintf("%s\n", line);
-                if (nl) { *nl = '\n'; line = nl + 1; }
-                else break;
-            }
-        } else {
-            /* Just print the output and run second command normally */
-            exec_single(pipe);
+    /* Split into pipeline stages */
+    char* segs[PIPE_MAX_STAGES];
+    int nsegs = 0;
+    char* p = expanded;
+    while (p) {
+        if (nsegs == PIPE_MAX_STAGES) {
+            kprintf("pipe: at most %d stages\n", PIPE_MAX_STAGES);
+            return;
         }
+        while (*p == ' ') p++;
+        segs[nsegs++] = p;
+        p = strchr(p, '|');
+        if (p) *p++ = '\0';
+    }
+    if (nsegs > 1) {
+        run_pipeline(segs, nsegs, redir, append);
         return;
     }
 
@@ -1514,15 +1806,25 @@ static void print_prompt(void) {
 void shell_init(void) {
     memset(history, 0, sizeof(history));
     history_count = 0;
+    for (int i = 0; i < PIPE_MAX_STAGES; i++) stages[i].pid = -1;
     init_cmd_names();
 }
 
+/* Deferred boot probes (network, VirtIO) may still be initialising the
+ * devices the first command touches; give them a bounded head start */
+static void wait_for_probes(void) {
+    uint32_t deadline = timer_get_ticks() + 5 * timer_get_frequency();
+    while (!bootprof_probes_done() && timer_get_ticks() < deadline)
+        task_sleep(10);
+}
+
 void shell_run(void) {
     char cmd[CMD_MAX];
     while (1) {
         print_prompt();
         shell_readline(cmd, CMD_MAX);
         if (cmd[0]) {
+            wait_for_probes();
             add_history(cmd);
             serial_printf("[sh] %s\n", cmd);
             execute_command(cmd);
@@ -10,6 +10,11 @@
 #include "gui.h"
 #include "virgl.h"
 #include "virgl_pipeline.h"
+#include "paging.h"
+#include "pmm.h"
+#include "elf.h"
+#include "procfs.h"
+#include "chan.h"
 
 /*
  * Syscall handler — INT 0x80 entry point.
@@ -34,6 +39,7 @@
 #define EINVAL   22   /* Invalid argument */
 
 int copy_from_user(void* to, const void* from, uint32_t size);
+int copy_to_user(void* to, const void* from, uint32_t size);
 
 int virgl_submit_command(const void* buf, uint32_t num_dwords);
 /* IRQ ownership table — maps IRQ numbers to task PIDs */
@@ -44,21 +50,70 @@ uint32_t irq_get_owner(uint32_t irq) {
     return irq_owners[irq];
 }
 
+/*
+ * sbrk for any task with its own page directory: isolated ELF tasks and
+ * the built-in servers, whose cloned PD takes the heap pages over the
+ * identity mapping.  Moves the break inside [USER_HEAP_BASE,
+ * USER_HEAP_LIMIT), mapping zeroed private frames as it grows and
+ * releasing them as it shrinks.  Returns the old break, or -ENOMEM (kernel
+ * tasks, which run on the kernel PD).  Frames are PAGE_OWNED, so exit
+ * reclaims whatever is left.
+ */
+static uint32_t user_sbrk(task_t* t, int32_t incr) {
+    if (!t || !t->page_directory) return (uint32_t)-ENOMEM;
+    if (!t->heap_brk) t->heap_brk = USER_HEAP_BASE;
+
+    uint32_t old_brk = t->heap_brk;
+    uint32_t new_brk = old_brk + (uint32_t)incr;
+    if (incr > 0 && (new_brk < old_brk || new_brk > USER_HEAP_LIMIT))
+        return (uint32_t)-ENOMEM;
+    if (incr < 0 && (new_brk > old_brk || new_brk < USER_HEAP_BASE))
+        return (uint32_t)-EINVAL;
+
+    uint32_t old_top = (old_brk + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    uint32_t new_top = (new_brk + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+
+    for (uint32_t va = old_top; va < new_top; va += PAGE_SIZE) {
+        uint32_t frame = (uint32_t)pmm_alloc_page();
+        if (!frame) {
+            while (va > old_top) {
+                va -= PAGE_SIZE;
+                paging_unmap_user(t->page_directory, va);
+            }
+            return (uint32_t)-ENOMEM;
+        }
+        memset((void*)frame, 0, PAGE_SIZE);
+        paging_map_user(t->page_directory, va, frame,
+                        PAGE_PRESENT | PAGE_WRITE | PAGE_USER | PAGE_OWNED);
+    }
+    for (uint32_t va = new_top; va < old_top; va += PAGE_SIZE)
+        paging_unmap_user(t->page_directory, va);
+
+    t->heap_brk = new_brk;
+    return old_brk;
+}
+
+/* VBO ring offset of the last SYS_GPU3D_UPLOAD */
+static uint32_t gpu3d_vbo_offset = 0;
+
 static void syscall_handler(registers_t* regs) {
     uint32_t num  = regs->eax;
     uint32_t arg1 = regs->ebx;
     uint32_t arg2 = regs->ecx;
     uint32_t arg3 = regs->edx;
 
+    task_acct_syscall_enter(num);
+
     switch (num) {
 
     /* --- Legacy I/O (direct console, used during boot) --- */
 
     case SYS_WRITE: {
+        /* Whole buffer per trap (userlib stdio flushes through here) */
         const char* buf = (const char*)arg1;
         uint32_t len = arg2;
-        for (uint32_t i = 0; i < len; i++)
-            terminal_putchar(buf[i]);
+        if (!buf) { regs->eax = (uint32_t)-EFAULT; break; }
+        terminal_write(buf, len);
         regs->eax = len;
         break;
     }
@@ -95,6 +150,9 @@ static void syscall_handler(registers_t* regs) {
         kfree((void*)arg1);
         regs->eax = 0;
         break;
+    case SYS_SBRK:
+        regs->eax = user_sbrk(task_get_current(), (int32_t)arg1);
+        break;
 
     /* --- IPC syscalls (the core microkernel interface) --- */
 
@@ -137,6 +195,33 @@ static void syscall_handler(registers_t* regs) {
         regs->eax = ipc_lookup_service((const char*)arg1);
         break;
     }
+    case SYS_ENDPOINT_CREATE: {
+        /* arg1 = name string; binds the endpoint to the caller */
+        task_t* t = task_get_current();
+        regs->eax = (uint32_t)ipc_endpoint_create((const char*)arg1, t->id);
+        break;
+    }
+    case SYS_ENDPOINT_OPEN: {
+        /* arg1 = name string */
+        regs->eax = (uint32_t)ipc_endpoint_open((const char*)arg1);
+        break;
+    }
+    case SYS_CHAN_CREATE: {
+        /* arg1 = peer PID or endpoint handle, arg2 = data pages, arg3 = flags */
+        task_t* t = task_get_current();
+        uint32_t peer = arg1;
+        if (!ipc_resolve(&peer)) { regs->eax = (uint32_t)-1; break; }
+        regs->eax = (uint32_t)chan_create(t->id, peer, arg2, arg3);
+        break;
+    }
+    case SYS_CHAN_MAP: {
+        regs->eax = (uint32_t)chan_map(arg1, task_get_current()->id);
+        break;
+    }
+    case SYS_CHAN_CLOSE: {
+        regs->eax = (uint32_t)chan_close(arg1, task_get_current()->id);
+        break;
+    }
     case SYS_GRANT_IO: {
         /* arg1 = target PID (0 = self) */
         /* For now, this is a privileged operation: only kernel (PID 0) can grant */
@@ -260,6 +345,8 @@ case SYS_VIRGL_SUBMIT: {
             regs->eax = (uint32_t)-1;
             break;
         }
+        /* Textures belong to the previous client */
+        virgl_pipeline_tex_reset();
         if (!virgl_setup_framebuffer((uint16_t)w, (uint16_t)h)) {
             //serial_printf("GPU3D: framebuffer setup FAILED\n");
             regs->eax = (uint32_t)-1;
@@ -291,8 +378,8 @@ case SYS_GPU3D_CLEAR: {
     float g = ((packed >>  8) & 0xFF) / 255.0f;
     float b = ((packed      ) & 0xFF) / 255.0f;
 
-    /* Begin a new command batch for this frame */
-    virgl_cmd_begin();
+    /* Appended to the frame's batch: uploads and binds queued before the
+     * clear stay queued (present submits and empties the buffer) */
     virgl_cmd_clear(pipe_flags, r, g, b, a, 1.0, 0);
     /* No submit — commands are batched until present */
     regs->eax = 0;
@@ -325,8 +412,10 @@ case SYS_GPU3D_UPLOAD: {
     }
     
     //serial_printf("GPU3D_UPLOAD: uploading %u floats (%u bytes)\n", num_floats, sz);
-    /* Just emit into the batch — no begin/submit (batched until present) */
-    virgl_upload_vertices(kbuf, num_floats);
+    /* Just emit into the batch — no begin/submit (batched until present).
+     * Each upload lands in a fresh stretch of the VBO ring; DRAW indexes
+     * from the most recent one. */
+    gpu3d_vbo_offset = virgl_upload_vertices(kbuf, num_floats);
     kfree(kbuf);
     //serial_printf("GPU3D_UPLOAD: SUCCESS\n");
     regs->eax = 0;
@@ -348,12 +437,71 @@ case SYS_GPU3D_UPLOAD: {
 case SYS_GPU3D_DRAW: {
     //serial_printf("GPU3D_DRAW: mode=%u start=%u count=%u\n", arg1, arg2, arg3);
     /* Just emit into the batch — no begin/submit (batched until present) */
-    virgl_cmd_set_vertex_buffer(32, 0);
+    virgl_cmd_set_vertex_buffer(32, gpu3d_vbo_offset);
     virgl_cmd_draw(arg1, arg2, arg3);
     regs->eax = 0;
     break;
 }
 
+    case SYS_GPU3D_TEX_CREATE: {
+        /* arg1 = width, arg2 = height, arg3 = mip levels */
+        if (!arg1 || !arg2 || arg1 > VIRGL_TEX_MAX_SIZE || arg2 > VIRGL_TEX_MAX_SIZE) {
+            regs->eax = (uint32_t)-EINVAL;
+            break;
+        }
+        uint32_t tex = virgl_pipeline_tex_create(arg1, arg2, arg3);
+        regs->eax = tex ? tex : (uint32_t)-ENOMEM;
+        break;
+    }
+
+    case SYS_GPU3D_TEX_UPLOAD: {
+        /* arg1 = handle, arg2 = level, arg3 = user ptr to w*h texels */
+        uint32_t w, h;
+        if (!arg3 || !virgl_pipeline_tex_level_size(arg1, arg2, &w, &h)) {
+            regs->eax = (uint32_t)-EINVAL;
+            break;
+        }
+        uint32_t sz = w * h * 4;
+        uint32_t* kbuf = (uint32_t*)kmalloc(sz);
+        if (!kbuf) { regs->eax = (uint32_t)-ENOMEM; break; }
+        if (copy_from_user(kbuf, (void*)arg3, sz) != 0) {
+            kfree(kbuf);
+            regs->eax = (uint32_t)-EFAULT;
+            break;
+        }
+        bool ok = virgl_pipeline_tex_upload(arg1, arg2, kbuf);
+        kfree(kbuf);
+        regs->eax = ok ? 0 : (uint32_t)-EINVAL;
+        break;
+    }
+
+    case SYS_GPU3D_TEX_BIND:
+        /* Batched like DRAW: call after this frame's CLEAR */
+        regs->eax = virgl_pipeline_tex_bind(arg1) ? 0 : (uint32_t)-EINVAL;
+        break;
+
+    case SYS_GPU3D_TEX_FREE:
+        virgl_pipeline_tex_free(arg1);
+        regs->eax = 0;
+        break;
+
+    case SYS_STATS: {
+        /* Snapshot into a kernel buffer (interrupts are off while it is
+         * taken, so never into user memory), then copy out the prefix the
+         * caller knows about and say how much that was */
+        uint32_t size = arg2;
+        if (!arg1 || size < 8) { regs->eax = (uint32_t)-EINVAL; break; }
+        if (size > sizeof(proc_stats_t)) size = sizeof(proc_stats_t);
+        proc_stats_t* st = (proc_stats_t*)kmalloc(sizeof(proc_stats_t));
+        if (!st) { regs->eax = (uint32_t)-ENOMEM; break; }
+        procfs_snapshot(st);
+        st->size = size;
+        int ok = copy_to_user((void*)arg1, st, size);
+        kfree(st);
+        regs->eax = ok == 0 ? size : (uint32_t)-EFAULT;
+        break;
+    }
+
 // src/syscall.c
 
     case SYS_GPU3D_PRESENT: {
@@ -390,6 +538,8 @@ case SYS_GPU3D_DRAW: {
         regs->eax = (uint32_t)-1;
         break;
     }
+
+    task_acct_syscall_exit();
 }
 
 void syscall_init(void) {
@@ -470,6 +620,26 @@ uint32_t sys_lookup_service(const char* name) {
     return ret;
 }
 
+int32_t sys_endpoint_create(const char* name) {
+    int32_t ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_ENDPOINT_CREATE), "b"((uint32_t)name)
+    );
+    return ret;
+}
+
+int32_t sys_endpoint_open(const char* name) {
+    int32_t ret;
+    __asm__ volatile (
+        "int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_ENDPOINT_OPEN), "b"((uint32_t)name)
+    );
+    return ret;
+}
+
 /* Legacy wrappers */
 int32_t sys_write(const char* buf, uint32_t len) {
     int32_t ret;
@@ -0,0 +1,266 @@
+#include "sysmon.h"
+#include "task.h"
+#include "timer.h"
+
+/*
+ * Samples are taken with the scheduler locked so the TSC times read from
+ * the task table belong to the same moment as the snapshot.  Everything
+ * after that works on the two private copies only.
+ */
+
+static void take_sample(sysmon_sample_t* s) {
+    task_lock_scheduler();
+    task_acct_sync(task_get_current());
+    procfs_snapshot(&s->st);
+    for (uint32_t i = 0; i < s->st.tasks; i++) {
+        task_t* t = task_get_by_pid(s->st.task[i].pid);
+        s->cpu_tsc[i] = t ? t->user_tsc + t->sys_tsc : 0;
+    }
+    s->tsc = timer_rdtsc();
+    task_unlock_scheduler();
+}
+
+/* Counter difference; a counter that went backwards (pid reused) counts
+ * from zero */
+static uint32_t delta(uint32_t cur, uint32_t prev) {
+    return cur >= prev ? cur - prev : cur;
+}
+
+/* delta per second over ms milliseconds, without overflowing 32 bits */
+static uint32_t rate(uint32_t d, uint32_t ms) {
+    if (!ms) ms = 1;
+    if (d < 0xFFFFFFFFu / 1000) return d * 1000 / ms;
+    return d / ms * 1000;
+}
+
+static int find_pid(const proc_stats_t* st, uint32_t pid) {
+    for (uint32_t i = 0; i < st->tasks; i++)
+        if (st->task[i].pid == pid) return (int)i;
+    return -1;
+}
+
+bool sysmon_update(sysmon_t* mon) {
+    mon->cur ^= 1;
+    sysmon_sample_t* cur = &mon->sample[mon->cur];
+    const sysmon_sample_t* prev = &mon->sample[mon->cur ^ 1];
+    take_sample(cur);
+    if (!mon->primed) {
+        mon->primed = true;
+        return false;
+    }
+
+    const proc_stats_t* c = &cur->st;
+    const proc_stats_t* p = &prev->st;
+    sysmon_view_t* v = &mon->view;
+    uint32_t ms = timer_tsc_to_ms(cur->tsc - prev->tsc);
+    if (!ms) ms = 1;
+
+    v->interval_ms = ms;
+    v->uptime_s = c->tick_hz ? c->ticks / c->tick_hz : 0;
+    v->tasks = c->tasks;
+    memcpy(v->tasks_by_state, c->tasks_by_state, sizeof(v->tasks_by_state));
+    v->csw = rate(delta(c->switches, p->switches), ms);
+    v->ipc = rate(delta(c->ipc_messages, p->ipc_messages), ms);
+    v->pages_used = c->pages_used;
+    v->pages_total = c->pages_total;
+    v->heap_used = c->heap_used / 1024;
+    v->heap_free = c->heap_free / 1024;
+    v->disk_read = rate(delta(c->disk_sectors_read, p->disk_sectors_read), ms) / 2;
+    v->disk_write = rate(delta(c->disk_sectors_written, p->disk_sectors_written), ms) / 2;
+    v->net_up = c->net_up;
+    v->net_rx = rate(delta(c->net_rx_bytes, p->net_rx_bytes), ms) / 1024;
+    v->net_tx = rate(delta(c->net_tx_bytes, p->net_tx_bytes), ms) / 1024;
+    v->net_rx_pkts = rate(delta(c->net_rx_packets, p->net_rx_packets), ms);
+    v->net_tx_pkts = rate(delta(c->net_tx_packets, p->net_tx_packets), ms);
+    v->gpu_submits = rate(delta(c->gpu_submits, p->gpu_submits), ms);
+    v->gpu_kb = rate(delta(c->gpu_submit_bytes, p->gpu_submit_bytes), ms) / 1024;
+    v->gpu_rects = rate(delta(c->gpu_flush_rects, p->gpu_flush_rects), ms);
+
+    /* Tasks, insertion-sorted by CPU share as they are added */
+    v->ntasks = 0;
+    for (uint32_t i = 0; i < c->tasks; i++) {
+        const proc_task_stats_t* ct = &c->task[i];
+        int j = find_pid(p, ct->pid);
+        static const proc_task_stats_t none;
+        const proc_task_stats_t* pt = j >= 0 ? &p->task[j] : &none;
+        uint64_t pcpu = j >= 0 ? prev->cpu_tsc[j] : 0;
+        uint64_t dcpu = cur->cpu_tsc[i] >= pcpu ? cur->cpu_tsc[i] - pcpu : cur->cpu_tsc[i];
+
+        sysmon_task_t t;
+        t.pid = ct->pid;
+        t.state = ct->state;
+        t.permille = timer_tsc_to_us(dcpu) / ms;
+        if (t.permille > 1000) t.permille = 1000;
+        t.cpu_ms = timer_tsc_to_ms(cur->cpu_tsc[i]);
+        t.csw = rate(delta(ct->switches, pt->switches), ms);
+        t.ipc = rate(delta(ct->ipc_sent + ct->ipc_received,
+                           pt->ipc_sent + pt->ipc_received), ms);
+        t.faults = rate(delta(ct->page_faults, pt->page_faults), ms);
+        t.syscalls = rate(delta(ct->syscalls, pt->syscalls), ms);
+        memcpy(t.name, ct->name, TASK_NAME_LEN);
+
+        uint32_t k = v->ntasks++;
+        while (k > 0 && v->task[k - 1].permille < t.permille) {
+            v->task[k] = v->task[k - 1];
+            k--;
+        }
+        v->task[k] = t;
+    }
+
+    /* Services: messages received by the serving task */
+    v->nservices = 0;
+    for (int i = 0; i < MAX_SERVICES; i++) {
+        uint32_t pid;
+        const char* name = ipc_service_at(i, &pid);
+        if (!name) continue;
+        sysmon_service_t* s = &v->service[v->nservices++];
+        s->pid = pid;
+        strncpy(s->name, name, SERVICE_NAME_LEN - 1);
+        s->name[SERVICE_NAME_LEN - 1] = '\0';
+        int ci = find_pid(c, pid), pi = find_pid(p, pid);
+        s->msgs = ci < 0 ? 0 : rate(delta(c->task[ci].ipc_received,
+                                          pi < 0 ? 0 : p->task[pi].ipc_received), ms);
+    }
+    return true;
+}
+
+/* ===== Text rendering ===== */
+
+#define TASK_HEAD   6               /* Line of the task table heading */
+
+typedef struct {
+    char* buf;
+    int   len;
+    int   max;
+} line_t;
+
+/* Append s in |w| columns, clipped: right-aligned, or left-aligned if
+ * w < 0.  w == 0 appends s as is. */
+static void put(line_t* l, const char* s, int w) {
+    int n = (int)strlen(s);
+    int cols = w < 0 ? -w : w;
+    if (!cols) cols = n;
+    if (n > cols) n = cols;
+    for (int i = 0; i < cols && l->len < l->max; i++) {
+        int pad = cols - n;
+        char ch;
+        if (w > 0) ch = i < pad ? ' ' : s[i - pad];
+        else       ch = i < n ? s[i] : ' ';
+        l->buf[l->len++] = ch;
+    }
+    l->buf[l->len] = '\0';
+}
+
+static void put_u(line_t* l, uint32_t val, int w) {
+    char v[12];
+    ksnprintf(v, sizeof(v), "%u", val);
+    put(l, v, w);
+}
+
+/* Tenths: 123 -> "12.3" */
+static void put_tenths(line_t* l, uint32_t val, int w) {
+    char v[16];
+    ksnprintf(v, sizeof(v), "%u.%u", val / 10, val % 10);
+    put(l, v, w);
+}
+
+static const char* state_short[] = { "ready", "run", "sleep", "block", "dead" };
+
+int sysmon_lines(const sysmon_view_t* v) {
+    int n = TASK_HEAD + 1 + (int)v->ntasks;
+    if (v->nservices) n += 2 + (int)v->nservices;
+    return n;
+}
+
+bool sysmon_line(const sysmon_view_t* v, int n, char* buf, int width) {
+    line_t l = { buf, 0, width };
+    buf[0] = '\0';
+    char tmp[48];
+
+    switch (n) {
+    case 0:
+        ksnprintf(tmp, sizeof(tmp), "up %u:%u%u:%u%u", v->uptime_s / 3600,
+                  v->uptime_s / 600 % 6, v->uptime_s / 60 % 10,
+                  v->uptime_s % 60 / 10, v->uptime_s % 10);
+        put(&l, tmp, 0);
+        put(&l, "  tasks ", 0);       put_u(&l, v->tasks, 0);
+        put(&l, " (", 0);             put_u(&l, v->tasks_by_state[TASK_RUNNING] +
+                                                v->tasks_by_state[TASK_READY], 0);
+        put(&l, " ready, ", 0);       put_u(&l, v->tasks_by_state[TASK_SLEEPING], 0);
+        put(&l, " sleep, ", 0);       put_u(&l, v->tasks_by_state[TASK_BLOCKED], 0);
+        put(&l, " blocked)  csw/s ", 0); put_u(&l, v->csw, 0);
+        put(&l, "  ipc/s ", 0);       put_u(&l, v->ipc, 0);
+        return false;
+    case 1:
+        put(&l, "mem   pages ", 0);   put_u(&l, v->pages_used, 0);
+        put(&l, "/", 0);              put_u(&l, v->pages_total, 0);
+        put(&l, "  heap ", 0);        put_u(&l, v->heap_used, 0);
+        put(&l, " KB used, ", 0);     put_u(&l, v->heap_free, 0);
+        put(&l, " KB free", 0);
+        return false;
+    case 2:
+        put(&l, "disk  read ", 0);    put_u(&l, v->disk_read, 0);
+        put(&l, " KB/s  write ", 0);  put_u(&l, v->disk_write, 0);
+        put(&l, " KB/s", 0);
+        return false;
+    case 3:
+        if (!v->net_up) put(&l, "net   down", 0);
+        else {
+            put(&l, "net   rx ", 0);  put_u(&l, v->net_rx, 0);
+            put(&l, " KB/s ", 0);     put_u(&l, v->net_rx_pkts, 0);
+            put(&l, " pk/s  tx ", 0); put_u(&l, v->net_tx, 0);
+            put(&l, " KB/s ", 0);     put_u(&l, v->net_tx_pkts, 0);
+            put(&l, " pk/s", 0);
+        }
+        return false;
+    case 4:
+        put(&l, "gpu   ", 0);         put_u(&l, v->gpu_submits, 0);
+        put(&l, " sub/s ", 0);        put_u(&l, v->gpu_kb, 0);
+        put(&l, " KB/s ", 0);         put_u(&l, v->gpu_rects, 0);
+        put(&l, " rect/s", 0);
+        return false;
+    case TASK_HEAD:
+        put(&l, "PID", 5);      put(&l, " ", 0);
+        put(&l, "NAME", -15);   put(&l, " ", 0);
+        put(&l, "STATE", -6);
+        put(&l, "CPU%", 6);     put(&l, "TIME s", 8);
+        put(&l, "CSW/s", 7);    put(&l, "IPC/s", 7);
+        put(&l, "FLT/s", 7);    put(&l, "SYS/s", 7);
+        return true;
+    }
+
+    n -= TASK_HEAD + 1;
+    if (n < 0) return false;                    /* Spacer after the summary */
+    if (n < (int)v->ntasks) {
+        const sysmon_task_t* t = &v->task[n];
+        put_u(&l, t->pid, 5);
+        put(&l, " ", 0);
+        put(&l, t->name, -15);
+        put(&l, " ", 0);
+        put(&l, t->state <= TASK_TERMINATED ? state_short[t->state] : "?", -6);
+        put_tenths(&l, t->permille, 6);
+        put_tenths(&l, t->cpu_ms / 100, 8);
+        put_u(&l, t->csw, 7);
+        put_u(&l, t->ipc, 7);
+        put_u(&l, t->faults, 7);
+        put_u(&l, t->syscalls, 7);
+        return false;
+    }
+
+    n -= (int)v->ntasks;
+    if (n == 0) return false;                   /* Spacer before services */
+    if (n == 1) {
+        put(&l, "PID", 5);      put(&l, " ", 0);
+        put(&l, "SERVICE", -20); put(&l, "MSG/s", 11);
+        return true;
+    }
+    n -= 2;
+    if (n < (int)v->nservices) {
+        const sysmon_service_t* s = &v->service[n];
+        put_u(&l, s->pid, 5);
+        put(&l, " ", 0);
+        put(&l, s->name, -20);
+        put_u(&l, s->msgs, 11);
+    }
+    return false;
+}
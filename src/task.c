@@ -6,6 +6,9 @@
 #include "paging.h"
 #include "ipc.h"
 #include "serial.h"
+#include "elf.h"
+#include "pipe.h"
+#include "chan.h"
 
 static task_t tasks[MAX_TASKS];
 static int32_t current_task = -1;
@@ -20,6 +23,87 @@ static volatile uint32_t switch_new_esp = 0;
 static volatile bool     switch_pending = false;
 static uint32_t total_ctx_switches = 0;
 
+/* ---- Accounting ----
+ * CPU time is charged in TSC cycles at every switch and at syscall entry
+ * and exit, so a ring 3 task's time splits into user and kernel.  IRQs
+ * are charged to whoever they interrupted.  Off-CPU time is charged at
+ * switch-in to the reason the task left the CPU; a sleeper woken but
+ * not yet scheduled is still counted as sleeping. */
+
+static void acct_charge(task_t* t, uint64_t now) {
+    uint64_t d = now - t->acct_stamp;
+    if (t->in_syscall || !t->is_user) t->sys_tsc += d;
+    else                              t->user_tsc += d;
+    t->acct_stamp = now;
+}
+
+static void acct_start(task_t* t) {
+    t->start_tsc = timer_rdtsc();
+    t->acct_stamp = t->start_tsc;
+    t->wait_stamp = t->start_tsc;
+    t->wait_reason = TASK_WAIT_RUNQ;
+}
+
+static uint32_t wait_reason_of(const task_t* t) {
+    if (t->state == TASK_SLEEPING) return TASK_WAIT_SLEEP;
+    if (t->state != TASK_BLOCKED)  return TASK_WAIT_RUNQ;
+    switch (t->blocked_on) {
+    case BLOCKED_SEND:    return TASK_WAIT_SEND;
+    case BLOCKED_RECEIVE: return TASK_WAIT_RECV;
+    case BLOCKED_SENDREC: return TASK_WAIT_SENDREC;
+    default:              return TASK_WAIT_OTHER;
+    }
+}
+
+/* Charge the outgoing task, start the incoming one */
+static void acct_switch(task_t* prev, task_t* next) {
+    uint64_t now = timer_rdtsc();
+
+    acct_charge(prev, now);
+    if (prev->yielded || prev->state != TASK_RUNNING) prev->nvcsw++;
+    else                                              prev->nivcsw++;
+    prev->yielded = false;
+    prev->wait_reason = wait_reason_of(prev);
+    prev->wait_stamp = now;
+
+    next->wait_tsc[next->wait_reason] += now - next->wait_stamp;
+    next->acct_stamp = now;
+}
+
+void task_acct_syscall_enter(uint32_t num) {
+    if (current_task < 0) return;
+    task_t* t = &tasks[current_task];
+    acct_charge(t, timer_rdtsc());
+    t->in_syscall = true;
+    t->syscalls++;
+    t->syscall_counts[num < TASK_SYSCALL_SLOTS ? num : TASK_SYSCALL_SLOTS - 1]++;
+}
+
+void task_acct_syscall_exit(void) {
+    if (current_task < 0) return;
+    task_t* t = &tasks[current_task];
+    acct_charge(t, timer_rdtsc());
+    t->in_syscall = false;
+}
+
+void task_acct_sync(task_t* t) {
+    uint32_t flags = irq_save();
+    if (current_task >= 0 && t == &tasks[current_task])
+        acct_charge(t, timer_rdtsc());
+    irq_restore(flags);
+}
+
+uint32_t task_owned_pages(const task_t* t) {
+    uint32_t pages = 0;
+    if (t->page_directory)
+        pages += paging_count_owned(t->page_directory);
+    if (t->stack_base && t->stack_base < 0x40000000)
+        pages += (t->stack_size + 4095) / 4096;
+    if (t->kernel_stack_base)
+        pages += (t->kernel_stack_top - t->kernel_stack_base + 4095) / 4096;
+    return pages;
+}
+
 void task_init(void) {
     memset(tasks, 0, sizeof(tasks));
 
@@ -42,6 +126,7 @@ void task_init(void) {
     tasks[0].kernel_stack_top = 0;
     tasks[0].blocked_on = BLOCKED_NONE;
     tasks[0].io_privileged = true;
+    acct_start(&tasks[0]);
     current_task = 0;
     scheduler_enabled = true;
 }
@@ -146,6 +231,7 @@ int32_t task_create(const char* name, task_entry_t entry, uint32_t priority) {
     t->is_user = false;
     t->page_directory = NULL; /* Kernel PD */
     t->blocked_on = BLOCKED_NONE;
+    acct_start(t);
 
     setup_kernel_stack(t, entry);
     return t->id;
@@ -189,6 +275,7 @@ int32_t task_create_user(const char* name, task_entry_t entry,
     t->kernel_stack_base = (uint32_t)kernel_stack;
     t->kernel_stack_top = (uint32_t)kernel_stack + KERNEL_STACK_SIZE;
     t->blocked_on = BLOCKED_NONE;
+    acct_start(t);
 
     setup_user_stack(t, entry);
     return t->id;
@@ -230,6 +317,7 @@ int32_t task_create_from_elf(const char* name, uint32_t entry_point,
     t->kernel_stack_base = kstack_base;
     t->kernel_stack_top = kstack_base + kstack_size;
     t->blocked_on = BLOCKED_NONE;
+    acct_start(t);
 
     /* Build the initial iret frame on the kernel stack.
      * Same as setup_user_stack, but entry_point is a raw address
@@ -363,11 +451,13 @@ void task_timer_tick(registers_t* regs) {
     int next = find_next_task();
     if (next == current_task) {
         tasks[current_task].ticks_left = tasks[current_task].quantum;
+        tasks[current_task].yielded = false;
         return;
     }
 
     /* Save current task's interrupt frame */
     tasks[current_task].saved_esp = (uint32_t)regs;
+    acct_switch(&tasks[current_task], &tasks[next]);
     if (tasks[current_task].state == TASK_RUNNING)
         tasks[current_task].state = TASK_READY;
 
@@ -435,6 +525,7 @@ void task_schedule(void) {
     task_t* old_task = &tasks[current_task];
     task_t* new_task = &tasks[next];
 
+    acct_switch(old_task, new_task);
     if (old_task->state == TASK_RUNNING)
         old_task->state = TASK_READY;
 
@@ -457,6 +548,7 @@ void task_schedule(void) {
 void task_yield(void) {
     if (current_task < 0) return;
     tasks[current_task].ticks_left = 0;
+    tasks[current_task].yielded = true;
 
     /* Force all context switches through the preemptive path (timer IRQ).
      *
@@ -488,9 +580,28 @@ void task_sleep(uint32_t ms) {
     task_yield();
 }
 
+/* Close whatever pipe ends the task still holds */
+static void release_streams(task_t* t) {
+    if (t->pipe_out) { pipe_close_write((int32_t)t->pipe_out - 1); t->pipe_out = 0; }
+    if (t->pipe_in)  { pipe_close_read((int32_t)t->pipe_in - 1);   t->pipe_in = 0; }
+}
+
 void task_exit(void) {
     if (current_task <= 0) return;
     task_t* t = &tasks[current_task];
+
+    /* A switch anywhere below would be final: once the task is marked
+     * terminated it never runs again, and whatever it still held would
+     * leak (a pipeline neighbour would wait forever for EOF).  Hold the
+     * scheduler until the teardown is done. */
+    task_lock_scheduler();
+
+    /* Let the pipeline neighbours see EOF / broken pipe */
+    release_streams(t);
+    /* Clients keep their endpoint handles for a restarted server */
+    ipc_task_exit(t->id);
+    chan_task_exit(t->id);
+
     t->state = TASK_TERMINATED;
     t->active = false;
 
@@ -527,6 +638,13 @@ void task_exit(void) {
         t->page_directory = NULL;
     }
 
+    /* Drop the shared text reference once nothing maps it any more */
+    if (t->elf_image) {
+        elf_image_release(t->elf_image);
+        t->elf_image = 0;
+    }
+
+    task_unlock_scheduler();
     task_yield();
     for(;;) hlt();
 }
@@ -538,6 +656,10 @@ void task_kill(uint32_t id) {
                           tasks[i].id, tasks[i].name, tasks[i].is_user,
                           tasks[i].stack_base, tasks[i].kernel_stack_base,
                           (uint32_t)tasks[i].page_directory);
+            task_lock_scheduler();
+            release_streams(&tasks[i]);
+            ipc_task_exit(tasks[i].id);
+            chan_task_exit(tasks[i].id);
             tasks[i].state = TASK_TERMINATED;
             tasks[i].active = false;
             /* Only kfree stack if it's a kernel heap allocation (below user base) */
@@ -559,6 +681,11 @@ void task_kill(uint32_t id) {
                 paging_destroy_address_space(tasks[i].page_directory);
                 tasks[i].page_directory = NULL;
             }
+            if (tasks[i].elf_image) {
+                elf_image_release(tasks[i].elf_image);
+                tasks[i].elf_image = 0;
+            }
+            task_unlock_scheduler();
             return;
         }
     }
@@ -602,7 +729,7 @@ static const char* state_names[] = {
 };
 
 static const char* blocked_names[] = {
-    "", "SEND", "RECV", "SENDREC"
+    "", "SEND", "RECV", "SENDREC", "PIPE"
 };
 
 void task_list(void) {
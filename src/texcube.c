@@ -4,6 +4,10 @@
  * texcube.c – ELF user-space program: rotating textured cube + benchmark
  *
  * FPS is calculated using sys_get_ticks() to measure actual time
+ *
+ * With virgl the faces are drawn through GPU3D and sampled on the host
+ * GPU (mipmapped textures, uploaded once); otherwise the software
+ * rasterizer below does the bilinear sampling per pixel.
  */
 
 #define FB_W ELF_GUI_FB_W   // 320
@@ -11,7 +15,8 @@
 #define RGB(r,g,b) ((uint32_t)(((r)<<16)|((g)<<8)|(b)))
 
 /* Texture */
-#define TEX_SIZE 64
+#define TEX_SIZE   64
+#define TEX_LEVELS 7    /* 64x64 down to 1x1 */
 typedef struct {
     uint32_t data[TEX_SIZE * TEX_SIZE];
 } texture_t;
@@ -273,6 +278,89 @@ static void draw_textured_triangle(
     }
 }
 
+/* ──────────────────────────────────────────────── */
+/* GPU3D path                                       */
+/* ──────────────────────────────────────────────── */
+
+#define GPU_FLOATS_PER_VERT 8   /* clip xyzw + (u, v, shade, 1) or RGBA */
+
+static float gpu_verts[36 * GPU_FLOATS_PER_VERT];
+static int32_t gpu_tex[6];      /* 0 = face drawn in its average color */
+
+/* Level 0 as is, then 2x2 box-filtered levels down to 1x1 */
+static int upload_mipmapped(int32_t tex, const texture_t* src) {
+    static uint32_t mip[2][(TEX_SIZE / 2) * (TEX_SIZE / 2)];
+    const uint32_t* prev = src->data;
+    int size = TEX_SIZE;
+
+    if (sys_gpu3d_tex_upload(tex, 0, prev) != 0) return -1;
+    for (int level = 1; size > 1; level++) {
+        uint32_t* out = mip[level & 1];
+        int half = size / 2;
+        for (int y = 0; y < half; y++)
+            for (int x = 0; x < half; x++) {
+                const uint32_t* p = &prev[(y * 2) * size + x * 2];
+                uint32_t c[4] = { p[0], p[1], p[size], p[size + 1] };
+                int r = 0, g = 0, b = 0;
+                for (int k = 0; k < 4; k++) {
+                    r += (c[k] >> 16) & 0xFF;
+                    g += (c[k] >> 8) & 0xFF;
+                    b += c[k] & 0xFF;
+                }
+                out[y * half + x] = RGB(r / 4, g / 4, b / 4);
+            }
+        if (sys_gpu3d_tex_upload(tex, level, out) != 0) return -1;
+        prev = out;
+        size = half;
+    }
+    return 0;
+}
+
+/* Init GPU3D and put the face textures on the GPU.  Returns 0 if there
+ * is no virgl (software path).  A face whose texture could not be made
+ * still draws, flat in its average color. */
+static int gpu_setup(void) {
+    if (sys_gpu3d_init(FB_W, FB_H) != 0) return 0;
+    for (int i = 0; i < 6; i++) {
+        gpu_tex[i] = sys_gpu3d_tex_create(TEX_SIZE, TEX_SIZE, TEX_LEVELS);
+        if (gpu_tex[i] <= 0) { gpu_tex[i] = 0; continue; }
+        if (upload_mipmapped(gpu_tex[i], &textures[i]) != 0) {
+            sys_gpu3d_tex_free(gpu_tex[i]);
+            gpu_tex[i] = 0;
+        }
+    }
+    if (!gpu_tex[0]) sys_debug_log("texcube: no GPU textures, flat faces\n");
+    return 1;
+}
+
+static void average_color(const texture_t* tex, float rgba[4]) {
+    uint32_t r = 0, g = 0, b = 0;
+    for (int i = 0; i < TEX_SIZE * TEX_SIZE; i++) {
+        r += (tex->data[i] >> 16) & 0xFF;
+        g += (tex->data[i] >> 8) & 0xFF;
+        b += tex->data[i] & 0xFF;
+    }
+    rgba[0] = r / (255.0f * TEX_SIZE * TEX_SIZE);
+    rgba[1] = g / (255.0f * TEX_SIZE * TEX_SIZE);
+    rgba[2] = b / (255.0f * TEX_SIZE * TEX_SIZE);
+    rgba[3] = 1.0f;
+}
+
+/* Clip-space vertex matching project(): 100/z pixels per unit, depth
+ * mapped from z = 50..70 (the cube sits at 60) */
+static float* gpu_vertex(float* out, vec3_t p, const float attr[4]) {
+    float w = p.z + 60.0f;
+    out[0] = p.x * (200.0f / FB_W);
+    out[1] = p.y * (200.0f / FB_H);
+    out[2] = 6.0f * w - 350.0f;
+    out[3] = w;
+    out[4] = attr[0];
+    out[5] = attr[1];
+    out[6] = attr[2];
+    out[7] = attr[3];
+    return out + GPU_FLOATS_PER_VERT;
+}
+
 /* Main */
 int main(void) {
     sys_debug_log("texcube benchmark starting\n");
@@ -330,6 +418,10 @@ int main(void) {
     float ax = 0.0f, ay = 0.0f, az = 0.0f;
     uint32_t frame = 0;
 
+    int gpu = gpu_setup();
+    float face_color[6][4];
+    for (int i = 0; i < 6; i++) average_color(&textures[i], face_color[i]);
+
     sys_debug_log("Starting benchmark loop\n");
 
     /* Initialize timing */
@@ -338,9 +430,13 @@ int main(void) {
 
     while (1) {
         /* Clear */
-        for (int i = 0; i < FB_W * FB_H; i++) {
-            fb[i] = RGB(15,15,25);
-            zbuffer[i] = 1000.0f;
+        if (gpu) {
+            sys_gpu3d_clear(GPU3D_CLEAR_COLOR | GPU3D_CLEAR_DEPTH, 0xFF0F0F19);
+        } else {
+            for (int i = 0; i < FB_W * FB_H; i++) {
+                fb[i] = RGB(15,15,25);
+                zbuffer[i] = 1000.0f;
+            }
         }
 
         /* Transform vertices */
@@ -353,8 +449,12 @@ int main(void) {
             transformed[i] = v;
         }
 
-        /* Draw triangles */
+        /* Draw triangles (GPU: collect them, one range per face) */
+        float* gv = gpu_verts;
+        int face_first[7];
         for (int i = 0; i < 12; i++) {
+            if ((i & 1) == 0) face_first[i / 2] = (int)(gv - gpu_verts) / GPU_FLOATS_PER_VERT;
+
             vec3_t v0 = transformed[indices[i][0]];
             vec3_t v1 = transformed[indices[i][1]];
             vec3_t v2 = transformed[indices[i][2]];
@@ -368,6 +468,16 @@ int main(void) {
             float vz = (v0.z + v1.z + v2.z)/3.0f + 60.0f;
             if (nx*vx + ny*vy + nz*vz <= 0) continue;
 
+            if (gpu) {
+                int f = tris[i].tex_id;
+                vec3_t* tv[3] = { &v0, &v1, &v2 };
+                for (int k = 0; k < 3; k++) {
+                    float uv[4] = { tris[i].uv[k].u, tris[i].uv[k].v, 1.0f, 1.0f };
+                    gv = gpu_vertex(gv, *tv[k], gpu_tex[f] ? uv : face_color[f]);
+                }
+                continue;
+            }
+
             /* Project */
             int px[3], py[3]; float pz[3];
             project(v0, &px[0], &py[0], &pz[0]);
@@ -382,6 +492,18 @@ int main(void) {
             );
         }
 
+        if (gpu) {
+            int n = (int)(gv - gpu_verts) / GPU_FLOATS_PER_VERT;
+            face_first[6] = n;
+            if (n) sys_gpu3d_upload(gpu_verts, n * GPU_FLOATS_PER_VERT);
+            for (int f = 0; f < 6; f++) {
+                int count = face_first[f + 1] - face_first[f];
+                if (!count) continue;
+                sys_gpu3d_tex_bind(gpu_tex[f]);
+                sys_gpu3d_draw(GPU3D_TRIANGLES, face_first[f], count);
+            }
+        }
+
         ax += 0.012f;
         ay += 0.018f;
         az += 0.008f;
@@ -399,6 +521,20 @@ int main(void) {
             frame_count = 0;
         }
 
+        if (gpu) {
+            /* The window shows the GPU framebuffer, so no HUD: log instead */
+            if (frame_count == 0) {
+                char buf[32];
+                sys_debug_log("texcube GPU FPS: ");
+                utoa((uint32_t)current_fps, buf, 10);
+                sys_debug_log(buf);
+                sys_debug_log("\n");
+            }
+            sys_gpu3d_present();
+            if (frame > 3000) break;
+            continue;
+        }
+
         /* HUD */
         draw_str(4,   4, "TexCube Benchmark", RGB(255,220,80));
         draw_str(4,  14, "Software 320x200",  RGB(200,180,60));
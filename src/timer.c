@@ -5,6 +5,7 @@
 
 static volatile uint32_t tick_count = 0;
 static uint32_t timer_freq = 100;
+static uint32_t tsc_khz = 0;
 
 static void timer_callback(registers_t* regs) {
     tick_count++;
@@ -37,7 +38,55 @@ void timer_sleep(uint32_t ms) {
         hlt();
 }
 
+uint32_t timer_tsc_khz(void) {
+    return tsc_khz;
+}
+
+/* cycles / MHz with a single divl (no libgcc 64-bit division) */
+uint32_t timer_tsc_to_us(uint64_t cycles) {
+    uint32_t mhz = tsc_khz / 1000;
+    if (!mhz) return 0;
+    uint32_t lo = (uint32_t)cycles, hi = (uint32_t)(cycles >> 32);
+    if (hi >= mhz) return 0xFFFFFFFF;
+    uint32_t q, r;
+    __asm__ ("divl %4" : "=a"(q), "=d"(r) : "a"(lo), "d"(hi), "rm"(mhz));
+    return q;
+}
+
+/* Same, in milliseconds: good for 49 days of cycles instead of 71 minutes */
+uint32_t timer_tsc_to_ms(uint64_t cycles) {
+    if (!tsc_khz) return 0;
+    uint32_t lo = (uint32_t)cycles, hi = (uint32_t)(cycles >> 32);
+    if (hi >= tsc_khz) return 0xFFFFFFFF;
+    uint32_t q, r;
+    __asm__ ("divl %4" : "=a"(q), "=d"(r) : "a"(lo), "d"(hi), "rm"(tsc_khz));
+    return q;
+}
+
+/*
+ * Measure the TSC rate over 10ms of PIT channel 2 (one-shot, gated
+ * through port 0x61).  Polls OUT2, so it works with interrupts off.
+ */
+static void tsc_calibrate(void) {
+    const uint32_t pit_count = 11932;   /* 1193182 Hz * 10ms */
+    uint8_t saved = inb(0x61);
+
+    outb(0x61, (saved & ~0x02) | 0x01); /* gate on, speaker off */
+    outb(0x43, 0xB0);                   /* ch2, lo/hi, mode 0 */
+    outb(0x42, (uint8_t)(pit_count & 0xFF));
+    outb(0x42, (uint8_t)(pit_count >> 8));
+
+    uint64_t start = timer_rdtsc();
+    while (!(inb(0x61) & 0x20))
+        ;
+    uint64_t end = timer_rdtsc();
+
+    outb(0x61, saved);
+    tsc_khz = (uint32_t)(end - start) / 10;
+}
+
 void timer_init(uint32_t frequency) {
+    tsc_calibrate();
     timer_freq = frequency;
     register_interrupt_handler(32, timer_callback);
     uint32_t divisor = 1193180 / frequency;
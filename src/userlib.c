@@ -71,6 +71,43 @@ uint32_t sys_lookup_service(const char* name) {
     return ret;
 }
 
+int32_t sys_endpoint_create(const char* name) {
+    int32_t ret;
+    __asm__ volatile ("int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_ENDPOINT_CREATE), "b"((uint32_t)name)
+        : "memory");
+    return ret;
+}
+
+int32_t sys_endpoint_open(const char* name) {
+    int32_t ret;
+    __asm__ volatile ("int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_ENDPOINT_OPEN), "b"((uint32_t)name)
+        : "memory");
+    return ret;
+}
+
+static int32_t endpoint_resolve(endpoint_t* ep) {
+    if (!ep->handle) {
+        int32_t h = sys_endpoint_open(ep->name);
+        if (h < 0) return h;
+        ep->handle = (uint32_t)h;
+    }
+    return 0;
+}
+
+int32_t endpoint_send(endpoint_t* ep, message_t* msg) {
+    int32_t r = endpoint_resolve(ep);
+    return r < 0 ? r : sys_send(ep->handle, msg);
+}
+
+int32_t endpoint_sendrec(endpoint_t* ep, message_t* msg) {
+    int32_t r = endpoint_resolve(ep);
+    return r < 0 ? r : sys_sendrec(ep->handle, msg);
+}
+
 int32_t sys_register_irq(uint32_t irq) {
     int32_t ret;
     __asm__ volatile ("int $0x80"
@@ -87,9 +124,19 @@ uint32_t sys_getpid(void) {
 }
 
 void sys_exit(int code) {
+    fflush(stdout);
     __asm__ volatile ("int $0x80" : : "a"(SYS_EXIT), "b"(code));
 }
 
+int32_t sys_write(const char* buf, uint32_t len) {
+    int32_t ret;
+    __asm__ volatile ("int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_WRITE), "b"((uint32_t)buf), "c"(len)
+        : "memory");
+    return ret;
+}
+
 /* ---- Server-support syscalls ---- */
 
 char sys_kbd_getchar(void) {
@@ -229,6 +276,148 @@ int32_t sys_net_poll(void) {
     return ret;
 }
 
+int32_t sys_stats(proc_stats_t* st, uint32_t size) {
+    int32_t ret;
+    __asm__ volatile ("int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_STATS), "b"((uint32_t)st), "c"(size)
+        : "memory");
+    return ret;
+}
+
+/* ---- Shared-memory channels ---- */
+
+int32_t sys_chan_create(uint32_t peer, uint32_t data_pages, uint32_t flags) {
+    int32_t ret;
+    __asm__ volatile ("int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_CHAN_CREATE), "b"(peer), "c"(data_pages), "d"(flags)
+        : "memory");
+    return ret;
+}
+
+chan_ring_t* sys_chan_map(uint32_t id) {
+    uint32_t ret;
+    __asm__ volatile ("int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_CHAN_MAP), "b"(id)
+        : "memory");
+    return (chan_ring_t*)ret;
+}
+
+int32_t sys_chan_close(uint32_t id) {
+    int32_t ret;
+    __asm__ volatile ("int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_CHAN_CLOSE), "b"(id)
+        : "memory");
+    return ret;
+}
+
+chan_ring_t* chan_create(uint32_t peer, uint32_t data_pages, uint32_t flags) {
+    int32_t id = sys_chan_create(peer, data_pages, flags);
+    return id < 0 ? NULL : sys_chan_map((uint32_t)id);
+}
+
+chan_ring_t* chan_open(uint32_t id) {
+    return sys_chan_map(id);
+}
+
+int32_t chan_close(chan_ring_t* r) {
+    return sys_chan_close(r->id);
+}
+
+/* Full fence between publishing our index and reading the peer's event
+ * index; the plain barrier is enough for store-store order on x86 */
+static inline void chan_mb(void) {
+    __asm__ volatile ("lock; addl $0, (%%esp)" : : : "memory");
+}
+
+static inline void chan_barrier(void) {
+    __asm__ volatile ("" : : : "memory");
+}
+
+static inline int chan_need_event(uint32_t event, uint32_t new_idx, uint32_t old_idx) {
+    return (uint32_t)(new_idx - event - 1) < (uint32_t)(new_idx - old_idx);
+}
+
+static void chan_doorbell(uint32_t pid, uint32_t id) {
+    message_t m;
+    memset(&m, 0, sizeof(m));
+    m.type = MSG_CHAN_DOORBELL;
+    m.chan.id = id;
+    sys_notify(pid, &m);
+}
+
+/* Doorbells are kernel notifications (sender 0); an early one is
+ * delivered without blocking */
+static void chan_wait(void) {
+    message_t m;
+    sys_receive(0, &m);
+}
+
+static void chan_copy_in(chan_ring_t* r, uint32_t pos, const void* src, uint32_t n) {
+    uint8_t* data = (uint8_t*)r + CHAN_DATA_OFFSET;
+    uint32_t off = pos & (r->size - 1);
+    uint32_t first = r->size - off < n ? r->size - off : n;
+    memcpy(data + off, src, first);
+    memcpy(data, (const uint8_t*)src + first, n - first);
+}
+
+static void chan_copy_out(chan_ring_t* r, uint32_t pos, void* dst, uint32_t n) {
+    const uint8_t* data = (const uint8_t*)r + CHAN_DATA_OFFSET;
+    uint32_t off = pos & (r->size - 1);
+    uint32_t first = r->size - off < n ? r->size - off : n;
+    memcpy(dst, data + off, first);
+    memcpy((uint8_t*)dst + first, data, n - first);
+}
+
+int32_t chan_write(chan_ring_t* r, const void* data, uint32_t len) {
+    uint32_t need = 4 + ((len + 3) & ~3u);
+    if (need > r->size || r->closed) return -1;
+
+    uint32_t head = r->head;
+    while (r->size - (head - r->tail) < need) {
+        if (r->closed) return -1;
+        r->space_event = r->tail;
+        chan_mb();
+        if (r->size - (head - r->tail) >= need) break;
+        if (!r->closed) chan_wait();
+    }
+
+    chan_copy_in(r, head, &len, 4);
+    chan_copy_in(r, head + 4, data, len);
+    chan_barrier();
+    r->head = head + need;
+    chan_mb();
+    if (chan_need_event(r->data_event, head + need, head)) chan_doorbell(r->consumer, r->id);
+    return (int32_t)len;
+}
+
+int32_t chan_read(chan_ring_t* r, void* buf, uint32_t max) {
+    uint32_t tail = r->tail;
+    while (r->head == tail) {
+        if (r->closed) return -1;
+        r->data_event = tail;
+        chan_mb();
+        if (r->head != tail) break;
+        if (!r->closed) chan_wait();
+    }
+    chan_barrier();
+
+    uint32_t len;
+    chan_copy_out(r, tail, &len, 4);
+    if (len > r->size - 4) return -1;
+    uint32_t copied = len < max ? len : max;   /* The rest of the record is dropped */
+    chan_copy_out(r, tail + 4, buf, copied);
+    uint32_t next = tail + 4 + ((len + 3) & ~3u);
+    chan_barrier();
+    r->tail = next;
+    chan_mb();
+    if (chan_need_event(r->space_event, next, tail)) chan_doorbell(r->producer, r->id);
+    return (int32_t)copied;
+}
+
 void sys_debug_log(const char* msg) {
     __asm__ volatile ("int $0x80"
         : : "a"(SYS_DEBUG_LOG), "b"((uint32_t)msg) : "memory");
@@ -275,6 +464,135 @@ void sys_sleep(uint32_t ms) {
     return ret;
 }
 
+void* sys_sbrk(int32_t increment) {
+    uint32_t ret;
+    __asm__ volatile ("int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_SBRK), "b"(increment)
+        : "memory");
+    return (ret >= 0xFFFFF000) ? (void*)-1 : (void*)ret;
+}
+
+/* ---- User heap allocator ---- */
+
+#define UHEAP_CLASSES   8           /* 32, 64, ... 4096 byte blocks */
+#define UHEAP_MIN_SHIFT 5
+#define UHEAP_REFILL    16384       /* bytes taken from sbrk per class refill */
+#define UHEAP_LARGE     0xFF        /* hdr.cls for blocks outside the classes */
+#define UHEAP_ALIGN     16          /* max_align_t: SSE vectors, long double */
+
+/* Padded to UHEAP_ALIGN so the payload after it keeps the block's alignment */
+typedef struct {
+    uint32_t size;                  /* Total block size including header */
+    uint32_t cls;                   /* Size class, or UHEAP_LARGE */
+    uint32_t pad[2];
+} uheap_hdr_t;
+
+/* Grow the break by bytes, starting on a UHEAP_ALIGN boundary even if
+ * someone else moved it by an odd amount */
+static void* uheap_sbrk(uint32_t bytes) {
+    uint32_t brk = (uint32_t)sys_sbrk(0);
+    if (brk == (uint32_t)-1) return (void*)-1;
+    uint32_t pad = (0u - brk) & (UHEAP_ALIGN - 1);
+    uint8_t* p = (uint8_t*)sys_sbrk((int32_t)(bytes + pad));
+    return p == (uint8_t*)-1 ? (void*)-1 : p + pad;
+}
+
+typedef struct uheap_free {
+    struct uheap_free* next;
+} uheap_free_t;
+
+static uheap_free_t* uheap_lists[UHEAP_CLASSES];
+static uheap_free_t* uheap_large;
+
+static int uheap_refill(uint32_t cls) {
+    uint32_t bsize = 1u << (cls + UHEAP_MIN_SHIFT);
+    uint8_t* chunk = (uint8_t*)uheap_sbrk(UHEAP_REFILL);
+    if (chunk == (uint8_t*)-1) return -1;
+
+    for (uint32_t off = 0; off + bsize <= UHEAP_REFILL; off += bsize) {
+        uheap_hdr_t* h = (uheap_hdr_t*)(chunk + off);
+        h->size = bsize;
+        h->cls  = cls;
+        uheap_free_t* f = (uheap_free_t*)(h + 1);
+        f->next = uheap_lists[cls];
+        uheap_lists[cls] = f;
+    }
+    return 0;
+}
+
+void* malloc(size_t size) {
+    if (size == 0) return NULL;
+    uint32_t total = size + sizeof(uheap_hdr_t);
+    if (total < size) return NULL;
+
+    uint32_t cls = 0;
+    while (cls < UHEAP_CLASSES && (1u << (cls + UHEAP_MIN_SHIFT)) < total) cls++;
+
+    if (cls < UHEAP_CLASSES) {
+        if (!uheap_lists[cls] && uheap_refill(cls) != 0) return NULL;
+        uheap_free_t* f = uheap_lists[cls];
+        uheap_lists[cls] = f->next;
+        return f;
+    }
+
+    /* Large: first fit from recycled blocks, else extend the break */
+    total = (total + UHEAP_ALIGN - 1) & ~(UHEAP_ALIGN - 1);
+    if (total < size) return NULL;
+    uheap_free_t** pp = &uheap_large;
+    while (*pp) {
+        uheap_hdr_t* h = (uheap_hdr_t*)*pp - 1;
+        if (h->size >= total) {
+            uheap_free_t* f = *pp;
+            *pp = f->next;
+            return f;
+        }
+        pp = &(*pp)->next;
+    }
+
+    uheap_hdr_t* h = (uheap_hdr_t*)uheap_sbrk(total);
+    if (h == (uheap_hdr_t*)-1) return NULL;
+    h->size = total;
+    h->cls  = UHEAP_LARGE;
+    return h + 1;
+}
+
+void free(void* ptr) {
+    if (!ptr) return;
+    uheap_hdr_t* h = (uheap_hdr_t*)ptr - 1;
+    uheap_free_t* f = (uheap_free_t*)ptr;
+    if (h->cls < UHEAP_CLASSES) {
+        f->next = uheap_lists[h->cls];
+        uheap_lists[h->cls] = f;
+    } else {
+        f->next = uheap_large;
+        uheap_large = f;
+    }
+}
+
+void* calloc(size_t count, size_t size) {
+    size_t total = count * size;
+    if (size && total / size != count) return NULL;
+    void* p = malloc(total);
+    if (p) memset(p, 0, total);
+    return p;
+}
+
+void* realloc(void* ptr, size_t size) {
+    if (!ptr) return malloc(size);
+    if (size == 0) { free(ptr); return NULL; }
+
+    uheap_hdr_t* h = (uheap_hdr_t*)ptr - 1;
+    size_t avail = h->size - sizeof(uheap_hdr_t);
+    if (size <= avail) return ptr;
+
+    void* np = malloc(size);
+    if (!np) return NULL;
+    memcpy(np, ptr, avail);
+    free(ptr);
+    return np;
+}
+
 /* --- Inside src/userlib.c --- */
 
 /**
@@ -350,6 +668,42 @@ int32_t sys_gpu3d_present(void) {
     return ret;
 }
 
+int32_t sys_gpu3d_tex_create(uint32_t width, uint32_t height, uint32_t levels) {
+    int32_t ret;
+    __asm__ volatile ("int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_GPU3D_TEX_CREATE), "b"(width), "c"(height), "d"(levels)
+        : "memory");
+    return ret;
+}
+
+int32_t sys_gpu3d_tex_upload(int32_t tex, uint32_t level, const uint32_t* texels) {
+    int32_t ret;
+    __asm__ volatile ("int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_GPU3D_TEX_UPLOAD), "b"(tex), "c"(level), "d"((uint32_t)texels)
+        : "memory");
+    return ret;
+}
+
+int32_t sys_gpu3d_tex_bind(int32_t tex) {
+    int32_t ret;
+    __asm__ volatile ("int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_GPU3D_TEX_BIND), "b"(tex)
+        : "memory");
+    return ret;
+}
+
+int32_t sys_gpu3d_tex_free(int32_t tex) {
+    int32_t ret;
+    __asm__ volatile ("int $0x80"
+        : "=a"(ret)
+        : "a"(SYS_GPU3D_TEX_FREE), "b"(tex)
+        : "memory");
+    return ret;
+}
+
 /**
  * Simple utoa (Unsigned Integer to ASCII) implementation
  */
@@ -378,4 +732,198 @@ char* utoa(uint32_t value, char* str, int base) {
         *ptr-- = tmp;
     }
     return rc;
-}
\ No newline at end of file
+}
+
+/* ---- Buffered stdio ---- */
+
+static FILE stdout_file = { .len = 0, .mode = _IOLBF };
+FILE* stdout = &stdout_file;
+
+int fflush(FILE* f) {
+    if (!f || f->len == 0) return 0;
+    int32_t ret = sys_write(f->buf, f->len);
+    f->len = 0;
+    return (ret < 0) ? EOF : 0;
+}
+
+int setvbuf(FILE* f, char* buf, int mode, size_t size) {
+    (void)buf; (void)size;
+    if (!f || mode < _IOFBF || mode > _IONBF) return -1;
+    fflush(f);
+    f->mode = mode;
+    return 0;
+}
+
+size_t fwrite(const void* ptr, size_t size, size_t count, FILE* f) {
+    const char* p = (const char*)ptr;
+    uint32_t total = size * count;
+    if (!f || total == 0) return 0;
+
+    if (f->mode == _IONBF) {
+        fflush(f);
+        sys_write(p, total);
+        return count;
+    }
+
+    bool saw_newline = false;
+    for (uint32_t i = 0; i < total; i++) {
+        if (f->len == BUFSIZ) fflush(f);
+        f->buf[f->len++] = p[i];
+        if (p[i] == '\n') saw_newline = true;
+    }
+    if (saw_newline && f->mode == _IOLBF) fflush(f);
+    return count;
+}
+
+int fputc(int c, FILE* f) {
+    char ch = (char)c;
+    return fwrite(&ch, 1, 1, f) ? (unsigned char)ch : EOF;
+}
+
+int fputs(const char* s, FILE* f) {
+    fwrite(s, 1, strlen(s), f);
+    return 0;
+}
+
+int putchar(int c) { return fputc(c, stdout); }
+
+int puts(const char* s) {
+    fputs(s, stdout);
+    return fputc('\n', stdout) == EOF ? EOF : 0;
+}
+
+/*
+ * Shared formatter: %d %i %u %x %X %p %s %c %% with '-' / '0' flags,
+ * a field width, and 'l' accepted (ignored, everything is 32-bit).
+ */
+typedef void (*fmt_out_t)(char c, void* ctx);
+
+static int fmt_core(fmt_out_t out, void* ctx, const char* fmt, va_list ap) {
+    int count = 0;
+    char num[12];
+
+    while (*fmt) {
+        if (*fmt != '%') { out(*fmt++, ctx); count++; continue; }
+        fmt++;
+
+        bool left = false, zero = false;
+        for (;; fmt++) {
+            if (*fmt == '-') left = true;
+            else if (*fmt == '0') zero = true;
+            else break;
+        }
+        int width = 0;
+        while (*fmt >= '0' && *fmt <= '9') width = width * 10 + (*fmt++ - '0');
+        while (*fmt == 'l') fmt++;
+
+        const char* str = num;
+        int len = 0;
+        bool neg = false;
+        switch (*fmt) {
+        case 'd': case 'i': {
+            int32_t v = va_arg(ap, int32_t);
+            uint32_t u = (uint32_t)v;
+            if (v < 0) { neg = true; u = 0u - u; }
+            utoa(u, num, 10);
+            len = strlen(num);
+            break;
+        }
+        case 'u': utoa(va_arg(ap, uint32_t), num, 10); len = strlen(num); break;
+        case 'p': out('0', ctx); out('x', ctx); count += 2; /* fall through */
+        case 'x': utoa(va_arg(ap, uint32_t), num, 16); len = strlen(num); break;
+        case 'X':
+            utoa(va_arg(ap, uint32_t), num, 16);
+            for (char* q = num; *q; q++) if (*q >= 'a') *q -= 'a' - 'A';
+            len = strlen(num);
+            break;
+        case 's':
+            str = va_arg(ap, const char*);
+            if (!str) str = "(null)";
+            len = strlen(str);
+            zero = false;
+            break;
+        case 'c': num[0] = (char)va_arg(ap, int); len = 1; zero = false; break;
+        case '%': num[0] = '%'; len = 1; break;
+        case '\0': return count;
+        default:  num[0] = '%'; num[1] = *fmt; len = 2; break;
+        }
+        fmt++;
+
+        int pad = width - len - (neg ? 1 : 0);
+        if (neg && zero) { out('-', ctx); count++; }
+        if (!left) for (; pad > 0; pad--, count++) out(zero ? '0' : ' ', ctx);
+        if (neg && !zero) { out('-', ctx); count++; }
+        for (int i = 0; i < len; i++) out(str[i], ctx);
+        count += len;
+        if (left) for (; pad > 0; pad--, count++) out(' ', ctx);
+    }
+    return count;
+}
+
+static void fmt_to_file(char c, void* ctx) {
+    FILE* f = (FILE*)ctx;
+    if (f->len == BUFSIZ) fflush(f);
+    f->buf[f->len++] = c;
+}
+
+int vfprintf(FILE* f, const char* fmt, va_list ap) {
+    if (!f) return -1;
+    if (f->mode == _IONBF) {
+        /* Format into a stack buffer so the write is still one trap */
+        char tmp[BUFSIZ];
+        int n = vsnprintf(tmp, sizeof(tmp), fmt, ap);
+        sys_write(tmp, (n < (int)sizeof(tmp)) ? (uint32_t)n : sizeof(tmp) - 1);
+        return n;
+    }
+    uint32_t start = f->len;
+    int n = fmt_core(fmt_to_file, f, fmt, ap);
+    if (f->mode == _IOLBF) {
+        /* Flush if a newline landed in what is still buffered */
+        for (uint32_t i = (start <= f->len) ? start : 0; i < f->len; i++)
+            if (f->buf[i] == '\n') { fflush(f); break; }
+    }
+    return n;
+}
+
+int fprintf(FILE* f, const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vfprintf(f, fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+int printf(const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vfprintf(stdout, fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+typedef struct {
+    char*    buf;
+    uint32_t size;
+    uint32_t pos;
+} fmt_str_t;
+
+static void fmt_to_str(char c, void* ctx) {
+    fmt_str_t* s = (fmt_str_t*)ctx;
+    if (s->pos + 1 < s->size) s->buf[s->pos] = c;
+    s->pos++;
+}
+
+int vsnprintf(char* buf, size_t size, const char* fmt, va_list ap) {
+    fmt_str_t s = { buf, size, 0 };
+    int n = fmt_core(fmt_to_str, &s, fmt, ap);
+    if (size) buf[(s.pos < size) ? s.pos : size - 1] = '\0';
+    return n;
+}
+
+int snprintf(char* buf, size_t size, const char* fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(buf, size, fmt, ap);
+    va_end(ap);
+    return n;
+}
@@ -6,31 +6,93 @@ static uint16_t* const vga_buffer = (uint16_t*)VGA_MEMORY;
 static uint8_t  term_row;
 static uint8_t  term_col;
 static uint8_t  term_color;
+
+/*
+ * Output is drawn into a shadow of the screen in RAM and copied to VGA
+ * memory by terminal_flush(), once per print call rather than per char.
+ * The shadow is a ring of rows: scrolling advances shadow_top instead of
+ * moving 4000 bytes.  Each screen row keeps a dirty column span
+ * [dirty_lo, dirty_hi), and the CRTC cursor is only reprogrammed when
+ * it actually moved.
+ */
+static uint16_t shadow[VGA_HEIGHT * VGA_WIDTH];
+static uint8_t  shadow_top;                 /* Ring row on screen row 0 */
+static uint8_t  dirty_lo[VGA_HEIGHT];
+static uint8_t  dirty_hi[VGA_HEIGHT];
+static uint16_t hw_cursor = 0xFFFF;         /* Last position sent to the CRTC */
 static terminal_hook_t output_hook = NULL;
+static terminal_redirect_t output_redirect = NULL;
 
 void terminal_set_hook(terminal_hook_t hook) { output_hook = hook; }
+void terminal_set_redirect(terminal_redirect_t redirect) { output_redirect = redirect; }
 
 static inline uint16_t vga_entry(unsigned char c, uint8_t color) {
     return (uint16_t)c | ((uint16_t)color << 8);
 }
 
+/* Shadow cells of screen row y */
+static inline uint16_t* row_ptr(int y) {
+    int r = shadow_top + y;
+    if (r >= VGA_HEIGHT) r -= VGA_HEIGHT;
+    return &shadow[r * VGA_WIDTH];
+}
+
+static inline void mark_dirty(int y, int lo, int hi) {
+    if (lo < dirty_lo[y]) dirty_lo[y] = (uint8_t)lo;
+    if (hi > dirty_hi[y]) dirty_hi[y] = (uint8_t)hi;
+}
+
+static void mark_all_dirty(void) {
+    for (int y = 0; y < VGA_HEIGHT; y++) {
+        dirty_lo[y] = 0;
+        dirty_hi[y] = VGA_WIDTH;
+    }
+}
+
+static inline void put_cell(int y, int x, uint16_t entry) {
+    row_ptr(y)[x] = entry;
+    mark_dirty(y, x, x + 1);
+}
+
 static void scroll(void) {
-    for (int y = 0; y < VGA_HEIGHT - 1; y++)
-        for (int x = 0; x < VGA_WIDTH; x++)
-            vga_buffer[y * VGA_WIDTH + x] = vga_buffer[(y + 1) * VGA_WIDTH + x];
+    /* The top row becomes the new, blank bottom row */
+    uint16_t* bottom = row_ptr(0);
     for (int x = 0; x < VGA_WIDTH; x++)
-        vga_buffer[(VGA_HEIGHT - 1) * VGA_WIDTH + x] = vga_entry(' ', term_color);
+        bottom[x] = vga_entry(' ', term_color);
+    shadow_top = (shadow_top + 1 == VGA_HEIGHT) ? 0 : shadow_top + 1;
+    mark_all_dirty();
     term_row = VGA_HEIGHT - 1;
 }
 
-static void update_cursor(void) {
+/* Write dirty spans to VGA memory, then the cursor if it moved */
+void terminal_flush(void) {
+    for (int y = 0; y < VGA_HEIGHT; y++) {
+        if (dirty_lo[y] >= dirty_hi[y]) continue;
+        const uint16_t* src = row_ptr(y);
+        uint16_t* dst = &vga_buffer[y * VGA_WIDTH];
+        for (int x = dirty_lo[y]; x < dirty_hi[y]; x++)
+            dst[x] = src[x];
+        dirty_lo[y] = VGA_WIDTH;
+        dirty_hi[y] = 0;
+    }
+
     uint16_t pos = term_row * VGA_WIDTH + term_col;
+    if (pos == hw_cursor) return;
+    hw_cursor = pos;
     outb(0x3D4, 14);
     outb(0x3D5, (uint8_t)(pos >> 8));
     outb(0x3D4, 15);
     outb(0x3D5, (uint8_t)(pos & 0xFF));
 }
 
+/* Rewrite the whole screen from the shadow (after something drew into
+ * VGA memory directly) */
+void terminal_refresh(void) {
+    mark_all_dirty();
+    hw_cursor = 0xFFFF;
+    terminal_flush();
+}
+
 void terminal_init(void) {
     term_row = 0;
     term_col = 0;
@@ -40,27 +102,60 @@ void terminal_init(void) {
 
 void terminal_clear(void) {
     for (int i = 0; i < VGA_WIDTH * VGA_HEIGHT; i++)
-        vga_buffer[i] = vga_entry(' ', term_color);
+        shadow[i] = vga_entry(' ', term_color);
+    shadow_top = 0;
     term_row = 0;
     term_col = 0;
-    update_cursor();
+    mark_all_dirty();
+    terminal_flush();
 }
 
 void terminal_setcolor(uint8_t color) { term_color = color; }
 uint8_t terminal_getcolor(void) { return term_color; }
 
-void terminal_putchar(char c) {
+static void put_raw(char c) {
+    if (output_redirect && output_redirect(c)) return;
     if (output_hook) output_hook(c);
     if (c == '\n') { term_col = 0; term_row++; }
     else if (c == '\t') { term_col = (term_col + 8) & ~7; }
     else if (c == '\r') { term_col = 0; }
     else {
-        vga_buffer[term_row * VGA_WIDTH + term_col] = vga_entry(c, term_color);
+        put_cell(term_row, term_col, vga_entry(c, term_color));
         term_col++;
     }
     if (term_col >= VGA_WIDTH) { term_col = 0; term_row++; }
     if (term_row >= VGA_HEIGHT) scroll();
-    update_cursor();
+}
+
+static void put_str(const char* str) {
+    while (*str) put_raw(*str++);
+}
+
+static void put_hex(uint32_t value) {
+    const char hex[] = "0123456789ABCDEF";
+    put_str("0x");
+    for (int i = 28; i >= 0; i -= 4)
+        put_raw(hex[(value >> i) & 0xF]);
+}
+
+static void put_dec(uint32_t value) {
+    if (value == 0) { put_raw('0'); return; }
+    char buf[12];
+    int i = 0;
+    while (value > 0) { buf[i++] = '0' + (value % 10); value /= 10; }
+    while (--i >= 0) put_raw(buf[i]);
+}
+
+void terminal_putchar(char c) {
+    put_raw(c);
+    terminal_flush();
+}
+
+/* Bulk write: same as putchar per byte, but flushed once */
+void terminal_write(const char* buf, uint32_t len) {
+    for (uint32_t i = 0; i < len; i++)
+        put_raw(buf[i]);
+    terminal_flush();
 }
 
 void terminal_backspace(void) {
@@ -70,27 +165,23 @@ void terminal_backspace(void) {
         term_row--;
         term_col = VGA_WIDTH - 1;
     }
-    vga_buffer[term_row * VGA_WIDTH + term_col] = vga_entry(' ', term_color);
-    update_cursor();
+    put_cell(term_row, term_col, vga_entry(' ', term_color));
+    terminal_flush();
 }
 
 void terminal_print(const char* str) {
-    while (*str) terminal_putchar(*str++);
+    put_str(str);
+    terminal_flush();
 }
 
 void terminal_print_hex(uint32_t value) {
-    const char hex[] = "0123456789ABCDEF";
-    terminal_print("0x");
-    for (int i = 28; i >= 0; i -= 4)
-        terminal_putchar(hex[(value >> i) & 0xF]);
+    put_hex(value);
+    terminal_flush();
 }
 
 void terminal_print_dec(uint32_t value) {
-    if (value == 0) { terminal_putchar('0'); return; }
-    char buf[12];
-    int i = 0;
-    while (value > 0) { buf[i++] = '0' + (value % 10); value /= 10; }
-    while (--i >= 0) terminal_putchar(buf[i]);
+    put_dec(value);
+    terminal_flush();
 }
 
 void terminal_print_dec64(uint64_t value) {
@@ -98,7 +189,8 @@ void terminal_print_dec64(uint64_t value) {
     char buf[21];
     int i = 0;
     while (value > 0) { buf[i++] = '0' + (value % 10); value /= 10; }
-    while (--i >= 0) terminal_putchar(buf[i]);
+    while (--i >= 0) put_raw(buf[i]);
+    terminal_flush();
 }
 
 void terminal_print_colored(const char* str, uint8_t color) {
@@ -111,7 +203,7 @@ void terminal_print_colored(const char* str, uint8_t color) {
 void terminal_set_cursor(int row, int col) {
     term_row = row;
     term_col = col;
-    update_cursor();
+    terminal_flush();
 }
 
 void terminal_get_cursor(int* row, int* col) {
@@ -123,32 +215,30 @@ void terminal_print_at(int row, int col, const char* str, uint8_t color) {
     uint8_t old_color = term_color;
     int old_row = term_row, old_col = term_col;
     term_row = row; term_col = col; term_color = color;
-    terminal_print(str);
+    put_str(str);
     term_color = old_color;
     term_row = old_row;
     term_col = old_col;
-    update_cursor();
+    terminal_flush();
 }
 
 void terminal_draw_box(int row, int col, int w, int h, uint8_t color) {
-    uint8_t old = term_color;
-    term_color = color;
     /* Corners and edges using CP437 box drawing */
-    vga_buffer[row * VGA_WIDTH + col] = vga_entry(0xC9, color);
-    vga_buffer[row * VGA_WIDTH + col + w - 1] = vga_entry(0xBB, color);
-    vga_buffer[(row + h - 1) * VGA_WIDTH + col] = vga_entry(0xC8, color);
-    vga_buffer[(row + h - 1) * VGA_WIDTH + col + w - 1] = vga_entry(0xBC, color);
+    put_cell(row, col, vga_entry(0xC9, color));
+    put_cell(row, col + w - 1, vga_entry(0xBB, color));
+    put_cell(row + h - 1, col, vga_entry(0xC8, color));
+    put_cell(row + h - 1, col + w - 1, vga_entry(0xBC, color));
     for (int x = 1; x < w - 1; x++) {
-        vga_buffer[row * VGA_WIDTH + col + x] = vga_entry(0xCD, color);
-        vga_buffer[(row + h - 1) * VGA_WIDTH + col + x] = vga_entry(0xCD, color);
+        put_cell(row, col + x, vga_entry(0xCD, color));
+        put_cell(row + h - 1, col + x, vga_entry(0xCD, color));
     }
     for (int y = 1; y < h - 1; y++) {
-        vga_buffer[(row + y) * VGA_WIDTH + col] = vga_entry(0xBA, color);
-        vga_buffer[(row + y) * VGA_WIDTH + col + w - 1] = vga_entry(0xBA, color);
+        put_cell(row + y, col, vga_entry(0xBA, color));
+        put_cell(row + y, col + w - 1, vga_entry(0xBA, color));
         for (int x = 1; x < w - 1; x++)
-            vga_buffer[(row + y) * VGA_WIDTH + col + x] = vga_entry(' ', color);
+            put_cell(row + y, col + x, vga_entry(' ', color));
     }
-    term_color = old;
+    terminal_flush();
 }
 
 /* Variadic kprintf - supports %s %d %u %x %c %% */
@@ -165,24 +255,25 @@ void kprintf(const char* fmt, ...) {
         if (*fmt == '%') {
             fmt++;
             switch (*fmt) {
-                case 's': terminal_print(va_arg(args, const char*)); break;
+                case 's': put_str(va_arg(args, const char*)); break;
                 case 'd': {
                     int v = va_arg(args, int);
-                    if (v < 0) { terminal_putchar('-'); v = -v; }
-                    terminal_print_dec((uint32_t)v);
+                    if (v < 0) { put_raw('-'); v = -v; }
+                    put_dec((uint32_t)v);
                     break;
                 }
-                case 'u': terminal_print_dec(va_arg(args, uint32_t)); break;
-                case 'x': terminal_print_hex(va_arg(args, uint32_t)); break;
-                case 'c': terminal_putchar((char)va_arg(args, int)); break;
-                case '%': terminal_putchar('%'); break;
-                default: terminal_putchar('%'); terminal_putchar(*fmt); break;
+                case 'u': put_dec(va_arg(args, uint32_t)); break;
+                case 'x': put_hex(va_arg(args, uint32_t)); break;
+                case 'c': put_raw((char)va_arg(args, int)); break;
+                case '%': put_raw('%'); break;
+                default: put_raw('%'); put_raw(*fmt); break;
             }
         } else {
-            terminal_putchar(*fmt);
+            put_raw(*fmt);
         }
         fmt++;
     }
 
     va_end(args);
+    terminal_flush();
 }
@@ -131,10 +131,6 @@ static bool virgl_dev_initialized = false;
 
 static virgl_ctx_t vctx;
 
-/* Aligned command/response buffers for GPU commands */
-/* Was 4096 — must be larger than biggest command + SUBMIT_3D header */
-static uint8_t v3d_cmd_buf[131072]  __attribute__((aligned(4096)));
-static uint8_t v3d_resp_buf[4096]   __attribute__((aligned(4096)));
 
 static uint32_t* vctx_display_backing = NULL; // Add this global
 static uint32_t* vctx_fb_backing = NULL; 
@@ -145,29 +141,12 @@ static uint32_t* vctx_fb_backing = NULL;
 
 
 
-/* ===== Low-level GPU command helper (same pattern as virtio_gpu.c) ===== */
+/* ===== Low-level GPU command helper =====
+ * Goes through the 2D driver's DMA slots on the shared device, so nothing
+ * on this stack is ever handed to the device */
 static bool gpu3d_cmd(void* cmd, uint32_t cmd_len, void* resp, uint32_t resp_len) {
-    memcpy(v3d_cmd_buf, cmd, cmd_len);
-    memset(v3d_resp_buf, 0, resp_len);
-
-    int head = virtio_send(virgl_dev, VIRTIO_GPU_QUEUE_CONTROL,
-                           (uint32_t)v3d_cmd_buf, cmd_len,
-                           (uint32_t)v3d_resp_buf, resp_len);
-    if (head < 0) {
-        //serial_printf("virgl: failed to submit gpu command\n");
-        return false;
-    }
-
-    virtio_notify(virgl_dev, VIRTIO_GPU_QUEUE_CONTROL);
-    virtio_wait(virgl_dev, VIRTIO_GPU_QUEUE_CONTROL);
-    memcpy(resp, v3d_resp_buf, resp_len);
-
-    virtio_gpu_ctrl_hdr_t* hdr = (virtio_gpu_ctrl_hdr_t*)resp;
-    if (hdr->type >= VIRTIO_GPU_RESP_ERR_UNSPEC) {
-        //serial_printf("virgl: gpu command error, type=%x\n", hdr->type);
-        return false;
-    }
-    return true;
+    if (!virgl_dev) return false;
+    return virtio_gpu_send_cmd_2iov(cmd, cmd_len, NULL, 0, resp, resp_len);
 }
 
 static bool gpu3d_cmd_ok(void* cmd, uint32_t cmd_len) {
@@ -196,19 +175,40 @@ static inline void emit(uint32_t word) {
 }
 
 
-/* Pack a NUL-terminated string into the command buffer as uint32_t words (little-endian) */
-static void emit_string(const char* str) {
-    uint32_t len = strlen(str) + 1;  /* include NUL */
-    const uint8_t* p = (const uint8_t*)str;
-    uint32_t nwords = (len + 3) / 4;
-    for (uint32_t w = 0; w < nwords; w++) {
-        uint32_t word = 0;
-        for (int b = 0; b < 4; b++) {
-            uint32_t idx = w * 4 + b;
-            if (idx < len)
-                word |= ((uint32_t)p[idx]) << (b * 8);
-        }
-        emit(word);
+/* ===== Bulk emission =====
+ * virgl_cmd_reserve(n) hands out n contiguous dwords at the end of the
+ * command buffer; the caller fills them (header included) and calls
+ * virgl_cmd_commit(n).  If the space is not there, whatever is already
+ * queued is submitted first, so a flush always falls on a command
+ * boundary.  NULL only if n is larger than the whole buffer or the flush
+ * failed. */
+
+uint32_t* virgl_cmd_reserve(uint32_t words) {
+    uint32_t cap = vctx.cmd_buf_size / 4;
+    if (!vctx.cmd_buf || words > cap) return NULL;
+    if (vctx.cmd_pos + words > cap && !virgl_cmd_submit()) return NULL;
+    return vctx.cmd_buf + vctx.cmd_pos;
+}
+
+void virgl_cmd_commit(uint32_t words) {
+    vctx.cmd_pos += words;
+}
+
+/* Dword copy for payloads (types.h memcpy goes a byte at a time) */
+static inline void copy_dwords(uint32_t* dst, const void* src, uint32_t n) {
+    __asm__ volatile ("cld; rep movsl"
+                      : "+D"(dst), "+S"(src), "+c"(n) : : "memory");
+}
+
+/* len bytes into whole dwords, zero-padding the last one */
+static void copy_bytes_padded(uint32_t* dst, const void* src, uint32_t len) {
+    copy_dwords(dst, src, len / 4);
+    if (len & 3) {
+        uint32_t tail = 0;
+        const uint8_t* p = (const uint8_t*)src + (len & ~3u);
+        for (uint32_t i = 0; i < (len & 3); i++)
+            tail |= (uint32_t)p[i] << (i * 8);
+        dst[len / 4] = tail;
     }
 }
 
@@ -279,9 +279,10 @@ static bool virgl_create_context(void) {
 /* ===== Create a 3D Resource ===== */
 // src/virgl.c
 
-bool virgl_create_resource_3d(uint32_t res_id, uint32_t target,
-                              uint32_t fmt, uint32_t bind,
-                              uint32_t width, uint32_t height, uint32_t depth)
+static bool create_resource_levels(uint32_t res_id, uint32_t target,
+                                   uint32_t fmt, uint32_t bind,
+                                   uint32_t width, uint32_t height, uint32_t depth,
+                                   uint32_t last_level)
 {
     virtio_gpu_resource_create_3d_t cmd;
     memset(&cmd, 0, sizeof(cmd));
@@ -299,7 +300,7 @@ bool virgl_create_resource_3d(uint32_t res_id, uint32_t target,
     cmd.depth       = depth;
 
     cmd.array_size  = 1;
-    cmd.last_level  = 0;
+    cmd.last_level  = last_level;
     cmd.nr_samples  = 0;  /* 0 = no multisampling (NOT 1!) */
     cmd.flags       = 0;
     cmd.padding     = 0;
@@ -314,6 +315,13 @@ bool virgl_create_resource_3d(uint32_t res_id, uint32_t target,
     return ok;
 }
 
+bool virgl_create_resource_3d(uint32_t res_id, uint32_t target,
+                              uint32_t fmt, uint32_t bind,
+                              uint32_t width, uint32_t height, uint32_t depth)
+{
+    return create_resource_levels(res_id, target, fmt, bind, width, height, depth, 0);
+}
+
 
 /* ===== Attach Resource to Context ===== */
 static bool virgl_ctx_attach(uint32_t res_id) {
@@ -352,6 +360,66 @@ static bool virgl_attach_backing(uint32_t res_id, uint32_t phys, uint32_t size)
 
     return gpu3d_cmd_ok(&cmd, sizeof(cmd));
 }
+
+/* Object handles and resource ids come from the same counter */
+uint32_t virgl_alloc_handle(void) {
+    return alloc_res_id();
+}
+
+/* ===== Texture Resources =====
+ * A sampled B8G8R8A8 2D texture with `levels` mip levels.  The backing
+ * holds the levels back to back; texels only ever arrive by INLINE_WRITE
+ * (virgl_upload_texture), so it is there for the host's sake alone.
+ * Returns the resource id, with the kmalloc'd backing in *backing. */
+uint32_t virgl_create_texture(uint32_t width, uint32_t height, uint32_t levels,
+                              void** backing)
+{
+    uint32_t size = 0;
+    for (uint32_t l = 0; l < levels; l++) {
+        uint32_t lw = width >> l, lh = height >> l;
+        size += (lw ? lw : 1) * (lh ? lh : 1) * 4;
+    }
+
+    uint32_t res_id = alloc_res_id();
+    if (!create_resource_levels(res_id, PIPE_TEXTURE_2D,
+                                VIRGL_FORMAT_B8G8R8A8_UNORM,
+                                VIRGL_BIND_SAMPLER_VIEW,
+                                width, height, 1, levels - 1))
+        return 0;
+
+    void* mem = kmalloc(size + 4096);
+    if (!mem) {
+        virgl_destroy_resource(res_id);
+        return 0;
+    }
+    void* aligned = (void*)(((uint32_t)mem + 4095) & ~4095u);
+    if (!virgl_attach_backing(res_id, virt_to_phys(aligned), size) ||
+        !virgl_ctx_attach(res_id)) {
+        virgl_destroy_resource(res_id);
+        kfree(mem);
+        return 0;
+    }
+
+    *backing = mem;
+    return res_id;
+}
+
+/* Detach from the context and drop the host resource (and with it the
+ * host's reference to the backing) */
+void virgl_destroy_resource(uint32_t res_id) {
+    virtio_gpu_ctx_resource_t detach;
+    memset(&detach, 0, sizeof(detach));
+    detach.hdr.type = VIRTIO_GPU_CMD_CTX_DETACH_RESOURCE;
+    detach.hdr.ctx_id = vctx.ctx_id;
+    detach.resource_id = res_id;
+    gpu3d_cmd_ok(&detach, sizeof(detach));
+
+    virtio_gpu_resource_unref_t unref;
+    memset(&unref, 0, sizeof(unref));
+    unref.hdr.type = VIRTIO_GPU_CMD_RESOURCE_UNREF;
+    unref.resource_id = res_id;
+    gpu3d_cmd_ok(&unref, sizeof(unref));
+}
 /* ============================================================
  * Debug dump (no %08x, no serial_putc)
  * ============================================================ */
@@ -393,50 +461,29 @@ static bool virgl_submit_cmd_buf(uint32_t *cmds, uint32_t size_bytes)
         return false;
     }
 
-    virtio_gpu_cmd_submit_3d_t *s = (virtio_gpu_cmd_submit_3d_t *)v3d_cmd_buf;
-    const uint32_t total_bytes = (uint32_t)sizeof(*s) + size_bytes;
-
-    /* Make sure the staging buffer can hold header + command stream */
-    if (total_bytes > (uint32_t)sizeof(v3d_cmd_buf)) {
-        //serial_printf("virgl: submit_3d overflow total=%u (hdr=%u + payload=%u) buf=%u\n",
-                  //    total_bytes, (uint32_t)sizeof(*s), size_bytes, (uint32_t)sizeof(v3d_cmd_buf));
-        return false;
-    }
-
-    memset(s, 0, sizeof(*s));
-    s->hdr.type   = VIRTIO_GPU_CMD_SUBMIT_3D;
-    s->hdr.ctx_id = vctx.ctx_id;
-    s->size       = size_bytes; /* BYTES */
-
-    uint8_t *dst = (uint8_t *)v3d_cmd_buf + sizeof(*s);
-
-    /*
-     * IMPORTANT: cmds might alias v3d_cmd_buf (depending on how you allocated vctx.cmd_buf).
-     * memmove is safe for overlap; memcpy is not.
-     */
-    memmove(dst, cmds, size_bytes);
-
-    memset(v3d_resp_buf, 0, sizeof(virtio_gpu_ctrl_hdr_t));
-
-    int head = virtio_send(virgl_dev, VIRTIO_GPU_QUEUE_CONTROL,
-                           (uint32_t)v3d_cmd_buf, total_bytes,
-                           (uint32_t)v3d_resp_buf, sizeof(virtio_gpu_ctrl_hdr_t));
-    if (head < 0) {
-        //serial_printf("virgl: virtio_send submit_3d failed head=%d total_bytes=%u\n",
-               //       head, total_bytes);
-        return false;
-    }
-
-    virtio_notify(virgl_dev, VIRTIO_GPU_QUEUE_CONTROL);
-    virtio_wait(virgl_dev, VIRTIO_GPU_QUEUE_CONTROL);
-
-    virtio_gpu_ctrl_hdr_t *resp = (virtio_gpu_ctrl_hdr_t *)v3d_resp_buf;
-    if (resp->type >= VIRTIO_GPU_RESP_ERR_UNSPEC) {
-        //serial_printf("virgl: submit_3d failed resp.type=%x ctx=%u size_bytes=%u total=%u\n",
-                  //    resp->type, vctx.ctx_id, size_bytes, total_bytes);
+    /* Header and command stream go out as two segments — the header is
+     * staged by the driver, the (up to 128 KB) stream is sent in place
+     * from the long-lived cmd_buf */
+    virtio_gpu_cmd_submit_3d_t s;
+    memset(&s, 0, sizeof(s));
+    s.hdr.type   = VIRTIO_GPU_CMD_SUBMIT_3D;
+    s.hdr.ctx_id = vctx.ctx_id;
+    s.size       = size_bytes; /* BYTES */
+
+    /* Fenced, so the response means the host has executed the stream
+     * (and is done reading the VBO ring ranges it referenced) */
+    uint64_t fence = ++vctx.fence_next;
+    s.hdr.flags    = VIRTIO_GPU_FLAG_FENCE;
+    s.hdr.fence_id = fence;
+
+    if (!virtio_gpu_send_cmd_2iov(&s, sizeof(s), cmds, size_bytes,
+                                  NULL, sizeof(virtio_gpu_ctrl_hdr_t))) {
+        //serial_printf("virgl: submit_3d failed ctx=%u size_bytes=%u\n",
+                  //    vctx.ctx_id, size_bytes);
         return false;
     }
 
+    vctx.fence_done = fence;
     return true;
 }
 
@@ -454,6 +501,7 @@ bool virgl_cmd_submit(void)
     if (size_bytes > vctx.cmd_buf_size) {
         //serial_printf("virgl_cmd_submit: size overflow (bytes=%u > buf=%u) cmd_pos=%u\n",
                   //    size_bytes, vctx.cmd_buf_size, vctx.cmd_pos);
+        vctx.cmd_pos = 0;
         return false;
     }
 
@@ -464,14 +512,16 @@ bool virgl_cmd_submit(void)
      * IMPORTANT: SUBMIT_3D size is BYTES (not dwords).
      * virgl_submit_cmd_buf() must send ONLY 'size_bytes' of command data.
      */
-    if (!virgl_submit_cmd_buf(vctx.cmd_buf, size_bytes)) {
-        //serial_printf("virgl_cmd_submit: SUBMIT_3D failed (bytes=%u words=%u)\n",
-                 //     size_bytes, vctx.cmd_pos);
-        return false;
-    }
+    bool ok = virgl_submit_cmd_buf(vctx.cmd_buf, size_bytes);
 
-    /* Reset command position after successful submit so next batch starts clean */
+    /* The next batch starts clean either way: a failed batch is dropped
+     * (and reported) rather than left to make every later reserve fail */
     vctx.cmd_pos = 0;
+    if (!ok) {
+        serial_printf("virgl_cmd_submit: SUBMIT_3D failed, dropped %u bytes\n", size_bytes);
+        return false;
+    }
+    virtio_gpu_count_submit(size_bytes);
 
     return true;
 }
@@ -572,23 +622,6 @@ bool virgl_available(void) {
     return virtio_gpu_has_virgl();
 }
 
-static void emit_bytes(const void *data, uint32_t len)
-{
-    const uint8_t *p = (const uint8_t*)data;
-    uint32_t nwords = (len + 3) / 4;
-
-    for (uint32_t w = 0; w < nwords; w++) {
-        uint32_t word = 0;
-        for (int b = 0; b < 4; b++) {
-            uint32_t idx = w * 4 + b;
-            if (idx < len)
-                word |= ((uint32_t)p[idx]) << (b * 8);
-        }
-        emit(word);
-    }
-}
-
-
 /* virgl shader IR type (this is NOT the stage) */
 #define VIRGL_SHADER_IR_TGSI  0u   /* most common / safest */
 static bool virgl_create_shader_text(uint32_t handle,
@@ -601,17 +634,21 @@ static bool virgl_create_shader_text(uint32_t handle,
 
     virgl_cmd_begin();
 
+    uint32_t* w = virgl_cmd_reserve(6 + text_words);
+    if (!w) return false;
+
     // MUST be 6 + text_words (includes num_outputs dword)
-   emit(VIRGL_CMD_HDR(VIRGL_CCMD_CREATE_OBJECT, VIRGL_OBJECT_SHADER, 5 + text_words));
-    emit(handle);
-    emit(shader_type);
+    w[0] = VIRGL_CMD_HDR(VIRGL_CCMD_CREATE_OBJECT, VIRGL_OBJECT_SHADER, 5 + text_words);
+    w[1] = handle;
+    w[2] = shader_type;
 
     // offlen is TOTAL shader text length in bytes (first chunk), CONT bit clear
-    emit(VIRGL_OBJ_SHADER_OFFSET_VAL(text_len));
-    emit(num_tokens);   // MUST be tgsi_num_tokens(tokens) / (bin_len/4)
-    emit(0);            // num_outputs (streamout) = 0
+    w[3] = VIRGL_OBJ_SHADER_OFFSET_VAL(text_len);
+    w[4] = num_tokens;  // MUST be tgsi_num_tokens(tokens) / (bin_len/4)
+    w[5] = 0;           // num_outputs (streamout) = 0
 
-    emit_bytes(tgsi_dump_text, text_len);
+    copy_bytes_padded(w + 6, tgsi_dump_text, text_len);
+    virgl_cmd_commit(6 + text_words);
 
     return virgl_cmd_submit();
 }
@@ -623,16 +660,19 @@ static bool virgl_create_shader(uint32_t handle, uint32_t shader_type,
 
     virgl_cmd_begin();
 
-    emit(VIRGL_CMD_HDR(VIRGL_CCMD_CREATE_OBJECT, VIRGL_OBJECT_SHADER, 5 + num_tokens));
-    emit(handle);
-    emit(shader_type);
-    emit(VIRGL_OBJ_SHADER_OFFSET_VAL_BYTES(num_tokens * 4u));  // byte length
-    emit(num_tokens);
-    emit(0); // num_so_outputs
+    uint32_t* w = virgl_cmd_reserve(6 + num_tokens);
+    if (!w) return false;
 
-    // Emit ALL tokens verbatim — token[0] is already the correct TGSI header
-    for (uint32_t i = 0; i < num_tokens; i++)
-        emit(tokens[i]);
+    w[0] = VIRGL_CMD_HDR(VIRGL_CCMD_CREATE_OBJECT, VIRGL_OBJECT_SHADER, 5 + num_tokens);
+    w[1] = handle;
+    w[2] = shader_type;
+    w[3] = VIRGL_OBJ_SHADER_OFFSET_VAL_BYTES(num_tokens * 4u);  // byte length
+    w[4] = num_tokens;
+    w[5] = 0; // num_so_outputs
+
+    // ALL tokens verbatim — token[0] is already the correct TGSI header
+    copy_dwords(w + 6, tokens, num_tokens);
+    virgl_cmd_commit(6 + num_tokens);
 
     return virgl_cmd_submit();
 }
@@ -813,6 +853,26 @@ if  (!virgl_create_shader_text(handle, PIPE_SHADER_FRAGMENT, fs_dump, 16)) {
     return false;
 }
 
+/* Textured variant, swapped in by virgl_pipeline_tex_bind(): the second
+ * attribute is (u, v, shade, -), the texel is scaled by shade.  Optional —
+ * if the host rejects it GPU3D just has no textures. */
+static const char *fs_tex_dump =
+"FRAG\n"
+"PROPERTY FS_COLOR0_WRITES_ALL_CBUFS 1\n"
+"DCL IN[0], TEXCOORD[0], PERSPECTIVE\n"
+"DCL OUT[0], COLOR\n"
+"DCL SAMP[0]\n"
+"DCL SVIEW[0], 2D, FLOAT\n"
+"DCL TEMP[0]\n"
+"  0: TEX TEMP[0], IN[0], SAMP[0], 2D\n"
+"  1: MUL OUT[0].xyz, TEMP[0], IN[0].zzzz\n"
+"  2: MOV OUT[0].w, TEMP[0].wwww\n"
+"  3: END\n";
+
+handle = alloc_res_id();
+vctx->fs_tex_handle =
+    virgl_create_shader_text(handle, PIPE_SHADER_FRAGMENT, fs_tex_dump, 40) ? handle : 0;
+
 
 /*
 uint32_t vs_tokens = dwords(VS_BIN_LEN);  // 104/4 = 26
@@ -969,7 +1029,7 @@ if (!virgl_create_resource_3d(vctx.depth_res_id,
     /* ------------------------------------------------------------
      * 3) VBO (PIPE_BUFFER)
      * ------------------------------------------------------------ */
-    vctx.vbo_size   = 256 * 1024;
+    vctx.vbo_size   = 1024 * 1024;   /* Ring; holds a max-size GPU3D upload */
     vctx.vbo_res_id = alloc_res_id();
     //serial_printf("virgl: creating VBO resource %u\n", vctx.vbo_res_id);
 
@@ -1094,19 +1154,17 @@ void virgl_cmd_begin(void)
 
 void virgl_cmd_set_viewport(uint32_t w, uint32_t h)
 {
-    emit(VIRGL_CMD_HDR(VIRGL_CCMD_SET_VIEWPORT_STATE, 0, 7));
-    emit(0);
-    emit(f2u(w / 2.0f));
-    emit(f2u(-(h / 2.0f)));   // negative
-    emit(f2u(0.5f));
-    emit(f2u(w / 2.0f));
-    emit(f2u(h / 2.0f));
-    emit(f2u(0.5f));
-}
-
-static inline void emit_u64(uint64_t v) {
-    emit((uint32_t)(v & 0xFFFFFFFFu));
-    emit((uint32_t)(v >> 32));
+    uint32_t* c = virgl_cmd_reserve(8);
+    if (!c) return;
+    c[0] = VIRGL_CMD_HDR(VIRGL_CCMD_SET_VIEWPORT_STATE, 0, 7);
+    c[1] = 0;
+    c[2] = f2u(w / 2.0f);
+    c[3] = f2u(-(h / 2.0f));   // negative
+    c[4] = f2u(0.5f);
+    c[5] = f2u(w / 2.0f);
+    c[6] = f2u(h / 2.0f);
+    c[7] = f2u(0.5f);
+    virgl_cmd_commit(8);
 }
 
 static inline uint64_t d2u(double d) {
@@ -1121,14 +1179,19 @@ void virgl_cmd_clear(uint32_t buffers, float r, float g, float b, float a,
     /* NOTE: Just emits into the command buffer — caller is responsible for
      * virgl_cmd_begin() before and virgl_cmd_submit() after.
      * This allows batching clear + draw commands into a single submit. */
-    emit(VIRGL_CMD_HDR(VIRGL_CCMD_CLEAR, 0, 8));
-    emit(buffers);
-    emit(f2u(r));
-    emit(f2u(g));
-    emit(f2u(b));
-    emit(f2u(a));
-    emit_u64(d2u(depth));
-    emit(stencil);
+    uint32_t* w = virgl_cmd_reserve(9);
+    if (!w) return;
+    uint64_t z = d2u(depth);
+    w[0] = VIRGL_CMD_HDR(VIRGL_CCMD_CLEAR, 0, 8);
+    w[1] = buffers;
+    w[2] = f2u(r);
+    w[3] = f2u(g);
+    w[4] = f2u(b);
+    w[5] = f2u(a);
+    w[6] = (uint32_t)z;
+    w[7] = (uint32_t)(z >> 32);
+    w[8] = stencil;
+    virgl_cmd_commit(9);
 }
 
 
@@ -1152,6 +1215,28 @@ void virgl_cmd_set_viewport(float x, float y, float width, float height,
 
 
 
+/* Sub-allocate from the VBO ring, 32-byte aligned (one vertex) */
+static uint32_t vbo_ring_alloc(uint32_t size_bytes) {
+    uint32_t size = (size_bytes + 31) & ~31u;
+    if (size > vctx.vbo_size) size = vctx.vbo_size;
+
+    if (vctx.vbo_head + size > vctx.vbo_size) {
+        /*
+         * Wrap.  Draws still in the command buffer point at the old ring
+         * contents: submit them and let the host retire their fence
+         * (the submit waits for it) before anything is overwritten.
+         */
+        if (vctx.fence_done < vctx.vbo_fence) virgl_cmd_submit();
+        vctx.vbo_head = 0;
+    }
+
+    uint32_t off = vctx.vbo_head;
+    vctx.vbo_head += size;
+    /* Retired by the submit that will carry this upload */
+    vctx.vbo_fence = vctx.fence_next + 1;
+    return off;
+}
+
 uint32_t virgl_upload_vertices(const float* data, uint32_t num_floats) {
     /*
      * RESOURCE_INLINE_WRITE: upload data directly into a GPU resource.
@@ -1159,39 +1244,92 @@ uint32_t virgl_upload_vertices(const float* data, uint32_t num_floats) {
      *
      * Format: header + resource_id + level + usage + stride + layer_stride
      *       + x + y + z + w + h + d + data...
-     * That's 11 header words + data words.
+     * That's 12 words of command + data words.  Uploads larger than the
+     * command buffer go out as several writes, flushing in between.
      */
     uint32_t size_bytes = num_floats * sizeof(float);
-    uint32_t payload_words = 11 + (size_bytes + 3) / 4;  /* 11 header words + data */
-
-    emit(VIRGL_CMD_HDR(VIRGL_CCMD_RESOURCE_INLINE_WRITE, 0, payload_words));
-    emit(vctx.vbo_res_id);   /* resource */
-    emit(0);                  /* level */
-    emit(0);                  /* usage */
-    emit(0);                  /* stride (not used for buffer) */
-    emit(0);                  /* layer_stride */
-    emit(0);                  /* x */
-    emit(0);                  /* y */
-    emit(0);                  /* z */
-    emit(size_bytes);         /* w (width in bytes for buffers) */
-    emit(1);                  /* h */
-    emit(1);                  /* d */
-
-    /* Copy vertex data as uint32_t words */
+    if (size_bytes > vctx.vbo_size) {
+        size_bytes = vctx.vbo_size;
+        num_floats = size_bytes / sizeof(float);
+    }
+
+    /* Allocate first: a wrap may flush, which must happen before this
+     * command starts */
+    uint32_t off = vbo_ring_alloc(size_bytes);
+
+    uint32_t max_chunk = vctx.cmd_buf_size / 4 - 12;
     const uint32_t* u = (const uint32_t*)data;
-    for (uint32_t i = 0; i < num_floats; i++) {
-        emit(u[i]);
+    uint32_t done = 0;
+    while (done < num_floats) {
+        uint32_t n = num_floats - done;
+        if (n > max_chunk) n = max_chunk;
+
+        uint32_t* w = virgl_cmd_reserve(12 + n);
+        if (!w) break;
+        w[0]  = VIRGL_CMD_HDR(VIRGL_CCMD_RESOURCE_INLINE_WRITE, 0, 11 + n);
+        w[1]  = vctx.vbo_res_id;   /* resource */
+        w[2]  = 0;                  /* level */
+        w[3]  = 0;                  /* usage */
+        w[4]  = 0;                  /* stride (not used for buffer) */
+        w[5]  = 0;                  /* layer_stride */
+        w[6]  = off + done * 4;     /* x (byte offset into the ring) */
+        w[7]  = 0;                  /* y */
+        w[8]  = 0;                  /* z */
+        w[9]  = n * 4;              /* w (width in bytes for buffers) */
+        w[10] = 1;                  /* h */
+        w[11] = 1;                  /* d */
+        copy_dwords(w + 12, u + done, n);
+        virgl_cmd_commit(12 + n);
+        done += n;
     }
 
-    return 0;  /* offset = 0 (we always write at start for simplicity) */
+    return off;
+}
+
+/* One mip level of a texture, whole rows per INLINE_WRITE (as many writes
+ * as it takes to fit the command buffer).  Submitted before returning:
+ * texels go up once, outside any frame's batch. */
+bool virgl_upload_texture(uint32_t res_id, uint32_t level,
+                          uint32_t width, uint32_t height, const uint32_t* texels)
+{
+    uint32_t max_rows = (vctx.cmd_buf_size / 4 - 12) / width;
+    if (!max_rows) return false;
+
+    for (uint32_t y = 0; y < height; ) {
+        uint32_t rows = height - y;
+        if (rows > max_rows) rows = max_rows;
+        uint32_t n = rows * width;
+
+        uint32_t* w = virgl_cmd_reserve(12 + n);
+        if (!w) return false;
+        w[0]  = VIRGL_CMD_HDR(VIRGL_CCMD_RESOURCE_INLINE_WRITE, 0, 11 + n);
+        w[1]  = res_id;
+        w[2]  = level;
+        w[3]  = 0;            /* usage */
+        w[4]  = width * 4;    /* stride (bytes per row) */
+        w[5]  = 0;            /* layer_stride */
+        w[6]  = 0;            /* x */
+        w[7]  = y;            /* y */
+        w[8]  = 0;            /* z */
+        w[9]  = width;        /* w (texels) */
+        w[10] = rows;         /* h */
+        w[11] = 1;            /* d */
+        copy_dwords(w + 12, texels + y * width, n);
+        virgl_cmd_commit(12 + n);
+        y += rows;
+    }
+    return virgl_cmd_submit();
 }
 
 void virgl_cmd_set_vertex_buffer(uint32_t stride, uint32_t offset)
 {
-    emit(VIRGL_CMD_HDR(VIRGL_CCMD_SET_VERTEX_BUFFERS, 0, 3));
-    emit(stride);
-    emit(offset);
-    emit(vctx.vbo_res_id);
+    uint32_t* w = virgl_cmd_reserve(4);
+    if (!w) return;
+    w[0] = VIRGL_CMD_HDR(VIRGL_CCMD_SET_VERTEX_BUFFERS, 0, 3);
+    w[1] = stride;
+    w[2] = offset;
+    w[3] = vctx.vbo_res_id;
+    virgl_cmd_commit(4);
 }
 
 
@@ -1200,19 +1338,22 @@ void virgl_cmd_draw(uint32_t prim_mode, uint32_t start, uint32_t count) {
     /*
      * DRAW_VBO: header + 12 words
      */
-    emit(VIRGL_CMD_HDR(VIRGL_CCMD_DRAW_VBO, 0, 12));
-    emit(start);         /* start */
-    emit(count);         /* count */
-    emit(prim_mode);     /* mode: PIPE_PRIM_TRIANGLES etc. */
-    emit(0);             /* indexed = false */
-    emit(1);             /* instance_count (MUST be >= 1, 0 = draw nothing!) */
-    emit(0);             /* index_bias */
-    emit(0);             /* start_instance */
-    emit(0);             /* primitive_restart */
-    emit(0);             /* restart_index */
-    emit(0);             /* min_index */
-    emit(0xFFFFFFFF);    /* max_index */
-    emit(0);             /* cso (0 = use current) */
+    uint32_t* w = virgl_cmd_reserve(13);
+    if (!w) return;
+    w[0]  = VIRGL_CMD_HDR(VIRGL_CCMD_DRAW_VBO, 0, 12);
+    w[1]  = start;       /* start */
+    w[2]  = count;       /* count */
+    w[3]  = prim_mode;   /* mode: PIPE_PRIM_TRIANGLES etc. */
+    w[4]  = 0;           /* indexed = false */
+    w[5]  = 1;           /* instance_count (MUST be >= 1, 0 = draw nothing!) */
+    w[6]  = 0;           /* index_bias */
+    w[7]  = 0;           /* start_instance */
+    w[8]  = 0;           /* primitive_restart */
+    w[9]  = 0;           /* restart_index */
+    w[10] = 0;           /* min_index */
+    w[11] = 0xFFFFFFFF;  /* max_index */
+    w[12] = 0;           /* cso (0 = use current) */
+    virgl_cmd_commit(13);
 }
 
 void virgl_cmd_set_constant_buffer(uint32_t shader_type,
@@ -1221,13 +1362,13 @@ void virgl_cmd_set_constant_buffer(uint32_t shader_type,
      * SET_CONSTANT_BUFFER: header + shader_type + index + data...
      * Used to upload matrices (MVP) and uniforms.
      */
-    emit(VIRGL_CMD_HDR(VIRGL_CCMD_SET_CONSTANT_BUFFER, 0, 2 + num_floats));
-    emit(shader_type);  /* PIPE_SHADER_VERTEX or PIPE_SHADER_FRAGMENT */
-    emit(0);            /* index (constant buffer slot 0) */
-    const uint32_t* u = (const uint32_t*)data;
-    for (uint32_t i = 0; i < num_floats; i++) {
-        emit(u[i]);
-    }
+    uint32_t* w = virgl_cmd_reserve(3 + num_floats);
+    if (!w) return;
+    w[0] = VIRGL_CMD_HDR(VIRGL_CCMD_SET_CONSTANT_BUFFER, 0, 2 + num_floats);
+    w[1] = shader_type;  /* PIPE_SHADER_VERTEX or PIPE_SHADER_FRAGMENT */
+    w[2] = 0;            /* index (constant buffer slot 0) */
+    copy_dwords(w + 3, data, num_floats);
+    virgl_cmd_commit(3 + num_floats);
 }
 
 
@@ -22,9 +22,10 @@
  *     All on the CPU. Slow for large scenes.
  *
  *   NEW PATH (this file — GPU):
- *     glEnd() → pack vertices into buffer → build MVP matrix →
- *     virgl_cmd_draw() → submit to host GPU → done.
- *     Host GPU does the rasterization in hardware.
+ *     glEnd() → pack vertices into the next stretch of the VBO ring →
+ *     MVP (only if it changed) → virgl_cmd_draw() into the frame's
+ *     command buffer.  virgl_gl_swap() submits the whole frame in one
+ *     host round trip; the host GPU does the rasterization.
  *
  * HOW TO USE:
  *   1. Call virgl_gl_init() instead of glInit() when virgl is available
@@ -67,13 +68,14 @@ static void mat4_mul(mat4_t* out, const mat4_t* A, const mat4_t* B) {
 }
 
 /* ---- Packed vertex for GPU upload ---- */
-/* Each vertex sent to the GPU: position(3) + color(4) = 7 floats = 28 bytes */
+/* Matches the vertex elements made by virgl_setup_pipeline_state():
+ * position(4) + color(4) = 8 floats = 32 bytes */
 typedef struct {
-    float x, y, z;
+    float x, y, z, w;
     float r, g, b, a;
 } gpu_vertex_t;
 
-#define GPU_VERTEX_STRIDE sizeof(gpu_vertex_t)  /* 28 bytes */
+#define GPU_VERTEX_STRIDE sizeof(gpu_vertex_t)  /* 32 bytes */
 
 /* ---- GL Context (GPU-accelerated version) ---- */
 static struct {
@@ -105,6 +107,10 @@ static struct {
 
     /* Pipeline state created? */
     bool     pipeline_ready;
+
+    /* MVP last sent this frame (skip re-sending an unchanged matrix) */
+    mat4_t   sent_mvp;
+    bool     mvp_valid;
 } gctx;
 
 /* Forward declaration */
@@ -264,15 +270,13 @@ void virgl_glClearColor(float r, float g, float b, float a) {
 }
 
 void virgl_glClear(int mask) {
-    virgl_cmd_begin();
-
     uint32_t buffers = 0;
     if (mask & GL_COLOR_BUFFER_BIT) buffers |= 0x1;  /* PIPE_CLEAR_COLOR */
     if (mask & GL_DEPTH_BUFFER_BIT) buffers |= 0x2;  /* PIPE_CLEAR_DEPTH */
 
+    /* Batched with the frame's draws; submitted by virgl_gl_swap() */
     virgl_cmd_clear(buffers, gctx.clear_r, gctx.clear_g, gctx.clear_b,
                     gctx.clear_a, 1.0, 0);
-    virgl_cmd_submit();
 }
 
 void virgl_glEnable(int cap) {
@@ -311,7 +315,7 @@ void virgl_glVertex3f(float x, float y, float z) {
     if (gctx.batch_count >= MAX_BATCH_VERTS) return;
 
     gpu_vertex_t* v = &gctx.batch[gctx.batch_count++];
-    v->x = x; v->y = y; v->z = z;
+    v->x = x; v->y = y; v->z = z; v->w = 1.0f;
     v->r = gctx.cur_color[0];
     v->g = gctx.cur_color[1];
     v->b = gctx.cur_color[2];
@@ -338,39 +342,35 @@ void virgl_glEnd(void) {
         default:                pipe_prim = PIPE_PRIM_TRIANGLES; break;
     }
 
-    /* Build and submit the draw command buffer */
-    virgl_cmd_begin();
+    /* Appended to the frame's command buffer; virgl_gl_swap() submits.
+     * (The buffer flushes itself early if a frame outgrows it.) */
+    uint32_t vert_words = gctx.batch_count * (GPU_VERTEX_STRIDE / 4);
 
-    /* 1. Upload MVP matrix as constant buffer for vertex shader */
+    /* 1. MVP matrix as constant buffer for the vertex shader, if changed */
     mat4_t mvp;
     mat4_mul(&mvp, &gctx.projection, &gctx.modelview);
-    virgl_cmd_set_constant_buffer(PIPE_SHADER_VERTEX, mvp.m, 16);
-
-    /* 2. Set viewport */
-   // virgl_cmd_set_viewport((float)gctx.vp_x, (float)gctx.vp_y,
- //                          (float)gctx.vp_w, (float)gctx.vp_h,
-     //                      0.0f, 1.0f);
-
-    /* 3. Upload vertex data */
-    virgl_upload_vertices((const float*)gctx.batch,
-                          gctx.batch_count * (sizeof(gpu_vertex_t) / sizeof(float)));
+    if (!gctx.mvp_valid || memcmp(&mvp, &gctx.sent_mvp, sizeof(mvp)) != 0) {
+        virgl_cmd_set_constant_buffer(PIPE_SHADER_VERTEX, mvp.m, 16);
+        gctx.sent_mvp = mvp;
+        gctx.mvp_valid = true;
+    }
 
-    /* 4. Bind vertex buffer */
-    virgl_cmd_set_vertex_buffer(GPU_VERTEX_STRIDE, 0);
+    /* 2. Vertex data into the next free stretch of the VBO ring */
+    uint32_t offset = virgl_upload_vertices((const float*)gctx.batch, vert_words);
 
-    /* 5. Draw */
+    /* 3. Bind that stretch and draw from its start */
+    virgl_cmd_set_vertex_buffer(GPU_VERTEX_STRIDE, offset);
     virgl_cmd_draw(pipe_prim, 0, gctx.batch_count);
 
-    /* 6. Submit to GPU */
-    virgl_cmd_submit();
-
     gctx.batch_count = 0;
 }
 
 /* ===== Present / SwapBuffers ===== */
 
 void virgl_gl_swap(void) {
+    /* Submits the frame's batched clears and draws, then presents */
     virgl_present();
+    gctx.mvp_valid = false;
 }
 
 /* ===== Shutdown ===== */
@@ -5,6 +5,9 @@
 #include "vga.h"
 #include "serial.h"
 #include "heap.h"
+#include "timer.h"
+#include "task.h"
+#include "idt.h"
 
 /*
  * VirtIO Modern PCI Transport Implementation
@@ -27,6 +30,11 @@
 /* Track how much MMIO space we've mapped */
 static uint32_t mmio_next_vaddr = VIRTIO_MMIO_VBASE;
 
+/* Devices with interrupts enabled, chained per legacy IRQ line, and the
+ * handler that owned each line before us (lines are shared on PCI) */
+static virtio_dev_t* irq_devs[16];
+static isr_t         irq_prev[16];
+
 /* ===== MMIO Read/Write Helpers ===== */
 
 static inline uint8_t mmio_read8(volatile uint8_t* base, uint32_t off) {
@@ -180,6 +188,12 @@ case VIRTIO_PCI_CAP_NOTIFY:
     dev->notify_off_mul = pci_read(pci->bus, pci->slot, pci->func, cap_ptr + 16);
     serial_printf("notify OK at %p mul=%u\n", dev->notify_base, dev->notify_off_mul);
     found_notify = true;
+    break;
+
+case VIRTIO_PCI_CAP_ISR:
+    /* Optional: without it the device simply stays polled */
+    dev->isr_cfg = map_bar_region(pci, bar_idx, offset, length);
+    found_isr = (dev->isr_cfg != NULL);
     break;
             }
         }
@@ -274,6 +288,7 @@ bool virtio_init(virtio_dev_t* dev, uint16_t pci_device_id) {
     mmio_write32(dev->common_cfg, VIRTIO_COMMON_GF, accepted_lo);
     mmio_write32(dev->common_cfg, VIRTIO_COMMON_GFSELECT, 1);
     mmio_write32(dev->common_cfg, VIRTIO_COMMON_GF, accepted_hi);
+    dev->features_lo = accepted_lo;
 
     serial_printf("virtio: accepted features[0-31]=%08x  [32-63]=%08x\n",
                   accepted_lo, accepted_hi);
@@ -343,7 +358,7 @@ bool virtio_init_pci(virtio_dev_t* dev, pci_device_t* pci) {
     mmio_write8(dev->common_cfg, VIRTIO_COMMON_STATUS,
                 VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
 
-    /* 4. Negotiate features — only accept VERSION_1 */
+    /* 4. Negotiate features — VERSION_1 plus the transport ring features */
     mmio_write32(dev->common_cfg, VIRTIO_COMMON_DFSELECT, 0);
     uint32_t features_lo = mmio_read32(dev->common_cfg, VIRTIO_COMMON_DF);
     mmio_write32(dev->common_cfg, VIRTIO_COMMON_DFSELECT, 1);
@@ -351,10 +366,12 @@ bool virtio_init_pci(virtio_dev_t* dev, pci_device_t* pci) {
 
     serial_printf("virtio: features[lo]=%08x [hi]=%08x\n", features_lo, features_hi);
 
+    uint32_t accepted_lo = features_lo & WANTED_FEATURES_LO;
     mmio_write32(dev->common_cfg, VIRTIO_COMMON_GFSELECT, 0);
-    mmio_write32(dev->common_cfg, VIRTIO_COMMON_GF, 0);  /* No low features needed */
+    mmio_write32(dev->common_cfg, VIRTIO_COMMON_GF, accepted_lo);
     mmio_write32(dev->common_cfg, VIRTIO_COMMON_GFSELECT, 1);
     mmio_write32(dev->common_cfg, VIRTIO_COMMON_GF, features_hi & 1);  /* VERSION_1 */
+    dev->features_lo = accepted_lo;
 
     /* 5. Set FEATURES_OK */
     uint8_t s = mmio_read8(dev->common_cfg, VIRTIO_COMMON_STATUS);
@@ -477,6 +494,18 @@ bool virtio_setup_queue(virtio_dev_t* dev, uint16_t queue_idx) {
     vq->num_free = qsize;
     vq->last_used_idx = 0;
 
+    /* One indirect table per ring slot lets a multi-segment chain cost a
+     * single ring descriptor */
+    vq->indirect = NULL;
+    if (dev->features_lo & VIRTIO_F_INDIRECT_DESC) {
+        uint32_t tbl_bytes = (uint32_t)qsize * VIRTIO_MAX_SG * sizeof(virtq_desc_t);
+        uint8_t* tbl = (uint8_t*)kmalloc(tbl_bytes + 16);
+        if (tbl) {
+            vq->indirect = (virtq_desc_t*)(((uint32_t)tbl + 15) & ~15u);
+            memset(vq->indirect, 0, tbl_bytes);
+        }
+    }
+
     /* Tell the device where our queue structures are */
     mmio_write16(dev->common_cfg, VIRTIO_COMMON_QSELECT, queue_idx);
 
@@ -505,41 +534,73 @@ bool virtio_setup_queue(virtio_dev_t* dev, uint16_t queue_idx) {
     return true;
 }
 
-/* ===== Submit a Request (out buffer + in buffer) ===== */
-int virtio_send(virtio_dev_t* dev, uint16_t queue_idx,
-                uint32_t out_addr, uint32_t out_len,
-                uint32_t in_addr, uint32_t in_len) {
+/* ===== Submit a Scatter-Gather Chain ===== */
+static void fill_desc(virtq_desc_t* d, const virtio_sg_t* sg, uint16_t flags) {
+    d->addr  = (uint64_t)sg->addr;
+    d->len   = sg->len;
+    d->flags = flags;
+}
+
+int virtio_submit_sg(virtio_dev_t* dev, uint16_t queue_idx,
+                     const virtio_sg_t* out, uint16_t n_out,
+                     const virtio_sg_t* in, uint16_t n_in,
+                     virtio_req_t* req) {
     virtq_t* vq = &dev->queues[queue_idx];
+    uint16_t total = n_out + n_in;
+    if (total == 0 || total > VIRTIO_MAX_SG) return -1;
+
+    if (req) {
+        req->done = false;
+        req->len = 0;
+        req->waiter = 0;
+    }
+
+    bool use_indirect = vq->indirect && total > 1;
+    uint16_t needed = use_indirect ? 1 : total;
+
+    uint32_t flags = irq_save();
 
-    /* Need at least 2 descriptors (out + in), or 1 if in_len == 0 */
-    uint16_t needed = (in_len > 0) ? 2 : 1;
     if (vq->num_free < needed) {
+        irq_restore(flags);
         serial_printf("virtio: queue %u full (%u free, need %u)\n",
                       queue_idx, vq->num_free, needed);
         return -1;
     }
 
-    /* Allocate output descriptor */
     uint16_t head = vq->free_head;
-    uint16_t idx = head;
 
-    vq->desc[idx].addr  = (uint64_t)out_addr;
-    vq->desc[idx].len   = out_len;
-    vq->desc[idx].flags = (in_len > 0) ? VRING_DESC_F_NEXT : 0;
-
-    if (in_len > 0) {
-        uint16_t next_idx = vq->desc[idx].next;
-        vq->desc[next_idx].addr  = (uint64_t)in_addr;
-        vq->desc[next_idx].len   = in_len;
-        vq->desc[next_idx].flags = VRING_DESC_F_WRITE;  /* Device writes to this */
+    if (use_indirect) {
+        /* Whole chain lives in this slot's table; the ring sees one entry */
+        virtq_desc_t* tbl = &vq->indirect[(uint32_t)head * VIRTIO_MAX_SG];
+        for (uint16_t i = 0; i < total; i++) {
+            bool is_in = (i >= n_out);
+            fill_desc(&tbl[i], is_in ? &in[i - n_out] : &out[i],
+                      (uint16_t)((is_in ? VRING_DESC_F_WRITE : 0) |
+                                 (i + 1 < total ? VRING_DESC_F_NEXT : 0)));
+            tbl[i].next = i + 1;
+        }
+        vq->free_head = vq->desc[head].next;
+        vq->num_free--;
 
-        vq->free_head = vq->desc[next_idx].next;
-        vq->num_free -= 2;
+        vq->desc[head].addr  = (uint64_t)(uint32_t)tbl;
+        vq->desc[head].len   = total * sizeof(virtq_desc_t);
+        vq->desc[head].flags = VRING_DESC_F_INDIRECT;
     } else {
+        uint16_t idx = head;
+        for (uint16_t i = 0; i < total; i++) {
+            bool is_in = (i >= n_out);
+            fill_desc(&vq->desc[idx], is_in ? &in[i - n_out] : &out[i],
+                      (uint16_t)((is_in ? VRING_DESC_F_WRITE : 0) |
+                                 (i + 1 < total ? VRING_DESC_F_NEXT : 0)));
+            if (i + 1 < total) idx = vq->desc[idx].next;
+        }
         vq->free_head = vq->desc[idx].next;
-        vq->num_free -= 1;
+        vq->num_free -= total;
     }
 
+    vq->reqs[head] = req;
+    vq->submitted++;
+
     /* Add to available ring */
     uint16_t avail_idx = vq->avail->idx % vq->size;
     vq->avail->ring[avail_idx] = head;
@@ -549,18 +610,97 @@ int virtio_send(virtio_dev_t* dev, uint16_t queue_idx,
 
     vq->avail->idx++;
 
+    irq_restore(flags);
     return (int)head;
 }
 
-/* ===== Notify Device ===== */
+/* ===== Submit a Request (out buffer + in buffer) ===== */
+int virtio_send_req(virtio_dev_t* dev, uint16_t queue_idx,
+                    uint32_t out_addr, uint32_t out_len,
+                    uint32_t in_addr, uint32_t in_len,
+                    virtio_req_t* req) {
+    virtio_sg_t out = { out_addr, out_len };
+    virtio_sg_t in  = { in_addr, in_len };
+    return virtio_submit_sg(dev, queue_idx, &out, 1, &in, (in_len > 0) ? 1 : 0, req);
+}
+
+int virtio_send(virtio_dev_t* dev, uint16_t queue_idx,
+                uint32_t out_addr, uint32_t out_len,
+                uint32_t in_addr, uint32_t in_len) {
+    return virtio_send_req(dev, queue_idx, out_addr, out_len, in_addr, in_len, NULL);
+}
+
+/* ===== Event Index Helpers =====
+ * used_event sits after the avail ring, avail_event after the used ring */
+static inline volatile uint16_t* used_event(virtq_t* vq) {
+    return (volatile uint16_t*)((uint8_t*)vq->avail + 4 + 2 * vq->size);
+}
+
+static inline volatile uint16_t* avail_event(virtq_t* vq) {
+    return (volatile uint16_t*)((uint8_t*)vq->used + 4 + 8 * vq->size);
+}
+
+/* Spec 2.7.10: has new_idx stepped past event since old was published? */
+static inline bool vring_need_event(uint16_t event, uint16_t new_idx, uint16_t old) {
+    return (uint16_t)(new_idx - event - 1) < (uint16_t)(new_idx - old);
+}
+
+/* Where the device should next interrupt: normally the next completion;
+ * for batched request queues, once everything in flight has retired */
+static void arm_used_event(virtio_dev_t* dev, virtq_t* vq) {
+    if (!(dev->features_lo & VIRTIO_F_EVENT_IDX)) return;
+    uint16_t ev = vq->last_used_idx;
+    if (vq->batch_irq && vq->avail->idx != vq->last_used_idx)
+        ev = (uint16_t)(vq->avail->idx - 1);
+    *used_event(vq) = ev;
+}
+
+/* ===== Notify Device =====
+ * Each notify is an MMIO write (a VM exit under QEMU), so skip it when
+ * the device has said it will look at the ring anyway. */
 void virtio_notify(virtio_dev_t* dev, uint16_t queue_idx) {
     virtq_t* vq = &dev->queues[queue_idx];
+
+    uint32_t flags = irq_save();
+    arm_used_event(dev, vq);
+
+    /* Publish avail->idx before reading the device's suppression hint */
+    __asm__ volatile ("mfence" ::: "memory");
+
+    uint16_t new_idx = vq->avail->idx;
+    uint16_t old_idx = vq->kicked_idx;
+    vq->kicked_idx = new_idx;
+
+    bool kick;
+    if (dev->features_lo & VIRTIO_F_EVENT_IDX)
+        kick = vring_need_event(*avail_event(vq), new_idx, old_idx);
+    else
+        kick = !(vq->used->flags & VRING_USED_F_NO_NOTIFY);
+    irq_restore(flags);
+
+    if (!kick) {
+        vq->kicks_skipped++;
+        return;
+    }
+    vq->kicks++;
     uint32_t offset = vq->notify_offset * dev->notify_off_mul;
     mmio_write16(dev->notify_base, offset, queue_idx);
 }
 
-/* ===== Poll for Completion ===== */
-bool virtio_poll(virtio_dev_t* dev, uint16_t queue_idx) {
+void virtio_set_batch_irq(virtio_dev_t* dev, uint16_t queue_idx, bool batch) {
+    dev->queues[queue_idx].batch_irq = batch;
+}
+
+/* Make a sleeping task runnable again (completion side) */
+static void wake_waiter(uint32_t waiter) {
+    if (!waiter) return;
+    task_t* t = task_get_by_pid(waiter - 1);
+    if (t && t->state == TASK_SLEEPING) t->state = TASK_READY;
+}
+
+/* Retire every used chain: free its descriptors, complete its request,
+ * run the driver hook.  Caller has interrupts disabled. */
+static bool drain_queue(virtio_dev_t* dev, uint16_t queue_idx) {
     virtq_t* vq = &dev->queues[queue_idx];
 
     /* Memory barrier to see device's writes */
@@ -569,13 +709,13 @@ bool virtio_poll(virtio_dev_t* dev, uint16_t queue_idx) {
     if (vq->last_used_idx == vq->used->idx)
         return false;
 
-    /* Process used entries and free descriptors */
     while (vq->last_used_idx != vq->used->idx) {
         uint16_t used_slot = vq->last_used_idx % vq->size;
-        uint32_t desc_head = vq->used->ring[used_slot].id;
+        uint16_t head = (uint16_t)vq->used->ring[used_slot].id;
+        uint32_t len  = vq->used->ring[used_slot].len;
 
         /* Walk the descriptor chain and free all descriptors */
-        uint16_t di = (uint16_t)desc_head;
+        uint16_t di = head;
         while (1) {
             uint16_t next = vq->desc[di].next;
             bool has_next = vq->desc[di].flags & VRING_DESC_F_NEXT;
@@ -590,29 +730,147 @@ bool virtio_poll(virtio_dev_t* dev, uint16_t queue_idx) {
         }
 
         vq->last_used_idx++;
+        vq->completions++;
+
+        virtio_req_t* req = vq->reqs[head];
+        vq->reqs[head] = NULL;
+        if (req) {
+            req->len = len;
+            req->done = true;
+            wake_waiter(req->waiter);
+            if (req->callback) req->callback(req);
+        }
+        if (vq->on_used) vq->on_used(dev, queue_idx, head, len);
     }
 
+    /* With EVENT_IDX the device only interrupts once used->idx passes
+     * used_event: re-arm it for what is still in flight */
+    arm_used_event(dev, vq);
+
+    uint32_t waiter = vq->waiter;
+    vq->waiter = 0;
+    wake_waiter(waiter);
     return true;
 }
 
-/* ===== Wait for Completion (Busy Poll) ===== */
-// src/virtio.c (or wherever virtio_wait is)
+/* ===== Poll for Completion ===== */
+bool virtio_poll(virtio_dev_t* dev, uint16_t queue_idx) {
+    uint32_t flags = irq_save();
+    bool any = drain_queue(dev, queue_idx);
+    irq_restore(flags);
+    return any;
+}
+
+/* ===== Interrupt Handling ===== */
+static void virtio_irq_handler(registers_t* regs) {
+    uint8_t line = (uint8_t)(regs->int_no - 32);
+
+    for (virtio_dev_t* dev = irq_devs[line]; dev; dev = dev->irq_next) {
+        /* Reading the ISR acknowledges it; 0 means the line is not ours */
+        uint8_t isr = mmio_read8(dev->isr_cfg, 0);
+        if (!isr) continue;
+        dev->irq_count++;
+        if (isr & 1) {
+            for (uint16_t q = 0; q < dev->num_queues && q < 4; q++)
+                if (dev->queues[q].size) drain_queue(dev, q);
+        }
+    }
+
+    /* Someone else may share the line */
+    if (irq_prev[line]) irq_prev[line](regs);
+}
 
-void virtio_wait(virtio_dev_t* dev, uint16_t queue_idx) {
+bool virtio_enable_irq(virtio_dev_t* dev) {
+    if (dev->irq_enabled) return true;
+    if (!dev->isr_cfg || dev->irq == 0 || dev->irq >= 16) {
+        serial_printf("virtio: no usable IRQ (isr=%p line=%u), staying polled\n",
+                      dev->isr_cfg, dev->irq);
+        return false;
+    }
+
+    uint32_t flags = irq_save();
+    if (!irq_devs[dev->irq]) {
+        isr_t cur = get_interrupt_handler(32 + dev->irq);
+        if (cur != virtio_irq_handler) irq_prev[dev->irq] = cur;
+        register_interrupt_handler(32 + dev->irq, virtio_irq_handler);
+    }
+    dev->irq_next = irq_devs[dev->irq];
+    irq_devs[dev->irq] = dev;
+    dev->irq_enabled = true;
+    irq_restore(flags);
+
+    irq_unmask(dev->irq);
+    if (dev->irq >= 8) irq_unmask(2);   /* Cascade */
+
+    serial_printf("virtio: IRQ %u enabled\n", dev->irq);
+    return true;
+}
+
+void virtio_set_used_handler(virtio_dev_t* dev, uint16_t queue_idx, virtq_used_fn fn) {
+    uint32_t flags = irq_save();
+    dev->queues[queue_idx].on_used = fn;
+    irq_restore(flags);
+}
+
+/*
+ * Sleep until 'cond' holds.  With interrupts enabled the task sleeps and
+ * the completion IRQ wakes it immediately; the one-tick wake deadline
+ * only matters if an interrupt is lost.  Without them this degrades to
+ * the old yield-and-poll loop.
+ */
+static bool wait_for(virtio_dev_t* dev, uint16_t queue_idx,
+                     virtio_req_t* req, uint32_t target) {
+    virtq_t* vq = &dev->queues[queue_idx];
     uint32_t start_ticks = timer_get_ticks();
-    
-    // Wait for up to 50 ticks (500ms)
-    while (!virtio_poll(dev, queue_idx)) {
-        if (timer_get_ticks() - start_ticks > 50) {
-            serial_printf("virtio: TIMEOUT waiting on queue %u after 500ms\n", queue_idx);
-            return;
+
+    while (1) {
+        uint32_t snap = vq->completions;
+        virtio_poll(dev, queue_idx);
+        if (req ? req->done : ((int32_t)(vq->completions - target) >= 0)) return true;
+
+        if (timer_get_ticks() - start_ticks > VIRTIO_WAIT_TICKS)
+            return false;
+
+        task_t* self = task_get_current();
+        if (dev->irq_enabled && self) {
+            uint32_t flags = irq_save();
+            /* Only sleep if nothing completed since we last looked */
+            if (vq->completions == snap) {
+                if (req) req->waiter = self->id + 1;
+                else     vq->waiter = self->id + 1;
+                self->state = TASK_SLEEPING;
+                self->wake_tick = timer_get_ticks() + 1;
+            }
+            irq_restore(flags);
         }
-        
+
         // Let other tasks (like the GUI!) run while the GPU is busy
-        task_yield(); 
+        task_yield();
     }
 }
 
+/* ===== Wait for Completion ===== */
+void virtio_wait(virtio_dev_t* dev, uint16_t queue_idx) {
+    if (!wait_for(dev, queue_idx, NULL, dev->queues[queue_idx].submitted))
+        serial_printf("virtio: TIMEOUT waiting on queue %u after 500ms\n", queue_idx);
+}
+
+bool virtio_wait_req(virtio_dev_t* dev, uint16_t queue_idx, virtio_req_t* req) {
+    if (wait_for(dev, queue_idx, req, 0)) return true;
+
+    /* Detach so a late completion cannot write into a dead stack frame */
+    virtq_t* vq = &dev->queues[queue_idx];
+    uint32_t flags = irq_save();
+    for (uint16_t i = 0; i < vq->size; i++)
+        if (vq->reqs[i] == req) vq->reqs[i] = NULL;
+    bool done = req->done;
+    irq_restore(flags);
+
+    if (!done)
+        serial_printf("virtio: TIMEOUT waiting on queue %u after 500ms\n", queue_idx);
+    return done;
+}
+
 /* ===== Read ISR Status ===== */
 uint8_t virtio_isr_status(virtio_dev_t* dev) {
     if (!dev->isr_cfg) return 0;
@@ -678,6 +936,7 @@ bool virtio_init_features(virtio_dev_t* dev, uint16_t pci_device_id,
     mmio_write32(dev->common_cfg, VIRTIO_COMMON_GF, accepted_lo);
     mmio_write32(dev->common_cfg, VIRTIO_COMMON_GFSELECT, 1);
     mmio_write32(dev->common_cfg, VIRTIO_COMMON_GF, accepted_hi);
+    dev->features_lo = accepted_lo;
 
     serial_printf("virtio: accepted features[0-31]=%08x  [32-63]=%08x\n",
                   accepted_lo, accepted_hi);
@@ -6,6 +6,8 @@
 #include "vga.h"
 #include "serial.h"
 #include "heap.h"
+#include "task.h"
+#include "timer.h"
 #include <stdint.h>
 
 extern uint16_t virtq_alloc_desc_chain(virtq_t* vq, uint16_t count);
@@ -39,56 +41,99 @@ static uint16_t  gpu_width = 0;
 static uint16_t  gpu_height = 0;
 static uint32_t  gpu_resource_id = 1;       /* Resource ID counter */
 static uint32_t  gpu_active_resource = 0;   /* Currently active resource */
+static virtio_gpu_stats_t gpu_stats;
 #define EINVAL      22   /* Invalid argument */
 #define EAGAIN      11   /* Resource temporarily unavailable */
 #define ETIMEDOUT   110  /* Connection timed out */
 #define ENOMEM      12   /* Out of memory */
 
 /*
- * Command buffer: we use a statically allocated region for building
- * GPU commands. Each command is sent as an output descriptor, and
- * the response comes back through an input descriptor.
- *
- * We use page-aligned memory so addresses are clean for the device.
+ * Control commands are staged in driver-owned DMA slots, never handed to
+ * the device on the caller's stack: a request that times out can still
+ * be completed (and its response written) by the device later.  Such a
+ * slot is abandoned rather than freed, and only returns to the pool when
+ * the queue's used hook sees its chain head come back.
  */
 #define CMD_BUF_SIZE  4096
-static uint8_t cmd_buf[CMD_BUF_SIZE] __attribute__((aligned(4096)));
-static uint8_t resp_buf[CMD_BUF_SIZE] __attribute__((aligned(4096)));
-
-/* ===== Send a GPU Command and Wait for Response ===== */
-static bool gpu_cmd(void* cmd, uint32_t cmd_len, void* resp, uint32_t resp_len) {
-    /* Copy command to the aligned command buffer */
-    memcpy(cmd_buf, cmd, cmd_len);
-
-    /* Clear response buffer */
-    memset(resp_buf, 0, resp_len);
-
-    /* Submit to control queue */
-    int head = virtio_send(&gpu_dev, VIRTIO_GPU_QUEUE_CONTROL,
-                           (uint32_t)cmd_buf, cmd_len,
-                           (uint32_t)resp_buf, resp_len);
-    if (head < 0) {
-        serial_printf("virtio-gpu: failed to submit command\n");
-        return false;
+#define GPU_CMD_SLOTS 4
+
+typedef struct {
+    uint8_t          cmd[CMD_BUF_SIZE];
+    uint8_t          resp[CMD_BUF_SIZE];
+    virtio_req_t     req;
+    volatile int32_t head;          /* Chain head while the device owns it, else -1 */
+    volatile bool    busy;
+    volatile bool    abandoned;     /* Timed out: freed by the used hook */
+} gpu_cmd_slot_t;
+
+static gpu_cmd_slot_t cmd_slots[GPU_CMD_SLOTS] __attribute__((aligned(4096)));
+
+/* Flush slots (see "Asynchronous flushes" below) follow the same rule */
+typedef struct {
+    virtio_gpu_transfer_to_host_2d_t xfer;
+    virtio_gpu_resource_flush_t      flush;
+    virtio_gpu_ctrl_hdr_t            resp[2];
+    virtio_req_t                     req[2];
+    volatile int32_t                 head[2];   /* As in gpu_cmd_slot_t */
+    volatile bool                    busy;
+    volatile bool                    abandoned;
+} gpu_flush_slot_t;
+
+static gpu_flush_slot_t flush_slots[GPU_FLUSH_SLOTS];
+
+/* Control queue used hook (IRQ context or under irq_save) */
+static void ctrl_used(virtio_dev_t* dev, uint16_t queue_idx, uint16_t head, uint32_t len) {
+    (void)dev; (void)queue_idx; (void)len;
+    for (int i = 0; i < GPU_CMD_SLOTS; i++) {
+        gpu_cmd_slot_t* cs = &cmd_slots[i];
+        if (!cs->busy || cs->head != (int32_t)head) continue;
+        cs->head = -1;
+        if (cs->abandoned) {
+            cs->abandoned = false;
+            cs->busy = false;
+        }
     }
+    for (int i = 0; i < GPU_FLUSH_SLOTS; i++) {
+        gpu_flush_slot_t* fs = &flush_slots[i];
+        if (!fs->busy) continue;
+        for (int k = 0; k < 2; k++)
+            if (fs->head[k] == (int32_t)head) fs->head[k] = -1;
+        if (fs->abandoned && fs->head[0] < 0 && fs->head[1] < 0) {
+            fs->abandoned = false;
+            fs->busy = false;
+        }
+    }
+}
 
-    /* Notify device */
-    virtio_notify(&gpu_dev, VIRTIO_GPU_QUEUE_CONTROL);
-
-    /* Wait for response */
-    virtio_wait(&gpu_dev, VIRTIO_GPU_QUEUE_CONTROL);
-
-    /* Copy response back */
-    memcpy(resp, resp_buf, resp_len);
-
-    /* Check response type */
-    virtio_gpu_ctrl_hdr_t* hdr = (virtio_gpu_ctrl_hdr_t*)resp;
-    if (hdr->type >= VIRTIO_GPU_RESP_ERR_UNSPEC) {
-        serial_printf("virtio-gpu: command error, type=%x\n", hdr->type);
-        return false;
+/* Claim a free slot, waiting out the transport timeout if all are in use */
+static gpu_cmd_slot_t* cmd_slot_get(void) {
+    uint32_t start = timer_get_ticks();
+    for (;;) {
+        uint32_t flags = irq_save();
+        for (int i = 0; i < GPU_CMD_SLOTS; i++) {
+            if (!cmd_slots[i].busy) {
+                cmd_slots[i].busy = true;
+                cmd_slots[i].head = -1;
+                irq_restore(flags);
+                return &cmd_slots[i];
+            }
+        }
+        irq_restore(flags);
+        if (timer_get_ticks() - start > VIRTIO_WAIT_TICKS) return NULL;
+        task_yield();
     }
+}
 
-    return true;
+static void cmd_slot_put(gpu_cmd_slot_t* cs, bool timed_out) {
+    uint32_t flags = irq_save();
+    if (timed_out && cs->head >= 0) cs->abandoned = true;
+    else cs->busy = false;
+    irq_restore(flags);
+}
+
+/* ===== Send a GPU Command and Wait for Response ===== */
+static bool gpu_cmd(void* cmd, uint32_t cmd_len, void* resp, uint32_t resp_len) {
+    return virtio_gpu_send_cmd_2iov(cmd, cmd_len, NULL, 0, resp, resp_len);
 }
 
 /* Simpler version for commands that only return a basic OK header */
@@ -326,6 +371,12 @@ bool virtio_gpu_init(void) {
         virtio_setup_queue(&gpu_dev, VIRTIO_GPU_QUEUE_CURSOR);
     }
 
+    /* Complete commands from the device interrupt (falls back to polling);
+     * one interrupt per submitted batch is enough */
+    virtio_set_batch_irq(&gpu_dev, VIRTIO_GPU_QUEUE_CONTROL, true);
+    virtio_set_used_handler(&gpu_dev, VIRTIO_GPU_QUEUE_CONTROL, ctrl_used);
+    virtio_enable_irq(&gpu_dev);
+
     /* Tell device we're ready */
     virtio_driver_ok(&gpu_dev);
 
@@ -370,64 +421,55 @@ bool virtio_gpu_send_cmd_2iov(const void *hdr, uint32_t hdr_len,
 {
     if (!hdr || hdr_len == 0) return false;
 
-    uint32_t total = hdr_len + data_len;
-
-    /* We must submit header+payload as ONE virtio-gpu control request.
-       Your transport only supports one OUT buffer, so we pack. */
-
-    uint8_t *out = NULL;
-
-    if (total <= CMD_BUF_SIZE) {
-        out = cmd_buf; /* use the aligned static buffer */
-    } else {
-        /* Fallback: allocate a temporary contiguous buffer.
-           Assumes kmalloc memory is DMA-visible/identity-mapped in your kernel. */
-        out = (uint8_t*)kmalloc(total);
-        if (!out) {
-            serial_printf("virtio-gpu: send_cmd_2iov ENOMEM total=%u\n", total);
-            return false;
-        }
+    if (hdr_len > CMD_BUF_SIZE || resp_len > CMD_BUF_SIZE) {
+        serial_printf("virtio-gpu: command too big (%u/%u)\n", hdr_len, resp_len);
+        return false;
     }
 
-    /* Build contiguous request */
-    memcpy(out, hdr, hdr_len);
-    if (data_len) memcpy(out + hdr_len, data, data_len);
-
-    /* Prepare response */
-    if (resp_len > CMD_BUF_SIZE) {
-        serial_printf("virtio-gpu: resp too big (%u)\n", resp_len);
-        if (out != cmd_buf) kfree(out);
+    gpu_cmd_slot_t* cs = cmd_slot_get();
+    if (!cs) {
+        serial_printf("virtio-gpu: no free command slot\n");
         return false;
     }
-    memset(resp_buf, 0, resp_len);
-
-    /* Submit to control queue */
-    int head = virtio_send(&gpu_dev, VIRTIO_GPU_QUEUE_CONTROL,
-                           (uint32_t)out, total,
-                           (uint32_t)resp_buf, resp_len);
+    memcpy(cs->cmd, hdr, hdr_len);
+    memset(cs->resp, 0, resp_len);
+    memset(&cs->req, 0, sizeof(cs->req));
+
+    /* Header and payload go out as two segments of one request */
+    virtio_sg_t out[2] = {
+        { (uint32_t)cs->cmd, hdr_len  },
+        { (uint32_t)data,    data_len },
+    };
+    virtio_sg_t in = { (uint32_t)cs->resp, resp_len };
+    uint32_t flags = irq_save();
+    int head = virtio_submit_sg(&gpu_dev, VIRTIO_GPU_QUEUE_CONTROL,
+                                out, (data && data_len) ? 2 : 1,
+                                &in, resp_len ? 1 : 0, &cs->req);
+    cs->head = head;
+    irq_restore(flags);
     if (head < 0) {
-        serial_printf("virtio-gpu: failed to submit 2iov cmd\n");
-        if (out != cmd_buf) kfree(out);
+        serial_printf("virtio-gpu: failed to submit command\n");
+        cmd_slot_put(cs, false);
         return false;
     }
 
     virtio_notify(&gpu_dev, VIRTIO_GPU_QUEUE_CONTROL);
-    virtio_wait(&gpu_dev, VIRTIO_GPU_QUEUE_CONTROL);
-
-    /* Copy response back */
-    if (resp && resp_len) {
-        memcpy(resp, resp_buf, resp_len);
+    if (!virtio_wait_req(&gpu_dev, VIRTIO_GPU_QUEUE_CONTROL, &cs->req)) {
+        cmd_slot_put(cs, true);
+        return false;
+    }
 
-        virtio_gpu_ctrl_hdr_t *rh = (virtio_gpu_ctrl_hdr_t*)resp;
+    bool ok = true;
+    if (resp_len >= sizeof(virtio_gpu_ctrl_hdr_t)) {
+        virtio_gpu_ctrl_hdr_t *rh = (virtio_gpu_ctrl_hdr_t*)cs->resp;
         if (rh->type >= VIRTIO_GPU_RESP_ERR_UNSPEC) {
             serial_printf("virtio-gpu: command error, type=%x\n", rh->type);
-            if (out != cmd_buf) kfree(out);
-            return false;
+            ok = false;
         }
     }
-
-    if (out != cmd_buf) kfree(out);
-    return true;
+    if (resp) memcpy(resp, cs->resp, resp_len);
+    cmd_slot_put(cs, false);
+    return ok;
 }
 
 
@@ -510,17 +552,175 @@ uint16_t virtio_gpu_get_height(void) {
     return gpu_height;
 }
 
-void virtio_gpu_flush(uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
-    if (!gpu_active_resource || !gpu_framebuffer) return;
+/*
+ * Asynchronous flushes.
+ *
+ * Each damaged rectangle becomes a TRANSFER_TO_HOST_2D + RESOURCE_FLUSH
+ * pair living in a flush slot until the device retires it; a whole damage
+ * list goes out with one notify and nobody waits.  Only the transfer reads
+ * guest memory, so a writer about to touch a region waits for overlapping
+ * transfers alone (virtio_gpu_wait_rect) — drawing of the next frame
+ * overlaps the host's copy of the previous one.
+ */
+static int flush_victim;
+
+/* Wait for both halves of a slot (bounded by the transport timeout).
+ * Returns true if the slot is free again; a half that timed out may
+ * still be read or written by the device, so the slot is abandoned
+ * instead and the used hook frees it once both halves come back. */
+static bool slot_retire(gpu_flush_slot_t* fs) {
+    bool ok = true;
+    for (int i = 0; i < 2; i++) {
+        if (!fs->req[i].done &&
+            !virtio_wait_req(&gpu_dev, VIRTIO_GPU_QUEUE_CONTROL, &fs->req[i])) {
+            ok = false;
+            continue;
+        }
+        if (fs->resp[i].type >= VIRTIO_GPU_RESP_ERR_UNSPEC)
+            serial_printf("virtio-gpu: flush error, type=%x\n", fs->resp[i].type);
+    }
+    uint32_t flags = irq_save();
+    if (ok || (fs->head[0] < 0 && fs->head[1] < 0)) fs->busy = false;
+    else fs->abandoned = true;
+    irq_restore(flags);
+    return !fs->busy;
+}
+
+/* A free slot, or NULL if every slot stays abandoned for the transport
+ * timeout */
+static gpu_flush_slot_t* slot_get(void) {
+    uint32_t start = timer_get_ticks();
+    for (;;) {
+        for (int i = 0; i < GPU_FLUSH_SLOTS; i++) {
+            gpu_flush_slot_t* fs = &flush_slots[i];
+            if (fs->busy && !fs->abandoned && fs->req[0].done && fs->req[1].done)
+                slot_retire(fs);
+            if (!fs->busy) return fs;
+        }
+        /* All in flight: slots are handed out round-robin once full, and
+         * the control queue is FIFO, so the next victim is the oldest
+         * submission */
+        for (int n = 0; n < GPU_FLUSH_SLOTS; n++) {
+            gpu_flush_slot_t* fs = &flush_slots[flush_victim];
+            flush_victim = (flush_victim + 1) % GPU_FLUSH_SLOTS;
+            if (!fs->abandoned && slot_retire(fs)) return fs;
+        }
+        if (timer_get_ticks() - start > VIRTIO_WAIT_TICKS) return NULL;
+        virtio_poll(&gpu_dev, VIRTIO_GPU_QUEUE_CONTROL);
+        task_yield();
+    }
+}
 
-    /* Clamp to screen bounds */
-    if (x >= gpu_width || y >= gpu_height) return;
-    if (x + w > gpu_width)  w = gpu_width - x;
-    if (y + h > gpu_height) h = gpu_height - y;
+/* Queue one half of a slot.  A full ring is kicked and drained once
+ * before giving up, so a long damage list is throttled rather than
+ * truncated. */
+static bool flush_submit(gpu_flush_slot_t* fs, int k,
+                         const virtio_sg_t* out, const virtio_sg_t* in) {
+    for (int attempt = 0; ; attempt++) {
+        uint32_t flags = irq_save();
+        int head = virtio_submit_sg(&gpu_dev, VIRTIO_GPU_QUEUE_CONTROL,
+                                    out, 1, in, 1, &fs->req[k]);
+        fs->head[k] = head;
+        irq_restore(flags);
+        if (head >= 0) return true;
+        if (attempt) return false;
+        virtio_notify(&gpu_dev, VIRTIO_GPU_QUEUE_CONTROL);
+        virtio_wait(&gpu_dev, VIRTIO_GPU_QUEUE_CONTROL);
+    }
+}
 
-    /* Transfer guest memory -> host resource, then flush to display */
-    gpu_transfer(gpu_active_resource, x, y, w, h);
-    gpu_flush_resource(gpu_active_resource, x, y, w, h);
+static bool rect_overlaps(const virtio_gpu_rect_t* r, uint32_t x, uint32_t y,
+                          uint32_t w, uint32_t h) {
+    return r->x < x + w && x < r->x + r->width &&
+           r->y < y + h && y < r->y + r->height;
+}
+
+int virtio_gpu_flush_rects(const virtio_gpu_rect_t* rects, uint32_t count) {
+    if (!gpu_active_resource || !gpu_framebuffer) return 0;
+
+    int queued = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t x = rects[i].x, y = rects[i].y;
+        uint32_t w = rects[i].width, h = rects[i].height;
+
+        /* Clamp to screen bounds */
+        if (x >= gpu_width || y >= gpu_height || !w || !h) continue;
+        if (x + w > gpu_width)  w = gpu_width - x;
+        if (y + h > gpu_height) h = gpu_height - y;
+
+        gpu_flush_slot_t* fs = slot_get();
+        if (!fs) {
+            serial_printf("virtio-gpu: no free flush slot, %u rects dropped\n", count - i);
+            break;
+        }
+        memset(fs, 0, sizeof(*fs));
+        fs->head[0] = fs->head[1] = -1;
+        fs->busy = true;
+
+        fs->xfer.hdr.type = VIRTIO_GPU_CMD_TRANSFER_TO_HOST_2D;
+        fs->xfer.r.x = x;
+        fs->xfer.r.y = y;
+        fs->xfer.r.width = w;
+        fs->xfer.r.height = h;
+        fs->xfer.offset = ((uint64_t)y * gpu_width + x) * 4;
+        fs->xfer.resource_id = gpu_active_resource;
+
+        fs->flush.hdr.type = VIRTIO_GPU_CMD_RESOURCE_FLUSH;
+        fs->flush.r = fs->xfer.r;
+        fs->flush.resource_id = gpu_active_resource;
+
+        /* The control queue is processed in order, so each flush sees
+         * its transfer's pixels */
+        virtio_sg_t out[2] = { { (uint32_t)&fs->xfer,  sizeof(fs->xfer)  },
+                               { (uint32_t)&fs->flush, sizeof(fs->flush) } };
+        virtio_sg_t in[2]  = { { (uint32_t)&fs->resp[0], sizeof(fs->resp[0]) },
+                               { (uint32_t)&fs->resp[1], sizeof(fs->resp[1]) } };
+        int ok = 0;
+        for (int k = 0; k < 2; k++) {
+            if (!flush_submit(fs, k, &out[k], &in[k])) break;
+            ok++;
+        }
+        if (ok == 0) fs->busy = false;
+        if (ok == 1) fs->req[1].done = true;    /* Flush never went out */
+        if (ok) queued++;
+        if (ok < 2) {
+            serial_printf("virtio-gpu: control queue stuck, %u rects dropped\n", count - i);
+            break;
+        }
+    }
+
+    if (queued) virtio_notify(&gpu_dev, VIRTIO_GPU_QUEUE_CONTROL);
+    gpu_stats.flush_rects += queued;
+    return queued;
+}
+
+void virtio_gpu_count_submit(uint32_t bytes) {
+    gpu_stats.submits++;
+    gpu_stats.submit_bytes += bytes;
+}
+
+void virtio_gpu_get_stats(virtio_gpu_stats_t* st) {
+    *st = gpu_stats;
+}
+
+void virtio_gpu_wait_rect(uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+    for (int i = 0; i < GPU_FLUSH_SLOTS; i++) {
+        gpu_flush_slot_t* fs = &flush_slots[i];
+        if (!fs->busy || fs->abandoned || fs->req[0].done) continue;
+        if (rect_overlaps(&fs->xfer.r, x, y, w, h))
+            virtio_wait_req(&gpu_dev, VIRTIO_GPU_QUEUE_CONTROL, &fs->req[0]);
+    }
+}
+
+void virtio_gpu_wait_idle(void) {
+    for (int i = 0; i < GPU_FLUSH_SLOTS; i++)
+        if (flush_slots[i].busy && !flush_slots[i].abandoned) slot_retire(&flush_slots[i]);
+}
+
+void virtio_gpu_flush(uint32_t x, uint32_t y, uint32_t w, uint32_t h) {
+    virtio_gpu_rect_t r = { x, y, w, h };
+    if (virtio_gpu_flush_rects(&r, 1))
+        virtio_gpu_wait_idle();
 }
 
 void virtio_gpu_flush_all(void) {
@@ -530,6 +730,8 @@ void virtio_gpu_flush_all(void) {
 void virtio_gpu_disable(void) {
     if (!gpu_initialized) return;
 
+    virtio_gpu_wait_idle();
+
     if (gpu_active_resource) {
         gpu_set_scanout(0, 0, 0, 0);
         gpu_destroy_resource(gpu_active_resource);
@@ -602,9 +804,11 @@ int virgl_submit_command(const void* buf, uint32_t num_dwords) {
     // Ensure CPU memory writes are visible to the GPU
     __asm__ volatile ("mfence" ::: "memory");
 
-    int ret = virtio_send(&gpu_dev, 0, (uint32_t)buf, num_dwords * 4, 0, 0);
+    virtio_req_t req = {0};
+    int ret = virtio_send_req(&gpu_dev, 0, (uint32_t)buf, num_dwords * 4, 0, 0, &req);
     if (ret < 0) return ret;
 
-    virtio_wait(&gpu_dev, 0);
+    virtio_notify(&gpu_dev, 0);
+    if (!virtio_wait_req(&gpu_dev, 0, &req)) return -ETIMEDOUT;
     return 0;
 }
\ No newline at end of file
@@ -5,6 +5,8 @@
 #include "pmm.h"
 #include "serial.h"
 #include "heap.h"
+#include "mouse.h"
+#include "input.h"
 
 /*
  * VirtIO Input Driver
@@ -16,6 +18,10 @@
  *   Queue 0 (eventq): device writes input events to pre-posted buffers
  *   Queue 1 (statusq): driver writes status (LEDs etc.) — not used
  *
+ * Events are handled from the device interrupt: each SYN_REPORT turns
+ * the accumulated axes and buttons into one mouse_report_*() call, which
+ * feeds the shared input ring.
+ *
  * QEMU may expose MULTIPLE virtio-input PCI devices (keyboard, tablet)
  * all with the same PCI device ID 0x1052. We scan all of them and pick
  * the one that supports absolute positioning (the tablet).
@@ -42,18 +48,14 @@ static uint32_t abs_x_max = 32767;
 static uint32_t abs_y_max = 32767;
 
 /* Current state */
-static volatile int vi_x = 0, vi_y = 0;
+static volatile int vi_x = 0, vi_y = 0;      /* Last absolute position */
 static volatile int vi_max_x = 1919, vi_max_y = 1079;
 static volatile uint8_t vi_buttons = 0;
-static volatile uint8_t vi_prev_buttons = 0;
 
-/* Pending absolute values (before SYN_REPORT) */
+/* Pending values (before SYN_REPORT) */
 static uint32_t pending_abs_x = 0, pending_abs_y = 0;
 static bool has_pending_x = false, has_pending_y = false;
-
-/* Debug counters */
-static uint32_t total_events = 0;
-static uint32_t debug_timer = 0;
+static int pending_rel_x = 0, pending_rel_y = 0;
 
 /* ===== Post a single receive buffer to the eventq ===== */
 static void post_event_buf(int buf_idx) {
@@ -209,15 +211,8 @@ static void process_event(virtio_input_event_t* ev) {
             break;
 
         case EV_REL:
-            if (ev->code == REL_X) {
-                vi_x += (int32_t)ev->value;
-                if (vi_x < 0) vi_x = 0;
-                if (vi_x > vi_max_x) vi_x = vi_max_x;
-            } else if (ev->code == REL_Y) {
-                vi_y += (int32_t)ev->value;
-                if (vi_y < 0) vi_y = 0;
-                if (vi_y > vi_max_y) vi_y = vi_max_y;
-            }
+            if (ev->code == REL_X)      pending_rel_x += (int32_t)ev->value;
+            else if (ev->code == REL_Y) pending_rel_y += (int32_t)ev->value;
             break;
 
         case EV_KEY:
@@ -250,13 +245,37 @@ static void process_event(virtio_input_event_t* ev) {
                     if (ay > abs_y_max) ay = abs_y_max;
                     vi_y = (int)((ay * (uint32_t)vi_max_y) / abs_y_max);
                 }
+                if (has_pending_x || has_pending_y)
+                    mouse_report_abs(INPUT_SRC_VIRTIO, vi_x, vi_y, vi_buttons);
+                else
+                    mouse_report_rel(INPUT_SRC_VIRTIO, pending_rel_x,
+                                     pending_rel_y, vi_buttons);
                 has_pending_x = false;
                 has_pending_y = false;
+                pending_rel_x = pending_rel_y = 0;
             }
             break;
     }
 }
 
+/* ===== Used-buffer hook: runs from the device IRQ (or a poll) =====
+ * Consume the event and hand the same buffer straight back. */
+static void eventq_used(virtio_dev_t* dev, uint16_t queue_idx,
+                        uint16_t head, uint32_t len) {
+    (void)len;
+    virtq_t* vq = &dev->queues[queue_idx];
+    virtio_input_event_t* ev = (virtio_input_event_t*)(uint32_t)vq->desc[head].addr;
+
+    process_event(ev);
+
+    int buf_idx = ((uint32_t)ev - (uint32_t)event_bufs) / sizeof(virtio_input_event_t);
+    if (buf_idx >= 0 && buf_idx < NUM_EVENT_BUFS) {
+        memset(ev, 0, sizeof(*ev));
+        post_event_buf(buf_idx);
+        virtio_notify(dev, queue_idx);
+    }
+}
+
 /* ===== Public API ===== */
 
 bool virtio_input_available(void) {
@@ -329,6 +348,11 @@ bool virtio_input_init(void) {
     /* Pre-fill event queue with receive buffers */
     prefill_eventq();
 
+    /* Events are consumed as they arrive; virtio_input_poll() remains
+     * as a fallback for a device without a usable interrupt */
+    virtio_set_used_handler(&input_dev, EVENTQ, eventq_used);
+    virtio_enable_irq(&input_dev);
+
     /* Set initial position to center */
     vi_x = vi_max_x / 2;
     vi_y = vi_max_y / 2;
@@ -340,74 +364,13 @@ bool virtio_input_init(void) {
 }
 
 void virtio_input_poll(void) {
-    if (!input_initialized) return;
-
-    virtq_t* vq = &input_dev.queues[EVENTQ];
-
-    /* Memory barrier to see device's writes */
-    __asm__ volatile ("mfence" ::: "memory");
-
-    /* Save previous button state */
-    vi_prev_buttons = vi_buttons;
-
-    /* Process all completed event buffers */
-    int processed = 0;
-    while (vq->last_used_idx != vq->used->idx) {
-        uint16_t used_slot = vq->last_used_idx % vq->size;
-        uint32_t desc_idx = vq->used->ring[used_slot].id;
-
-        virtio_input_event_t* ev = (virtio_input_event_t*)(uint32_t)vq->desc[desc_idx].addr;
-
-        process_event(ev);
-        total_events++;
-        processed++;
-
-        /* Free descriptor */
-        vq->desc[desc_idx].next = vq->free_head;
-        vq->free_head = desc_idx;
-        vq->num_free++;
-        vq->last_used_idx++;
-
-        /* Re-post this buffer */
-        int buf_idx = ((uint32_t)ev - (uint32_t)event_bufs) / sizeof(virtio_input_event_t);
-        if (buf_idx >= 0 && buf_idx < NUM_EVENT_BUFS) {
-            memset(ev, 0, sizeof(*ev));
-            post_event_buf(buf_idx);
-        }
-    }
-
-    if (processed > 0) {
-        virtio_notify(&input_dev, EVENTQ);
-    }
-
-    /* Periodic debug — logs every ~500 poll cycles */
-    debug_timer++;
-    if (debug_timer >= 500) {
-        debug_timer = 0;
-        serial_printf("vi: xy=%d,%d btn=%x tot=%u used=%u avail=%u\n",
-                      vi_x, vi_y, vi_buttons, total_events,
-                      vq->used->idx, vq->avail->idx);
-    }
-}
-
-int  virtio_input_get_x(void) { return vi_x; }
-int  virtio_input_get_y(void) { return vi_y; }
-
-bool virtio_input_left_held(void)  { return (vi_buttons & 0x01) != 0; }
-bool virtio_input_right_held(void) { return (vi_buttons & 0x02) != 0; }
-
-bool virtio_input_left_click(void) {
-    return (vi_buttons & 0x01) && !(vi_prev_buttons & 0x01);
-}
-bool virtio_input_right_click(void) {
-    return (vi_buttons & 0x02) && !(vi_prev_buttons & 0x02);
+    if (!input_initialized || input_dev.irq_enabled) return;
+    virtio_poll(&input_dev, EVENTQ);
 }
 
 void virtio_input_set_bounds(int max_x, int max_y) {
     vi_max_x = max_x;
     vi_max_y = max_y;
-    if (vi_x > vi_max_x) vi_x = vi_max_x;
-    if (vi_y > vi_max_y) vi_y = vi_max_y;
     serial_printf("virtio-input: bounds set to %d x %d\n", max_x, max_y);
 }
 
@@ -0,0 +1,134 @@
+#!/usr/bin/env bash
+#
+# Headless benchmark run: boot the kernel in QEMU with no display, type a
+# command script into the shell over the serial console, collect the
+# BENCH lines the kernel writes to COM1 and compare medians against a
+# stored baseline.
+#
+# Usage: tools/qemu-bench.sh <kernel> [initrd]
+#
+# Environment:
+#   BENCH_SCRIPT    shell commands to send     (default tools/bench.cmds)
+#   BENCH_BASELINE  baseline results           (default tools/bench-baseline.txt)
+#   BENCH_TOL       allowed slowdown, percent  (default 25)
+#   BENCH_TIMEOUT   whole run, seconds         (default 300)
+#   BENCH_UPDATE=1  overwrite the baseline with this run
+#   BENCH_LOG       full serial log            (default build/bench-serial.log)
+#   QEMU            emulator binary            (default qemu-system-i386)
+#
+# Exit status: 0 pass, 1 regression or failed benchmark, 2 run error.
+
+set -u
+
+KERNEL=${1:?usage: $0 <kernel> [initrd]}
+INITRD=${2:-}
+HERE=$(cd "$(dirname "$0")" && pwd)
+
+SCRIPT=${BENCH_SCRIPT:-$HERE/bench.cmds}
+BASELINE=${BENCH_BASELINE:-$HERE/bench-baseline.txt}
+TOL=${BENCH_TOL:-25}
+TIMEOUT=${BENCH_TIMEOUT:-300}
+LOG=${BENCH_LOG:-build/bench-serial.log}
+QEMU=${QEMU:-qemu-system-i386}
+
+RESULTS=$(mktemp)
+trap 'rm -f "$RESULTS"' EXIT
+mkdir -p "$(dirname "$LOG")"
+: > "$LOG"
+
+# Each 'bench' command ends with exactly one BENCH_END line
+expected=$(grep -c '^[[:space:]]*bench\b' "$SCRIPT")
+if [ "$expected" -eq 0 ]; then
+    echo "qemu-bench: $SCRIPT runs no 'bench' command" >&2
+    exit 2
+fi
+
+qemu_args=(-kernel "$KERNEL" -m 2G -display none -serial stdio
+           -monitor none -no-reboot)
+[ -n "$INITRD" ] && qemu_args+=(-initrd "$INITRD")
+[ -n "${BENCH_DISK:-}" ] && qemu_args+=(-hda "$BENCH_DISK")
+
+coproc QEMU_PROC { exec "$QEMU" "${qemu_args[@]}" 2>&1; }
+qemu_pid=$QEMU_PROC_PID
+
+deadline=$((SECONDS + TIMEOUT))
+booted=0
+ended=0
+
+while [ $SECONDS -lt $deadline ]; do
+    if ! IFS= read -r -t 5 line <&"${QEMU_PROC[0]}"; then
+        kill -0 "$qemu_pid" 2>/dev/null || break
+        continue
+    fi
+    line=${line%$'\r'}
+    printf '%s\n' "$line" >> "$LOG"
+
+    case "$line" in
+    "Boot complete."*)
+        booted=1
+        # Let the shell reach its prompt, then type the script
+        sleep 1
+        while IFS= read -r cmd || [ -n "$cmd" ]; do
+            case "$cmd" in ''|'#'*) continue ;; esac
+            printf '%s\r' "$cmd" >&"${QEMU_PROC[1]}"
+        done < "$SCRIPT"
+        ;;
+    "BENCH "*)
+        printf '%s\n' "$line" >> "$RESULTS"
+        ;;
+    BENCH_END*)
+        ended=$((ended + 1))
+        [ $ended -ge "$expected" ] && break
+        ;;
+    esac
+done
+
+kill "$qemu_pid" 2>/dev/null
+wait "$qemu_pid" 2>/dev/null
+
+if [ $booted -eq 0 ]; then
+    echo "qemu-bench: kernel did not finish booting (see $LOG)" >&2
+    exit 2
+fi
+if [ $ended -lt "$expected" ]; then
+    echo "qemu-bench: timed out after ${TIMEOUT}s, $ended/$expected runs done (see $LOG)" >&2
+    exit 2
+fi
+
+status=0
+grep -q ' failed' "$RESULTS" && status=1
+
+if [ "${BENCH_UPDATE:-0}" = 1 ] || [ ! -f "$BASELINE" ]; then
+    grep -v -e ' skipped' -e ' failed' "$RESULTS" > "$BASELINE"
+    echo "qemu-bench: baseline written to $BASELINE"
+    cat "$RESULTS"
+    exit $status
+fi
+
+# Compare per-op medians; a benchmark missing from either side is listed
+# but does not fail the run
+awk -v tol="$TOL" '
+    function field(line, key,    n, i, kv) {
+        n = split(line, kv, " ")
+        for (i = 3; i <= n; i++)
+            if (index(kv[i], key "=") == 1) return substr(kv[i], length(key) + 2)
+        return ""
+    }
+    NR == FNR { if ($0 ~ / med=/) base[$2] = field($0, "med"); next }
+    / skipped/ { printf "  %-10s skipped\n", $2; next }
+    / failed/  { printf "  %-10s FAILED\n", $2; bad = 1; next }
+    {
+        med = field($0, "med")
+        if (!($2 in base)) { printf "  %-10s %12s cyc  (new)\n", $2, med; next }
+        b = base[$2]
+        pct = b > 0 ? (med - b) * 100.0 / b : 0
+        verdict = pct > tol ? "REGRESSION" : "ok"
+        if (pct > tol) bad = 1
+        printf "  %-10s %12s cyc  base %12s  %+7.1f%%  %s\n", $2, med, b, pct, verdict
+    }
+    END { exit bad }
+' "$BASELINE" "$RESULTS" || status=1
+
+[ $status -eq 0 ] && echo "qemu-bench: PASS (tolerance ${TOL}%)" \
+                  || echo "qemu-bench: FAIL (tolerance ${TOL}%)"
+exit $status